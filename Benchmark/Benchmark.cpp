@@ -0,0 +1,94 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <format>
+#include <fstream>
+
+BenchmarkRunner::BenchmarkRunner(std::string_view          filter,
+                                 std::chrono::milliseconds minSampleTime,
+                                 uint32_t                  sampleCount) noexcept
+    : filter(filter),
+      minSampleTime(minSampleTime),
+      sampleCount(std::max<uint32_t>(sampleCount, 1)),
+      results() {}
+
+BenchmarkRunner::~BenchmarkRunner() noexcept {}
+
+auto BenchmarkRunner::WriteJSON(std::string_view path, std::string_view label) const noexcept
+    -> std::error_code {
+    std::ofstream file{std::string(path), std::ios::trunc};
+    if (!file.is_open())
+        return std::make_error_code(std::errc::permission_denied);
+
+#ifdef NDEBUG
+    constexpr const std::string_view configuration = "Release";
+#else
+    constexpr const std::string_view configuration = "Debug";
+#endif
+
+    std::string text;
+    std::format_to(std::back_inserter(text),
+                   R"({{"label": "{}", "configuration": "{}", "benchmarks": [)",
+                   label,
+                   configuration);
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &result = results[i];
+        std::format_to(std::back_inserter(text),
+                       R"({}{{"name": "{}", "iterations": {}, "samples": {}, "median_ns": {:.3f}, )"
+                       R"("min_ns": {:.3f}, "max_ns": {:.3f}, "bytes_per_second": {:.0f}, )"
+                       R"("items_per_second": {:.0f}}})",
+                       i == 0 ? "\n" : ",\n",
+                       result.name,
+                       result.iterations,
+                       result.samples,
+                       result.median,
+                       result.min,
+                       result.max,
+                       result.bytesPerSecond,
+                       result.itemsPerSecond);
+    }
+
+    text.append("\n]}\n");
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!file)
+        return std::make_error_code(std::errc::io_error);
+
+    return std::error_code();
+}
+
+auto BenchmarkRunner::AddResult(std::string_view     name,
+                                uint64_t             iterations,
+                                uint64_t             bytesPerIteration,
+                                uint64_t             itemsPerIteration,
+                                std::vector<double> &samples) noexcept -> void {
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult result{};
+    result.name       = name;
+    result.iterations = iterations;
+    result.samples    = static_cast<uint32_t>(samples.size());
+    result.median     = samples[samples.size() / 2];
+    result.min        = samples.front();
+    result.max        = samples.back();
+
+    if (result.median > 0) {
+        result.bytesPerSecond = static_cast<double>(bytesPerIteration) * 1e9 / result.median;
+        result.itemsPerSecond = static_cast<double>(itemsPerIteration) * 1e9 / result.median;
+    }
+
+    std::string line = std::format("{:<52} {:>14.1f} ns {:>14.1f} ns {:>14.1f} ns",
+                                   result.name,
+                                   result.median,
+                                   result.min,
+                                   result.max);
+    if (result.bytesPerSecond > 0)
+        std::format_to(std::back_inserter(line), " {:>10.1f} MB/s", result.bytesPerSecond / 1e6);
+    if (result.itemsPerSecond > 0)
+        std::format_to(std::back_inserter(line), " {:>12.0f} items/s", result.itemsPerSecond);
+
+    line.push_back('\n');
+    std::fputs(line.c_str(), stdout);
+
+    results.push_back(std::move(result));
+}
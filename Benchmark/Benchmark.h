@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#ifdef _MSC_VER
+#    include <intrin.h>
+#endif
+
+/// @brief
+///   Prevent the compiler from optimizing away computation of @p value.
+///
+/// @tparam T       Type of the value.
+/// @param  value   The value that must be computed.
+template <typename T>
+inline auto DoNotOptimize(const T &value) noexcept -> void {
+#ifdef _MSC_VER
+    const volatile void *volatile sink = &value;
+    (void)sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+/// @brief
+///   Emit every frame that is due on a fixed schedule. Producers call this after each wake up
+///   since sleep granularity may exceed the period.
+///
+/// @tparam Function    Type of the callable that emits one frame.
+/// @param  next        Due time of the next frame. Advanced by @p period per emitted frame.
+/// @param  period      Frame period.
+/// @param  emit        The callable that emits one frame.
+template <typename Function>
+inline auto EmitDueFrames(std::chrono::steady_clock::time_point &next,
+                          std::chrono::steady_clock::duration    period,
+                          Function                             &&emit) -> void {
+    while (std::chrono::steady_clock::now() >= next) {
+        emit();
+        next += period;
+    }
+}
+
+/// @brief
+///   Get the specified percentile of latencies. @p latencies is partially reordered.
+///
+/// @param latencies    The latencies. Return 0 if empty.
+/// @param quantile     The quantile in [0, 1].
+inline auto Percentile(std::vector<double> &latencies, double quantile) noexcept -> double {
+    if (latencies.empty())
+        return 0;
+
+    const size_t index =
+        std::min(static_cast<size_t>(quantile * latencies.size()), latencies.size() - 1);
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies[index];
+}
+
+struct BenchmarkResult {
+    /// @brief
+    ///   Name of the benchmark.
+    std::string name;
+
+    /// @brief
+    ///   Number of iterations of each sample.
+    uint64_t iterations;
+
+    /// @brief
+    ///   Number of samples.
+    uint32_t samples;
+
+    /// @brief
+    ///   Median time of one iteration in nanoseconds.
+    double median;
+
+    /// @brief
+    ///   Fastest time of one iteration in nanoseconds.
+    double min;
+
+    /// @brief
+    ///   Slowest time of one iteration in nanoseconds.
+    double max;
+
+    /// @brief
+    ///   Throughput in bytes per second based on median time. 0 if bytes are not counted.
+    double bytesPerSecond;
+
+    /// @brief
+    ///   Throughput in items per second based on median time. 0 if items are not counted.
+    double itemsPerSecond;
+};
+
+/// @brief
+///   Runs benchmarks and collects their results. Each benchmark is calibrated so that a sample
+///   takes at least the minimum sample time, then the median of all samples is reported.
+class BenchmarkRunner {
+public:
+    /// @brief
+    ///   Create a benchmark runner.
+    ///
+    /// @param filter           Only benchmarks whose name contains this string are run.
+    /// @param minSampleTime    Minimum time of a sample.
+    /// @param sampleCount      Number of samples of each benchmark.
+    BenchmarkRunner(std::string_view          filter,
+                    std::chrono::milliseconds minSampleTime,
+                    uint32_t                  sampleCount) noexcept;
+
+    /// @brief
+    ///   Destroy this benchmark runner.
+    ~BenchmarkRunner() noexcept;
+
+    /// @brief
+    ///   Run a benchmark.
+    ///
+    /// @tparam Function            Type of the benchmark body.
+    /// @param  name                Name of the benchmark.
+    /// @param  bytesPerIteration   Bytes processed by one iteration. 0 if not applicable.
+    /// @param  itemsPerIteration   Items processed by one iteration. 0 if not applicable.
+    /// @param  function            The benchmark body that runs one iteration.
+    template <typename Function>
+    auto Run(std::string_view name,
+             uint64_t         bytesPerIteration,
+             uint64_t         itemsPerIteration,
+             Function       &&function) -> void {
+        if (!filter.empty() && name.find(filter) == std::string_view::npos)
+            return;
+
+        // Warm up and find an iteration count that fills a sample.
+        uint64_t iterations = 1;
+        for (;;) {
+            const std::chrono::nanoseconds elapsed = Measure(function, iterations);
+            if (elapsed >= minSampleTime || iterations >= MaxIterations)
+                break;
+            iterations *= (elapsed * 10 < minSampleTime) ? 10 : 2;
+        }
+
+        std::vector<double> samples;
+        samples.reserve(sampleCount);
+        for (uint32_t i = 0; i < sampleCount; ++i) {
+            const std::chrono::nanoseconds elapsed = Measure(function, iterations);
+            samples.push_back(static_cast<double>(elapsed.count()) /
+                              static_cast<double>(iterations));
+        }
+
+        AddResult(name, iterations, bytesPerIteration, itemsPerIteration, samples);
+    }
+
+    /// @brief
+    ///   Get results of all benchmarks that have run.
+    auto GetResults() const noexcept -> const std::vector<BenchmarkResult> & {
+        return results;
+    }
+
+    /// @brief
+    ///   Write results to the specified file in JSON format.
+    ///
+    /// @param path     Path to the result file.
+    /// @param label    Label of this run, such as commit hash. Used to compare results.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the write result.
+    auto WriteJSON(std::string_view path, std::string_view label) const noexcept
+        -> std::error_code;
+
+private:
+    /// @brief
+    ///   Run the benchmark body for the specified times.
+    template <typename Function>
+    static auto Measure(Function &function, uint64_t iterations) -> std::chrono::nanoseconds {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            function();
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    /// @brief
+    ///   Compute statistics of the samples, print and keep the result.
+    auto AddResult(std::string_view     name,
+                   uint64_t             iterations,
+                   uint64_t             bytesPerIteration,
+                   uint64_t             itemsPerIteration,
+                   std::vector<double> &samples) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Upper limit of iterations of a sample.
+    static constexpr const uint64_t MaxIterations = uint64_t(1) << 30;
+
+    /// @brief
+    ///   Only benchmarks whose name contains this string are run.
+    std::string filter;
+
+    /// @brief
+    ///   Minimum time of a sample.
+    std::chrono::nanoseconds minSampleTime;
+
+    /// @brief
+    ///   Number of samples of each benchmark.
+    uint32_t sampleCount;
+
+    /// @brief
+    ///   Results of benchmarks that have run.
+    std::vector<BenchmarkResult> results;
+};
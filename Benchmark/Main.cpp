@@ -0,0 +1,1092 @@
+#include "Benchmark.h"
+#include "IWR1443/Clustering.h"
+#include "IWR1443/FrameGenerator.h"
+#include "IWR1443/PointCloud.h"
+#include "IWR1443/Tracker.h"
+
+// Serial, IO and log benchmarks depend on Win32. Other builds only run the processing kernels.
+#ifdef _WIN32
+#    include "IOContext.h"
+#    include "IWR1443/Fusion.h"
+#    include "IWR1443/Serials.h"
+#    include "Log.h"
+#    include "Scale.h"
+#    include "Soak.h"
+#endif
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+using namespace iwr1443;
+
+// Number of frames of each tracking scenario. Targets return to their start after this many frames,
+// so the scenario loops without breaking tracks.
+static constexpr const size_t TRACKING_FRAME_COUNT = 300;
+
+// Frame period of tracking scenarios. 30 frames per second.
+static constexpr const std::chrono::microseconds TRACKING_FRAME_PERIOD(33333);
+
+// Largest point count that transform kernels are checked against scalar with. Covers every tail
+// length of 4 and 8 wide vectors a few times over.
+static constexpr const size_t TRANSFORM_CHECK_COUNT = 35;
+
+// Number of frames of the crossing targets check. Two targets walk 6 m towards each other at
+// 1.5 m/s and meet halfway.
+static constexpr const size_t CROSSING_FRAME_COUNT = 120;
+
+// Largest difference to scalar relative to the magnitude of a coordinate. AVX2 uses fused
+// multiply-add, so it is not bitwise equal to scalar.
+static constexpr const float TRANSFORM_TOLERANCE = 1e-5f;
+
+#ifdef _WIN32
+
+// Number of frames in each corpus.
+static constexpr const size_t CORPUS_FRAME_COUNT = 64;
+
+// Number of completions dispatched in each IOContext iteration.
+static constexpr const uint32_t DISPATCH_BATCH = 1000;
+
+// Capacity of the soak input queue. Larger than the serial driver queue so that big frames fit.
+static constexpr const size_t SOAK_QUEUE_CAPACITY = 64 * 1024;
+
+// Maximum bytes of each soak read. Matches the data serial read buffer.
+static constexpr const size_t SOAK_READ_SIZE = 4096;
+
+// Frame periods of the two devices of the fusion check, 30 and 20 frames per second, and the
+// number of frames added in total.
+static constexpr const std::chrono::microseconds FUSION_CHECK_PERIODS[] = {
+    std::chrono::microseconds(33333), std::chrono::microseconds(50000)};
+static constexpr const size_t FUSION_CHECK_FRAME_COUNT = 200;
+
+struct FrameCorpus {
+    /// @brief
+    ///   Name of the corpus.
+    std::string name;
+
+    /// @brief
+    ///   Frames back to back, as received from the data port.
+    std::vector<std::byte> stream;
+
+    /// @brief
+    ///   Offset of each frame in the stream.
+    std::vector<size_t> offsets;
+};
+
+/// @brief
+///   Log writer that drops all data.
+class NullLogWriter final : public LogWriter {
+public:
+    /// @brief
+    ///   Create a null log writer.
+    ///
+    /// @param buffered     Whether this writer claims to buffer data by itself.
+    explicit NullLogWriter(bool buffered) noexcept : buffered(buffered) {}
+
+    auto Write(const void *data, size_t size) -> void override {
+        DoNotOptimize(data);
+        DoNotOptimize(size);
+    }
+
+    auto IsBuffered() const noexcept -> bool override {
+        return buffered;
+    }
+
+private:
+    /// @brief
+    ///   Whether this writer claims to buffer data by itself.
+    bool buffered;
+};
+
+/// @brief
+///   Connection that counts completions and stops the IOContext after a batch.
+class CountingConnection final : public IAsync {
+public:
+    /// @brief
+    ///   Create a counting connection for the specified IOContext.
+    explicit CountingConnection(IOContext &context) noexcept : context(context), remaining(0) {}
+
+    auto OnRegister() noexcept -> void override {}
+
+    auto OnIOComplete(DWORD bytesTransferred, OVERLAPPED *overlapped) noexcept -> void override {
+        DoNotOptimize(bytesTransferred);
+        DoNotOptimize(overlapped);
+        if (--remaining == 0)
+            context.Quit(1);
+    }
+
+    auto GetHandle() const noexcept -> HANDLE override {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    /// @brief
+    ///   Set number of completions before the IOContext is stopped.
+    auto Expect(uint32_t count) noexcept -> void {
+        remaining = count;
+    }
+
+private:
+    /// @brief
+    ///   The IOContext to be stopped.
+    IOContext &context;
+
+    /// @brief
+    ///   Number of completions before the IOContext is stopped.
+    uint32_t remaining;
+};
+
+static auto MakeCorpus(std::string_view name, const FrameGeneratorConfig &config) -> FrameCorpus {
+    FrameCorpus    corpus{std::string(name), {}, {}};
+    FrameGenerator generator(config);
+
+    for (size_t i = 0; i < CORPUS_FRAME_COUNT; ++i) {
+        corpus.offsets.push_back(corpus.stream.size());
+        generator.GenerateFrame(corpus.stream);
+    }
+
+    return corpus;
+}
+
+static auto MakeCorpora() -> std::vector<FrameCorpus> {
+    std::vector<FrameCorpus> corpora;
+
+    FrameGeneratorConfig small = FrameGenerator::DefaultConfig();
+    small.tlvs                 = {TLVType::DetectedPoints, TLVType::Statistics};
+    small.pointCount           = 8;
+    corpora.push_back(MakeCorpus("small", small));
+
+    corpora.push_back(MakeCorpus("medium", FrameGenerator::DefaultConfig()));
+
+    FrameGeneratorConfig large = FrameGenerator::DefaultConfig();
+    large.pointCount           = 512;
+    large.targetCount          = 16;
+    large.rangeBins            = 256;
+    large.dopplerBins          = 32;
+    corpora.push_back(MakeCorpus("large", large));
+
+    return corpora;
+}
+
+static auto BenchmarkLocateFrameHeader(BenchmarkRunner &runner, const FrameCorpus &corpus)
+    -> void {
+    const std::byte *begin = corpus.stream.data();
+    const size_t     size  = corpus.stream.size();
+
+    runner.Run(std::format("LocateFrameHeader/{}", corpus.name),
+               size,
+               corpus.offsets.size(),
+               [begin, size]() -> void {
+                   // Skip the current magic word so that every search scans a whole frame.
+                   size_t offset = sizeof(uint64_t);
+                   while (const void *found = LocateFrameHeader(begin + offset, size - offset)) {
+                       offset = static_cast<size_t>(static_cast<const std::byte *>(found) - begin) +
+                                sizeof(uint64_t);
+                   }
+                   DoNotOptimize(offset);
+               });
+}
+
+static auto BenchmarkOnRead(BenchmarkRunner &runner, const FrameCorpus &corpus, size_t chunkSize)
+    -> void {
+    DataSerial serial;
+    uint64_t   serializedBytes = 0;
+    serial.SetPersistantWriter([&serializedBytes](const void *, size_t size) -> void {
+        serializedBytes += size;
+    });
+
+    runner.Run(std::format("DataSerial::OnRead/{}/chunk={}", corpus.name, chunkSize),
+               corpus.stream.size(),
+               corpus.offsets.size(),
+               [&]() -> void {
+                   for (size_t offset = 0; offset < corpus.stream.size(); offset += chunkSize) {
+                       const size_t size = std::min(chunkSize, corpus.stream.size() - offset);
+                       serial.OnRead(corpus.stream.data() + offset, size);
+                   }
+               });
+
+    DoNotOptimize(serializedBytes);
+}
+
+static auto BenchmarkHandleFrame(BenchmarkRunner &runner, const FrameCorpus &corpus) -> void {
+    DataSerial serial;
+    uint64_t   serializedBytes = 0;
+    serial.SetPersistantWriter([&serializedBytes](const void *, size_t size) -> void {
+        serializedBytes += size;
+    });
+
+    // HandleFrame may rewrite points in place.
+    std::vector<std::byte> stream = corpus.stream;
+
+    runner.Run(std::format("DataSerial::HandleFrame/{}", corpus.name),
+               stream.size(),
+               corpus.offsets.size(),
+               [&]() -> void {
+                   for (size_t offset : corpus.offsets) {
+                       FrameTimestamps timestamps{};
+                       serial.HandleFrame(
+                           stream.data() + offset, stream.size() - offset, timestamps);
+                   }
+               });
+
+    DoNotOptimize(serializedBytes);
+}
+
+#endif
+
+template <typename T>
+static auto BenchmarkFormatter(BenchmarkRunner &runner, std::string_view name, const T &value)
+    -> void {
+    std::string text;
+    runner.Run(std::format("std::formatter<{}>", name), 0, 1, [&]() -> void {
+        text.clear();
+        std::format_to(std::back_inserter(text), "{}", value);
+        DoNotOptimize(text.data());
+    });
+}
+
+static auto BenchmarkFormatters(BenchmarkRunner &runner) -> void {
+    const FrameHeader frameHeader{
+        {0x0102, 0x0304, 0x0506, 0x0708}, 0x02010004, 1504, 0x000A1443, 12345, 678901234, 32, 15};
+
+    Q9Real q9Real{};
+    q9Real.sign     = 0;
+    q9Real.integer  = 57;
+    q9Real.fraction = 13;
+
+    TemperatureStatistics temperature{};
+    temperature.time       = 123456;
+    temperature.tmpRx0Sens = 46;
+    temperature.tmpTx0Sens = 48;
+    temperature.tmpPmSens  = 47;
+
+    Tracked3DTarget target{};
+    target.trackID               = 3;
+    target.position.x            = 1.25f;
+    target.position.y            = 4.5f;
+    target.velocity.y            = -0.75f;
+    target.errorCovariance[0][0] = 0.05f;
+    target.confidenceLevel       = 0.9f;
+
+    BenchmarkFormatter(runner, "FrameHeader", frameHeader);
+    BenchmarkFormatter(runner, "TLVType", TLVType::SphericalCompressedPointCloud);
+    BenchmarkFormatter(runner, "DetectedPointHeader", DetectedPointHeader{32, 9});
+    BenchmarkFormatter(runner, "DetectedPoint", DetectedPoint{1.25f, 4.5f, -0.125f});
+    BenchmarkFormatter(runner, "Q9Real", q9Real);
+    BenchmarkFormatter(runner, "Statistics", Statistics{2800, 13000, 84200, 13, 45, 3});
+    BenchmarkFormatter(runner, "DetectedPointSideInfo", DetectedPointSideInfo{254, 312});
+    BenchmarkFormatter(runner, "TemperatureStatistics", temperature);
+    BenchmarkFormatter(
+        runner, "SphericalCoordinate", SphericalCoordinate{4.67f, 0.27f, -0.03f, -0.75f});
+    BenchmarkFormatter(runner, "Tracked3DTarget", target);
+    BenchmarkFormatter(runner,
+                       "SphericalCompressedPointCloudHeader",
+                       SphericalCompressedPointCloudHeader{0.01f, 0.01f, 0.0045f, 0.004f, 0.04f});
+    BenchmarkFormatter(
+        runner, "SphericalCompressedPoint", SphericalCompressedPoint{-3, 27, -167, 1168, 625});
+}
+
+#ifdef _WIN32
+
+static auto BenchmarkLogMessage(BenchmarkRunner &runner) -> void {
+    constexpr const std::string_view message =
+        "Serial COM3 received frame with invalid packet length 4294967295. Skipped.";
+
+    // Baseline without the prefix cache. The std::chrono formatter runs for every message while
+    // the buffer mutex is held, as LogSystem did before.
+    {
+        std::mutex        mutex;
+        std::vector<char> buffer;
+        NullLogWriter     writer(false);
+        const DWORD       threadID = GetCurrentThreadId();
+        buffer.reserve(LogSystem::BufferSize);
+
+        runner.Run("LogSystem::LogMessage/uncached", message.size(), 1, [&]() -> void {
+            const auto                  now = std::chrono::system_clock::now();
+            std::lock_guard<std::mutex> lock(mutex);
+            std::format_to(
+                std::back_inserter(buffer), "{} {} [{}] {}\n", threadID, now, "Info", message);
+
+            if (buffer.size() >= LogSystem::FlushSize) {
+                writer.Write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        });
+    }
+
+    for (bool buffered : {false, true}) {
+        LogSystem logSystem(LogLevel::Info);
+        logSystem.SetPersistantWriter<NullLogWriter>(buffered);
+
+        runner.Run(std::format("LogSystem::LogMessage/{}", buffered ? "buffered" : "cached"),
+                   message.size(),
+                   1,
+                   [&]() -> void { logSystem.LogMessage(LogLevel::Info, message); });
+    }
+
+    LogSystem logSystem(LogLevel::Info);
+    logSystem.SetPersistantWriter<NullLogWriter>(false);
+    runner.Run("LogSystem::LogMessage/filtered", 0, 1, [&]() -> void {
+        logSystem.LogMessage(LogLevel::Debug, message);
+    });
+
+    // Trace messages are below LOG_COMPILE_LEVEL of the benchmark, so nothing is left to run.
+    runner.Run("LogSystem::LogMessage/compiled-out", 0, 1, [&]() -> void {
+        logSystem.Log<LogLevel::Trace>(message);
+        DoNotOptimize(message.data());
+    });
+}
+
+static auto BenchmarkLogLevel(BenchmarkRunner &runner) -> void {
+    // The benchmark is built with LOG_COMPILE_LEVEL=Debug. Trace call sites are removed at compile
+    // time, debug call sites are kept and filtered by the log system at runtime.
+    static_assert(LogLevel::Trace < CompileLogLevel && LogLevel::Debug >= CompileLogLevel,
+                  "Benchmark must be built with LOG_COMPILE_LEVEL=Debug.");
+
+    uint32_t frame = 0;
+    runner.Run("LOG_TRACE/compiled-out", 0, 1, [&]() -> void {
+        LOG_TRACE("Serial COM3 frame {} has {} points.", frame, frame % 64);
+        DoNotOptimize(++frame);
+    });
+
+    runner.Run("LOG_DEBUG/filtered", 0, 1, [&]() -> void {
+        LOG_DEBUG("Serial COM3 frame {} has {} points.", frame, frame % 64);
+        DoNotOptimize(++frame);
+    });
+
+    // LOG_DEBUG expands to this call once the level checks pass. A local log system keeps the
+    // enabled messages off stderr.
+    LogSystem logSystem(LogLevel::Debug);
+    logSystem.SetPersistantWriter<NullLogWriter>(false);
+    runner.Run("LOG_DEBUG/enabled", 0, 1, [&]() -> void {
+        if (logSystem.IsEnabled(LogLevel::Debug))
+            logSystem.Log<LogLevel::Debug>(
+                "Serial COM3 frame {} has {} points.", frame, frame % 64);
+        DoNotOptimize(++frame);
+    });
+}
+
+/// @brief
+///   Check that fusion of two devices at different frame rates merges every frame and drops none
+///   as late.
+///
+/// @return bool
+///   Return true if every added frame reaches the sink.
+static auto CheckFusion() -> bool {
+    FrameGenerator         generator(FrameGenerator::DefaultConfig());
+    std::vector<std::byte> frame;
+    generator.GenerateFrame(frame);
+
+    // The wait window never expires, so slices are only emitted once both devices moved past them.
+    PointCloudFusion fusion(FusionConfig{std::chrono::milliseconds(50), std::chrono::hours(1)},
+                            {FusionDevice{"fast", RigidTransform::Identity()},
+                             FusionDevice{"slow", RigidTransform::Identity()}});
+
+    uint64_t fusedFrames = 0;
+    fusion.SetSink(
+        [&fusedFrames](const FusedFrame &slice) -> void { fusedFrames += slice.sources.size(); });
+
+    // Frames of both devices are added in acquisition order.
+    const auto                                           start = std::chrono::steady_clock::now();
+    std::array<std::chrono::steady_clock::time_point, 2> next{start, start};
+    for (size_t i = 0; i < FUSION_CHECK_FRAME_COUNT; ++i) {
+        const uint16_t device = next[0] <= next[1] ? 0 : 1;
+        fusion.OnFrame(device, frame.data(), next[device]);
+        next[device] += FUSION_CHECK_PERIODS[device];
+    }
+
+    fusion.Flush();
+
+    const FusionReport report = fusion.GetReport();
+    if (report.lateFrames == 0 && fusedFrames == FUSION_CHECK_FRAME_COUNT)
+        return true;
+
+    std::fputs(std::format("PointCloudFusion merged {} of {} frames, {} late\n",
+                           fusedFrames,
+                           FUSION_CHECK_FRAME_COUNT,
+                           report.lateFrames)
+                   .c_str(),
+               stderr);
+    return false;
+}
+
+static auto BenchmarkIOContext(BenchmarkRunner &runner) -> void {
+    IOContext context;
+    if (context.Initialize().value() != 0)
+        return;
+
+    CountingConnection connection(context);
+    runner.Run("IOContext::Run/dispatch", 0, DISPATCH_BATCH, [&]() -> void {
+        connection.Expect(DISPATCH_BATCH);
+        for (uint32_t i = 0; i < DISPATCH_BATCH; ++i)
+            context.Post(&connection, i, nullptr);
+        context.Run();
+    });
+}
+
+#endif
+
+/// @brief
+///   Check that vector transform kernels match scalar for every tail length, and that they do not
+///   write past the specified point count.
+///
+/// @return bool
+///   Return true if every kernel supported by current processor matches scalar.
+static auto CheckTransform() -> bool {
+    const RigidTransform transform =
+        RigidTransform::FromPose(1.5f, -0.25f, 2.0f, 30.0f, -15.0f, 5.0f);
+
+    constexpr const std::pair<SimdLevel, std::string_view> levels[] = {{SimdLevel::SSE, "SSE"},
+                                                                       {SimdLevel::AVX2, "AVX2"}};
+
+    // Points after the transformed count must be left untouched, so one more point than the
+    // largest count is compared.
+    PointCloud input;
+    input.Resize(TRANSFORM_CHECK_COUNT + 1);
+    for (size_t i = 0; i <= TRANSFORM_CHECK_COUNT; ++i) {
+        input.x[i] = static_cast<float>(i % 7) * 1.25f - 4.0f;
+        input.y[i] = static_cast<float>(i % 11) * 0.75f + 0.5f;
+        input.z[i] = static_cast<float>(i % 5) * -0.5f + 1.0f;
+    }
+
+    bool passed = true;
+    for (size_t count = 0; count <= TRANSFORM_CHECK_COUNT; ++count) {
+        PointCloud expected = input;
+        TransformPoints(transform,
+                        expected.x.data(),
+                        expected.y.data(),
+                        expected.z.data(),
+                        count,
+                        SimdLevel::Scalar);
+
+        for (const auto &[level, name] : levels) {
+            if (level > GetSimdLevel())
+                continue;
+
+            PointCloud actual = input;
+            TransformPoints(
+                transform, actual.x.data(), actual.y.data(), actual.z.data(), count, level);
+
+            const auto close = [](float a, float b) -> bool {
+                return std::fabs(a - b) <= TRANSFORM_TOLERANCE * (1 + std::fabs(b));
+            };
+
+            for (size_t i = 0; i <= TRANSFORM_CHECK_COUNT; ++i) {
+                if (close(actual.x[i], expected.x[i]) && close(actual.y[i], expected.y[i]) &&
+                    close(actual.z[i], expected.z[i]))
+                    continue;
+
+                std::fputs(std::format("TransformPoints/{} differs from scalar at point {} of {}: "
+                                       "({}, {}, {}) != ({}, {}, {})\n",
+                                       name,
+                                       i,
+                                       count,
+                                       actual.x[i],
+                                       actual.y[i],
+                                       actual.z[i],
+                                       expected.x[i],
+                                       expected.y[i],
+                                       expected.z[i])
+                               .c_str(),
+                           stderr);
+                passed = false;
+                break;
+            }
+        }
+    }
+
+    return passed;
+}
+
+static auto BenchmarkTransform(BenchmarkRunner &runner) -> void {
+    const RigidTransform transform =
+        RigidTransform::FromPose(1.5f, -0.25f, 2.0f, 30.0f, -15.0f, 5.0f);
+
+    constexpr const std::pair<SimdLevel, std::string_view> levels[] = {
+        {SimdLevel::Scalar, "scalar"}, {SimdLevel::SSE, "SSE"}, {SimdLevel::AVX2, "AVX2"}};
+
+    for (size_t count : {64, 1024, 16384}) {
+        PointCloud cloud;
+        cloud.Resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            cloud.x[i] = static_cast<float>(i % 97) * 0.1f;
+            cloud.y[i] = static_cast<float>(i % 89) * 0.1f;
+            cloud.z[i] = static_cast<float>(i % 13) * 0.1f;
+        }
+
+        // Items are points, so items per second is points per second on one core.
+        for (const auto &[level, name] : levels) {
+            if (level > GetSimdLevel())
+                continue;
+
+            runner.Run(std::format("TransformPoints/{}/n={}", name, count),
+                       count * 3 * sizeof(float),
+                       count,
+                       [&]() -> void {
+                           TransformPoints(transform,
+                                           cloud.x.data(),
+                                           cloud.y.data(),
+                                           cloud.z.data(),
+                                           count,
+                                           level);
+                           DoNotOptimize(cloud.x.data());
+                       });
+        }
+    }
+}
+
+static auto BenchmarkCluster(BenchmarkRunner &runner) -> void {
+    PointClusterer clusterer(PointClusterer::DefaultConfig());
+
+    for (size_t count : {256, 1024, 4096}) {
+        // Targets of about 20 points each spread over the field of view, with a quarter of the
+        // points as uniform clutter.
+        PointCloud   cloud;
+        const size_t targets = count / 27;
+        cloud.Resize(count);
+
+        uint32_t   seed   = 1;
+        const auto random = [&seed]() -> float {
+            seed = seed * 1664525 + 1013904223;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        };
+
+        for (size_t i = 0; i < count; ++i) {
+            if (i % 4 == 3) {
+                cloud.x[i]       = random() * 20 - 10;
+                cloud.y[i]       = random() * 15 + 1;
+                cloud.z[i]       = random() * 3 - 1;
+                cloud.doppler[i] = random() * 4 - 2;
+                continue;
+            }
+
+            const size_t target = i % targets;
+            cloud.x[i]          = static_cast<float>(target % 8) * 2.5f - 9 + random() * 0.6f;
+            cloud.y[i]          = static_cast<float>(target / 8) * 2.0f + 2 + random() * 0.6f;
+            cloud.z[i]          = random() * 1.8f - 0.5f;
+            cloud.doppler[i]    = static_cast<float>(target % 5) * 0.5f - 1 + random() * 0.2f;
+            cloud.snr[i]        = random() * 20 + 10;
+        }
+
+        runner.Run(std::format("PointClusterer::Cluster/n={}", count), 0, count, [&]() -> void {
+            DoNotOptimize(clusterer.Cluster(cloud));
+        });
+    }
+}
+
+/// @brief
+///   Check that two targets that walk through each other keep their track IDs.
+///
+/// @return bool
+///   Return true if both targets are tracked from confirmation to the end with distinct IDs that
+///   never change.
+static auto CheckTracker() -> bool {
+    const TrackerConfig config = TargetTracker::DefaultConfig();
+    TargetTracker       tracker(config);
+
+    auto                   time = std::chrono::steady_clock::time_point();
+    std::array<int32_t, 2> ids{-1, -1};
+    for (size_t frame = 0; frame < CROSSING_FRAME_COUNT; ++frame) {
+        const float elapsed = static_cast<float>(frame) * 0.033333f;
+
+        // Cluster 0 walks along +x and cluster 1 along -x, on the same line.
+        std::vector<ClusterSummary> clusters(2);
+        for (size_t target = 0; target < clusters.size(); ++target) {
+            const float direction       = target == 0 ? 1.0f : -1.0f;
+            clusters[target].pointCount = 20;
+            clusters[target].x          = direction * (1.5f * elapsed - 3.0f);
+            clusters[target].y          = 5.0f;
+            clusters[target].z          = 1.0f;
+        }
+
+        time += TRACKING_FRAME_PERIOD;
+        tracker.Update(time, clusters);
+        if (frame + 1 < config.confirmHits)
+            continue;
+
+        const std::vector<int32_t> &tracks = tracker.GetClusterTracks();
+        for (size_t target = 0; target < ids.size(); ++target) {
+            if (ids[target] == -1)
+                ids[target] = tracks[target];
+            if (tracks[target] != -1 && tracks[target] == ids[target] && ids[0] != ids[1])
+                continue;
+
+            std::fputs(std::format("TargetTracker lost crossing target {} at frame {}: track {}, "
+                                   "expected {}\n",
+                                   target,
+                                   frame,
+                                   tracks[target],
+                                   ids[target])
+                           .c_str(),
+                       stderr);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// @brief
+///   Check that queryDemoStatus responses of the simulator read back as the state they report, so
+///   that ConfigLoader tells a running sensor from a stopped one.
+///
+/// @return bool
+///   Return true if both states survive the round trip.
+static auto CheckDemoStatus() -> bool {
+    for (const SensorState state : {SensorState::Stopped, SensorState::Started}) {
+        // ControlSerial hands response lines over without line breaks.
+        const std::string response = FormatDemoStatus(state);
+        SensorState       parsed   = SensorState::Unknown;
+        for (size_t begin = 0; begin < response.size() && parsed == SensorState::Unknown;) {
+            const size_t end  = std::min(response.find("\r\n", begin), response.size());
+            const auto   line = std::string_view(response).substr(begin, end - begin);
+            parsed            = ParseSensorState(line);
+            begin             = end + 2;
+        }
+
+        if (parsed != state) {
+            std::fputs(std::format("queryDemoStatus reports state {} as {}\n",
+                                   static_cast<int>(state),
+                                   static_cast<int>(parsed))
+                           .c_str(),
+                       stderr);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static auto BenchmarkTracker(BenchmarkRunner &runner) -> void {
+    constexpr const float pi = 3.14159265f;
+
+    for (size_t count : {100, 200}) {
+        // Targets walk on circles of 1 to 3 m radius over a grid. Every tenth detection is missed
+        // and a few clutter clusters appear in each frame, so tracks are also created and deleted.
+        std::vector<std::vector<ClusterSummary>> frames(TRACKING_FRAME_COUNT);
+
+        uint32_t   seed   = 1;
+        const auto random = [&seed]() -> float {
+            seed = seed * 1664525 + 1013904223;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        };
+
+        for (size_t frame = 0; frame < TRACKING_FRAME_COUNT; ++frame) {
+            const float angle = 2 * pi * static_cast<float>(frame) / TRACKING_FRAME_COUNT;
+            for (size_t target = 0; target < count; ++target) {
+                if ((frame + target) % 10 == 0)
+                    continue;
+
+                const float radius  = 1 + static_cast<float>(target % 3);
+                const float phase   = angle + static_cast<float>(target) * 0.7f;
+                const float centerX = static_cast<float>(target % 10) * 8 - 40;
+                const float centerY = static_cast<float>(target / 10) * 8 + 2;
+
+                ClusterSummary cluster{};
+                cluster.pointCount = 20;
+                cluster.x          = centerX + radius * std::cos(phase) + random() * 0.2f - 0.1f;
+                cluster.y          = centerY + radius * std::sin(phase) + random() * 0.2f - 0.1f;
+                cluster.z          = random() * 0.2f + 0.9f;
+                frames[frame].push_back(cluster);
+            }
+
+            for (size_t clutter = 0; clutter < count / 20; ++clutter) {
+                ClusterSummary cluster{};
+                cluster.pointCount = 3;
+                cluster.x          = random() * 80 - 40;
+                cluster.y          = random() * static_cast<float>(count / 10) * 8 + 2;
+                cluster.z          = random() * 3 - 1;
+                frames[frame].push_back(cluster);
+            }
+        }
+
+        // One pass confirms the tracks before timing.
+        TargetTracker tracker(TargetTracker::DefaultConfig());
+        auto          time  = std::chrono::steady_clock::time_point();
+        size_t        frame = 0;
+        const auto    step  = [&]() -> void {
+            time += TRACKING_FRAME_PERIOD;
+            tracker.Update(time, frames[frame]);
+            frame = (frame + 1) % TRACKING_FRAME_COUNT;
+        };
+
+        for (size_t i = 0; i < TRACKING_FRAME_COUNT; ++i)
+            step();
+
+        // Items are targets. A frame must take well under 33 ms to keep up with 30 frames per
+        // second.
+        runner.Run(std::format("TargetTracker::Update/tracks={}", count), 0, count, [&]() -> void {
+            step();
+            DoNotOptimize(tracker.GetTargets().size());
+        });
+    }
+}
+
+#ifdef _WIN32
+
+static auto BenchmarkClutterFilter(BenchmarkRunner &runner) -> void {
+    // Three quarters of the points are static reflectors. Frames are renumbered on every pass, so
+    // that the occupancy map sees a continuous stream.
+    FrameGeneratorConfig config = FrameGenerator::DefaultConfig();
+    config.tlvs                 = {TLVType::DetectedPoints,
+                                   TLVType::RangeProfile,
+                                   TLVType::Statistics,
+                                   TLVType::DetectedPointsSideInfo,
+                                   TLVType::SphericalCoordinates};
+    config.pointCount           = 64;
+    config.reflectorCount       = 192;
+
+    FrameCorpus corpus      = MakeCorpus("clutter", config);
+    uint32_t    frameNumber = 0;
+
+    const std::pair<ClutterAction, const char *> actions[]{
+        {ClutterAction::None, "none"},
+        {ClutterAction::Drop, "drop"},
+        {ClutterAction::Tag, "tag"},
+    };
+
+    for (const auto &[action, name] : actions) {
+        ClutterFilterConfig filter = StaticClutterFilter::DefaultConfig();
+        filter.action              = action;
+
+        DataSerial serial;
+        serial.SetClutterFilter(filter);
+        serial.GetClutterFilter().SetLogInterval(std::chrono::seconds(0));
+
+        uint64_t serializedBytes = 0;
+        serial.SetPersistantWriter([&serializedBytes](const void *, size_t size) -> void {
+            serializedBytes += size;
+        });
+
+        runner.Run(std::format("DataSerial::HandleFrame/clutter={}", name),
+                   corpus.stream.size(),
+                   corpus.offsets.size(),
+                   [&]() -> void {
+                       for (size_t offset : corpus.offsets) {
+                           std::byte *frame = corpus.stream.data() + offset;
+                           ++frameNumber;
+                           std::memcpy(frame + offsetof(FrameHeader, frameNumber),
+                                       &frameNumber,
+                                       sizeof(frameNumber));
+
+                           FrameTimestamps timestamps{};
+                           serial.HandleFrame(
+                               frame, corpus.stream.size() - offset, timestamps);
+                       }
+                   });
+
+        DoNotOptimize(serializedBytes);
+    }
+}
+
+static auto RunRamp(SoakTest          &test,
+                    double             startRate,
+                    uint32_t           stepSeconds,
+                    std::string_view   output,
+                    std::string_view   label,
+                    const std::string &tlvs) -> int {
+    std::fputs(std::format("{:>12} {:>12} {:>10} {:>12} {:>12} {:>10}\n",
+                           "target fps",
+                           "fps",
+                           "MB/s",
+                           "dropped",
+                           "p99 us",
+                           "sustained")
+                   .c_str(),
+               stdout);
+
+    const RampReport report =
+        test.Ramp(startRate, std::chrono::seconds(stepSeconds), [](const RampStep &step) -> void {
+            std::fputs(std::format("{:>12.1f} {:>12.1f} {:>10.2f} {:>12} {:>12.1f} {:>10}\n",
+                                   step.sample.targetFrameRate,
+                                   step.sample.framesPerSecond,
+                                   step.sample.megabytesPerSecond,
+                                   step.sample.droppedBytes,
+                                   step.sample.latencyP99,
+                                   step.sustained ? "yes" : "no")
+                           .c_str(),
+                       stdout);
+        });
+
+    std::fputs(std::format("Max sustainable: {:.1f} fps, {:.2f} MB/s\n",
+                           report.maxFrameRate,
+                           report.maxMegabytesPerSecond)
+                   .c_str(),
+               stdout);
+
+    std::string text = std::format(
+        R"({{"label": "{}", "tlvs": "{}", "max_frame_rate": {:.3f}, )"
+        R"("max_megabytes_per_second": {:.3f}, "steps": [)",
+        label,
+        tlvs,
+        report.maxFrameRate,
+        report.maxMegabytesPerSecond);
+
+    for (size_t i = 0; i < report.steps.size(); ++i) {
+        std::string step = SoakTest::ToJSON(report.steps[i].sample);
+        step.pop_back();
+        std::format_to(std::back_inserter(text),
+                       R"({}{}, "sustained": {}}})",
+                       i == 0 ? "\n" : ",\n",
+                       step,
+                       report.steps[i].sustained);
+    }
+    text.append("\n]}\n");
+
+    std::FILE *file = std::fopen(std::string(output).c_str(), "wb");
+    if (file == nullptr) {
+        std::fputs(std::format("Failed to write {}\n", output).c_str(), stderr);
+        return EXIT_FAILURE;
+    }
+
+    std::fwrite(text.data(), 1, text.size(), file);
+    std::fclose(file);
+    return EXIT_SUCCESS;
+}
+
+static auto RunSoak(SoakTest        &test,
+                    double           frameRate,
+                    uint32_t         durationSeconds,
+                    uint32_t         intervalSeconds,
+                    std::string_view output) -> int {
+    std::FILE *file = std::fopen(std::string(output).c_str(), "wb");
+    if (file == nullptr) {
+        std::fputs(std::format("Failed to write {}\n", output).c_str(), stderr);
+        return EXIT_FAILURE;
+    }
+
+    // One JSON object per line so that an interrupted soak still leaves a readable report.
+    const SoakSample total = test.Soak(frameRate,
+                                       std::chrono::seconds(durationSeconds),
+                                       std::chrono::seconds(intervalSeconds),
+                                       [file](const SoakSample &sample) -> void {
+                                           std::string line = SoakTest::ToJSON(sample);
+                                           line.push_back('\n');
+                                           std::fputs(line.c_str(), stdout);
+                                           std::fputs(line.c_str(), file);
+                                           std::fflush(file);
+                                       });
+
+    std::fclose(file);
+    std::fputs(std::format("Total: {}\n", SoakTest::ToJSON(total)).c_str(), stdout);
+    return EXIT_SUCCESS;
+}
+
+static auto RunScale(ScaleTest       &test,
+                     uint32_t         maxDevices,
+                     double           frameRate,
+                     uint32_t         durationSeconds,
+                     std::string_view output,
+                     std::string_view label) -> int {
+    std::fputs(std::format("{:>8} {:>8} {:>12} {:>10} {:>10} {:>10} {:>10} {:>12} {:>12}\n",
+                           "devices",
+                           "threads",
+                           "fps",
+                           "MB/s",
+                           "p50 us",
+                           "p99 us",
+                           "max us",
+                           "worst p99",
+                           "first p99")
+                   .c_str(),
+               stdout);
+
+    std::string text = std::format(
+        R"({{"label": "{}", "frame_rate": {:.3f}, "runs": [)", label, frameRate);
+
+    // Double the number of devices each run: 1, 2, 4, ... up to maxDevices.
+    for (uint32_t devices = 1; devices <= maxDevices; devices *= 2) {
+        const ScaleSample sample =
+            test.Run(devices, frameRate, std::chrono::seconds(durationSeconds));
+
+        std::fputs(std::format("{:>8} {:>8} {:>12.1f} {:>10.2f} {:>10.1f} {:>10.1f} {:>10.1f} "
+                               "{:>12.1f} {:>12.1f}\n",
+                               sample.devices,
+                               sample.threads,
+                               sample.framesPerSecond,
+                               sample.megabytesPerSecond,
+                               sample.latencyP50,
+                               sample.latencyP99,
+                               sample.latencyMax,
+                               sample.worstDeviceP99,
+                               sample.firstDeviceP99)
+                       .c_str(),
+                   stdout);
+
+        text.append(devices == 1 ? "\n" : ",\n");
+        text.append(ScaleTest::ToJSON(sample));
+    }
+    text.append("\n]}\n");
+
+    std::FILE *file = std::fopen(std::string(output).c_str(), "wb");
+    if (file == nullptr) {
+        std::fputs(std::format("Failed to write {}\n", output).c_str(), stderr);
+        return EXIT_FAILURE;
+    }
+
+    std::fwrite(text.data(), 1, text.size(), file);
+    std::fclose(file);
+    return EXIT_SUCCESS;
+}
+
+#endif
+
+static auto PrintUsage() noexcept -> void {
+#ifdef _WIN32
+    std::fputs("Usage: Benchmark [--mode bench|check|ramp|soak|scale] [--filter name] "
+               "[--output path] [--label text] [--samples n] [--min-time-ms n] [--tlvs list|all] "
+               "[--points n] [--targets n] [--rate fps] [--duration s] [--step s] [--interval s] "
+               "[--sink path] [--devices n]\n",
+               stderr);
+#else
+    std::fputs("Usage: Benchmark [--mode bench|check] [--filter name] [--output path] "
+               "[--label text] [--samples n] [--min-time-ms n]\n",
+               stderr);
+#endif
+}
+
+auto main(int argc, char *argv[]) -> int {
+    std::string_view mode = "bench";
+    std::string_view filter;
+    std::string_view output = "benchmark.json";
+    std::string_view label;
+    uint32_t         samples = 15;
+    uint32_t         minTime = 20;
+
+#ifdef _WIN32
+    std::string_view     tlvs     = "all";
+    std::string_view     sink     = "soak.json";
+    FrameGeneratorConfig config   = FrameGenerator::DefaultConfig();
+    double               rate     = 10;
+    uint32_t             duration = 60;
+    uint32_t             step     = 5;
+    uint32_t             interval = 10;
+    uint32_t             devices  = 16;
+#endif
+
+    // Every option takes a value.
+    for (int i = 1; i < argc; i += 2) {
+        const std::string_view option = argv[i];
+        if (i + 1 == argc) {
+            std::fputs(std::format("Missing value of option {}\n", option).c_str(), stderr);
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (option == "--mode") {
+            mode = argv[i + 1];
+        } else if (option == "--filter") {
+            filter = argv[i + 1];
+        } else if (option == "--output") {
+            output = argv[i + 1];
+        } else if (option == "--label") {
+            label = argv[i + 1];
+        } else if (option == "--samples") {
+            samples = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--min-time-ms") {
+            minTime = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+#ifdef _WIN32
+        } else if (option == "--tlvs") {
+            tlvs = argv[i + 1];
+        } else if (option == "--points") {
+            config.pointCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--targets") {
+            config.targetCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--rate") {
+            rate = std::strtod(argv[i + 1], nullptr);
+        } else if (option == "--duration") {
+            duration = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--step") {
+            step = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--interval") {
+            interval = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (option == "--sink") {
+            sink = argv[i + 1];
+        } else if (option == "--devices") {
+            devices = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+#endif
+        } else {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+#ifdef _WIN32
+    // Keep warnings only so that periodic reports do not disturb measurements.
+    LogSystem::GetSingleton()->SetLevel(LogLevel::Warning);
+
+    if (mode == "ramp" || mode == "soak" || mode == "scale") {
+        if (tlvs != "all" && !FrameGenerator::ParseTLVs(tlvs, config.tlvs)) {
+            std::fputs(std::format("Invalid TLV list: {}\n", tlvs).c_str(), stderr);
+            return EXIT_FAILURE;
+        }
+
+        if (mode == "scale") {
+            ScaleTest test(config);
+            if (output == "benchmark.json")
+                output = "scale.json";
+            return RunScale(test, devices, rate, duration, output, label);
+        }
+
+        SoakTest test(SoakConfig{config, std::string(sink), SOAK_QUEUE_CAPACITY, SOAK_READ_SIZE});
+        if (output == "benchmark.json")
+            output = (mode == "ramp") ? "ramp.json" : "soak.jsonl";
+
+        if (mode == "ramp")
+            return RunRamp(test, rate, step, output, label, std::string(tlvs));
+        return RunSoak(test, rate, duration, interval, output);
+    }
+#endif
+
+    if (mode != "bench" && mode != "check") {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    // Kernels are only timed once their results are known to be right. Check mode stops here.
+    if (!CheckTransform() || !CheckTracker() || !CheckDemoStatus())
+        return EXIT_FAILURE;
+#ifdef _WIN32
+    if (!CheckFusion())
+        return EXIT_FAILURE;
+#endif
+    if (mode == "check")
+        return EXIT_SUCCESS;
+
+    BenchmarkRunner runner(filter, std::chrono::milliseconds(minTime), samples);
+
+#ifdef _WIN32
+    const std::vector<FrameCorpus> corpora = MakeCorpora();
+    for (const auto &corpus : corpora) {
+        BenchmarkLocateFrameHeader(runner, corpus);
+        for (size_t chunkSize : {64, 1024, 4096})
+            BenchmarkOnRead(runner, corpus, chunkSize);
+        BenchmarkHandleFrame(runner, corpus);
+    }
+#endif
+
+    BenchmarkFormatters(runner);
+#ifdef _WIN32
+    BenchmarkLogMessage(runner);
+    BenchmarkLogLevel(runner);
+    BenchmarkIOContext(runner);
+#endif
+    BenchmarkTransform(runner);
+    BenchmarkCluster(runner);
+    BenchmarkTracker(runner);
+#ifdef _WIN32
+    BenchmarkClutterFilter(runner);
+#endif
+
+    std::error_code errorCode = runner.WriteJSON(output, label);
+    if (errorCode.value() != 0) {
+        std::fputs(std::format("Failed to write {}: {}\n", output, errorCode.message()).c_str(),
+                   stderr);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+#include "Scale.h"
+#include "Benchmark.h"
+#include "IOContext.h"
+#include "IWR1443/Serials.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace iwr1443;
+
+// Maximum bytes of each simulated read. Matches the data serial read buffer.
+static constexpr const size_t SCALE_READ_SIZE = 4096;
+
+// Maximum time to wait for devices to handle frames in flight when the run stops.
+static constexpr const std::chrono::seconds DRAIN_TIMEOUT = std::chrono::seconds(1);
+
+/// @brief
+///   Data serial fed by IOContext completions instead of a serial port.
+class SimulatedDevice final : public IAsync {
+public:
+    /// @brief
+    ///   Create a simulated device that posts its completions to the specified IOContext.
+    explicit SimulatedDevice(IOContext &context) noexcept
+        : context(context),
+          serial(),
+          mutex(),
+          pending(),
+          scheduled(false),
+          postTime(),
+          latencies(),
+          framesHandled(0),
+          bytesRead(0) {
+        serial.SetPersistantWriter([this](const void *data, size_t size) -> void {
+            DoNotOptimize(data);
+            DoNotOptimize(size);
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                                    std::chrono::steady_clock::now() - postTime)
+                                    .count());
+            framesHandled.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    auto OnRegister() noexcept -> void override {}
+
+    /// @brief
+    ///   Handle one frame, then requeue behind completions of other devices if more are pending.
+    auto OnIOComplete(DWORD bytesTransferred, OVERLAPPED *overlapped) noexcept -> void override {
+        DoNotOptimize(bytesTransferred);
+        DoNotOptimize(overlapped);
+
+        Frame frame;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        postTime = frame.postTime;
+        for (size_t offset = 0; offset < frame.data.size(); offset += SCALE_READ_SIZE) {
+            const size_t size = std::min(SCALE_READ_SIZE, frame.data.size() - offset);
+            serial.OnRead(frame.data.data() + offset, size);
+        }
+        bytesRead.fetch_add(frame.data.size(), std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty())
+            scheduled = false;
+        else
+            context.Post(this, static_cast<DWORD>(pending.front().data.size()), nullptr);
+    }
+
+    auto GetHandle() const noexcept -> HANDLE override {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    /// @brief
+    ///   Queue a frame. A completion is posted unless one is already in flight.
+    auto Push(std::vector<std::byte> data) noexcept -> void {
+        std::lock_guard<std::mutex> lock(mutex);
+        const DWORD size = static_cast<DWORD>(data.size());
+        pending.push_back(Frame{std::move(data), std::chrono::steady_clock::now()});
+        if (!scheduled) {
+            scheduled = true;
+            context.Post(this, size, nullptr);
+        }
+    }
+
+    /// @brief
+    ///   Get number of frames written to the sink.
+    auto GetFramesHandled() const noexcept -> uint64_t {
+        return framesHandled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Get number of bytes passed to the data serial.
+    auto GetBytesRead() const noexcept -> uint64_t {
+        return bytesRead.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Get latencies of handled frames. Only valid after the IOContext stops.
+    auto GetLatencies() noexcept -> std::vector<double> & {
+        return latencies;
+    }
+
+private:
+    struct Frame {
+        /// @brief
+        ///   Frame bytes as received from the data port.
+        std::vector<std::byte> data;
+
+        /// @brief
+        ///   Time that the frame is queued.
+        std::chrono::steady_clock::time_point postTime;
+    };
+
+    /// @brief
+    ///   The IOContext that dispatches completions of this device.
+    IOContext &context;
+
+    /// @brief
+    ///   The data serial under test.
+    DataSerial serial;
+
+    /// @brief
+    ///   Protects pending frames and the scheduled flag.
+    std::mutex mutex;
+
+    /// @brief
+    ///   Frames waiting to be read.
+    std::deque<Frame> pending;
+
+    /// @brief
+    ///   Whether a completion of this device is in flight.
+    bool scheduled;
+
+    /// @brief
+    ///   Queue time of the frame being read.
+    std::chrono::steady_clock::time_point postTime;
+
+    /// @brief
+    ///   Latencies in microseconds of handled frames.
+    std::vector<double> latencies;
+
+    /// @brief
+    ///   Number of frames written to the sink.
+    std::atomic<uint64_t> framesHandled;
+
+    /// @brief
+    ///   Number of bytes passed to the data serial.
+    std::atomic<uint64_t> bytesRead;
+};
+
+ScaleTest::ScaleTest(const FrameGeneratorConfig &config) noexcept : config(config) {}
+
+ScaleTest::~ScaleTest() noexcept {}
+
+auto ScaleTest::Run(uint32_t devices, double frameRate, std::chrono::seconds duration) noexcept
+    -> ScaleSample {
+    using Clock = std::chrono::steady_clock;
+
+    devices  = std::max(devices, 1U);
+    duration = std::max(duration, std::chrono::seconds(1));
+
+    ScaleSample sample{};
+    sample.devices         = devices;
+    sample.targetFrameRate = frameRate;
+
+    IOContext context;
+    if (context.Initialize().value() != 0)
+        return sample;
+
+    std::vector<std::unique_ptr<SimulatedDevice>> simulated;
+    for (uint32_t i = 0; i < devices; ++i)
+        simulated.push_back(std::make_unique<SimulatedDevice>(context));
+
+    // Same pool size as the capture application.
+    sample.threads = std::clamp(devices, 1U, std::max(std::thread::hardware_concurrency(), 1U));
+
+    std::vector<std::jthread> threads;
+    for (uint32_t i = 0; i < sample.threads; ++i)
+        threads.emplace_back([&context]() -> void { context.Run(); });
+
+    std::atomic<uint64_t> framesGenerated{0};
+    const auto            start = Clock::now();
+    const auto            period =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameRate));
+
+    std::jthread producer([&](std::stop_token stopToken) -> void {
+        FrameGeneratorConfig generatorConfig = config;
+        generatorConfig.frameRate            = frameRate;
+
+        // Devices are not synchronized, so spread their frames over the period.
+        std::vector<FrameGenerator>    generators(devices, FrameGenerator(generatorConfig));
+        std::vector<Clock::time_point> next(devices);
+        for (uint32_t i = 0; i < devices; ++i)
+            next[i] = start + period * i / devices;
+
+        while (!stopToken.stop_requested()) {
+            for (uint32_t i = 0; i < devices; ++i) {
+                EmitDueFrames(next[i], period, [&]() -> void {
+                    std::vector<std::byte> frame;
+                    generators[i].GenerateFrame(frame);
+                    simulated[i]->Push(std::move(frame));
+                    framesGenerated.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            std::this_thread::sleep_until(*std::min_element(next.begin(), next.end()));
+        }
+    });
+
+    std::this_thread::sleep_until(start + duration);
+    producer.request_stop();
+    producer.join();
+
+    const auto handledFrames = [&simulated]() -> uint64_t {
+        uint64_t total = 0;
+        for (const auto &device : simulated)
+            total += device->GetFramesHandled();
+        return total;
+    };
+
+    const auto stop     = Clock::now();
+    const auto deadline = stop + DRAIN_TIMEOUT;
+    while (handledFrames() < framesGenerated.load() && Clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    context.Quit(sample.threads);
+    for (auto &thread : threads)
+        thread.join();
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+
+    uint64_t            bytes = 0;
+    std::vector<double> latencies;
+    for (uint32_t i = 0; i < devices; ++i) {
+        std::vector<double> &deviceLatencies = simulated[i]->GetLatencies();
+        latencies.insert(latencies.end(), deviceLatencies.begin(), deviceLatencies.end());
+        bytes += simulated[i]->GetBytesRead();
+
+        const double p99      = Percentile(deviceLatencies, 0.99);
+        sample.worstDeviceP99 = std::max(sample.worstDeviceP99, p99);
+        if (i == 0)
+            sample.firstDeviceP99 = p99;
+    }
+
+    const uint64_t handled    = handledFrames();
+    sample.framesPerSecond    = static_cast<double>(handled) / seconds;
+    sample.megabytesPerSecond = static_cast<double>(bytes) / 1e6 / seconds;
+    sample.framesBehind       = framesGenerated.load() - handled;
+    sample.latencyP50         = Percentile(latencies, 0.5);
+    sample.latencyP99         = Percentile(latencies, 0.99);
+    sample.latencyMax         = Percentile(latencies, 1.0);
+    return sample;
+}
+
+auto ScaleTest::ToJSON(const ScaleSample &sample) noexcept -> std::string {
+    return std::format(
+        R"({{"devices": {}, "threads": {}, "target_frame_rate": {:.3f}, )"
+        R"("frames_per_second": {:.3f}, "megabytes_per_second": {:.3f}, "frames_behind": {}, )"
+        R"("latency_p50_us": {:.1f}, "latency_p99_us": {:.1f}, "latency_max_us": {:.1f}, )"
+        R"("worst_device_p99_us": {:.1f}, "first_device_p99_us": {:.1f}}})",
+        sample.devices,
+        sample.threads,
+        sample.targetFrameRate,
+        sample.framesPerSecond,
+        sample.megabytesPerSecond,
+        sample.framesBehind,
+        sample.latencyP50,
+        sample.latencyP99,
+        sample.latencyMax,
+        sample.worstDeviceP99,
+        sample.firstDeviceP99);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "IWR1443/FrameGenerator.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct ScaleSample {
+    /// @brief
+    ///   Number of simulated devices.
+    uint32_t devices;
+
+    /// @brief
+    ///   Number of threads running the shared IOContext.
+    uint32_t threads;
+
+    /// @brief
+    ///   Target frame rate of each device.
+    double targetFrameRate;
+
+    /// @brief
+    ///   Frames handled per second over all devices.
+    double framesPerSecond;
+
+    /// @brief
+    ///   Megabytes of data port stream consumed per second over all devices.
+    double megabytesPerSecond;
+
+    /// @brief
+    ///   Number of frames generated but not handled when the run stops.
+    uint64_t framesBehind;
+
+    /// @brief
+    ///   Latency percentiles in microseconds over all devices, from a frame being posted to the
+    ///   IOContext to its JSON reaching the sink.
+    double latencyP50;
+    double latencyP99;
+    double latencyMax;
+
+    /// @brief
+    ///   Worst 99th percentile latency of a single device in microseconds.
+    double worstDeviceP99;
+
+    /// @brief
+    ///   99th percentile latency of the first device in microseconds. Compare across runs to see
+    ///   whether added devices slow down an existing one.
+    double firstDeviceP99;
+};
+
+/// @brief
+///   Runs several simulated data serials on one IOContext pool, like the capture application does
+///   with several radars. Each device receives generated frames through IOContext completions with
+///   at most one completion in flight, as a real serial keeps one read pending.
+class ScaleTest {
+public:
+    /// @brief
+    ///   Create a scaling test.
+    ///
+    /// @param config   Configuration of generated frames. Errors are not injected.
+    explicit ScaleTest(const iwr1443::FrameGeneratorConfig &config) noexcept;
+
+    /// @brief
+    ///   Destroy this scaling test.
+    ~ScaleTest() noexcept;
+
+    /// @brief
+    ///   Run the specified number of devices at the specified frame rate.
+    ///
+    /// @param devices      Number of simulated devices.
+    /// @param frameRate    Frame rate of each device.
+    /// @param duration     Duration of the run.
+    ///
+    /// @return ScaleSample
+    ///   Return result of the run.
+    auto Run(uint32_t devices, double frameRate, std::chrono::seconds duration) noexcept
+        -> ScaleSample;
+
+    /// @brief
+    ///   Format a sample as a single line JSON object.
+    static auto ToJSON(const ScaleSample &sample) noexcept -> std::string;
+
+private:
+    /// @brief
+    ///   Configuration of generated frames.
+    iwr1443::FrameGeneratorConfig config;
+};
@@ -0,0 +1,458 @@
+#include "Soak.h"
+#include "Benchmark.h"
+#include "FileWriter.h"
+#include "IWR1443/Serials.h"
+#include "Log.h"
+
+#include <Windows.h>
+
+#include <Psapi.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <format>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#pragma comment(lib, "Psapi.lib")
+
+using namespace iwr1443;
+
+// Factor applied to frame rate between ramp steps until the pipeline fails.
+static constexpr const double RAMP_FACTOR = 1.5;
+
+// Upper limit of ramp steps before bisecting.
+static constexpr const uint32_t RAMP_MAX_STEPS = 24;
+
+// Number of bisect steps between the last sustained and the first failed rate.
+static constexpr const uint32_t RAMP_BISECT_STEPS = 4;
+
+// Fraction of valid frames that must reach the sink for a run to be sustained.
+static constexpr const double SUSTAINED_HANDLED_RATIO = 0.99;
+
+// Fraction of target frames that the producer must generate for a run to be sustained.
+static constexpr const double SUSTAINED_GENERATED_RATIO = 0.95;
+
+// Fraction of queue capacity that may be left at the end of a sustained run.
+static constexpr const double SUSTAINED_QUEUE_RATIO = 0.1;
+
+// Number of frames that may be left in the queue at the end of a sustained run.
+static constexpr const double SUSTAINED_QUEUE_FRAMES = 2;
+
+// Number of in-flight frames whose enqueue time is kept.
+static constexpr const size_t ENQUEUE_TIME_SLOTS = 4096;
+
+// Heap allocations of the whole process. Relaxed since they are only sampled.
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> freeCount{0};
+
+auto operator new(size_t size) -> void * {
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return memory;
+}
+
+auto operator new[](size_t size) -> void * {
+    return operator new(size);
+}
+
+auto operator delete(void *memory) noexcept -> void {
+    if (memory == nullptr)
+        return;
+    freeCount.fetch_add(1, std::memory_order_relaxed);
+    std::free(memory);
+}
+
+auto operator delete[](void *memory) noexcept -> void {
+    operator delete(memory);
+}
+
+auto operator delete(void *memory, size_t) noexcept -> void {
+    operator delete(memory);
+}
+
+auto operator delete[](void *memory, size_t) noexcept -> void {
+    operator delete(memory);
+}
+
+/// @brief
+///   Get resident set size of this process.
+static auto GetResidentBytes() noexcept -> size_t {
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+}
+
+/// @brief
+///   Fixed capacity byte queue between the producer and DataSerial::OnRead. Bytes that do not fit
+///   are dropped like an overflowed driver input queue.
+class ByteQueue {
+public:
+    /// @brief
+    ///   Create a byte queue with the specified capacity.
+    explicit ByteQueue(size_t capacity) noexcept
+        : mutex(),
+          condition(),
+          data(std::max<size_t>(capacity, 1)),
+          head(0),
+          size(0),
+          peakSize(0),
+          droppedBytes(0) {}
+
+    /// @brief
+    ///   Append as many bytes as fit.
+    auto Push(const std::byte *bytes, size_t count) noexcept -> void {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const size_t accepted = std::min(count, data.size() - size);
+            for (size_t i = 0; i < accepted; ++i)
+                data[(head + size + i) % data.size()] = bytes[i];
+
+            size += accepted;
+            peakSize = std::max(peakSize, size);
+            droppedBytes += count - accepted;
+        }
+        condition.notify_one();
+    }
+
+    /// @brief
+    ///   Wait for bytes and move up to @p count of them to @p output.
+    ///
+    /// @return size_t
+    ///   Return number of bytes moved. 0 if stop is requested.
+    auto Pop(std::byte *output, size_t count, std::stop_token stopToken) noexcept -> size_t {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, stopToken, [this]() -> bool { return size != 0; });
+        if (size == 0)
+            return 0;
+
+        const size_t moved = std::min(count, size);
+        for (size_t i = 0; i < moved; ++i)
+            output[i] = data[(head + i) % data.size()];
+
+        head = (head + moved) % data.size();
+        size -= moved;
+        return moved;
+    }
+
+    /// @brief
+    ///   Get current size, reset and return the peak size since the last call.
+    auto Sample(size_t &currentSize, size_t &peak, uint64_t &dropped) noexcept -> void {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentSize = size;
+        peak        = peakSize;
+        dropped     = droppedBytes;
+        peakSize    = size;
+    }
+
+private:
+    /// @brief
+    ///   Protects all members below.
+    std::mutex mutex;
+
+    /// @brief
+    ///   Notified when bytes are appended.
+    std::condition_variable_any condition;
+
+    /// @brief
+    ///   Ring buffer of queued bytes.
+    std::vector<std::byte> data;
+
+    /// @brief
+    ///   Offset of the first queued byte in the ring buffer.
+    size_t head;
+
+    /// @brief
+    ///   Number of queued bytes.
+    size_t size;
+
+    /// @brief
+    ///   Peak number of queued bytes since the last sample.
+    size_t peakSize;
+
+    /// @brief
+    ///   Number of bytes that did not fit since the queue is created.
+    uint64_t droppedBytes;
+};
+
+SoakTest::SoakTest(const SoakConfig &config) noexcept : config(config) {}
+
+SoakTest::~SoakTest() noexcept {}
+
+auto SoakTest::Ramp(double                                       startRate,
+                    std::chrono::seconds                         stepDuration,
+                    const std::function<void(const RampStep &)> &onStep) noexcept -> RampReport {
+    RampReport report{{}, 0, 0};
+
+    const auto runStep = [&](double rate) -> bool {
+        RampStep step{};
+        step.sample    = Run(rate, stepDuration, stepDuration, nullptr);
+        step.sustained = IsSustained(step.sample);
+
+        if (step.sustained && rate > report.maxFrameRate) {
+            report.maxFrameRate          = rate;
+            report.maxMegabytesPerSecond = step.sample.megabytesPerSecond;
+        }
+
+        if (onStep)
+            onStep(step);
+        report.steps.push_back(step);
+        return step.sustained;
+    };
+
+    // Grow geometrically until the pipeline fails.
+    double passed = 0;
+    double failed = 0;
+    double rate   = startRate;
+    for (uint32_t i = 0; i < RAMP_MAX_STEPS; ++i, rate *= RAMP_FACTOR) {
+        if (!runStep(rate)) {
+            failed = rate;
+            break;
+        }
+        passed = rate;
+    }
+
+    if (failed == 0)
+        return report;
+
+    // Narrow down between the last sustained and the first failed rate.
+    for (uint32_t i = 0; i < RAMP_BISECT_STEPS; ++i) {
+        const double middle = (passed + failed) / 2;
+        if (runStep(middle))
+            passed = middle;
+        else
+            failed = middle;
+    }
+
+    return report;
+}
+
+auto SoakTest::Soak(double                                         frameRate,
+                    std::chrono::seconds                           duration,
+                    std::chrono::seconds                           interval,
+                    const std::function<void(const SoakSample &)> &onSample) noexcept
+    -> SoakSample {
+    return Run(frameRate, duration, interval, onSample);
+}
+
+auto SoakTest::ToJSON(const SoakSample &sample) noexcept -> std::string {
+    return std::format(
+        R"({{"elapsed": {:.3f}, "target_frame_rate": {:.3f}, "frames_generated": {}, )"
+        R"("frames_valid": {}, "frames_handled": {}, "dropped_bytes": {}, )"
+        R"("frames_per_second": {:.3f}, "megabytes_per_second": {:.3f}, "queue_bytes": {}, )"
+        R"("peak_queue_bytes": {}, )"
+        R"("resident_bytes": {}, "allocations": {}, "live_allocations": {}, )"
+        R"("latency_p50_us": {:.1f}, "latency_p99_us": {:.1f}, "latency_p999_us": {:.1f}, )"
+        R"("latency_max_us": {:.1f}}})",
+        sample.elapsed,
+        sample.targetFrameRate,
+        sample.framesGenerated,
+        sample.framesValid,
+        sample.framesHandled,
+        sample.droppedBytes,
+        sample.framesPerSecond,
+        sample.megabytesPerSecond,
+        sample.queueBytes,
+        sample.peakQueueBytes,
+        sample.residentBytes,
+        sample.allocations,
+        sample.liveAllocations,
+        sample.latencyP50,
+        sample.latencyP99,
+        sample.latencyP999,
+        sample.latencyMax);
+}
+
+auto SoakTest::Run(double                                         frameRate,
+                   std::chrono::seconds                           duration,
+                   std::chrono::seconds                           interval,
+                   const std::function<void(const SoakSample &)> &onSample) noexcept
+    -> SoakSample {
+    using Clock = std::chrono::steady_clock;
+
+    duration = std::max(duration, std::chrono::seconds(1));
+    interval = std::clamp(interval, std::chrono::seconds(1), duration);
+
+    FileWriter sink;
+    if (std::error_code errorCode = sink.Open(config.sinkPath); errorCode.value() != 0)
+        LogError("Failed to open soak sink {}: {}", config.sinkPath, errorCode.message());
+
+    ByteQueue queue(config.queueCapacity);
+
+    // Enqueue time of the last byte of each in-flight frame, indexed by frame number.
+    std::array<Clock::time_point, ENQUEUE_TIME_SLOTS> enqueueTimes{};
+
+    std::atomic<uint64_t> framesGenerated{0};
+    std::atomic<uint64_t> framesValid{0};
+    std::atomic<uint64_t> framesHandled{0};
+    std::atomic<uint64_t> bytesRead{0};
+
+    std::mutex          latencyMutex;
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(frameRate * interval.count()) * 2 + 16);
+
+    DataSerial serial;
+    uint32_t   currentFrame = 0;
+    serial.AddFrameListener([&currentFrame](const void *frame) -> void {
+        currentFrame = static_cast<const FrameHeader *>(frame)->frameNumber;
+    });
+
+    serial.SetPersistantWriter([&](const void *data, size_t size) -> void {
+        sink.Write(data, size);
+
+        // Frames are handed to the sink in order, so the slot is not overwritten yet unless the
+        // queue holds more than ENQUEUE_TIME_SLOTS frames, which already fails the run.
+        const auto   enqueued = enqueueTimes[currentFrame % ENQUEUE_TIME_SLOTS];
+        const double latency =
+            std::chrono::duration<double, std::micro>(Clock::now() - enqueued).count();
+
+        framesHandled.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        latencies.push_back(latency);
+    });
+
+    const auto start = Clock::now();
+
+    std::jthread consumer([&](std::stop_token stopToken) -> void {
+        std::vector<std::byte> chunk(std::max<size_t>(config.readSize, 1));
+        while (size_t count = queue.Pop(chunk.data(), chunk.size(), stopToken)) {
+            serial.OnRead(chunk.data(), count);
+            bytesRead.fetch_add(count, std::memory_order_relaxed);
+        }
+    });
+
+    std::jthread producer([&](std::stop_token stopToken) -> void {
+        FrameGeneratorConfig generatorConfig = config.generator;
+        generatorConfig.frameRate            = frameRate;
+        FrameGenerator generator(generatorConfig);
+
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / frameRate));
+
+        std::vector<std::byte> output;
+        auto                   next = start;
+        while (!stopToken.stop_requested()) {
+            EmitDueFrames(next, period, [&]() -> void {
+                output.clear();
+                generator.Generate(output);
+
+                const FrameGeneratorStatistics &statistics = generator.GetStatistics();
+                enqueueTimes[statistics.frames % ENQUEUE_TIME_SLOTS] = Clock::now();
+                queue.Push(output.data(), output.size());
+
+                framesGenerated.store(statistics.frames, std::memory_order_relaxed);
+                framesValid.store(statistics.frames - statistics.dropped - statistics.corrupted -
+                                      statistics.truncated,
+                                  std::memory_order_relaxed);
+            });
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    SoakSample total{};
+    total.targetFrameRate = frameRate;
+
+    const uint64_t startAllocations = allocationCount.load(std::memory_order_relaxed);
+    uint64_t       lastAllocations  = startAllocations;
+    uint64_t       lastHandled      = 0;
+    uint64_t       lastBytes        = 0;
+    auto           lastTime         = start;
+
+    std::vector<double> intervalLatencies;
+    intervalLatencies.reserve(latencies.capacity());
+
+    const auto end = start + duration;
+    for (auto sampleTime = start + interval; lastTime < end; sampleTime += interval) {
+        sampleTime = std::min(sampleTime, end);
+        std::this_thread::sleep_until(sampleTime);
+
+        const auto   now     = Clock::now();
+        const double seconds = std::chrono::duration<double>(now - lastTime).count();
+
+        {
+            std::lock_guard<std::mutex> lock(latencyMutex);
+            intervalLatencies.swap(latencies);
+        }
+
+        SoakSample sample{};
+        sample.elapsed         = std::chrono::duration<double>(now - start).count();
+        sample.targetFrameRate = frameRate;
+        sample.framesGenerated = framesGenerated.load(std::memory_order_relaxed);
+        sample.framesHandled   = framesHandled.load(std::memory_order_relaxed);
+        queue.Sample(sample.queueBytes, sample.peakQueueBytes, sample.droppedBytes);
+
+        const uint64_t handled     = sample.framesHandled - lastHandled;
+        const uint64_t bytes       = bytesRead.load(std::memory_order_relaxed);
+        const uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+
+        sample.framesValid        = framesValid.load(std::memory_order_relaxed);
+        sample.framesPerSecond    = static_cast<double>(handled) / seconds;
+        sample.megabytesPerSecond = static_cast<double>(bytes - lastBytes) / 1e6 / seconds;
+        sample.residentBytes      = GetResidentBytes();
+        sample.allocations        = allocations - lastAllocations;
+        sample.liveAllocations    = allocations - freeCount.load(std::memory_order_relaxed);
+        sample.latencyP50         = Percentile(intervalLatencies, 0.5);
+        sample.latencyP99         = Percentile(intervalLatencies, 0.99);
+        sample.latencyP999        = Percentile(intervalLatencies, 0.999);
+        sample.latencyMax         = Percentile(intervalLatencies, 1.0);
+        intervalLatencies.clear();
+
+        if (onSample)
+            onSample(sample);
+
+        // The whole run reports totals, averages and the worst interval.
+        total.elapsed         = sample.elapsed;
+        total.framesGenerated = sample.framesGenerated;
+        total.framesHandled   = sample.framesHandled;
+        total.droppedBytes    = sample.droppedBytes;
+        total.queueBytes      = sample.queueBytes;
+        total.peakQueueBytes  = std::max(total.peakQueueBytes, sample.peakQueueBytes);
+        total.residentBytes   = std::max(total.residentBytes, sample.residentBytes);
+        total.liveAllocations = sample.liveAllocations;
+        total.latencyP50      = std::max(total.latencyP50, sample.latencyP50);
+        total.latencyP99      = std::max(total.latencyP99, sample.latencyP99);
+        total.latencyP999     = std::max(total.latencyP999, sample.latencyP999);
+        total.latencyMax      = std::max(total.latencyMax, sample.latencyMax);
+
+        lastAllocations = allocations;
+        lastHandled     = sample.framesHandled;
+        lastBytes       = bytes;
+        lastTime        = now;
+    }
+
+    producer.request_stop();
+    producer.join();
+    consumer.request_stop();
+    consumer.join();
+
+    total.framesPerSecond    = static_cast<double>(total.framesHandled) / total.elapsed;
+    total.megabytesPerSecond = static_cast<double>(lastBytes) / 1e6 / total.elapsed;
+    total.allocations        = lastAllocations - startAllocations;
+    total.framesValid        = framesValid.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+auto SoakTest::IsSustained(const SoakSample &sample) const noexcept -> bool {
+    const double target = sample.targetFrameRate * sample.elapsed;
+
+    // A frame or two in flight is expected when the run stops. Only a growing backlog fails.
+    const double frameBytes =
+        sample.framesPerSecond > 0 ? sample.megabytesPerSecond * 1e6 / sample.framesPerSecond : 0;
+    const double queueLimit =
+        std::max(static_cast<double>(config.queueCapacity) * SUSTAINED_QUEUE_RATIO,
+                 frameBytes * SUSTAINED_QUEUE_FRAMES);
+
+    return sample.droppedBytes == 0 &&
+           static_cast<double>(sample.framesGenerated) >= target * SUSTAINED_GENERATED_RATIO &&
+           static_cast<double>(sample.framesHandled) >=
+               static_cast<double>(sample.framesValid) * SUSTAINED_HANDLED_RATIO &&
+           static_cast<double>(sample.queueBytes) < queueLimit;
+}
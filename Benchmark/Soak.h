@@ -0,0 +1,181 @@
+#pragma once
+
+#include "IWR1443/FrameGenerator.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct SoakConfig {
+    /// @brief
+    ///   Configuration of generated frames, including TLV mix and injected errors.
+    iwr1443::FrameGeneratorConfig generator;
+
+    /// @brief
+    ///   Path of the file sink that serialized frames are written to.
+    std::string sinkPath;
+
+    /// @brief
+    ///   Capacity in bytes of the input queue in front of DataSerial::OnRead. Bytes that do not
+    ///   fit are dropped like a driver input queue overflow.
+    size_t queueCapacity;
+
+    /// @brief
+    ///   Maximum number of bytes passed to each DataSerial::OnRead call.
+    size_t readSize;
+};
+
+struct SoakSample {
+    /// @brief
+    ///   Seconds since the run started.
+    double elapsed;
+
+    /// @brief
+    ///   Target frame rate of the run.
+    double targetFrameRate;
+
+    /// @brief
+    ///   Number of frames generated since the run started.
+    uint64_t framesGenerated;
+
+    /// @brief
+    ///   Number of generated frames that are not dropped, corrupted or truncated on purpose.
+    uint64_t framesValid;
+
+    /// @brief
+    ///   Number of frames written to the file sink since the run started.
+    uint64_t framesHandled;
+
+    /// @brief
+    ///   Number of bytes dropped by the input queue since the run started.
+    uint64_t droppedBytes;
+
+    /// @brief
+    ///   Frames written to the file sink per second during this interval.
+    double framesPerSecond;
+
+    /// @brief
+    ///   Megabytes of data port stream consumed per second during this interval.
+    double megabytesPerSecond;
+
+    /// @brief
+    ///   Bytes waiting in the input queue at the end of this interval.
+    size_t queueBytes;
+
+    /// @brief
+    ///   Peak bytes waiting in the input queue during this interval.
+    size_t peakQueueBytes;
+
+    /// @brief
+    ///   Resident set size of the process in bytes.
+    size_t residentBytes;
+
+    /// @brief
+    ///   Number of heap allocations during this interval.
+    uint64_t allocations;
+
+    /// @brief
+    ///   Number of heap allocations that are not freed yet.
+    uint64_t liveAllocations;
+
+    /// @brief
+    ///   Latency percentiles in microseconds from the last byte of a frame entering the input queue
+    ///   to its JSON being written to the file sink, during this interval.
+    double latencyP50;
+    double latencyP99;
+    double latencyP999;
+    double latencyMax;
+};
+
+struct RampStep {
+    /// @brief
+    ///   Result of the whole step.
+    SoakSample sample;
+
+    /// @brief
+    ///   Whether the pipeline kept up at this rate.
+    bool sustained;
+};
+
+struct RampReport {
+    /// @brief
+    ///   All steps in the order they ran.
+    std::vector<RampStep> steps;
+
+    /// @brief
+    ///   Highest frame rate that is sustained.
+    double maxFrameRate;
+
+    /// @brief
+    ///   Data port throughput at the highest sustained frame rate in megabytes per second.
+    double maxMegabytesPerSecond;
+};
+
+/// @brief
+///   Pushes generated frames through DataSerial::OnRead, HandleFrame and a FileWriter sink. A
+///   producer thread enqueues frames at a fixed rate and a consumer thread reads them like the IO
+///   thread does.
+class SoakTest {
+public:
+    /// @brief
+    ///   Create a soak test.
+    ///
+    /// @param config   The test configuration.
+    explicit SoakTest(const SoakConfig &config) noexcept;
+
+    /// @brief
+    ///   Destroy this soak test.
+    ~SoakTest() noexcept;
+
+    /// @brief
+    ///   Raise frame rate until frames are dropped or the input queue grows, then bisect between
+    ///   the last sustained rate and the first failed rate.
+    ///
+    /// @param startRate        Frame rate of the first step.
+    /// @param stepDuration     Duration of each step.
+    /// @param onStep           Called after each step.
+    ///
+    /// @return RampReport
+    ///   Return results of all steps and the maximum sustainable rate.
+    auto Ramp(double                                       startRate,
+              std::chrono::seconds                         stepDuration,
+              const std::function<void(const RampStep &)> &onStep) noexcept -> RampReport;
+
+    /// @brief
+    ///   Run at a fixed frame rate for a long time.
+    ///
+    /// @param frameRate    The frame rate.
+    /// @param duration     Duration of the run.
+    /// @param interval     Interval between samples.
+    /// @param onSample     Called with a sample of each interval.
+    ///
+    /// @return SoakSample
+    ///   Return the sample of the whole run.
+    auto Soak(double                                         frameRate,
+              std::chrono::seconds                           duration,
+              std::chrono::seconds                           interval,
+              const std::function<void(const SoakSample &)> &onSample) noexcept -> SoakSample;
+
+    /// @brief
+    ///   Format a sample as a single line JSON object.
+    static auto ToJSON(const SoakSample &sample) noexcept -> std::string;
+
+private:
+    /// @brief
+    ///   Run the pipeline at the specified rate.
+    auto Run(double                                         frameRate,
+             std::chrono::seconds                           duration,
+             std::chrono::seconds                           interval,
+             const std::function<void(const SoakSample &)> &onSample) noexcept -> SoakSample;
+
+    /// @brief
+    ///   Check whether a run kept up with its target rate.
+    auto IsSustained(const SoakSample &sample) const noexcept -> bool;
+
+private:
+    /// @brief
+    ///   The test configuration.
+    SoakConfig config;
+};
@@ -0,0 +1,505 @@
+// Synthetic IWR1443 device over pseudo-terminals.
+//
+// The simulator opens one pty for the CLI port and one for the data port and prints their paths.
+// Point ControlSerial and DataSerial at the printed paths to exercise the capture stack without
+// the physical radar. CLI commands are echoed and answered with the mmWave demo prompt.
+// sensorStart and sensorStop control streaming, guiMonitor selects TLVs and frameCfg sets frame
+// rate.
+//
+// Build on Linux with GCC 13 or later from the repository root:
+//   cmake -S . -B build && cmake --build build --target iwr1443sim
+//
+// Usage:
+//   iwr1443sim [--rate fps] [--points n] [--targets n] [--reflectors n] [--range-bins n]
+//              [--tlvs t1,t2,...] [--baud n] [--drift ppm] [--corrupt p] [--drop p]
+//              [--truncate p] [--garbage p] [--seed n] [--link prefix] [--start]
+
+#include "IWR1443/FrameGenerator.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace iwr1443;
+
+static constexpr const std::string_view PROMPT = "mmwDemo:/>";
+
+// Commands of the mmWave demo that are accepted without effect.
+static constexpr const std::string_view CONFIG_COMMANDS[] = {
+    "dfeDataOutputMode",
+    "channelCfg",
+    "adcCfg",
+    "adcbufCfg",
+    "profileCfg",
+    "chirpCfg",
+    "lowPower",
+    "cfarCfg",
+    "peakGrouping",
+    "multiObjBeamForming",
+    "clutterRemoval",
+    "calibDcRangeSig",
+    "extendedMaxVelocity",
+    "compRangeBiasAndRxChanPhase",
+    "measureRangeBiasAndRxChanPhase",
+    "CQRxSatMonitor",
+    "CQSigImgMonitor",
+    "analogMonitor",
+    "bpmCfg",
+    "lvdsStreamCfg",
+    "flushCfg",
+};
+
+// TLVs that are controlled by each field of guiMonitor, in field order.
+static constexpr const TLVType GUI_MONITOR_TLVS[][2] = {
+    {TLVType::DetectedPoints, TLVType::DetectedPointsSideInfo},
+    {TLVType::RangeProfile, TLVType::RangeProfile},
+    {TLVType::NoiseFloorProfile, TLVType::NoiseFloorProfile},
+    {TLVType::AzimuthStaticHeatmap, TLVType::AzimuthElevationStaticHeatmap},
+    {TLVType::RangeDopplerHeatmap, TLVType::RangeDopplerHeatmap},
+    {TLVType::Statistics, TLVType::TemperatureStatistics},
+};
+
+struct SimulatorOptions {
+    FrameGeneratorConfig generator;
+    std::string          link;
+    bool                 start;
+};
+
+struct PseudoTerminal {
+    /// @brief
+    ///   Master side that is used by the simulator.
+    int master;
+
+    /// @brief
+    ///   Slave side. Kept open so that master reads do not fail before a client connects.
+    int slave;
+
+    /// @brief
+    ///   Path to the slave side.
+    std::string path;
+};
+
+class Simulator {
+public:
+    /// @brief
+    ///   Create a simulator with the specified options.
+    explicit Simulator(const SimulatorOptions &options) noexcept
+        : generator(options.generator),
+          baudRate(options.generator.baudRate),
+          streaming(options.start),
+          overruns(0),
+          mutex() {}
+
+    /// @brief
+    ///   Serve CLI commands until stop is requested.
+    auto RunControl(int fd, std::stop_token stopToken) noexcept -> void {
+        std::string pending;
+        char        buffer[256];
+
+        while (!stopToken.stop_requested()) {
+            pollfd descriptor{fd, POLLIN, 0};
+            if (poll(&descriptor, 1, 100) <= 0)
+                continue;
+
+            const ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count <= 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            pending.append(buffer, static_cast<size_t>(count));
+
+            size_t end;
+            while ((end = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, end);
+                pending.erase(0, end + 1);
+
+                while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                    line.pop_back();
+
+                const std::string response = HandleCommand(line);
+                WriteAll(fd, response.data(), response.size(), stopToken);
+            }
+        }
+    }
+
+    /// @brief
+    ///   Stream frames until stop is requested.
+    auto RunData(int fd, std::stop_token stopToken) noexcept -> void {
+        using Clock = std::chrono::steady_clock;
+
+        std::vector<std::byte> frame;
+        auto                   nextFrame = Clock::now();
+
+        while (!stopToken.stop_requested()) {
+            double frameRate;
+            bool   started;
+
+            frame.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                frameRate = generator.GetConfig().frameRate;
+                started   = streaming;
+                if (started)
+                    generator.Generate(frame);
+            }
+
+            nextFrame += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / std::max(frameRate, 0.1)));
+
+            if (started)
+                WritePaced(fd, frame, nextFrame, stopToken);
+
+            const auto now = Clock::now();
+            if (nextFrame < now)
+                nextFrame = now;
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+
+    /// @brief
+    ///   Print statistics of generated frames.
+    auto PrintStatistics() noexcept -> void {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto                 &stats = generator.GetStatistics();
+        std::fputs(std::format("Generated {} frames, {} bytes. Injected {} corrupted, {} dropped, "
+                               "{} truncated, {} garbage. {} bytes overran the data port.\n",
+                               stats.frames,
+                               stats.bytes,
+                               stats.corrupted,
+                               stats.dropped,
+                               stats.truncated,
+                               stats.garbage,
+                               overruns.load())
+                       .c_str(),
+                   stdout);
+    }
+
+private:
+    /// @brief
+    ///   Handle one CLI line and build the response including echo and prompt.
+    auto HandleCommand(const std::string &line) noexcept -> std::string {
+        std::vector<std::string_view> args;
+        for (size_t begin = 0; begin < line.size();) {
+            const size_t end = std::min(line.find(' ', begin), line.size());
+            if (end > begin)
+                args.emplace_back(line.data() + begin, end - begin);
+            begin = end + 1;
+        }
+
+        std::string response = line + "\r\n";
+        if (args.empty() || args[0].starts_with('%'))
+            return response.append(PROMPT);
+
+        const std::string_view command = args[0];
+        std::string            output;
+        bool                   success = true;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (command == "sensorStart") {
+                if (streaming)
+                    output = "Ignored: Sensor is already started\r\n";
+                streaming = true;
+            } else if (command == "sensorStop") {
+                if (!streaming)
+                    output = "Ignored: Sensor is already stopped\r\n";
+                streaming = false;
+            } else if (command == "version") {
+                output = "Platform                : xWR14xx\r\n"
+                         "mmWave SDK Version      : 02.01.00.04\r\n"
+                         "Device Info             : IWR14XX QM ES 03.00\r\n"
+                         "RF F/W Version          : 01.02.02.00\r\n"
+                         "mmWaveLink Version      : 01.02.01.01\r\n";
+            } else if (command == "queryDemoStatus") {
+                output =
+                    FormatDemoStatus(streaming ? SensorState::Started : SensorState::Stopped);
+            } else if (command == "guiMonitor") {
+                success = SetGuiMonitor(args);
+            } else if (command == "frameCfg") {
+                success = SetFrameConfig(args);
+            } else if (std::find(std::begin(CONFIG_COMMANDS), std::end(CONFIG_COMMANDS), command) ==
+                       std::end(CONFIG_COMMANDS)) {
+                std::format_to(std::back_inserter(response),
+                               "'{}' is not recognized as a CLI command\r\n",
+                               command);
+                return response.append(PROMPT);
+            }
+        }
+
+        response.append(output);
+        response.append(success ? "Done\r\n" : "Error -1\r\n");
+        return response.append(PROMPT);
+    }
+
+    /// @brief
+    ///   Enable TLVs according to guiMonitor arguments. Caller must hold the mutex.
+    auto SetGuiMonitor(const std::vector<std::string_view> &args) noexcept -> bool {
+        // Subframe index is optional.
+        constexpr const size_t fieldCount = std::size(GUI_MONITOR_TLVS);
+        if (args.size() != fieldCount + 1 && args.size() != fieldCount + 2)
+            return false;
+
+        const size_t first = args.size() - fieldCount;
+        for (size_t i = 0; i < fieldCount; ++i) {
+            // detectedObjects 1 emits points only and 2 also emits side info.
+            const std::string_view value = args[first + i];
+            const bool             main  = (value != "0");
+            const bool             extra = (i == 0) ? (value == "2") : main;
+
+            generator.SetTLVEnabled(GUI_MONITOR_TLVS[i][0], main);
+            generator.SetTLVEnabled(GUI_MONITOR_TLVS[i][1], extra);
+        }
+        return true;
+    }
+
+    /// @brief
+    ///   Set frame rate from the frame periodicity of frameCfg. Caller must hold the mutex.
+    auto SetFrameConfig(const std::vector<std::string_view> &args) noexcept -> bool {
+        if (args.size() != 8)
+            return false;
+
+        const std::string periodicity(args[5]);
+        const double      milliseconds = std::strtod(periodicity.c_str(), nullptr);
+        if (milliseconds <= 0)
+            return false;
+
+        generator.SetFrameRate(1000.0 / milliseconds);
+        return true;
+    }
+
+    /// @brief
+    ///   Write all bytes unless stop is requested.
+    static auto WriteAll(int fd, const char *data, size_t size, std::stop_token stopToken) noexcept
+        -> void {
+        while (size != 0 && !stopToken.stop_requested()) {
+            const ssize_t count = write(fd, data, size);
+            if (count > 0) {
+                data += count;
+                size -= static_cast<size_t>(count);
+            } else {
+                pollfd descriptor{fd, POLLOUT, 0};
+                poll(&descriptor, 1, 100);
+            }
+        }
+    }
+
+    /// @brief
+    ///   Write a frame no faster than the configured baud rate. Bytes that could not be written
+    ///   before @p deadline are dropped like a UART overrun.
+    auto WritePaced(int                                   fd,
+                    const std::vector<std::byte>         &frame,
+                    std::chrono::steady_clock::time_point deadline,
+                    std::stop_token                       stopToken) noexcept -> void {
+        using Clock = std::chrono::steady_clock;
+
+        const auto   start   = Clock::now();
+        const double rate    = baudRate / 10.0;
+        size_t       written = 0;
+
+        while (written < frame.size() && !stopToken.stop_requested()) {
+            const auto now = Clock::now();
+            if (now >= deadline)
+                break;
+
+            size_t allowed = frame.size() - written;
+            if (rate > 0) {
+                const double elapsed = std::chrono::duration<double>(now - start).count();
+                const size_t budget  = static_cast<size_t>(elapsed * rate) + 64;
+                allowed = budget > written ? std::min(allowed, budget - written) : 0;
+            }
+
+            ssize_t count = 0;
+            if (allowed != 0)
+                count = write(fd, frame.data() + written, allowed);
+
+            if (count > 0)
+                written += static_cast<size_t>(count);
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        overruns += frame.size() - written;
+    }
+
+private:
+    /// @brief
+    ///   Frame generator. Protected by the mutex.
+    FrameGenerator generator;
+
+    /// @brief
+    ///   Baud rate of the data port. 0 means unlimited.
+    uint32_t baudRate;
+
+    /// @brief
+    ///   Whether the sensor is started. Protected by the mutex.
+    bool streaming;
+
+    /// @brief
+    ///   Number of bytes that are dropped because the client did not keep up.
+    std::atomic<uint64_t> overruns;
+
+    /// @brief
+    ///   Mutex that is used to protect generator and streaming state.
+    std::mutex mutex;
+};
+
+static auto OpenPseudoTerminal(PseudoTerminal &terminal) noexcept -> bool {
+    terminal.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (terminal.master < 0 || grantpt(terminal.master) != 0 || unlockpt(terminal.master) != 0)
+        return false;
+
+    const char *path = ptsname(terminal.master);
+    if (path == nullptr)
+        return false;
+    terminal.path = path;
+
+    terminal.slave = open(path, O_RDWR | O_NOCTTY);
+    if (terminal.slave < 0)
+        return false;
+
+    // Bytes must pass through unchanged like a real UART.
+    termios attributes{};
+    tcgetattr(terminal.slave, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(terminal.slave, TCSANOW, &attributes);
+
+    fcntl(terminal.master, F_SETFL, fcntl(terminal.master, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+static auto ParseOptions(int argc, char *argv[], SimulatorOptions &options) noexcept -> bool {
+    options.generator = FrameGenerator::DefaultConfig();
+    options.start     = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--start") {
+            options.start = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            return false;
+
+        const char *value = argv[++i];
+        auto       &config = options.generator;
+
+        if (option == "--rate")
+            config.frameRate = std::strtod(value, nullptr);
+        else if (option == "--points")
+            config.pointCount = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--targets")
+            config.targetCount = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--reflectors")
+            config.reflectorCount = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--range-bins")
+            config.rangeBins = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--tlvs" && !FrameGenerator::ParseTLVs(value, config.tlvs))
+            return false;
+        else if (option == "--baud")
+            config.baudRate = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--drift")
+            config.clockDrift = std::strtod(value, nullptr);
+        else if (option == "--corrupt")
+            config.corruptProbability = std::strtod(value, nullptr);
+        else if (option == "--drop")
+            config.dropProbability = std::strtod(value, nullptr);
+        else if (option == "--truncate")
+            config.truncateProbability = std::strtod(value, nullptr);
+        else if (option == "--garbage")
+            config.garbageProbability = std::strtod(value, nullptr);
+        else if (option == "--seed")
+            config.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (option == "--link")
+            options.link = value;
+        else if (option != "--tlvs")
+            return false;
+    }
+
+    // Point count is stored in a 16-bit field of DetectedPoints TLV.
+    return options.generator.frameRate > 0 &&
+           uint64_t(options.generator.pointCount) + options.generator.reflectorCount <= UINT16_MAX;
+}
+
+auto main(int argc, char *argv[]) -> int {
+    SimulatorOptions options{};
+    if (!ParseOptions(argc, argv, options)) {
+        std::fputs("Invalid arguments. See header of Simulator/Main.cpp for usage.\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    PseudoTerminal control{-1, -1, {}};
+    PseudoTerminal data{-1, -1, {}};
+    if (!OpenPseudoTerminal(control) || !OpenPseudoTerminal(data)) {
+        const std::string message =
+            std::format("Failed to open pseudo terminal: {}\n", std::strerror(errno));
+        std::fputs(message.c_str(), stderr);
+        return EXIT_FAILURE;
+    }
+
+    if (!options.link.empty()) {
+        const std::string controlLink = options.link + "-cli";
+        const std::string dataLink    = options.link + "-data";
+        unlink(controlLink.c_str());
+        unlink(dataLink.c_str());
+        if (symlink(control.path.c_str(), controlLink.c_str()) != 0 ||
+            symlink(data.path.c_str(), dataLink.c_str()) != 0)
+            std::fputs(std::format("Failed to create links: {}\n", std::strerror(errno)).c_str(),
+                       stderr);
+    }
+
+    std::fputs(std::format("CLI port: {}\nData port: {}\n", control.path, data.path).c_str(),
+               stdout);
+    std::fflush(stdout);
+
+    // Signals are waited for by the main thread only.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Simulator simulator(options);
+
+    {
+        std::jthread controlThread([&](std::stop_token stopToken) -> void {
+            simulator.RunControl(control.master, stopToken);
+        });
+        std::jthread dataThread([&](std::stop_token stopToken) -> void {
+            simulator.RunData(data.master, stopToken);
+        });
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+    }
+
+    simulator.PrintStatistics();
+
+    if (!options.link.empty()) {
+        unlink((options.link + "-cli").c_str());
+        unlink((options.link + "-data").c_str());
+    }
+
+    close(control.slave);
+    close(control.master);
+    close(data.slave);
+    close(data.master);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "ConsoleSink.h"
+
+#include <algorithm>
+#include <format>
+
+ConsoleSink::ConsoleSink(HANDLE output, size_t capacity, std::chrono::milliseconds coalesceDelay)
+    : output(output),
+      capacity(capacity),
+      coalesceDelay(coalesceDelay),
+      pending(),
+      droppedBytes(0),
+      totalDroppedBytes(0),
+      pendingMutex(),
+      pendingCondition(),
+      thread() {
+    pending.reserve(capacity);
+    thread = std::jthread([this](std::stop_token stopToken) -> void { Run(stopToken); });
+}
+
+ConsoleSink::~ConsoleSink() {
+    thread.request_stop();
+    thread.join();
+}
+
+auto ConsoleSink::Write(const void *data, size_t size) noexcept -> void {
+    bool wakeUp;
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pending.size() + size > capacity) {
+            droppedBytes += size;
+            totalDroppedBytes.fetch_add(size, std::memory_order_relaxed);
+            return;
+        }
+
+        wakeUp = pending.empty();
+        pending.insert(pending.end(),
+                       static_cast<const char *>(data),
+                       static_cast<const char *>(data) + size);
+    }
+
+    if (wakeUp)
+        pendingCondition.notify_one();
+}
+
+auto ConsoleSink::Run(std::stop_token stopToken) -> void {
+    std::vector<char> writeBuffer;
+    writeBuffer.reserve(capacity);
+
+    // Size of the incomplete line at the end of write buffer and when it started.
+    size_t                                tailSize = 0;
+    std::chrono::steady_clock::time_point tailTime;
+
+    for (;;) {
+        size_t dropped;
+
+        { // Wait for new data. Hold incomplete line for at most coalesceDelay.
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            if (tailSize == 0)
+                pendingCondition.wait(
+                    lock, stopToken, [this]() -> bool { return !pending.empty(); });
+            else
+                pendingCondition.wait_for(
+                    lock, stopToken, coalesceDelay, [this]() -> bool { return !pending.empty(); });
+
+            writeBuffer.insert(writeBuffer.end(), pending.begin(), pending.end());
+            pending.clear();
+            dropped      = droppedBytes;
+            droppedBytes = 0;
+        }
+
+        const bool stopping = stopToken.stop_requested();
+        if (dropped != 0)
+            std::format_to(std::back_inserter(writeBuffer),
+                           "\n[Console could not keep up, {} bytes dropped.]\n",
+                           dropped);
+
+        // Coalesce complete lines. Incomplete line is held for at most coalesceDelay.
+        const auto now       = std::chrono::steady_clock::now();
+        size_t     writeSize = writeBuffer.size();
+        if (!stopping && (tailSize == 0 || now - tailTime < coalesceDelay)) {
+            auto lastLine = std::find(writeBuffer.rbegin(), writeBuffer.rend(), '\n');
+            writeSize     = static_cast<size_t>(writeBuffer.rend() - lastLine);
+        }
+
+        if (writeSize != 0)
+            WriteFile(output, writeBuffer.data(), static_cast<DWORD>(writeSize), nullptr, nullptr);
+
+        writeBuffer.erase(writeBuffer.begin(), writeBuffer.begin() + writeSize);
+        if (writeSize != 0 || tailSize == 0)
+            tailTime = now;
+        tailSize = writeBuffer.size();
+
+        if (stopping) {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if (pending.empty())
+                break;
+        }
+    }
+}
+
+auto ConsoleSink::GetSingleton() noexcept -> ConsoleSink * {
+    static ConsoleSink instance(GetStdHandle(STD_OUTPUT_HANDLE));
+    return &instance;
+}
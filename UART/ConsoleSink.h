@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ConsoleSink {
+public:
+    /// @brief
+    ///   Create a console sink that writes to the specified handle through a background thread.
+    ///
+    /// @param output           The console handle to write to.
+    /// @param capacity         Maximum size in byte of data waiting to be written. Data is dropped
+    ///                         once the console could not keep up.
+    /// @param coalesceDelay    Maximum time to hold an incomplete line before writing it.
+    ConsoleSink(HANDLE                    output,
+                size_t                    capacity      = 1024 * 1024,
+                std::chrono::milliseconds coalesceDelay = std::chrono::milliseconds(20));
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    ConsoleSink(const ConsoleSink &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const ConsoleSink &) = delete;
+
+    /// @brief
+    ///   Stop the background thread and write all pending data to console.
+    ~ConsoleSink();
+
+    /// @brief
+    ///   Append data to the console. This method never waits for the console. Data is dropped if
+    ///   the console could not keep up.
+    ///
+    /// @param[in] data     Pointer to start of data to be written.
+    /// @param     size     Size in byte of data to be written.
+    auto Write(const void *data, size_t size) noexcept -> void;
+
+    /// @brief
+    ///   Get total number of bytes dropped since this sink is created.
+    ///
+    /// @return uint64_t
+    ///   Return total number of bytes dropped.
+    auto GetDroppedBytes() const noexcept -> uint64_t {
+        return totalDroppedBytes.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Get stdout console sink singleton instance. This instance is created when this function
+    ///   is called for the first time.
+    ///
+    /// @return ConsoleSink *
+    ///   Return pointer to the console sink instance.
+    static auto GetSingleton() noexcept -> ConsoleSink *;
+
+private:
+    /// @brief
+    ///   Background thread entry. Writes complete lines to console.
+    auto Run(std::stop_token stopToken) -> void;
+
+private:
+    /// @brief
+    ///   The console handle to write to.
+    HANDLE output;
+
+    /// @brief
+    ///   Maximum size in byte of pending data.
+    size_t capacity;
+
+    /// @brief
+    ///   Maximum time to hold an incomplete line.
+    std::chrono::milliseconds coalesceDelay;
+
+    /// @brief
+    ///   Data waiting to be written by the background thread.
+    std::vector<char> pending;
+
+    /// @brief
+    ///   Number of bytes dropped since last time the background thread reported it.
+    size_t droppedBytes;
+
+    /// @brief
+    ///   Total number of bytes dropped.
+    std::atomic<uint64_t> totalDroppedBytes;
+
+    /// @brief
+    ///   Mutex that is used to protect @p pending and @p droppedBytes.
+    std::mutex pendingMutex;
+
+    /// @brief
+    ///   Condition variable that is used to wake up the background thread.
+    std::condition_variable_any pendingCondition;
+
+    /// @brief
+    ///   Background console thread. Declared last so that it starts after other members.
+    std::jthread thread;
+};
@@ -0,0 +1,59 @@
+#include "FileWriter.h"
+#include "Trace.h"
+
+#include <string>
+
+FileWriter::FileWriter() noexcept
+    : fileHandle(INVALID_HANDLE_VALUE),
+      writtenBytesCounter(MetricRegistry::GetSingleton()->GetCounter("writer_written_bytes")),
+      writeHistogram(MetricRegistry::GetSingleton()->GetHistogram("writer_write_ns")) {}
+
+FileWriter::~FileWriter() noexcept {
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+}
+
+auto FileWriter::Open(std::string_view path) noexcept -> std::error_code {
+    const int count =
+        MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+
+    if (count <= 0)
+        return std::error_code(GetLastError(), std::system_category());
+
+    std::wstring widePath;
+    widePath.resize(static_cast<size_t>(count));
+
+    MultiByteToWideChar(
+        CP_UTF8, 0, path.data(), static_cast<int>(path.size()), widePath.data(), count);
+
+    HANDLE newFile = CreateFile(widePath.c_str(),
+                                GENERIC_WRITE,
+                                FILE_SHARE_READ,
+                                nullptr,
+                                CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+
+    if (newFile == INVALID_HANDLE_VALUE)
+        return std::error_code(GetLastError(), std::system_category());
+
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+
+    fileHandle = newFile;
+    return std::error_code();
+}
+
+auto FileWriter::Write(const void *data, size_t size) noexcept -> std::error_code {
+    TRACE_SPAN_ARG("FileWriter::Write", size);
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!WriteFile(fileHandle, data, static_cast<DWORD>(size), nullptr, nullptr))
+        return std::error_code(GetLastError(), std::system_category());
+
+    writtenBytesCounter.Add(size);
+    writeHistogram.RecordSince(start);
+    return std::error_code();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Metrics.h"
+
+#include <Windows.h>
+
+#include <string_view>
+#include <system_error>
+
+class FileWriter {
+public:
+    /// @brief
+    ///   Create an null json writer.
+    FileWriter() noexcept;
+
+    /// @brief
+    ///   Destroy this json writer.
+    ~FileWriter() noexcept;
+
+    /// @brief
+    ///   Try to open the specified file as output file.
+    auto Open(std::string_view path) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Try to append data to the end of file.
+    auto Write(const void *data, size_t size) noexcept -> std::error_code;
+
+private:
+    /// @brief
+    ///   Handle of the json file.
+    HANDLE fileHandle;
+
+    /// @brief
+    ///   Number of bytes written to the json file.
+    MetricCounter writtenBytesCounter;
+
+    /// @brief
+    ///   Time in nanoseconds to write data to the json file.
+    MetricHistogram writeHistogram;
+};
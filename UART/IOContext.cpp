@@ -1,11 +1,15 @@
 #include "IOContext.h"
 #include "Log.h"
+#include "Trace.h"
 
 #include <limits>
 
 static constexpr const ULONG_PTR QUIT_HANDLE = std::numeric_limits<ULONG_PTR>::max();
 
-IOContext::IOContext() noexcept : ioCompletePort(nullptr) {}
+IOContext::IOContext() noexcept
+    : ioCompletePort(nullptr),
+      completionCounter(MetricRegistry::GetSingleton()->GetCounter("io_completions")),
+      dispatchHistogram(MetricRegistry::GetSingleton()->GetHistogram("io_dispatch_ns")) {}
 
 IOContext::~IOContext() noexcept {
     if (ioCompletePort != nullptr) {
@@ -45,6 +49,20 @@ auto IOContext::Register(IAsync *connection) noexcept -> std::error_code {
     return std::error_code();
 }
 
+auto IOContext::Post(IAsync *connection, DWORD bytesTransferred, OVERLAPPED *overlapped) noexcept
+    -> std::error_code {
+    if (!PostQueuedCompletionStatus(ioCompletePort,
+                                    bytesTransferred,
+                                    reinterpret_cast<ULONG_PTR>(connection),
+                                    overlapped)) {
+        DWORD errorCode = GetLastError();
+        LogError("Failed to post completion to IO complete port: {}.", errorCode);
+        return std::error_code(errorCode, std::system_category());
+    }
+
+    return std::error_code();
+}
+
 auto IOContext::Run() noexcept -> std::error_code {
     DWORD       bytesTransferred;
     ULONG_PTR   completeKey;
@@ -58,16 +76,29 @@ auto IOContext::Run() noexcept -> std::error_code {
             return std::error_code(errorCode, std::system_category());
         }
 
+        // Each thread consumes exactly one quit notification, so that none is left behind and the
+        // IOContext could be run again.
         if (completeKey == QUIT_HANDLE)
             break;
 
-        IAsync *connection = reinterpret_cast<IAsync *>(completeKey);
-        connection->OnIOComplete(bytesTransferred, overlapped);
+        const auto start      = std::chrono::steady_clock::now();
+        IAsync    *connection = reinterpret_cast<IAsync *>(completeKey);
+
+        {
+            TRACE_SPAN_ARG("IOContext::Dispatch", bytesTransferred);
+            connection->OnIOComplete(bytesTransferred, overlapped);
+        }
+
+        completionCounter.Add();
+        dispatchHistogram.RecordSince(start);
     }
 
     return std::error_code();
 }
 
-auto IOContext::Quit() noexcept -> void {
-    PostQueuedCompletionStatus(ioCompletePort, 0, QUIT_HANDLE, nullptr);
+auto IOContext::Quit(uint32_t threadCount) noexcept -> void {
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        if (!PostQueuedCompletionStatus(ioCompletePort, 0, QUIT_HANDLE, nullptr))
+            LogError("Failed to post quit to IO complete port: {}.", GetLastError());
+    }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "IAsync.h"
+#include "Metrics.h"
 
+#include <cstdint>
 #include <system_error>
 
 class IOContext {
@@ -28,15 +30,43 @@ public:
     auto Register(IAsync *connection) noexcept -> std::error_code;
 
     /// @brief
-    ///   Start looping over all connections.
+    ///   Queue a completion for the specified connection. The connection does not need to be
+    ///   registered. OnIOComplete of the connection is called by the thread that runs this
+    ///   IOContext.
+    ///
+    /// @param[in] connection       The connection to be notified.
+    /// @param     bytesTransferred Number of bytes passed to OnIOComplete.
+    /// @param[in] overlapped       Overlapped pointer passed to OnIOComplete.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the post result.
+    auto Post(IAsync *connection, DWORD bytesTransferred, OVERLAPPED *overlapped) noexcept
+        -> std::error_code;
+
+    /// @brief
+    ///   Start looping over all connections. Several threads may run the same IOContext as a pool.
+    ///   Completions of one connection are not serialized: a read and a write completion of the
+    ///   same connection may be dispatched at the same time on different threads, so
+    ///   OnIOComplete must protect state that both of them touch.
     auto Run() noexcept -> std::error_code;
 
     /// @brief
-    ///   Stop looping of this IOContext.
-    auto Quit() noexcept -> void;
+    ///   Stop looping of this IOContext. Each thread quits after it takes one quit notification, so
+    ///   threads that have not entered Run yet still find theirs.
+    ///
+    /// @param threadCount  Number of threads that run this IOContext.
+    auto Quit(uint32_t threadCount) noexcept -> void;
 
 private:
     /// @brief
     ///   IO complete port handle.
     HANDLE ioCompletePort;
+
+    /// @brief
+    ///   Number of dispatched IO completions.
+    MetricCounter completionCounter;
+
+    /// @brief
+    ///   Time in nanoseconds spent in IO complete callbacks.
+    MetricHistogram dispatchHistogram;
 };
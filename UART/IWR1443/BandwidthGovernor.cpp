@@ -0,0 +1,257 @@
+#include "BandwidthGovernor.h"
+#include "../Log.h"
+
+#include <algorithm>
+#include <charconv>
+
+using namespace iwr1443;
+
+// Weight of a new sample in utilisation trend.
+static constexpr const double SMOOTHING = 0.1;
+
+// Number of frames ahead that utilisation is forecast.
+static constexpr const double FORECAST_FRAMES = 10.0;
+
+// Time to measure effect of an adjustment before the next one.
+static constexpr const std::chrono::seconds HOLD_TIME = std::chrono::seconds(2);
+
+// Time that utilisation should stay low before restoring a switch.
+static constexpr const std::chrono::seconds RESTORE_DELAY = std::chrono::seconds(5);
+
+/// @brief
+///   Get index of the guiMonitor switch that controls the specified TLV.
+///
+/// @return int
+///   Return index of the switch. Return -1 if the TLV is not controlled by guiMonitor.
+static auto GuiMonitorSwitch(TLVType type) noexcept -> int {
+    switch (type) {
+    case TLVType::DetectedPoints:
+    case TLVType::DetectedPointsSideInfo:
+        return 0;
+    case TLVType::RangeProfile:
+        return 1;
+    case TLVType::NoiseFloorProfile:
+        return 2;
+    case TLVType::AzimuthStaticHeatmap:
+    case TLVType::AzimuthElevationStaticHeatmap:
+        return 3;
+    case TLVType::RangeDopplerHeatmap:
+        return 4;
+    case TLVType::Statistics:
+    case TLVType::TemperatureStatistics:
+        return 5;
+    default:
+        return -1;
+    }
+}
+
+iwr1443::BandwidthGovernor::BandwidthGovernor(ControlSerial &control, const LinkBudget &linkBudget)
+    : control(control),
+      linkBudget(linkBudget),
+      highWatermark(0.9),
+      lowWatermark(0.7),
+      active(false),
+      subFrameIndex(),
+      configuredSwitches(),
+      currentSwitches(),
+      priorities{NeverDisable, 2, 1, 0, 0, 3},
+      disabled(),
+      utilisationTrend(0),
+      utilisation(0),
+      holdUntil(),
+      headroomSince(),
+      pendingCommand(),
+      mutex(),
+      commandCondition(),
+      thread() {
+    thread = std::jthread([this](std::stop_token stopToken) -> void { Run(stopToken); });
+}
+
+iwr1443::BandwidthGovernor::~BandwidthGovernor() {
+    thread.request_stop();
+    thread.join();
+}
+
+auto iwr1443::BandwidthGovernor::SetGuiMonitor(std::string_view command) noexcept -> bool {
+    std::vector<std::string_view> arguments;
+    for (std::string_view rest = command; !rest.empty();) {
+        const size_t start = rest.find_first_not_of(' ');
+        if (start == rest.npos)
+            break;
+
+        rest.remove_prefix(start);
+        const size_t end = std::min(rest.find(' '), rest.size());
+        arguments.push_back(rest.substr(0, end));
+        rest.remove_prefix(end);
+    }
+
+    if (arguments.empty() || arguments[0] != "guiMonitor" ||
+        (arguments.size() != GuiMonitorFieldCount + 1 &&
+         arguments.size() != GuiMonitorFieldCount + 2)) {
+        LogWarning("Bandwidth governor does not support command \"{}\".", command);
+        return false;
+    }
+
+    const size_t first = arguments.size() - GuiMonitorFieldCount;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    subFrameIndex = (first == 2) ? std::string(arguments[1]) : std::string();
+    for (size_t i = 0; i < GuiMonitorFieldCount; ++i) {
+        const std::string_view value = arguments[first + i];
+        std::from_chars(value.data(), value.data() + value.size(), configuredSwitches[i]);
+    }
+
+    currentSwitches = configuredSwitches;
+    disabled.clear();
+    active = true;
+    return true;
+}
+
+auto iwr1443::BandwidthGovernor::SetPriority(TLVType type, int priority) noexcept -> void {
+    const int index = GuiMonitorSwitch(type);
+    if (index < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    priorities[static_cast<size_t>(index)] = priority;
+}
+
+auto iwr1443::BandwidthGovernor::SetWatermarks(double high, double low) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    highWatermark = high;
+    lowWatermark  = low;
+}
+
+auto iwr1443::BandwidthGovernor::OnFrame() noexcept -> void {
+    const auto             now    = std::chrono::steady_clock::now();
+    const LinkBudgetReport report = linkBudget.GetReport();
+    if (report.frameRate <= 0)
+        return;
+
+    std::array<double, GuiMonitorFieldCount> switchBytes{};
+    for (const auto &tlv : report.tlvs) {
+        const int index = GuiMonitorSwitch(tlv.type);
+        if (index >= 0)
+            switchBytes[static_cast<size_t>(index)] += tlv.bytesPerFrame;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    utilisationTrend += SMOOTHING * ((report.utilisation - utilisation) - utilisationTrend);
+    utilisation = report.utilisation;
+
+    if (!active || now < holdUntil)
+        return;
+
+    const double forecast = utilisation + utilisationTrend * FORECAST_FRAMES;
+    if (forecast > highWatermark) {
+        // Disable the heaviest switch among those with the lowest priority.
+        size_t victim = GuiMonitorFieldCount;
+        for (size_t i = 0; i < GuiMonitorFieldCount; ++i) {
+            if (currentSwitches[i] == 0 || priorities[i] == NeverDisable || switchBytes[i] <= 0)
+                continue;
+
+            if (victim == GuiMonitorFieldCount || priorities[i] < priorities[victim] ||
+                (priorities[i] == priorities[victim] && switchBytes[i] > switchBytes[victim]))
+                victim = i;
+        }
+
+        if (victim == GuiMonitorFieldCount) {
+            LOG_RATE_LIMITED(LogLevel::Warning,
+                             0.1,
+                             1,
+                             "Data port utilisation {:.1f}% is forecast to exceed {:.1f}% but no "
+                             "TLV output could be disabled.",
+                             forecast * 100,
+                             highWatermark * 100);
+            return;
+        }
+
+        LogWarning("Data port utilisation {:.1f}% is forecast to exceed {:.1f}%. Disabling "
+                   "guiMonitor switch {} ({:.0f} bytes per frame).",
+                   forecast * 100,
+                   highWatermark * 100,
+                   victim,
+                   switchBytes[victim]);
+
+        disabled.emplace_back(victim, switchBytes[victim]);
+        currentSwitches[victim] = 0;
+        holdUntil               = now + HOLD_TIME;
+        headroomSince           = std::chrono::steady_clock::time_point();
+        QueueGuiMonitor();
+        return;
+    }
+
+    if (disabled.empty())
+        return;
+
+    // Restore the last disabled switch once utilisation with it stays low for a while.
+    const auto [index, savedBytes] = disabled.back();
+    const double restored          = linkBudget.ProjectUtilisation(savedBytes);
+    if (restored >= lowWatermark) {
+        headroomSince = std::chrono::steady_clock::time_point();
+        return;
+    }
+
+    if (headroomSince == std::chrono::steady_clock::time_point())
+        headroomSince = now;
+
+    if (now - headroomSince < RESTORE_DELAY)
+        return;
+
+    LogInfo("Data port utilisation {:.1f}% leaves headroom. Restoring guiMonitor switch {}.",
+            restored * 100,
+            index);
+
+    currentSwitches[index] = configuredSwitches[index];
+    disabled.pop_back();
+    holdUntil     = now + HOLD_TIME;
+    headroomSince = std::chrono::steady_clock::time_point();
+    QueueGuiMonitor();
+}
+
+auto iwr1443::BandwidthGovernor::GetUtilisation() const noexcept -> double {
+    std::lock_guard<std::mutex> lock(mutex);
+    return utilisation;
+}
+
+auto iwr1443::BandwidthGovernor::QueueGuiMonitor() noexcept -> void {
+    pendingCommand = "guiMonitor";
+    if (!subFrameIndex.empty())
+        std::format_to(std::back_inserter(pendingCommand), " {}", subFrameIndex);
+    for (int value : currentSwitches)
+        std::format_to(std::back_inserter(pendingCommand), " {}", value);
+
+    commandCondition.notify_one();
+}
+
+auto iwr1443::BandwidthGovernor::Run(std::stop_token stopToken) -> void {
+    for (;;) {
+        std::string command;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!commandCondition.wait(
+                    lock, stopToken, [this]() -> bool { return !pendingCommand.empty(); }))
+                break;
+
+            command.swap(pendingCommand);
+        }
+
+        // guiMonitor could only be changed while the sensor is stopped.
+        CommandResponse response = control.SendCommand("sensorStop").get();
+        if (response.error.value() == 0)
+            response = control.SendCommand(command).get();
+        if (response.error.value() == 0) {
+            response = control.SendCommand("sensorStart 0").get();
+            if (response.error == std::errc::invalid_argument)
+                response = control.SendCommand("sensorStart").get();
+        }
+
+        if (response.error.value() != 0)
+            LogError("Bandwidth governor failed to apply \"{}\": {}.",
+                     command,
+                     response.error.message());
+        else
+            LogInfo("Bandwidth governor applied \"{}\".", command);
+    }
+}
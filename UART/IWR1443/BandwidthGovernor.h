@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Data.h"
+#include "LinkBudget.h"
+#include "Serials.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace iwr1443 {
+
+class BandwidthGovernor {
+public:
+    /// @brief
+    ///   Number of output switches of guiMonitor command.
+    static constexpr const size_t GuiMonitorFieldCount = 6;
+
+    /// @brief
+    ///   Create a bandwidth governor for the specified sensor. The governor is inactive until the
+    ///   guiMonitor command of current config is set.
+    ///
+    /// @param control      The control serial connected to the sensor CLI port.
+    /// @param linkBudget   Link budget analyzer of the sensor data port.
+    BandwidthGovernor(ControlSerial &control, const LinkBudget &linkBudget);
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    BandwidthGovernor(const BandwidthGovernor &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const BandwidthGovernor &) = delete;
+
+    /// @brief
+    ///   Stop the governor. TLV outputs disabled by the governor are not restored.
+    ~BandwidthGovernor();
+
+    /// @brief
+    ///   Set the guiMonitor command that is applied to the sensor and activate this governor.
+    ///   Both "guiMonitor <6 switches>" and "guiMonitor <subFrameIdx> <6 switches>" forms are
+    ///   accepted.
+    ///
+    /// @param command  The guiMonitor command in current config.
+    ///
+    /// @return bool
+    ///   Return true if the command is parsed and the governor is activated.
+    auto SetGuiMonitor(std::string_view command) noexcept -> bool;
+
+    /// @brief
+    ///   Set priority of the specified TLV. TLVs with lower priority are disabled first under
+    ///   saturation, and the heaviest one is chosen among TLVs of the same priority. TLVs that
+    ///   share a guiMonitor switch share the same priority.
+    ///
+    /// @param type         The TLV type.
+    /// @param priority     The new priority. TLVs with NeverDisable priority are never disabled.
+    auto SetPriority(TLVType type, int priority) noexcept -> void;
+
+    /// @brief
+    ///   Set link utilisation thresholds. A TLV is disabled once forecast utilisation exceeds
+    ///   @p high, and restored once utilisation with it restored stays below @p low.
+    ///
+    /// @param high     Utilisation threshold to disable TLV output.
+    /// @param low      Utilisation threshold to restore TLV output.
+    auto SetWatermarks(double high, double low) noexcept -> void;
+
+    /// @brief
+    ///   Frame listener. Call this method from DataSerial for each frame after the link budget is
+    ///   updated. The decision is made from link budget statistics, so the frame itself is not
+    ///   needed.
+    auto OnFrame() noexcept -> void;
+
+    /// @brief
+    ///   Get measured data port utilisation.
+    ///
+    /// @return double
+    ///   Return ratio of measured throughput to data port capacity.
+    auto GetUtilisation() const noexcept -> double;
+
+    /// @brief
+    ///   Priority of TLVs that are never disabled.
+    static constexpr const int NeverDisable = std::numeric_limits<int>::max();
+
+private:
+    /// @brief
+    ///   Command thread entry. Applies guiMonitor changes to the sensor.
+    auto Run(std::stop_token stopToken) -> void;
+
+    /// @brief
+    ///   Queue guiMonitor command of current switches for the command thread.
+    auto QueueGuiMonitor() noexcept -> void;
+
+private:
+    /// @brief
+    ///   The control serial connected to the sensor CLI port.
+    ControlSerial &control;
+
+    /// @brief
+    ///   Link budget analyzer of the sensor data port.
+    const LinkBudget &linkBudget;
+
+    /// @brief
+    ///   Utilisation threshold to disable TLV output.
+    double highWatermark;
+
+    /// @brief
+    ///   Utilisation threshold to restore TLV output.
+    double lowWatermark;
+
+    /// @brief
+    ///   Whether the guiMonitor command is known and this governor is active.
+    bool active;
+
+    /// @brief
+    ///   Sub-frame index argument of guiMonitor command. Empty if the firmware does not take it.
+    std::string subFrameIndex;
+
+    /// @brief
+    ///   guiMonitor switches in the config.
+    std::array<int, GuiMonitorFieldCount> configuredSwitches;
+
+    /// @brief
+    ///   guiMonitor switches currently applied.
+    std::array<int, GuiMonitorFieldCount> currentSwitches;
+
+    /// @brief
+    ///   Priority of each guiMonitor switch.
+    std::array<int, GuiMonitorFieldCount> priorities;
+
+    /// @brief
+    ///   Switches disabled by this governor and their average bytes per frame before disabled.
+    ///   The last one is restored first.
+    std::vector<std::pair<size_t, double>> disabled;
+
+    /// @brief
+    ///   Average utilisation change per frame.
+    double utilisationTrend;
+
+    /// @brief
+    ///   Utilisation measured at last frame.
+    double utilisation;
+
+    /// @brief
+    ///   No adjustment is made before this time, so that effect of last adjustment is measured.
+    std::chrono::steady_clock::time_point holdUntil;
+
+    /// @brief
+    ///   Time since utilisation allows restoring the last disabled switch.
+    std::chrono::steady_clock::time_point headroomSince;
+
+    /// @brief
+    ///   guiMonitor command waiting for the command thread.
+    std::string pendingCommand;
+
+    /// @brief
+    ///   Mutex that is used to protect state of this governor.
+    mutable std::mutex mutex;
+
+    /// @brief
+    ///   Condition variable that is used to wake up the command thread.
+    std::condition_variable_any commandCondition;
+
+    /// @brief
+    ///   Command thread. Sensor commands could not be waited for in IO thread. Declared last so
+    ///   that it starts after other members.
+    std::jthread thread;
+};
+
+} // namespace iwr1443
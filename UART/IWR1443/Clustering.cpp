@@ -0,0 +1,295 @@
+#include "Clustering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+
+using namespace iwr1443;
+
+// Bits of each cell coordinate in a cell key.
+static constexpr const uint32_t CELL_BITS = 21;
+
+// Offset that maps signed cell coordinates to unsigned ones.
+static constexpr const int64_t CELL_OFFSET = int64_t(1) << (CELL_BITS - 1);
+
+// Largest cell coordinate magnitude. Leaves room for neighbour cells on both sides.
+static constexpr const float CELL_LIMIT = static_cast<float>(CELL_OFFSET - 2);
+
+// Key of unused hash table slots and of points with non-finite coordinates.
+static constexpr const uint64_t EMPTY_KEY = std::numeric_limits<uint64_t>::max();
+
+// End of a cell point list.
+static constexpr const uint32_t NO_POINT = std::numeric_limits<uint32_t>::max();
+
+// Minimum number of hash table slots.
+static constexpr const size_t MIN_SLOT_COUNT = 16;
+
+iwr1443::PointClusterer::PointClusterer(const ClusterConfig &config) noexcept
+    : config(config),
+      inverseCellSize(config.epsilon > 0 ? 1.0f / config.epsilon : 1.0f),
+      slotKeys(),
+      slotBegins(),
+      slotEnds(),
+      pointSlots(),
+      order(),
+      sorted(),
+      sortedKeys(),
+      sortedLabels(),
+      visited(),
+      neighbours(),
+      frontier(),
+      labels(),
+      clusters() {}
+
+iwr1443::PointClusterer::~PointClusterer() noexcept {}
+
+auto iwr1443::PointClusterer::DefaultConfig() noexcept -> ClusterConfig {
+    ClusterConfig config{};
+    config.epsilon       = 0.5f;
+    config.minPoints     = 3;
+    config.dopplerWeight = 0.5f;
+    config.snrWeight     = 0;
+    return config;
+}
+
+auto iwr1443::PointClusterer::Cluster(const PointCloud &cloud) -> size_t {
+    const size_t count = cloud.Size();
+
+    labels.assign(count, Noise);
+    pointSlots.resize(count);
+    clusters.clear();
+
+    if (count == 0)
+        return 0;
+
+    // At most a quarter of the slots are used, so that probes for empty cells end early.
+    size_t slotCount = MIN_SLOT_COUNT;
+    while (slotCount < count * 4)
+        slotCount *= 2;
+
+    slotKeys.assign(slotCount, EMPTY_KEY);
+    slotBegins.resize(slotCount);
+    slotEnds.resize(slotCount);
+
+    // Count points of each cell. Points with non-finite coordinates are left as noise.
+    for (size_t i = 0; i < count; ++i) {
+        if (!std::isfinite(cloud.x[i]) || !std::isfinite(cloud.y[i]) ||
+            !std::isfinite(cloud.z[i])) {
+            pointSlots[i] = NO_POINT;
+            continue;
+        }
+
+        const uint64_t key  = CellKey(cloud.x[i], cloud.y[i], cloud.z[i]);
+        const size_t   slot = FindSlot(key);
+        if (slotKeys[slot] == EMPTY_KEY) {
+            slotKeys[slot] = key;
+            slotEnds[slot] = 0;
+        }
+
+        ++slotEnds[slot];
+        pointSlots[i] = static_cast<uint32_t>(slot);
+    }
+
+    uint32_t sortedCount = 0;
+    for (size_t slot = 0; slot < slotCount; ++slot) {
+        if (slotKeys[slot] == EMPTY_KEY)
+            continue;
+
+        slotBegins[slot] = sortedCount;
+        sortedCount     += slotEnds[slot];
+        slotEnds[slot]   = slotBegins[slot];
+    }
+
+    order.resize(sortedCount);
+    sorted.Resize(sortedCount);
+    sortedKeys.resize(sortedCount);
+    sortedLabels.assign(sortedCount, Noise);
+    visited.assign(sortedCount, 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t slot = pointSlots[i];
+        if (slot == NO_POINT)
+            continue;
+
+        const uint32_t position = slotEnds[slot]++;
+        order[position]          = static_cast<uint32_t>(i);
+        sortedKeys[position]     = slotKeys[slot];
+        sorted.x[position]       = cloud.x[i];
+        sorted.y[position]       = cloud.y[i];
+        sorted.z[position]       = cloud.z[i];
+        sorted.doppler[position] = cloud.doppler[i] * config.dopplerWeight;
+        sorted.snr[position]     = cloud.snr[i] * config.snrWeight;
+    }
+
+    for (uint32_t i = 0; i < sortedCount; ++i) {
+        if (visited[i] != 0)
+            continue;
+
+        visited[i] = 1;
+        QueryNeighbours(i);
+        if (neighbours.size() < config.minPoints)
+            continue;
+
+        // Points are labelled when they are queued, so each point is queued at most once. Border
+        // points that are already visited join the cluster without being expanded.
+        const int32_t label = static_cast<int32_t>(clusters.size());
+        clusters.push_back(ClusterSummary{});
+        sortedLabels[i] = label;
+
+        frontier.clear();
+        for (;;) {
+            for (uint32_t neighbour : neighbours) {
+                if (sortedLabels[neighbour] != Noise)
+                    continue;
+
+                sortedLabels[neighbour] = label;
+                if (visited[neighbour] == 0)
+                    frontier.push_back(neighbour);
+            }
+
+            // Skip border points until a core point is found.
+            bool core = false;
+            while (!core && !frontier.empty()) {
+                const uint32_t point = frontier.back();
+                frontier.pop_back();
+
+                visited[point] = 1;
+                QueryNeighbours(point);
+                core = neighbours.size() >= config.minPoints;
+            }
+
+            if (!core)
+                break;
+        }
+    }
+
+    for (uint32_t i = 0; i < sortedCount; ++i)
+        labels[order[i]] = sortedLabels[i];
+
+    constexpr const float infinity = std::numeric_limits<float>::infinity();
+    for (auto &cluster : clusters) {
+        cluster.minimum[0] = cluster.minimum[1] = cluster.minimum[2] = infinity;
+        cluster.maximum[0] = cluster.maximum[1] = cluster.maximum[2] = -infinity;
+        cluster.peakSNR    = -infinity;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (labels[i] == Noise)
+            continue;
+
+        ClusterSummary &cluster = clusters[static_cast<size_t>(labels[i])];
+        const float     position[3]{cloud.x[i], cloud.y[i], cloud.z[i]};
+
+        ++cluster.pointCount;
+        cluster.x       += position[0];
+        cluster.y       += position[1];
+        cluster.z       += position[2];
+        cluster.doppler += cloud.doppler[i];
+        cluster.peakSNR  = std::max(cluster.peakSNR, cloud.snr[i]);
+        for (size_t axis = 0; axis < 3; ++axis) {
+            cluster.minimum[axis] = std::min(cluster.minimum[axis], position[axis]);
+            cluster.maximum[axis] = std::max(cluster.maximum[axis], position[axis]);
+        }
+    }
+
+    for (auto &cluster : clusters) {
+        const float scale = 1.0f / static_cast<float>(cluster.pointCount);
+        cluster.x       *= scale;
+        cluster.y       *= scale;
+        cluster.z       *= scale;
+        cluster.doppler *= scale;
+    }
+
+    return clusters.size();
+}
+
+auto iwr1443::PointClusterer::Serialize(uint32_t frameNumber, std::string &output) const -> void {
+    std::format_to(std::back_inserter(output), "{{\"Frame\": {}, \"Labels\": [", frameNumber);
+
+    for (size_t i = 0; i < labels.size(); ++i)
+        std::format_to(std::back_inserter(output), "{}{}", i == 0 ? "" : ", ", labels[i]);
+
+    output.append("], \"Clusters\": [");
+
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const ClusterSummary &cluster = clusters[i];
+        std::format_to(std::back_inserter(output),
+                       "{}{{\"Points\": {}, \"x\": {}, \"y\": {}, \"z\": {}, "
+                       "\"Min\": [{}, {}, {}], \"Max\": [{}, {}, {}], "
+                       "\"doppler\": {}, \"snr\": {}}}",
+                       i == 0 ? "" : ", ",
+                       cluster.pointCount,
+                       cluster.x,
+                       cluster.y,
+                       cluster.z,
+                       cluster.minimum[0],
+                       cluster.minimum[1],
+                       cluster.minimum[2],
+                       cluster.maximum[0],
+                       cluster.maximum[1],
+                       cluster.maximum[2],
+                       cluster.doppler,
+                       cluster.peakSNR);
+    }
+
+    output.append("]}, ");
+}
+
+auto iwr1443::PointClusterer::CellKey(float x, float y, float z) const noexcept -> uint64_t {
+    const auto cell = [this](float value) -> uint64_t {
+        const float index =
+            std::clamp(std::floor(value * inverseCellSize), -CELL_LIMIT, CELL_LIMIT);
+        return static_cast<uint64_t>(static_cast<int64_t>(index) + CELL_OFFSET);
+    };
+
+    return (cell(x) << (CELL_BITS * 2)) | (cell(y) << CELL_BITS) | cell(z);
+}
+
+auto iwr1443::PointClusterer::FindSlot(uint64_t key) const noexcept -> size_t {
+    const size_t mask = slotKeys.size() - 1;
+
+    // Fibonacci hashing mixes all coordinates into the high bits, which are folded down so that
+    // neighbouring cells spread over the table.
+    const uint64_t hash = key * 0x9E3779B97F4A7C15;
+    size_t         slot = static_cast<size_t>(hash ^ (hash >> 40)) & mask;
+    while (slotKeys[slot] != key && slotKeys[slot] != EMPTY_KEY)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+auto iwr1443::PointClusterer::QueryNeighbours(uint32_t point) -> void {
+    neighbours.clear();
+
+    const float epsilonSquared = config.epsilon * config.epsilon;
+    const float x              = sorted.x[point];
+    const float y              = sorted.y[point];
+    const float z              = sorted.z[point];
+    const float doppler        = sorted.doppler[point];
+    const float snr            = sorted.snr[point];
+
+    // Extra dimensions only add distance, so the 27 cells around the point hold all neighbours.
+    const uint64_t key = sortedKeys[point];
+    for (uint64_t dx = 0; dx < 3; ++dx) {
+        for (uint64_t dy = 0; dy < 3; ++dy) {
+            for (uint64_t dz = 0; dz < 3; ++dz) {
+                const uint64_t cell = key + ((dx - 1) << (CELL_BITS * 2)) +
+                                      ((dy - 1) << CELL_BITS) + (dz - 1);
+                const size_t slot = FindSlot(cell);
+                if (slotKeys[slot] == EMPTY_KEY)
+                    continue;
+
+                const uint32_t end = slotEnds[slot];
+                for (uint32_t other = slotBegins[slot]; other < end; ++other) {
+                    const float ex = sorted.x[other] - x;
+                    const float ey = sorted.y[other] - y;
+                    const float ez = sorted.z[other] - z;
+                    const float ed = sorted.doppler[other] - doppler;
+                    const float es = sorted.snr[other] - snr;
+                    if (ex * ex + ey * ey + ez * ez + ed * ed + es * es <= epsilonSquared)
+                        neighbours.push_back(other);
+                }
+            }
+        }
+    }
+}
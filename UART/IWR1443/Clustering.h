@@ -0,0 +1,208 @@
+#pragma once
+
+#include "PointCloud.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace iwr1443 {
+
+struct ClusterConfig {
+    /// @brief
+    ///   Neighbourhood radius in meters. Points within this distance of each other are neighbours.
+    float epsilon;
+
+    /// @brief
+    ///   Minimum number of neighbours, including the point itself, for a point to grow a cluster.
+    uint32_t minPoints;
+
+    /// @brief
+    ///   Meters of distance per m/s of doppler difference. 0 clusters on position only.
+    float dopplerWeight;
+
+    /// @brief
+    ///   Meters of distance per dB of SNR difference. 0 ignores SNR.
+    float snrWeight;
+};
+
+struct ClusterSummary {
+    /// @brief
+    ///   Number of points in this cluster.
+    uint32_t pointCount;
+
+    /// @brief
+    ///   Mean position in meters.
+    float x;
+    float y;
+    float z;
+
+    /// @brief
+    ///   Axis aligned bounding box in meters.
+    float minimum[3];
+    float maximum[3];
+
+    /// @brief
+    ///   Mean radial velocity in meters per second.
+    float doppler;
+
+    /// @brief
+    ///   Highest SNR of points in this cluster in dB.
+    float peakSNR;
+};
+
+/// @brief
+///   Density based clustering (DBSCAN) of point clouds. Neighbours are searched in a uniform grid
+///   whose cell size is the neighbourhood radius, so each query visits at most 27 cells. Points
+///   are counting sorted by cell, so that the points of a cell are scanned contiguously. Buffers
+///   are kept between calls, so clustering a frame no larger than previous ones does not allocate.
+class PointClusterer {
+public:
+    /// @brief
+    ///   Label of points that belong to no cluster.
+    static constexpr const int32_t Noise = -1;
+
+    /// @brief
+    ///   Create a clusterer with the specified config.
+    ///
+    /// @param config   Neighbourhood radius, density threshold and dimension weights.
+    explicit PointClusterer(const ClusterConfig &config) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    PointClusterer(const PointClusterer &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const PointClusterer &) = delete;
+
+    /// @brief
+    ///   Destroy this clusterer.
+    ~PointClusterer() noexcept;
+
+    /// @brief
+    ///   Get default configuration. Suits people and vehicles at the range of the demo firmware.
+    static auto DefaultConfig() noexcept -> ClusterConfig;
+
+    /// @brief
+    ///   Get the config of this clusterer.
+    auto GetConfig() const noexcept -> const ClusterConfig & {
+        return config;
+    }
+
+    /// @brief
+    ///   Cluster points of a point cloud. Labels and summaries of the previous call are replaced.
+    ///
+    /// @param cloud    The point cloud to be clustered.
+    ///
+    /// @return size_t
+    ///   Return number of clusters found.
+    auto Cluster(const PointCloud &cloud) -> size_t;
+
+    /// @brief
+    ///   Get cluster label of each point of the last clustered point cloud.
+    ///
+    /// @return const std::vector<int32_t> &
+    ///   Return index into summaries for each point, or Noise.
+    auto GetLabels() const noexcept -> const std::vector<int32_t> & {
+        return labels;
+    }
+
+    /// @brief
+    ///   Get summaries of clusters of the last clustered point cloud.
+    ///
+    /// @return const std::vector<ClusterSummary> &
+    ///   Return one summary per cluster, in order of cluster label.
+    auto GetClusters() const noexcept -> const std::vector<ClusterSummary> & {
+        return clusters;
+    }
+
+    /// @brief
+    ///   Serialize labels and summaries of the last clustered point cloud as a JSON object
+    ///   followed by a comma, like frames of DataSerial.
+    ///
+    /// @param      frameNumber     Frame number of the clustered frame.
+    /// @param[out] output          The JSON is appended to this string.
+    auto Serialize(uint32_t frameNumber, std::string &output) const -> void;
+
+private:
+    /// @brief
+    ///   Get grid cell key of a position.
+    auto CellKey(float x, float y, float z) const noexcept -> uint64_t;
+
+    /// @brief
+    ///   Find the slot of a cell in the hash table.
+    ///
+    /// @return size_t
+    ///   Return the slot that holds the cell, or the empty slot that the cell would be stored in.
+    auto FindSlot(uint64_t key) const noexcept -> size_t;
+
+    /// @brief
+    ///   Collect neighbours of a sorted point into the neighbour buffer, including the point
+    ///   itself.
+    auto QueryNeighbours(uint32_t point) -> void;
+
+private:
+    /// @brief
+    ///   Neighbourhood radius, density threshold and dimension weights.
+    ClusterConfig config;
+
+    /// @brief
+    ///   Reciprocal of the grid cell size.
+    float inverseCellSize;
+
+    /// @brief
+    ///   Hash table of cell keys. Unused slots hold an empty key.
+    std::vector<uint64_t> slotKeys;
+
+    /// @brief
+    ///   First sorted point of the cell in each hash table slot.
+    std::vector<uint32_t> slotBegins;
+
+    /// @brief
+    ///   End of sorted points of the cell in each hash table slot.
+    std::vector<uint32_t> slotEnds;
+
+    /// @brief
+    ///   Hash table slot of each point.
+    std::vector<uint32_t> pointSlots;
+
+    /// @brief
+    ///   Index in the input point cloud of each sorted point.
+    std::vector<uint32_t> order;
+
+    /// @brief
+    ///   Points sorted by cell, so that points of a cell are contiguous. Doppler and SNR are
+    ///   scaled by their weights.
+    PointCloud sorted;
+
+    /// @brief
+    ///   Cell key of each sorted point.
+    std::vector<uint64_t> sortedKeys;
+
+    /// @brief
+    ///   Cluster label of each sorted point.
+    std::vector<int32_t> sortedLabels;
+
+    /// @brief
+    ///   Whether neighbours of each sorted point have been searched.
+    std::vector<uint8_t> visited;
+
+    /// @brief
+    ///   Sorted neighbours found by the last query.
+    std::vector<uint32_t> neighbours;
+
+    /// @brief
+    ///   Sorted points waiting to expand the current cluster.
+    std::vector<uint32_t> frontier;
+
+    /// @brief
+    ///   Cluster label of each point of the input point cloud.
+    std::vector<int32_t> labels;
+
+    /// @brief
+    ///   Summaries of clusters.
+    std::vector<ClusterSummary> clusters;
+};
+
+} // namespace iwr1443
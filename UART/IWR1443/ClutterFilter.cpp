@@ -0,0 +1,348 @@
+#include "ClutterFilter.h"
+#include "../Log.h"
+#include "../Trace.h"
+#include "Data.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+using namespace iwr1443;
+
+// Largest number of occupancy map cells. Bounds memory of a map with small cells or long range.
+static constexpr const size_t MAX_CELL_COUNT = size_t(1) << 22;
+
+/// @brief
+///   Get name of the specified clutter action in log lines.
+static auto ActionName(ClutterAction action) noexcept -> const char * {
+    return action == ClutterAction::Tag ? "tagged" : "dropped";
+}
+
+iwr1443::StaticClutterFilter::StaticClutterFilter(const Serial &serial) noexcept
+    : serial(serial),
+      config(DefaultConfig()),
+      rangeCells(0),
+      angleCells(0),
+      occupancy(),
+      updateFrames(),
+      decayRate(0),
+      pointCells(),
+      clutterPoints(),
+      output(),
+      frames(0),
+      inputPoints(0),
+      staticPoints(0),
+      inputBytes(0),
+      outputBytes(0),
+      logInterval(10),
+      lastLogTime(),
+      mutex() {}
+
+iwr1443::StaticClutterFilter::~StaticClutterFilter() noexcept {}
+
+auto iwr1443::StaticClutterFilter::DefaultConfig() noexcept -> ClutterFilterConfig {
+    ClutterFilterConfig config{};
+    config.action           = ClutterAction::None;
+    config.dopplerThreshold = 0.1f;
+    config.rangeCellSize    = 0.25f;
+    config.angleCellSize    = 4.0f * std::numbers::pi_v<float> / 180.0f;
+    config.maxRange         = 20.0f;
+    config.halfLife         = 30.0f;
+    config.threshold        = 4.0f;
+    return config;
+}
+
+auto iwr1443::StaticClutterFilter::SetConfig(const ClutterFilterConfig &config) noexcept -> void {
+    this->config = config;
+    rangeCells   = 0;
+    angleCells   = 0;
+
+    // Azimuth and elevation both span [-pi/2, pi/2]. The filter is disabled if the map would be
+    // too large.
+    if (config.action != ClutterAction::None) {
+        rangeCells = static_cast<size_t>(std::ceil(config.maxRange / config.rangeCellSize));
+        angleCells =
+            static_cast<size_t>(std::ceil(std::numbers::pi_v<float> / config.angleCellSize));
+    }
+
+    if (rangeCells * angleCells * angleCells > MAX_CELL_COUNT) {
+        LogError("Serial {} clutter map of {}x{}x{} cells exceeds {} cells. Clutter filter is "
+                 "disabled.",
+                 serial.GetPortName(),
+                 rangeCells,
+                 angleCells,
+                 angleCells,
+                 MAX_CELL_COUNT);
+        this->config.action = ClutterAction::None;
+        rangeCells          = 0;
+        angleCells          = 0;
+    }
+
+    occupancy.assign(rangeCells * angleCells * angleCells, 0);
+    updateFrames.assign(occupancy.size(), 0);
+    decayRate = 1.0f / config.halfLife;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    frames       = 0;
+    inputPoints  = 0;
+    staticPoints = 0;
+    inputBytes   = 0;
+    outputBytes  = 0;
+}
+
+auto iwr1443::StaticClutterFilter::Filter(const void *frame) noexcept -> const void * {
+    TRACE_SPAN("StaticClutterFilter::Filter");
+    clutterPoints.clear();
+    if (config.action == ClutterAction::None)
+        return frame;
+
+    FrameHeader frameHeader;
+    std::memcpy(&frameHeader, frame, sizeof(FrameHeader));
+
+    const std::byte *spherical      = nullptr;
+    size_t           sphericalCount = 0;
+    size_t           detectedCount  = 0;
+    bool             hasDetected    = false;
+
+    // TargetIndex and SphericalCompressedPointCloud also carry one element per point.
+    size_t indexLength      = 0;
+    size_t compressedLength = 0;
+    bool   hasIndex         = false;
+    bool   hasCompressed    = false;
+    ForEachTLV(frame, [&](const TLVHeader &header, const void *data) -> void {
+        if (header.type == TLVType::SphericalCoordinates) {
+            spherical      = static_cast<const std::byte *>(data);
+            sphericalCount = header.length / sizeof(SphericalCoordinate);
+        } else if (header.type == TLVType::DetectedPoints) {
+            DetectedPointHeader detectedHeader;
+            std::memcpy(&detectedHeader, data, sizeof(DetectedPointHeader));
+            detectedCount = detectedHeader.detectedObjectCount;
+            hasDetected   = true;
+        } else if (header.type == TLVType::TargetIndex) {
+            indexLength = header.length;
+            hasIndex    = true;
+        } else if (header.type == TLVType::SphericalCompressedPointCloud) {
+            compressedLength = header.length;
+            hasCompressed    = true;
+        }
+    });
+
+    // Doppler is only reported in SphericalCoordinates. Both TLVs must describe the same points.
+    if (spherical == nullptr || (hasDetected && detectedCount != sphericalCount))
+        return frame;
+
+    const size_t count     = sphericalCount;
+    const size_t cellCount = occupancy.size();
+    const float  doppler   = config.dopplerThreshold;
+
+    // Frame numbers of untouched cells are moved just before the first frame, so that no cell
+    // looks updated in it.
+    if (frames == 0)
+        std::fill(updateFrames.begin(), updateFrames.end(), frameHeader.frameNumber - 1);
+
+    // Points are judged by the map of previous frames, so that a reflector is only clutter once
+    // it has persisted, and points that share a cell agree.
+    pointCells.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        SphericalCoordinate point;
+        std::memcpy(&point, spherical + i * sizeof(SphericalCoordinate), sizeof(point));
+
+        const bool   still = std::fabs(point.doppler) <= doppler;
+        const size_t cell =
+            still ? CellIndex(point.range, point.azimuth, point.elevation) : cellCount;
+        pointCells[i] = cell;
+
+        if (cell != cellCount && Occupancy(cell, frameHeader.frameNumber) >= config.threshold)
+            clutterPoints.push_back(static_cast<uint32_t>(i));
+    }
+
+    // Each frame adds one to a cell no matter how many points fall in it.
+    for (size_t i = 0; i < count; ++i) {
+        const size_t cell = pointCells[i];
+        if (cell == cellCount || updateFrames[cell] == frameHeader.frameNumber)
+            continue;
+
+        occupancy[cell]    = Occupancy(cell, frameHeader.frameNumber) + 1;
+        updateFrames[cell] = frameHeader.frameNumber;
+    }
+
+    // Points could only be dropped from per-point TLVs that describe the same points. Otherwise
+    // the frame is passed through, so that TLVs stay in step.
+    const bool compactable =
+        (!hasIndex || indexLength == count * sizeof(uint8_t)) &&
+        (!hasCompressed || compressedLength == sizeof(SphericalCompressedPointCloudHeader) +
+                                                   count * sizeof(SphericalCompressedPoint));
+
+    if (config.action == ClutterAction::Drop && !clutterPoints.empty() && !compactable) {
+        LOG_RATE_LIMITED(LogLevel::Warning,
+                         1.0,
+                         5,
+                         "Serial {} clutter filter kept static points of frame {}: TargetIndex or "
+                         "SphericalCompressedPointCloud does not have one element per point.",
+                         serial.GetPortName(),
+                         frameHeader.frameNumber);
+    }
+
+    const bool drop = config.action == ClutterAction::Drop && !clutterPoints.empty() && compactable;
+    if (drop)
+        Compact(frame, count);
+
+    const size_t frameSize = frameHeader.packetLength;
+    const size_t finalSize = drop ? output.size() : frameSize;
+
+    const auto now       = std::chrono::steady_clock::now();
+    bool       shouldLog = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++frames;
+        inputPoints  += count;
+        staticPoints += clutterPoints.size();
+        inputBytes   += frameSize;
+        outputBytes  += finalSize;
+
+        if (logInterval.count() > 0 && now - lastLogTime >= logInterval) {
+            lastLogTime = now;
+            shouldLog   = frames > 1;
+        }
+    }
+
+    if (shouldLog && LogSystem::GetSingleton()->IsEnabled(LogLevel::Info)) {
+        const ClutterReport report = GetReport();
+        LogInfo("Serial {} clutter filter {} {} of {} points ({:.1f}%), frame bytes reduced by "
+                "{:.1f}%.",
+                serial.GetPortName(),
+                ActionName(config.action),
+                report.clutterPoints,
+                report.inputPoints,
+                report.pointReduction * 100,
+                report.byteReduction * 100);
+    }
+
+    return drop ? static_cast<const void *>(output.data()) : frame;
+}
+
+auto iwr1443::StaticClutterFilter::GetReport() const noexcept -> ClutterReport {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ClutterReport report{};
+    report.frames        = frames;
+    report.inputPoints   = inputPoints;
+    report.clutterPoints = staticPoints;
+    report.inputBytes    = inputBytes;
+    report.outputBytes   = outputBytes;
+    if (inputPoints != 0)
+        report.pointReduction = static_cast<double>(staticPoints) / inputPoints;
+    if (inputBytes != 0)
+        report.byteReduction = 1.0 - static_cast<double>(outputBytes) / inputBytes;
+    return report;
+}
+
+auto iwr1443::StaticClutterFilter::SetLogInterval(std::chrono::seconds interval) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInterval = interval;
+}
+
+auto iwr1443::StaticClutterFilter::CellIndex(float range, float azimuth, float elevation)
+    const noexcept -> size_t {
+    const size_t cellCount = occupancy.size();
+    if (!(range >= 0 && range < config.maxRange) || !std::isfinite(azimuth) ||
+        !std::isfinite(elevation))
+        return cellCount;
+
+    const auto angleCell = [this](float angle) -> size_t {
+        const float index =
+            std::floor((angle + std::numbers::pi_v<float> / 2) / config.angleCellSize);
+        return static_cast<size_t>(std::clamp(index, 0.0f, static_cast<float>(angleCells - 1)));
+    };
+
+    const size_t rangeCell =
+        std::min(static_cast<size_t>(range / config.rangeCellSize), rangeCells - 1);
+    return (rangeCell * angleCells + angleCell(azimuth)) * angleCells + angleCell(elevation);
+}
+
+auto iwr1443::StaticClutterFilter::Occupancy(size_t cell, uint32_t frameNumber) const noexcept
+    -> float {
+    // Unsigned difference stays correct across wrap around. Frame numbers that go backwards after
+    // a sensor restart look very old, so the map starts over.
+    const uint32_t elapsed = frameNumber - updateFrames[cell];
+    return occupancy[cell] * std::exp2(-static_cast<float>(elapsed) * decayRate);
+}
+
+auto iwr1443::StaticClutterFilter::Compact(const void *frame, size_t count) noexcept -> void {
+    FrameHeader frameHeader;
+    std::memcpy(&frameHeader, frame, sizeof(FrameHeader));
+
+    output.resize(sizeof(FrameHeader));
+
+    // Append a TLV whose payload is a prefix followed by one element per point, without the
+    // elements of clutter points. clutterPoints is in ascending order.
+    const auto appendKept = [this, count](TLVType     type,
+                                          const void *data,
+                                          size_t      prefixSize,
+                                          size_t      elementSize) -> void {
+        const auto  *source = static_cast<const std::byte *>(data);
+        const size_t offset = output.size();
+        output.resize(offset + sizeof(TLVHeader));
+        output.insert(output.end(), source, source + prefixSize);
+        source += prefixSize;
+
+        size_t begin = 0;
+        for (uint32_t index : clutterPoints) {
+            output.insert(output.end(), source + begin * elementSize, source + index * elementSize);
+            begin = index + 1;
+        }
+        output.insert(output.end(), source + begin * elementSize, source + count * elementSize);
+
+        const TLVHeader header{type,
+                               static_cast<uint32_t>(output.size() - offset - sizeof(TLVHeader))};
+        std::memcpy(output.data() + offset, &header, sizeof(TLVHeader));
+    };
+
+    const size_t kept = count - clutterPoints.size();
+    ForEachTLV(frame, [&](const TLVHeader &header, const void *data) -> void {
+        if (header.type == TLVType::DetectedPoints) {
+            const size_t offset = output.size() + sizeof(TLVHeader);
+            appendKept(header.type, data, sizeof(DetectedPointHeader), sizeof(DetectedPoint));
+
+            DetectedPointHeader detectedHeader;
+            std::memcpy(&detectedHeader, output.data() + offset, sizeof(DetectedPointHeader));
+            detectedHeader.detectedObjectCount = static_cast<uint16_t>(kept);
+            std::memcpy(output.data() + offset, &detectedHeader, sizeof(DetectedPointHeader));
+            return;
+        }
+
+        if (header.type == TLVType::SphericalCoordinates) {
+            appendKept(header.type, data, 0, sizeof(SphericalCoordinate));
+            return;
+        }
+
+        // Filter checks that these have one element per point before compacting.
+        if (header.type == TLVType::TargetIndex) {
+            appendKept(header.type, data, 0, sizeof(uint8_t));
+            return;
+        }
+
+        if (header.type == TLVType::SphericalCompressedPointCloud) {
+            appendKept(header.type,
+                       data,
+                       sizeof(SphericalCompressedPointCloudHeader),
+                       sizeof(SphericalCompressedPoint));
+            return;
+        }
+
+        // Side info is optional and only filtered if it describes the same points.
+        if (header.type == TLVType::DetectedPointsSideInfo &&
+            header.length / sizeof(DetectedPointSideInfo) == count) {
+            appendKept(header.type, data, 0, sizeof(DetectedPointSideInfo));
+            return;
+        }
+
+        const auto *source = reinterpret_cast<const std::byte *>(&header);
+        output.insert(output.end(), source, source + sizeof(TLVHeader) + header.length);
+    });
+
+    frameHeader.packetLength        = static_cast<uint32_t>(output.size());
+    frameHeader.detectedObjectCount = static_cast<uint32_t>(kept);
+    std::memcpy(output.data(), &frameHeader, sizeof(FrameHeader));
+}
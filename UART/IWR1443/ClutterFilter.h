@@ -0,0 +1,239 @@
+#pragma once
+
+#include "../Serial.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace iwr1443 {
+
+enum class ClutterAction {
+    None = 0,
+    Drop = 1,
+    Tag  = 2,
+};
+
+struct ClutterFilterConfig {
+    /// @brief
+    ///   What to do with points of static clutter. None disables the filter.
+    ClutterAction action;
+
+    /// @brief
+    ///   Largest absolute radial velocity in m/s of a point that could be static.
+    float dopplerThreshold;
+
+    /// @brief
+    ///   Size in meters of occupancy map cells along range.
+    float rangeCellSize;
+
+    /// @brief
+    ///   Size in radians of occupancy map cells along azimuth and elevation.
+    float angleCellSize;
+
+    /// @brief
+    ///   Range in meters covered by the occupancy map. Farther points are always kept.
+    float maxRange;
+
+    /// @brief
+    ///   Number of frames for occupancy of a cell to decay by half. Longer half-life remembers
+    ///   static reflectors longer after they are last seen.
+    float halfLife;
+
+    /// @brief
+    ///   Occupancy that a cell must reach before its static points are treated as clutter. Each
+    ///   frame with a static point in the cell adds one.
+    float threshold;
+};
+
+struct ClutterReport {
+    /// @brief
+    ///   Number of frames filtered.
+    uint64_t frames;
+
+    /// @brief
+    ///   Number of points in filtered frames.
+    uint64_t inputPoints;
+
+    /// @brief
+    ///   Number of points dropped or tagged as static clutter.
+    uint64_t clutterPoints;
+
+    /// @brief
+    ///   Bytes of filtered frames as received.
+    uint64_t inputBytes;
+
+    /// @brief
+    ///   Bytes of filtered frames after points are dropped.
+    uint64_t outputBytes;
+
+    /// @brief
+    ///   Ratio of points that are static clutter.
+    double pointReduction;
+
+    /// @brief
+    ///   Ratio of frame bytes that are removed.
+    double byteReduction;
+};
+
+/// @brief
+///   Streaming static clutter filter. A decaying occupancy map over range, azimuth and elevation
+///   cells in sensor coordinates accumulates points with near-zero doppler. Static points that fall
+///   in cells occupied for long enough are dropped from DetectedPoints, SphericalCoordinates,
+///   DetectedPointsSideInfo, TargetIndex and SphericalCompressedPointCloud, or tagged by index.
+///   Frames without SphericalCoordinates carry no doppler and are passed through. Frames whose
+///   TargetIndex or SphericalCompressedPointCloud do not have one element per point are passed
+///   through too, since dropping would put them out of step.
+class StaticClutterFilter {
+public:
+    /// @brief
+    ///   Create a disabled static clutter filter for the specified serial.
+    ///
+    /// @param serial   The serial that receives frames. Used to name log lines.
+    explicit StaticClutterFilter(const Serial &serial) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    StaticClutterFilter(const StaticClutterFilter &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const StaticClutterFilter &) = delete;
+
+    /// @brief
+    ///   Destroy this static clutter filter.
+    ~StaticClutterFilter() noexcept;
+
+    /// @brief
+    ///   Get default configuration. The filter is disabled. Cells of 0.25 m and 4 degrees, a
+    ///   half-life of 30 frames and a threshold of 4 drop a reflector after about 5 frames and
+    ///   forget it about 100 frames after it is last seen.
+    static auto DefaultConfig() noexcept -> ClutterFilterConfig;
+
+    /// @brief
+    ///   Set configuration and clear the occupancy map. Set before frames are filtered.
+    ///
+    /// @param config   The filter configuration.
+    auto SetConfig(const ClutterFilterConfig &config) noexcept -> void;
+
+    /// @brief
+    ///   Get configuration of this filter.
+    auto GetConfig() const noexcept -> const ClutterFilterConfig & {
+        return config;
+    }
+
+    /// @brief
+    ///   Update the occupancy map with a complete frame and filter its static clutter.
+    ///
+    /// @param[in] frame    Pointer to start of a complete frame.
+    ///
+    /// @return const void *
+    ///   Return @p frame if nothing is dropped, otherwise a filtered copy that is valid until the
+    ///   next call.
+    auto Filter(const void *frame) noexcept -> const void *;
+
+    /// @brief
+    ///   Get indices of static clutter points in the last filtered frame. Indices refer to the
+    ///   frame as received.
+    auto GetClutterPoints() const noexcept -> const std::vector<uint32_t> & {
+        return clutterPoints;
+    }
+
+    /// @brief
+    ///   Get clutter statistics.
+    ///
+    /// @return ClutterReport
+    ///   Return a snapshot of points and bytes removed since the filter is configured.
+    auto GetReport() const noexcept -> ClutterReport;
+
+    /// @brief
+    ///   Set interval to log clutter statistics. Pass zero to disable logging.
+    ///
+    /// @param interval     The new log interval.
+    auto SetLogInterval(std::chrono::seconds interval) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Get occupancy map cell of a point.
+    ///
+    /// @return size_t
+    ///   Return index of the cell, or the number of cells if the point is outside the map.
+    auto CellIndex(float range, float azimuth, float elevation) const noexcept -> size_t;
+
+    /// @brief
+    ///   Get occupancy of a cell decayed to the specified frame.
+    auto Occupancy(size_t cell, uint32_t frameNumber) const noexcept -> float;
+
+    /// @brief
+    ///   Copy a frame without the points of clutterPoints into output. TargetIndex and
+    ///   SphericalCompressedPointCloud must have one element per point.
+    ///
+    /// @param[in] frame    Pointer to start of the frame.
+    /// @param     count    Number of points in the frame.
+    auto Compact(const void *frame, size_t count) noexcept -> void;
+
+private:
+    /// @brief
+    ///   The serial that receives frames.
+    const Serial &serial;
+
+    /// @brief
+    ///   The filter configuration.
+    ClutterFilterConfig config;
+
+    /// @brief
+    ///   Number of occupancy map cells along range.
+    size_t rangeCells;
+
+    /// @brief
+    ///   Number of occupancy map cells along azimuth and along elevation.
+    size_t angleCells;
+
+    /// @brief
+    ///   Occupancy of each cell as of its last update.
+    std::vector<float> occupancy;
+
+    /// @brief
+    ///   Frame number of the last update of each cell.
+    std::vector<uint32_t> updateFrames;
+
+    /// @brief
+    ///   Reciprocal of the half-life.
+    float decayRate;
+
+    /// @brief
+    ///   Cell of each point of the current frame, or the number of cells if it is not static.
+    std::vector<size_t> pointCells;
+
+    /// @brief
+    ///   Indices of static clutter points in the last filtered frame.
+    std::vector<uint32_t> clutterPoints;
+
+    /// @brief
+    ///   Filtered copy of the last frame.
+    std::vector<std::byte> output;
+
+    /// @brief
+    ///   Statistics.
+    uint64_t frames;
+    uint64_t inputPoints;
+    uint64_t staticPoints;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+
+    /// @brief
+    ///   Interval to log clutter statistics.
+    std::chrono::seconds logInterval;
+
+    /// @brief
+    ///   Time that clutter statistics are logged last time.
+    std::chrono::steady_clock::time_point lastLogTime;
+
+    /// @brief
+    ///   Mutex that is used to protect statistics.
+    mutable std::mutex mutex;
+};
+
+} // namespace iwr1443
@@ -0,0 +1,79 @@
+#include "ConfigCache.h"
+#include "../Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+using namespace iwr1443;
+
+iwr1443::ConfigCache::ConfigCache() noexcept : path(), entries() {}
+
+iwr1443::ConfigCache::~ConfigCache() noexcept {}
+
+auto iwr1443::ConfigCache::Load(std::string_view path) noexcept -> std::error_code {
+    this->path = path;
+    entries.clear();
+
+    std::ifstream file(this->path);
+    if (!file.is_open())
+        return std::error_code();
+
+    // Each line is "<identity> <config hash> <bring-up time in microseconds>".
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        ConfigCacheEntry   entry;
+        int64_t            bringUpTime;
+
+        stream >> entry.identity >> std::hex >> entry.configHash >> std::dec >> bringUpTime;
+        if (!stream) {
+            LogWarning("Ignored malformed config cache line \"{}\" in {}.", line, path);
+            continue;
+        }
+
+        entry.bringUpTime = std::chrono::microseconds(bringUpTime);
+        entries.push_back(std::move(entry));
+    }
+
+    return std::error_code();
+}
+
+auto iwr1443::ConfigCache::Save() const noexcept -> std::error_code {
+    // std::ofstream reports the failure of the underlying open through errno.
+    errno = 0;
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        const std::error_code error = errno == 0 ? std::make_error_code(std::errc::io_error)
+                                                 : std::error_code(errno, std::generic_category());
+        LogError("Failed to open config cache file {}: {}.", path, error.message());
+        return error;
+    }
+
+    for (const auto &entry : entries)
+        file << std::format(
+            "{} {:016x} {}\n", entry.identity, entry.configHash, entry.bringUpTime.count());
+
+    return std::error_code();
+}
+
+auto iwr1443::ConfigCache::Find(std::string_view identity) const noexcept
+    -> const ConfigCacheEntry * {
+    auto iter = std::find_if(entries.begin(), entries.end(), [identity](const auto &entry) {
+        return entry.identity == identity;
+    });
+
+    return iter == entries.end() ? nullptr : &*iter;
+}
+
+auto iwr1443::ConfigCache::Store(ConfigCacheEntry entry) noexcept -> void {
+    auto iter = std::find_if(entries.begin(), entries.end(), [&entry](const auto &value) {
+        return value.identity == entry.identity;
+    });
+
+    if (iter == entries.end())
+        entries.push_back(std::move(entry));
+    else
+        *iter = std::move(entry);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace iwr1443 {
+
+struct ConfigCacheEntry {
+    /// @brief
+    ///   Identity of the sensor, formed by port name and hash of its version information.
+    std::string identity;
+
+    /// @brief
+    ///   Hash of the config that has been applied to the sensor.
+    uint64_t configHash;
+
+    /// @brief
+    ///   Time spent to apply the config last time.
+    std::chrono::microseconds bringUpTime;
+};
+
+class ConfigCache {
+public:
+    /// @brief
+    ///   Create an empty config cache.
+    ConfigCache() noexcept;
+
+    /// @brief
+    ///   Destroy this config cache.
+    ~ConfigCache() noexcept;
+
+    /// @brief
+    ///   Load cache entries from the specified file. A missing file is treated as an empty cache.
+    ///
+    /// @param path     Path to the cache file. Entries are saved to the same file.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the load result.
+    auto Load(std::string_view path) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Save cache entries to the file that they are loaded from.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the save result.
+    auto Save() const noexcept -> std::error_code;
+
+    /// @brief
+    ///   Find cache entry of the specified sensor.
+    ///
+    /// @param identity     Identity of the sensor.
+    ///
+    /// @return const ConfigCacheEntry *
+    ///   Return pointer to the cache entry. Return nullptr if the sensor is not cached.
+    auto Find(std::string_view identity) const noexcept -> const ConfigCacheEntry *;
+
+    /// @brief
+    ///   Insert or update cache entry of a sensor.
+    ///
+    /// @param entry    The new cache entry.
+    auto Store(ConfigCacheEntry entry) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Path to the cache file.
+    std::string path;
+
+    /// @brief
+    ///   Cached entries.
+    std::vector<ConfigCacheEntry> entries;
+};
+
+/// @brief
+///   Compute 64-bit FNV-1a hash of the specified data.
+///
+/// @param data     The data to be hashed.
+/// @param hash     Hash of previous data. Pass the default value to start a new hash.
+///
+/// @return uint64_t
+///   Return the hash value.
+constexpr auto HashFNV1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ULL) noexcept
+    -> uint64_t {
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace iwr1443
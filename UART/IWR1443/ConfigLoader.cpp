@@ -0,0 +1,175 @@
+#include "ConfigLoader.h"
+#include "../Log.h"
+
+#include <deque>
+#include <fstream>
+#include <thread>
+
+using namespace iwr1443;
+
+iwr1443::ConfigLoader::ConfigLoader() noexcept
+    : commands(), pipelineDepth(1), bringUpTime() {}
+
+iwr1443::ConfigLoader::~ConfigLoader() noexcept {}
+
+auto iwr1443::ConfigLoader::Load(std::string_view path) noexcept -> std::error_code {
+    std::ifstream file{std::string(path)};
+    if (!file.is_open()) {
+        LogError("Failed to open config file {}.", path);
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    commands.clear();
+
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '%')
+            continue;
+
+        const size_t last = line.find_last_not_of(" \t\r");
+        commands.emplace_back(line, first, last - first + 1);
+    }
+
+    LogInfo("Loaded {} commands from config file {}.", commands.size(), path);
+    return std::error_code();
+}
+
+auto iwr1443::ConfigLoader::Apply(ControlSerial            &serial,
+                                  std::chrono::milliseconds commandTimeout) noexcept
+    -> std::error_code {
+    std::deque<std::future<CommandResponse>> inFlight;
+    std::error_code                          result;
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t     next  = 0;
+
+    for (size_t index = 0; index < commands.size(); ++index) {
+        // Keep the pipeline full.
+        while (next < commands.size() && inFlight.size() < pipelineDepth)
+            inFlight.push_back(serial.SendCommand(commands[next++], commandTimeout));
+
+        CommandResponse response = inFlight.front().get();
+        inFlight.pop_front();
+
+        if (response.error == std::errc::timed_out) {
+            LogError("Sensor did not acknowledge command \"{}\" within {}.",
+                     commands[index],
+                     commandTimeout);
+            result = response.error;
+            break;
+        }
+
+        if (response.error.value() != 0) {
+            LogError("Sensor rejected command \"{}\": {}",
+                     commands[index],
+                     response.lines.empty() ? std::string_view() : response.lines.back());
+            result = response.error;
+            break;
+        }
+    }
+
+    bringUpTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    if (result.value() == 0)
+        LogInfo("Sensor configured with {} commands in {}.", commands.size(), bringUpTime);
+
+    return result;
+}
+
+/// @brief
+///   Identify the sensor connected to the specified control serial.
+///
+/// @return std::string
+///   Return identity of the sensor. Return empty string if the sensor did not respond.
+static auto QueryIdentity(ControlSerial &control, std::chrono::milliseconds timeout) noexcept
+    -> std::string {
+    CommandResponse response = control.SendCommand("version", timeout).get();
+    if (response.error.value() != 0)
+        return std::string();
+
+    uint64_t hash = HashFNV1a(control.GetPortName());
+    for (const auto &line : response.lines)
+        hash = HashFNV1a(line, hash);
+
+    return std::format("{}#{:016x}", control.GetPortName(), hash);
+}
+
+/// @brief
+///   Checks whether the sensor is started. Firmware without queryDemoStatus command is detected by
+///   watching frames on the data port.
+static auto IsSensorRunning(ControlSerial            &control,
+                            const DataSerial         &data,
+                            std::chrono::milliseconds timeout) noexcept -> bool {
+    CommandResponse response = control.SendCommand("queryDemoStatus", timeout).get();
+    if (response.error.value() == 0) {
+        for (const auto &line : response.lines) {
+            const SensorState state = ParseSensorState(line);
+            if (state != SensorState::Unknown)
+                return state == SensorState::Started;
+        }
+    }
+
+    const uint64_t frameCount = data.GetFrameCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    return data.GetFrameCount() != frameCount;
+}
+
+auto iwr1443::ConfigLoader::ApplyCached(ControlSerial            &control,
+                                        const DataSerial         &data,
+                                        ConfigCache              &cache,
+                                        std::chrono::milliseconds commandTimeout) noexcept
+    -> std::error_code {
+    const auto        start      = std::chrono::steady_clock::now();
+    const uint64_t    configHash = GetConfigHash();
+    const std::string identity   = QueryIdentity(control, commandTimeout);
+
+    const ConfigCacheEntry *entry = identity.empty() ? nullptr : cache.Find(identity);
+    if (entry != nullptr && entry->configHash == configHash) {
+        bool running = IsSensorRunning(control, data, commandTimeout);
+        if (!running) {
+            // Restart with the config that is already applied.
+            CommandResponse response = control.SendCommand("sensorStart 0", commandTimeout).get();
+            running                  = (response.error.value() == 0);
+        }
+
+        if (running) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            bringUpTime = elapsed;
+
+            LogInfo("Sensor {} already has config {:016x}. Reconfiguration skipped in {}, saved "
+                    "about {} of downtime.",
+                    identity,
+                    configHash,
+                    elapsed,
+                    entry->bringUpTime > elapsed ? entry->bringUpTime - elapsed
+                                                 : std::chrono::microseconds(0));
+            return std::error_code();
+        }
+
+        LogInfo("Sensor {} could not be restarted with cached config. Reconfiguring.", identity);
+    }
+
+    std::error_code errorCode = Apply(control, commandTimeout);
+    if (errorCode.value() != 0 || identity.empty())
+        return errorCode;
+
+    cache.Store(ConfigCacheEntry{identity, configHash, bringUpTime});
+    return cache.Save();
+}
+
+auto iwr1443::ConfigLoader::GetConfigHash() const noexcept -> uint64_t {
+    uint64_t hash = HashFNV1a({});
+    for (const auto &command : commands) {
+        if (command.starts_with("sensorStart") || command.starts_with("sensorStop") ||
+            command.starts_with("flushCfg"))
+            continue;
+
+        hash = HashFNV1a(command, hash);
+        hash = HashFNV1a("\n", hash);
+    }
+
+    return hash;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "ConfigCache.h"
+#include "Serials.h"
+
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace iwr1443 {
+
+class ConfigLoader {
+public:
+    /// @brief
+    ///   Create an empty config loader.
+    ConfigLoader() noexcept;
+
+    /// @brief
+    ///   Destroy this config loader.
+    ~ConfigLoader() noexcept;
+
+    /// @brief
+    ///   Load CLI commands from the specified mmWave config file. Comments start with '%' and
+    ///   empty lines are skipped.
+    ///
+    /// @param path     Path to the config file.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the load result.
+    auto Load(std::string_view path) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Stream loaded commands to the sensor. A command is acknowledged once the CLI reports its
+    ///   status and prints the prompt again. Next command is sent as soon as the number of
+    ///   unacknowledged commands drops below the pipeline depth. This method blocks the calling
+    ///   thread, so it must not be called from the IO thread.
+    ///
+    /// @param serial           The control serial connected to the sensor CLI port.
+    /// @param commandTimeout   Maximum time to wait for acknowledgment of a single command.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the configuration result.
+    auto Apply(ControlSerial &serial, std::chrono::milliseconds commandTimeout) noexcept
+        -> std::error_code;
+
+    /// @brief
+    ///   Apply loaded commands unless the sensor is already running the same config. The sensor is
+    ///   identified by port name and its version information, and the hash of the config applied
+    ///   to it is kept in @p cache. If the config is unchanged but the sensor is stopped, the
+    ///   sensor is restarted without reconfiguration.
+    ///
+    /// @param control          The control serial connected to the sensor CLI port.
+    /// @param data             The data serial connected to the sensor data port. It is used to
+    ///                         detect running sensor if the firmware could not report its state.
+    /// @param cache            The config cache. Updated if the sensor is reconfigured.
+    /// @param commandTimeout   Maximum time to wait for acknowledgment of a single command.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the configuration result.
+    auto ApplyCached(ControlSerial            &control,
+                     const DataSerial         &data,
+                     ConfigCache              &cache,
+                     std::chrono::milliseconds commandTimeout) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Compute hash of the loaded config. Sensor start, stop and flush commands are not part of
+    ///   the config and are excluded.
+    ///
+    /// @return uint64_t
+    ///   Return hash of the loaded config.
+    auto GetConfigHash() const noexcept -> uint64_t;
+
+    /// @brief
+    ///   Get the loaded CLI commands.
+    ///
+    /// @return const std::vector<std::string> &
+    ///   Return the loaded CLI commands.
+    auto GetCommands() const noexcept -> const std::vector<std::string> & {
+        return commands;
+    }
+
+    /// @brief
+    ///   Get maximum number of commands that could be sent before acknowledgment.
+    ///
+    /// @return size_t
+    ///   Return the pipeline depth.
+    auto GetPipelineDepth() const noexcept -> size_t {
+        return pipelineDepth;
+    }
+
+    /// @brief
+    ///   Set maximum number of commands that could be sent before acknowledgment. The IWR1443 CLI
+    ///   does not read UART while executing a command, so depth greater than 1 is only safe for
+    ///   firmware that buffers CLI input.
+    ///
+    /// @param depth    The new pipeline depth.
+    auto SetPipelineDepth(size_t depth) noexcept -> void {
+        pipelineDepth = depth > 0 ? depth : 1;
+    }
+
+    /// @brief
+    ///   Get time spent by last Apply call, from sending the first command to acknowledgment of
+    ///   the last one.
+    ///
+    /// @return std::chrono::microseconds
+    ///   Return the sensor bring-up time.
+    auto GetBringUpTime() const noexcept -> std::chrono::microseconds {
+        return bringUpTime;
+    }
+
+private:
+    /// @brief
+    ///   CLI commands to be sent to the sensor.
+    std::vector<std::string> commands;
+
+    /// @brief
+    ///   Maximum number of unacknowledged commands.
+    size_t pipelineDepth;
+
+    /// @brief
+    ///   Sensor bring-up time of last Apply call.
+    std::chrono::microseconds bringUpTime;
+};
+
+} // namespace iwr1443
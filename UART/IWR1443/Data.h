@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
 #include <format>
+#include <string>
+#include <string_view>
 
 namespace iwr1443 {
 
@@ -16,6 +20,51 @@ struct FrameHeader {
     // uint32_t subframeNumber;
 };
 
+/// @brief
+///   Nominal frequency in Hz of the R4F CPU clock that stamps FrameHeader::time.
+inline constexpr const double DeviceClockRate = 200e6;
+
+/// @brief
+///   Sensor state reported by the queryDemoStatus command of the mmWave demo.
+enum class SensorState {
+    Unknown = 0,
+    Stopped = 1,
+    Started = 2,
+};
+
+/// @brief
+///   Format the response of queryDemoStatus like the mmWave demo, without echo and prompt.
+///
+/// @param state    Sensor state to report.
+inline auto FormatDemoStatus(SensorState state) -> std::string {
+    return std::format("Sensor State: {}\r\nData Passthrough: 0\r\n", static_cast<int>(state));
+}
+
+/// @brief
+///   Parse a line of the queryDemoStatus response.
+///
+/// @param line     A response line.
+///
+/// @return SensorState
+///   Return the reported state, or Unknown if the line does not report a known sensor state.
+inline auto ParseSensorState(std::string_view line) noexcept -> SensorState {
+    constexpr const std::string_view key = "Sensor State:";
+
+    const size_t position = line.find(key);
+    if (position == std::string_view::npos)
+        return SensorState::Unknown;
+
+    line.remove_prefix(position + key.size());
+    line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+
+    int state = 0;
+    std::from_chars(line.data(), line.data() + line.size(), state);
+    if (state != static_cast<int>(SensorState::Stopped) &&
+        state != static_cast<int>(SensorState::Started))
+        return SensorState::Unknown;
+    return static_cast<SensorState>(state);
+}
+
 enum class TLVType : uint32_t {
     DetectedPoints                = 1,
     RangeProfile                  = 2,
@@ -134,6 +183,24 @@ struct SphericalCompressedPoint {
     uint16_t snr;
 };
 
+/// @brief
+///   Call @p handler for each TLV in the specified frame.
+///
+/// @tparam Handler     Type of the TLV handler.
+/// @param[in] frame    Pointer to start of a complete frame.
+/// @param     handler  The TLV handler that is called with TLV header and pointer to TLV data.
+template <typename Handler>
+auto ForEachTLV(const void *frame, Handler &&handler) -> void {
+    const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+    const std::byte   *iter        = static_cast<const std::byte *>(frame) + sizeof(FrameHeader);
+
+    for (uint32_t i = 0; i < frameHeader->tlvCount; ++i) {
+        const TLVHeader *tlvHeader = reinterpret_cast<const TLVHeader *>(iter);
+        handler(*tlvHeader, static_cast<const void *>(iter + sizeof(TLVHeader)));
+        iter += sizeof(TLVHeader) + tlvHeader->length;
+    }
+}
+
 } // namespace iwr1443
 
 template <>
@@ -0,0 +1,231 @@
+#include "DeviceClock.h"
+#include "../Log.h"
+#include "Data.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace iwr1443;
+
+// Number of device time values before the 32-bit timestamp wraps around.
+static constexpr const double DEVICE_TIME_RANGE = 4294967296.0;
+
+// Maximum number of frames in the fit window.
+static constexpr const size_t WINDOW_SIZE = 1024;
+
+// Number of window segments whose minimum delay samples form the lower envelope.
+static constexpr const size_t ENVELOPE_SEGMENTS = 8;
+
+// Number of frames before the fit replaces the nominal clock rate.
+static constexpr const size_t MIN_FIT_SAMPLES = 2 * ENVELOPE_SEGMENTS;
+
+// Seconds that a frame may deviate from current fit before the device clock is considered jumped.
+static constexpr const double RESYNC_THRESHOLD = 1.0;
+
+iwr1443::DeviceClock::DeviceClock(const Serial &serial) noexcept
+    : serial(serial),
+      samples(),
+      baseDeviceTime(0),
+      baseHostTime(),
+      lastDeviceTime(0),
+      lastHostTime(),
+      slope(1),
+      intercept(0),
+      meanDelay(0),
+      delayDeviation(0),
+      maxDelay(0),
+      wraps(0),
+      resets(0),
+      logInterval(10),
+      lastLogTime(),
+      mutex() {}
+
+iwr1443::DeviceClock::~DeviceClock() noexcept {}
+
+auto iwr1443::DeviceClock::OnFrame(const void                           *frame,
+                                   std::chrono::steady_clock::time_point arrival) noexcept
+    -> std::chrono::steady_clock::time_point {
+    if (arrival == std::chrono::steady_clock::time_point())
+        return arrival;
+
+    const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+    const uint32_t     deviceTime  = frameHeader->time;
+
+    std::chrono::steady_clock::time_point acquired;
+    bool                                  shouldLog = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Wraps can not be counted if frames are more than half a wrap period apart.
+        const double hostGap = std::chrono::duration<double>(arrival - lastHostTime).count();
+        if (samples.empty() || hostGap > DEVICE_TIME_RANGE / DeviceClockRate / 2) {
+            Reset(deviceTime, arrival);
+        } else {
+            const uint32_t lastRaw = static_cast<uint32_t>(lastDeviceTime);
+            if (deviceTime < lastRaw)
+                ++wraps;
+            lastDeviceTime += static_cast<uint32_t>(deviceTime - lastRaw);
+            lastHostTime = arrival;
+
+            const double device =
+                static_cast<double>(lastDeviceTime - baseDeviceTime) / DeviceClockRate;
+            const double host = std::chrono::duration<double>(arrival - baseHostTime).count();
+
+            if (std::abs(host - (intercept + slope * device)) > RESYNC_THRESHOLD) {
+                LogWarning("Serial {} device clock jumped by {:.3f} s. Resynchronized.",
+                           serial.GetPortName(),
+                           host - (intercept + slope * device));
+                ++resets;
+                Reset(deviceTime, arrival);
+            } else {
+                samples.push_back(Sample{device, host});
+                if (samples.size() > WINDOW_SIZE)
+                    samples.pop_front();
+                Fit();
+            }
+        }
+
+        acquired = MapToHost(samples.back().device);
+
+        if (logInterval.count() > 0 && samples.size() >= MIN_FIT_SAMPLES &&
+            arrival - lastLogTime >= logInterval) {
+            lastLogTime = arrival;
+            shouldLog   = true;
+        }
+    }
+
+    if (shouldLog && LogSystem::GetSingleton()->IsEnabled(LogLevel::Info)) {
+        const DeviceClockReport report = GetReport();
+        LogInfo("Serial {} device clock: {:.0f} Hz, drift {:+.2f} ppm, jitter {:.1f} us, "
+                "delay mean {:.1f} us max {:.1f} us over {} frames, {} wraps, {} resets.",
+                serial.GetPortName(),
+                report.clockRate,
+                report.drift,
+                report.jitter,
+                report.meanDelay,
+                report.maxDelay,
+                report.samples,
+                report.wraps,
+                report.resets);
+    }
+
+    return acquired;
+}
+
+auto iwr1443::DeviceClock::ToHostTime(uint32_t deviceTime) const noexcept
+    -> std::chrono::steady_clock::time_point {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (samples.empty())
+        return std::chrono::steady_clock::time_point();
+
+    // Signed distance to the last frame so that timestamps slightly before it also map.
+    const uint32_t lastRaw   = static_cast<uint32_t>(lastDeviceTime);
+    const int32_t  delta     = static_cast<int32_t>(deviceTime - lastRaw);
+    const uint64_t unwrapped = lastDeviceTime + static_cast<uint64_t>(static_cast<int64_t>(delta));
+    return MapToHost(static_cast<double>(static_cast<int64_t>(unwrapped - baseDeviceTime)) /
+                     DeviceClockRate);
+}
+
+auto iwr1443::DeviceClock::GetClockRate() const noexcept -> double {
+    std::lock_guard<std::mutex> lock(mutex);
+    return DeviceClockRate / slope;
+}
+
+auto iwr1443::DeviceClock::GetReport() const noexcept -> DeviceClockReport {
+    DeviceClockReport report{};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    report.samples   = samples.size();
+    report.wraps     = wraps;
+    report.resets    = resets;
+    report.clockRate = DeviceClockRate / slope;
+    report.drift     = (1.0 / slope - 1.0) * 1e6;
+    report.jitter    = delayDeviation * 1e6;
+    report.meanDelay = meanDelay * 1e6;
+    report.maxDelay  = maxDelay * 1e6;
+    return report;
+}
+
+auto iwr1443::DeviceClock::SetLogInterval(std::chrono::seconds interval) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInterval = interval;
+}
+
+auto iwr1443::DeviceClock::Reset(uint32_t                              deviceTime,
+                                 std::chrono::steady_clock::time_point arrival) noexcept -> void {
+    samples.clear();
+    samples.push_back(Sample{0, 0});
+
+    baseDeviceTime = deviceTime;
+    baseHostTime   = arrival;
+    lastDeviceTime = deviceTime;
+    lastHostTime   = arrival;
+    slope          = 1;
+    intercept      = 0;
+    meanDelay      = 0;
+    delayDeviation = 0;
+    maxDelay       = 0;
+}
+
+auto iwr1443::DeviceClock::Fit() noexcept -> void {
+    // Queueing on the host only delays arrivals, so the fastest frame of each segment lies close
+    // to the true mapping. Fit through those and ignore the rest.
+    if (samples.size() >= MIN_FIT_SAMPLES) {
+        double sumX  = 0;
+        double sumY  = 0;
+        double sumXX = 0;
+        double sumXY = 0;
+
+        const size_t segmentSize = samples.size() / ENVELOPE_SEGMENTS;
+        for (size_t segment = 0; segment < ENVELOPE_SEGMENTS; ++segment) {
+            const auto begin = samples.begin() + static_cast<ptrdiff_t>(segment * segmentSize);
+            const auto end   = (segment + 1 == ENVELOPE_SEGMENTS)
+                                   ? samples.end()
+                                   : begin + static_cast<ptrdiff_t>(segmentSize);
+
+            const auto fastest = std::min_element(begin, end, [](const auto &lhs, const auto &rhs) {
+                return lhs.host - lhs.device < rhs.host - rhs.device;
+            });
+
+            sumX += fastest->device;
+            sumY += fastest->host;
+            sumXX += fastest->device * fastest->device;
+            sumXY += fastest->device * fastest->host;
+        }
+
+        const double count       = static_cast<double>(ENVELOPE_SEGMENTS);
+        const double denominator = count * sumXX - sumX * sumX;
+        if (denominator > 0) {
+            slope     = (count * sumXY - sumX * sumY) / denominator;
+            intercept = (sumY - slope * sumX) / count;
+        }
+    }
+
+    // Lower the line onto the envelope so that every delay is non-negative.
+    double minResidual = std::numeric_limits<double>::max();
+    for (const auto &sample : samples)
+        minResidual = std::min(minResidual, sample.host - (intercept + slope * sample.device));
+    intercept += minResidual;
+
+    double sum        = 0;
+    double sumSquares = 0;
+    maxDelay          = 0;
+    for (const auto &sample : samples) {
+        const double delay = sample.host - (intercept + slope * sample.device);
+        sum += delay;
+        sumSquares += delay * delay;
+        maxDelay = std::max(maxDelay, delay);
+    }
+
+    const double count = static_cast<double>(samples.size());
+    meanDelay          = sum / count;
+    delayDeviation     = std::sqrt(std::max(sumSquares / count - meanDelay * meanDelay, 0.0));
+}
+
+auto iwr1443::DeviceClock::MapToHost(double device) const noexcept
+    -> std::chrono::steady_clock::time_point {
+    const std::chrono::duration<double> host(intercept + slope * device);
+    return baseHostTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(host);
+}
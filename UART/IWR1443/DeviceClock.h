@@ -0,0 +1,201 @@
+#pragma once
+
+#include "../Serial.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace iwr1443 {
+
+struct DeviceClockReport {
+    /// @brief
+    ///   Number of frames in the fit window.
+    uint64_t samples;
+
+    /// @brief
+    ///   Number of times the 32-bit device timestamp wrapped around.
+    uint64_t wraps;
+
+    /// @brief
+    ///   Number of times the estimator is reset because the device clock jumped.
+    uint64_t resets;
+
+    /// @brief
+    ///   Estimated device clock rate in Hz, measured with host monotonic clock.
+    double clockRate;
+
+    /// @brief
+    ///   Deviation of device clock rate from nominal rate in parts per million.
+    double drift;
+
+    /// @brief
+    ///   Standard deviation in microseconds of frame arrival delays in the fit window.
+    double jitter;
+
+    /// @brief
+    ///   Mean in microseconds of frame arrival delays over the transport floor.
+    double meanDelay;
+
+    /// @brief
+    ///   Maximum in microseconds of frame arrival delays over the transport floor.
+    double maxDelay;
+};
+
+/// @brief
+///   Maps device timestamps in frame headers to host monotonic time. The mapping is a line fitted
+///   to the lower envelope of (device time, arrival time) pairs over a sliding window, so it
+///   follows device clock drift while queueing delays on the host only lift single samples.
+class DeviceClock {
+public:
+    /// @brief
+    ///   Create a device clock estimator for the specified serial.
+    ///
+    /// @param serial   The serial that receives frames. Only used to name it in logs.
+    explicit DeviceClock(const Serial &serial) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    DeviceClock(const DeviceClock &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const DeviceClock &) = delete;
+
+    /// @brief
+    ///   Destroy this device clock estimator.
+    ~DeviceClock() noexcept;
+
+    /// @brief
+    ///   Add a frame to the fit window.
+    ///
+    /// @param[in] frame    Pointer to start of a complete frame.
+    /// @param     arrival  Host time that the magic word of the frame arrived.
+    ///
+    /// @return std::chrono::steady_clock::time_point
+    ///   Return host time that the frame is acquired by the device. This includes the minimum
+    ///   transport delay, which can not be observed with one-way timestamps. Return a default
+    ///   constructed time point if @p arrival is not set.
+    auto OnFrame(const void *frame, std::chrono::steady_clock::time_point arrival) noexcept
+        -> std::chrono::steady_clock::time_point;
+
+    /// @brief
+    ///   Map a device timestamp to host time with current fit. The timestamp must be within half
+    ///   a wrap period of the last frame.
+    ///
+    /// @param deviceTime   Device timestamp in CPU cycles.
+    ///
+    /// @return std::chrono::steady_clock::time_point
+    ///   Return the host time. Return a default constructed time point if no frame is received.
+    auto ToHostTime(uint32_t deviceTime) const noexcept -> std::chrono::steady_clock::time_point;
+
+    /// @brief
+    ///   Get estimated device clock rate in Hz. The nominal rate is returned until enough frames
+    ///   are fitted.
+    auto GetClockRate() const noexcept -> double;
+
+    /// @brief
+    ///   Get current clock mapping statistics.
+    ///
+    /// @return DeviceClockReport
+    ///   Return a snapshot of clock mapping statistics.
+    auto GetReport() const noexcept -> DeviceClockReport;
+
+    /// @brief
+    ///   Set interval to log clock mapping statistics. Pass zero to disable logging.
+    ///
+    /// @param interval     The new log interval.
+    auto SetLogInterval(std::chrono::seconds interval) noexcept -> void;
+
+private:
+    struct Sample {
+        /// @brief
+        ///   Seconds of nominal device clock since the base sample.
+        double device;
+
+        /// @brief
+        ///   Seconds of host clock since the base sample.
+        double host;
+    };
+
+    /// @brief
+    ///   Drop all samples and start over with the specified frame.
+    auto Reset(uint32_t deviceTime, std::chrono::steady_clock::time_point arrival) noexcept
+        -> void;
+
+    /// @brief
+    ///   Fit mapping line to the lower envelope of the window and update delay statistics.
+    auto Fit() noexcept -> void;
+
+    /// @brief
+    ///   Map seconds of nominal device clock since base sample to host time.
+    auto MapToHost(double device) const noexcept -> std::chrono::steady_clock::time_point;
+
+private:
+    /// @brief
+    ///   The serial that receives frames.
+    const Serial &serial;
+
+    /// @brief
+    ///   (device time, arrival time) pairs in the fit window.
+    std::deque<Sample> samples;
+
+    /// @brief
+    ///   Unwrapped device time of the base sample in CPU cycles.
+    uint64_t baseDeviceTime;
+
+    /// @brief
+    ///   Host time of the base sample.
+    std::chrono::steady_clock::time_point baseHostTime;
+
+    /// @brief
+    ///   Unwrapped device time of the last frame in CPU cycles.
+    uint64_t lastDeviceTime;
+
+    /// @brief
+    ///   Arrival time of the last frame.
+    std::chrono::steady_clock::time_point lastHostTime;
+
+    /// @brief
+    ///   Host seconds per nominal device second.
+    double slope;
+
+    /// @brief
+    ///   Host seconds since base sample at device time of base sample.
+    double intercept;
+
+    /// @brief
+    ///   Mean seconds of arrival delays over the fitted line in the window.
+    double meanDelay;
+
+    /// @brief
+    ///   Standard deviation in seconds of arrival delays in the window.
+    double delayDeviation;
+
+    /// @brief
+    ///   Maximum seconds of arrival delays over the fitted line in the window.
+    double maxDelay;
+
+    /// @brief
+    ///   Number of times the device timestamp wrapped around.
+    uint64_t wraps;
+
+    /// @brief
+    ///   Number of times the estimator is reset.
+    uint64_t resets;
+
+    /// @brief
+    ///   Interval to log clock mapping statistics.
+    std::chrono::seconds logInterval;
+
+    /// @brief
+    ///   Time that clock mapping statistics are logged last time.
+    std::chrono::steady_clock::time_point lastLogTime;
+
+    /// @brief
+    ///   Mutex that is used to protect the fit.
+    mutable std::mutex mutex;
+};
+
+} // namespace iwr1443
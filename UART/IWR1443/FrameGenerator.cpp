@@ -0,0 +1,529 @@
+#include "FrameGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace iwr1443;
+
+static constexpr const std::array<TLVType, 15> ALL_TLV_TYPES = {
+    TLVType::DetectedPoints,
+    TLVType::RangeProfile,
+    TLVType::NoiseFloorProfile,
+    TLVType::AzimuthStaticHeatmap,
+    TLVType::RangeDopplerHeatmap,
+    TLVType::Statistics,
+    TLVType::DetectedPointsSideInfo,
+    TLVType::AzimuthElevationStaticHeatmap,
+    TLVType::TemperatureStatistics,
+    TLVType::SphericalCoordinates,
+    TLVType::TargetList,
+    TLVType::TargetIndex,
+    TLVType::SphericalCompressedPointCloud,
+    TLVType::PresenceDetection,
+    TLVType::OccupancyStateMachineOutput,
+};
+
+// Frames are padded to a multiple of this size like the mmWave demo does.
+static constexpr const size_t FRAME_ALIGNMENT = 32;
+
+// Version and platform reported by the IWR1443 mmWave demo.
+static constexpr const uint32_t DEMO_VERSION  = 0x02010004;
+static constexpr const uint32_t DEMO_PLATFORM = 0x000A1443;
+
+// Range covered by range bins in meters.
+static constexpr const float MAX_RANGE = 10.0f;
+
+// Maximum radial velocity covered by doppler bins in meters per second.
+static constexpr const float MAX_VELOCITY = 5.0f;
+
+// Target index that marks a point not associated with any target.
+static constexpr const uint8_t NO_TARGET = 255;
+
+// Ratio of points that are not associated with any target.
+static constexpr const double CLUTTER_RATIO = 0.1;
+
+template <typename T>
+static auto Append(std::vector<std::byte> &output, const T &value) noexcept -> void {
+    const size_t offset = output.size();
+    output.resize(offset + sizeof(T));
+    std::memcpy(output.data() + offset, &value, sizeof(T));
+}
+
+static auto MakeQ9(float value) noexcept -> Q9Real {
+    const float magnitude = std::min(std::fabs(value), 511.96875f);
+
+    Q9Real result{};
+    result.sign     = value < 0 ? 1 : 0;
+    result.integer  = static_cast<uint16_t>(magnitude);
+    result.fraction = static_cast<uint16_t>((magnitude - std::floor(magnitude)) * 32);
+    return result;
+}
+
+// Quantize a value in the specified unit. Values out of range of T saturate.
+template <typename T>
+static auto Quantize(float value, float unit) noexcept -> T {
+    const float steps = std::round(value / unit);
+    const float lower = static_cast<float>(std::numeric_limits<T>::min());
+    const float upper = static_cast<float>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::clamp(steps, lower, upper));
+}
+
+iwr1443::FrameGenerator::FrameGenerator(const FrameGeneratorConfig &config) noexcept
+    : config(config),
+      statistics(),
+      random(config.seed),
+      frameNumber(1),
+      lastPacketLength(0),
+      deviceTime(0),
+      targets(),
+      reflectors(),
+      points() {
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+
+    targets.reserve(config.targetCount);
+    for (uint32_t i = 0; i < config.targetCount; ++i) {
+        targets.push_back(Target{
+            position(random),
+            position(random) + 4.0f,
+            position(random) / 3.0f,
+            velocity(random),
+            velocity(random),
+            velocity(random) / 10.0f,
+        });
+    }
+
+    // Reflectors are spread like clutter but stay in place.
+    std::uniform_real_distribution<float> range(0.5f, MAX_RANGE - 0.5f);
+    std::uniform_real_distribution<float> angle(-1.0f, 1.0f);
+
+    reflectors.reserve(config.reflectorCount);
+    for (uint32_t i = 0; i < config.reflectorCount; ++i) {
+        Point point{};
+        point.range     = range(random);
+        point.azimuth   = angle(random);
+        point.elevation = angle(random) / 4.0f;
+        point.snr       = 10.0f + static_cast<float>(Uniform()) * 10.0f;
+        point.target    = NO_TARGET;
+        reflectors.push_back(point);
+    }
+
+    points.reserve(config.pointCount + config.reflectorCount);
+}
+
+iwr1443::FrameGenerator::~FrameGenerator() noexcept {}
+
+auto iwr1443::FrameGenerator::DefaultConfig() noexcept -> FrameGeneratorConfig {
+    FrameGeneratorConfig config{};
+    config.tlvs.assign(ALL_TLV_TYPES.begin(), ALL_TLV_TYPES.end());
+    config.pointCount      = 32;
+    config.targetCount     = 4;
+    config.reflectorCount  = 0;
+    config.rangeBins       = 64;
+    config.dopplerBins     = 16;
+    config.virtualAntennas = 8;
+    config.zoneCount       = 4;
+    config.frameRate       = 10;
+    config.clockRate       = DeviceClockRate;
+    config.clockDrift      = 0;
+    config.baudRate        = 921600;
+    config.seed            = 1;
+    return config;
+}
+
+auto iwr1443::FrameGenerator::AllTLVTypes() noexcept -> std::span<const TLVType> {
+    return ALL_TLV_TYPES;
+}
+
+auto iwr1443::FrameGenerator::ParseTLVs(std::string_view value, std::vector<TLVType> &tlvs) noexcept
+    -> bool {
+    tlvs.clear();
+    while (!value.empty()) {
+        const size_t     end  = std::min(value.find(','), value.size());
+        uint32_t         type = 0;
+        std::string_view item = value.substr(0, end);
+
+        auto [ptr, error] = std::from_chars(item.data(), item.data() + item.size(), type);
+        if (error != std::errc() || ptr != item.data() + item.size())
+            return false;
+
+        tlvs.push_back(static_cast<TLVType>(type));
+        value.remove_prefix(std::min(end + 1, value.size()));
+    }
+    return true;
+}
+
+auto iwr1443::FrameGenerator::Generate(std::vector<std::byte> &output) noexcept -> void {
+    const size_t offset = output.size();
+    GenerateFrame(output);
+    InjectErrors(output, offset);
+    statistics.bytes += output.size() - offset;
+}
+
+auto iwr1443::FrameGenerator::GenerateFrame(std::vector<std::byte> &output) noexcept -> void {
+    Simulate();
+
+    const size_t offset = output.size();
+    output.resize(offset + sizeof(FrameHeader));
+
+    uint32_t tlvCount         = 0;
+    size_t   statisticsOffset = 0;
+    for (TLVType type : ALL_TLV_TYPES) {
+        if (!IsTLVEnabled(type))
+            continue;
+
+        const size_t tlvOffset = output.size();
+        output.resize(tlvOffset + sizeof(TLVHeader));
+        AppendTLV(type, output);
+
+        const TLVHeader tlvHeader{type,
+                                  static_cast<uint32_t>(output.size() - tlvOffset -
+                                                        sizeof(TLVHeader))};
+        std::memcpy(output.data() + tlvOffset, &tlvHeader, sizeof(TLVHeader));
+
+        if (type == TLVType::Statistics)
+            statisticsOffset = tlvOffset + sizeof(TLVHeader);
+        ++tlvCount;
+    }
+
+    const size_t length = output.size() - offset;
+    output.resize(offset + (length + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT);
+
+    FrameHeader frameHeader{};
+    frameHeader.magic[0]            = 0x0102;
+    frameHeader.magic[1]            = 0x0304;
+    frameHeader.magic[2]            = 0x0506;
+    frameHeader.magic[3]            = 0x0708;
+    frameHeader.version             = DEMO_VERSION;
+    frameHeader.packetLength        = static_cast<uint32_t>(output.size() - offset);
+    frameHeader.platform            = DEMO_PLATFORM;
+    frameHeader.frameNumber         = frameNumber;
+    frameHeader.time                = static_cast<uint32_t>(static_cast<uint64_t>(deviceTime));
+    frameHeader.detectedObjectCount = static_cast<uint32_t>(points.size());
+    frameHeader.tlvCount            = tlvCount;
+    std::memcpy(output.data() + offset, &frameHeader, sizeof(FrameHeader));
+
+    // Processing margin depends on the final frame size. Transmit time is reported for the
+    // previous frame like the demo does.
+    if (statisticsOffset != 0) {
+        const double framePeriod = 1e6 / std::max(config.frameRate, 1e-3);
+        const double processing  = 2000.0 + 25.0 * static_cast<double>(points.size());
+        const double byteTime     = config.baudRate == 0 ? 0 : 10.0 * 1e6 / config.baudRate;
+
+        Statistics value{};
+        value.interFrameProcessingTime   = static_cast<uint32_t>(processing);
+        value.transmitOutputTime         = static_cast<uint32_t>(lastPacketLength * byteTime);
+        value.interFrameProcessingMargin = static_cast<uint32_t>(
+            std::max(framePeriod - processing - frameHeader.packetLength * byteTime, 0.0));
+        value.interChirpProcessingMargin = 12 + random() % 4;
+        value.activeFrameCPULoad         = 40 + random() % 10;
+        value.interFrameCPULoad          = static_cast<uint32_t>(
+            std::min(processing / framePeriod * 100, 100.0));
+        std::memcpy(output.data() + statisticsOffset, &value, sizeof(Statistics));
+    }
+
+    lastPacketLength = frameHeader.packetLength;
+    ++frameNumber;
+    ++statistics.frames;
+
+    const double ticksPerFrame =
+        config.clockRate * (1 + config.clockDrift * 1e-6) / std::max(config.frameRate, 1e-3);
+    deviceTime = std::fmod(deviceTime + ticksPerFrame, 4294967296.0);
+}
+
+auto iwr1443::FrameGenerator::SetTLVEnabled(TLVType type, bool enable) noexcept -> void {
+    auto iter = std::find(config.tlvs.begin(), config.tlvs.end(), type);
+    if (enable && iter == config.tlvs.end())
+        config.tlvs.push_back(type);
+    else if (!enable && iter != config.tlvs.end())
+        config.tlvs.erase(iter);
+}
+
+auto iwr1443::FrameGenerator::IsTLVEnabled(TLVType type) const noexcept -> bool {
+    return std::find(config.tlvs.begin(), config.tlvs.end(), type) != config.tlvs.end();
+}
+
+auto iwr1443::FrameGenerator::Simulate() noexcept -> void {
+    const float dt = 1.0f / static_cast<float>(std::max(config.frameRate, 1e-3));
+
+    // Targets bounce inside the field of view.
+    for (auto &target : targets) {
+        target.x += target.vx * dt;
+        target.y += target.vy * dt;
+        target.z += target.vz * dt;
+
+        if (std::fabs(target.x) > 4.0f)
+            target.vx = -target.vx;
+        if (target.y < 0.5f || target.y > 8.0f)
+            target.vy = -target.vy;
+        if (target.z < -1.0f || target.z > 2.0f)
+            target.vz = -target.vz;
+    }
+
+    std::normal_distribution<float>       scatter(0.0f, 0.15f);
+    std::uniform_real_distribution<float> clutter(0.5f, MAX_RANGE - 0.5f);
+    std::uniform_real_distribution<float> angle(-1.0f, 1.0f);
+
+    points.clear();
+    for (uint32_t i = 0; i < config.pointCount; ++i) {
+        Point point{};
+        if (targets.empty() || Uniform() < CLUTTER_RATIO) {
+            point.range     = clutter(random);
+            point.azimuth   = angle(random);
+            point.elevation = angle(random) / 4.0f;
+            point.doppler   = 0;
+            point.snr       = 8.0f + static_cast<float>(Uniform()) * 4.0f;
+            point.target    = NO_TARGET;
+        } else {
+            // Only targets with an index below NO_TARGET can be referenced by points.
+            const size_t  index  = i % std::min<size_t>(targets.size(), NO_TARGET);
+            const Target &target = targets[index];
+
+            const float x     = target.x + scatter(random);
+            const float y     = target.y + scatter(random);
+            const float z     = target.z + scatter(random);
+            const float range = std::sqrt(x * x + y * y + z * z);
+
+            point.range     = range;
+            point.azimuth   = std::atan2(x, y);
+            point.elevation = std::asin(z / range);
+            point.doppler   = (x * target.vx + y * target.vy + z * target.vz) / range;
+            point.snr       = 15.0f + static_cast<float>(Uniform()) * 20.0f;
+            point.target    = static_cast<uint8_t>(index);
+        }
+
+        point.noise = 30.0f + static_cast<float>(Uniform()) * 5.0f;
+        points.push_back(point);
+    }
+
+    for (Point point : reflectors) {
+        point.noise = 30.0f + static_cast<float>(Uniform()) * 5.0f;
+        points.push_back(point);
+    }
+}
+
+auto iwr1443::FrameGenerator::AppendTLV(TLVType type, std::vector<std::byte> &output) noexcept
+    -> void {
+    const float rangeStep = MAX_RANGE / static_cast<float>(std::max(config.rangeBins, 1u));
+
+    // Log magnitude of a range bin, peaks at points.
+    auto magnitude = [&](uint32_t bin, bool withPoints) -> float {
+        float value = 40.0f + static_cast<float>(Uniform()) * 3.0f;
+        if (withPoints) {
+            for (const auto &point : points) {
+                if (static_cast<uint32_t>(point.range / rangeStep) == bin)
+                    value = std::max(value, 40.0f + point.snr * 2.0f);
+            }
+        }
+        return value;
+    };
+
+    switch (type) {
+    case TLVType::DetectedPoints: {
+        Append(output, DetectedPointHeader{static_cast<uint16_t>(points.size()), 9});
+        for (const auto &point : points) {
+            const float horizontal = point.range * std::cos(point.elevation);
+            Append(output,
+                   DetectedPoint{horizontal * std::sin(point.azimuth),
+                                 horizontal * std::cos(point.azimuth),
+                                 point.range * std::sin(point.elevation)});
+        }
+        break;
+    }
+
+    case TLVType::RangeProfile:
+    case TLVType::NoiseFloorProfile: {
+        const bool withPoints = (type == TLVType::RangeProfile);
+        for (uint32_t bin = 0; bin < config.rangeBins; ++bin)
+            Append(output, MakeQ9(magnitude(bin, withPoints)));
+        break;
+    }
+
+    case TLVType::AzimuthStaticHeatmap:
+    case TLVType::AzimuthElevationStaticHeatmap: {
+        // Complex samples of each virtual antenna, imaginary part first.
+        std::normal_distribution<float> sample(0.0f, 64.0f);
+        for (uint32_t bin = 0; bin < config.rangeBins; ++bin) {
+            for (uint32_t antenna = 0; antenna < config.virtualAntennas; ++antenna) {
+                Append(output, static_cast<int16_t>(sample(random)));
+                Append(output, static_cast<int16_t>(sample(random)));
+            }
+        }
+        break;
+    }
+
+    case TLVType::RangeDopplerHeatmap: {
+        std::vector<uint16_t> heatmap(static_cast<size_t>(config.rangeBins) * config.dopplerBins);
+        for (auto &value : heatmap)
+            value = static_cast<uint16_t>(1000 + random() % 200);
+
+        const float dopplerStep =
+            2 * MAX_VELOCITY / static_cast<float>(std::max(config.dopplerBins, 1u));
+        for (const auto &point : points) {
+            const auto rangeBin   = static_cast<uint32_t>(point.range / rangeStep);
+            const auto dopplerBin = static_cast<uint32_t>(
+                std::clamp((point.doppler + MAX_VELOCITY) / dopplerStep,
+                           0.0f,
+                           static_cast<float>(config.dopplerBins) - 1));
+            if (rangeBin < config.rangeBins)
+                heatmap[rangeBin * config.dopplerBins + dopplerBin] =
+                    static_cast<uint16_t>(1000 + point.snr * 100);
+        }
+
+        for (uint16_t value : heatmap)
+            Append(output, value);
+        break;
+    }
+
+    case TLVType::Statistics:
+        // Filled in once the frame size is known.
+        Append(output, Statistics{});
+        break;
+
+    case TLVType::DetectedPointsSideInfo:
+        // SNR and noise are reported in 0.1 dB.
+        for (const auto &point : points) {
+            Append(output,
+                   DetectedPointSideInfo{static_cast<uint16_t>(point.snr * 10),
+                                         static_cast<uint16_t>(point.noise * 10)});
+        }
+        break;
+
+    case TLVType::TemperatureStatistics: {
+        TemperatureStatistics value{};
+        value.tempReportValid = 0;
+        value.time            = static_cast<uint32_t>(deviceTime / config.clockRate * 1000);
+
+        const auto sensor = [this]() -> uint16_t {
+            return static_cast<uint16_t>(45 + random() % 5);
+        };
+
+        value.tmpRx0Sens  = sensor();
+        value.tmpRx1Sens  = sensor();
+        value.tmpRx2Sens  = sensor();
+        value.tmpRx3Sens  = sensor();
+        value.tmpTx0Sens  = sensor();
+        value.tmpTx1Sens  = sensor();
+        value.tmpTx2Sens  = sensor();
+        value.tmpPmSens   = sensor();
+        value.tmpDig0Sens = sensor();
+        value.tmpDig1Sens = sensor();
+
+        Append(output, value);
+        break;
+    }
+
+    case TLVType::SphericalCoordinates:
+        for (const auto &point : points)
+            Append(output,
+                   SphericalCoordinate{point.range, point.azimuth, point.elevation, point.doppler});
+        break;
+
+    case TLVType::TargetList:
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const Target &target = targets[i];
+
+            Tracked3DTarget value{};
+            value.trackID               = static_cast<float>(i);
+            value.position.x            = target.x;
+            value.position.y            = target.y;
+            value.position.z            = target.z;
+            value.velocity.x            = target.vx;
+            value.velocity.y            = target.vy;
+            value.velocity.z            = target.vz;
+            value.errorCovariance[0][0] = 0.05f;
+            value.errorCovariance[1][1] = 0.05f;
+            value.errorCovariance[2][2] = 0.1f;
+            value.gatingFunctionGain    = 3.0f;
+            value.confidenceLevel       = 0.9f;
+            Append(output, value);
+        }
+        break;
+
+    case TLVType::TargetIndex:
+        for (const auto &point : points)
+            Append(output, point.target);
+        break;
+
+    case TLVType::SphericalCompressedPointCloud: {
+        const SphericalCompressedPointCloudHeader header{
+            0.01f, 0.01f, 0.00028f * 16, 0.00025f * 16, 0.04f};
+        Append(output, header);
+
+        for (const auto &point : points) {
+            Append(output,
+                   SphericalCompressedPoint{
+                       Quantize<int8_t>(point.elevation, header.elevationUnit),
+                       Quantize<int8_t>(point.azimuth, header.azimuthUnit),
+                       Quantize<int16_t>(point.doppler, header.dopplerUnit),
+                       Quantize<uint16_t>(point.range, header.rangeUnit),
+                       Quantize<uint16_t>(point.snr, header.snrUnit),
+                   });
+        }
+        break;
+    }
+
+    case TLVType::PresenceDetection:
+        Append(output, static_cast<uint32_t>(targets.empty() ? 0 : 1));
+        break;
+
+    case TLVType::OccupancyStateMachineOutput: {
+        // One bit per zone. Zones split the field of view by azimuth.
+        uint32_t occupied = 0;
+        for (const auto &target : targets) {
+            const float azimuth = std::atan2(target.x, target.y);
+            const auto  zone    = static_cast<uint32_t>(std::clamp(
+                (azimuth + 1.0f) / 2.0f * config.zoneCount, 0.0f, config.zoneCount - 1.0f));
+            if (zone < 32)
+                occupied |= 1u << zone;
+        }
+        Append(output, occupied);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+auto iwr1443::FrameGenerator::InjectErrors(std::vector<std::byte> &output, size_t offset) noexcept
+    -> void {
+    const size_t size = output.size() - offset;
+    if (size == 0)
+        return;
+
+    auto pick = [this](size_t count) -> size_t { return static_cast<size_t>(random() % count); };
+
+    if (Uniform() < config.corruptProbability) {
+        const size_t count = 1 + pick(4);
+        for (size_t i = 0; i < count; ++i)
+            output[offset + pick(size)] ^= static_cast<std::byte>(1 + pick(255));
+        ++statistics.corrupted;
+    }
+
+    if (Uniform() < config.dropProbability) {
+        const size_t position = offset + pick(size);
+        const size_t count    = std::min<size_t>(1 + pick(16), output.size() - position);
+        output.erase(output.begin() + static_cast<ptrdiff_t>(position),
+                     output.begin() + static_cast<ptrdiff_t>(position + count));
+        ++statistics.dropped;
+    }
+
+    if (Uniform() < config.truncateProbability && output.size() > offset) {
+        output.resize(offset + pick(output.size() - offset));
+        ++statistics.truncated;
+    }
+
+    if (Uniform() < config.garbageProbability) {
+        std::vector<std::byte> garbage(1 + pick(64));
+        for (auto &value : garbage)
+            value = static_cast<std::byte>(pick(256));
+        output.insert(
+            output.begin() + static_cast<ptrdiff_t>(offset), garbage.begin(), garbage.end());
+        ++statistics.garbage;
+    }
+}
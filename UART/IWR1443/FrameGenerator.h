@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace iwr1443 {
+
+struct FrameGeneratorConfig {
+    /// @brief
+    ///   TLVs that are emitted in each frame. TLVs are always emitted in the order of TLVType.
+    std::vector<TLVType> tlvs;
+
+    /// @brief
+    ///   Number of detected points per frame.
+    uint32_t pointCount;
+
+    /// @brief
+    ///   Number of tracked targets per frame.
+    uint32_t targetCount;
+
+    /// @brief
+    ///   Number of static reflectors. Every frame has a point with zero doppler at each reflector
+    ///   in addition to detected points.
+    uint32_t reflectorCount;
+
+    /// @brief
+    ///   Number of range bins of range profiles and heatmaps.
+    uint32_t rangeBins;
+
+    /// @brief
+    ///   Number of doppler bins of range doppler heatmap.
+    uint32_t dopplerBins;
+
+    /// @brief
+    ///   Number of virtual antennas of azimuth heatmaps.
+    uint32_t virtualAntennas;
+
+    /// @brief
+    ///   Number of zones of presence detection and occupancy outputs.
+    uint32_t zoneCount;
+
+    /// @brief
+    ///   Frame rate in frames per second. Used to advance the device clock.
+    double frameRate;
+
+    /// @brief
+    ///   Frequency of the device clock that is reported in frame header.
+    double clockRate;
+
+    /// @brief
+    ///   Drift of the device clock in parts per million.
+    double clockDrift;
+
+    /// @brief
+    ///   Baud rate of the data port. Used to fill transmit time of statistics TLV.
+    uint32_t baudRate;
+
+    /// @brief
+    ///   Probability that some bytes of a frame are flipped.
+    double corruptProbability;
+
+    /// @brief
+    ///   Probability that some bytes of a frame are removed.
+    double dropProbability;
+
+    /// @brief
+    ///   Probability that a frame is cut short.
+    double truncateProbability;
+
+    /// @brief
+    ///   Probability that garbage bytes are inserted before a frame.
+    double garbageProbability;
+
+    /// @brief
+    ///   Seed of the random generator.
+    uint32_t seed;
+};
+
+struct FrameGeneratorStatistics {
+    /// @brief
+    ///   Number of frames generated.
+    uint64_t frames;
+
+    /// @brief
+    ///   Number of bytes generated, including injected errors.
+    uint64_t bytes;
+
+    /// @brief
+    ///   Number of frames that have flipped bytes.
+    uint64_t corrupted;
+
+    /// @brief
+    ///   Number of frames that have removed bytes.
+    uint64_t dropped;
+
+    /// @brief
+    ///   Number of frames that are cut short.
+    uint64_t truncated;
+
+    /// @brief
+    ///   Number of garbage blocks inserted between frames.
+    uint64_t garbage;
+};
+
+/// @brief
+///   Generator of synthetic IWR1443 data port frames. Frames contain moving targets with scattered
+///   points and are valid unless errors are injected.
+class FrameGenerator {
+public:
+    /// @brief
+    ///   Create a frame generator.
+    ///
+    /// @param config   The generator configuration.
+    explicit FrameGenerator(const FrameGeneratorConfig &config) noexcept;
+
+    /// @brief
+    ///   Destroy this frame generator.
+    ~FrameGenerator() noexcept;
+
+    /// @brief
+    ///   Get default configuration. All TLVs are enabled and no error is injected.
+    static auto DefaultConfig() noexcept -> FrameGeneratorConfig;
+
+    /// @brief
+    ///   Get all TLV types that could be generated.
+    static auto AllTLVTypes() noexcept -> std::span<const TLVType>;
+
+    /// @brief
+    ///   Parse a comma separated list of TLV type numbers, such as "1,2,6".
+    ///
+    /// @param      value   The TLV list.
+    /// @param[out] tlvs    Parsed TLV types.
+    ///
+    /// @return bool
+    ///   Return false if the list contains an invalid number.
+    static auto ParseTLVs(std::string_view value, std::vector<TLVType> &tlvs) noexcept -> bool;
+
+    /// @brief
+    ///   Generate next frame and inject errors according to configuration.
+    ///
+    /// @param[out] output  The frame is appended to this buffer.
+    auto Generate(std::vector<std::byte> &output) noexcept -> void;
+
+    /// @brief
+    ///   Generate next frame without injecting errors.
+    ///
+    /// @param[out] output  The frame is appended to this buffer.
+    auto GenerateFrame(std::vector<std::byte> &output) noexcept -> void;
+
+    /// @brief
+    ///   Enable or disable the specified TLV.
+    ///
+    /// @param type     Type of the TLV.
+    /// @param enable   Whether to emit the TLV.
+    auto SetTLVEnabled(TLVType type, bool enable) noexcept -> void;
+
+    /// @brief
+    ///   Check whether the specified TLV is emitted.
+    auto IsTLVEnabled(TLVType type) const noexcept -> bool;
+
+    /// @brief
+    ///   Set frame rate. The device clock advances by this rate.
+    auto SetFrameRate(double rate) noexcept -> void {
+        config.frameRate = rate;
+    }
+
+    /// @brief
+    ///   Get the generator configuration.
+    auto GetConfig() const noexcept -> const FrameGeneratorConfig & {
+        return config;
+    }
+
+    /// @brief
+    ///   Get number of frames and injected errors so far.
+    auto GetStatistics() const noexcept -> const FrameGeneratorStatistics & {
+        return statistics;
+    }
+
+private:
+    /// @brief
+    ///   Move targets and scatter points for next frame.
+    auto Simulate() noexcept -> void;
+
+    /// @brief
+    ///   Append payload of the specified TLV.
+    auto AppendTLV(TLVType type, std::vector<std::byte> &output) noexcept -> void;
+
+    /// @brief
+    ///   Inject errors into the last frame of @p output that starts at @p offset.
+    auto InjectErrors(std::vector<std::byte> &output, size_t offset) noexcept -> void;
+
+    /// @brief
+    ///   Draw a uniform number in [0, 1).
+    auto Uniform() noexcept -> double {
+        return std::uniform_real_distribution<double>(0, 1)(random);
+    }
+
+private:
+    struct Target {
+        float x;
+        float y;
+        float z;
+        float vx;
+        float vy;
+        float vz;
+    };
+
+    struct Point {
+        float   range;
+        float   azimuth;
+        float   elevation;
+        float   doppler;
+        float   snr;
+        float   noise;
+        uint8_t target;
+    };
+
+    /// @brief
+    ///   The generator configuration.
+    FrameGeneratorConfig config;
+
+    /// @brief
+    ///   Frames and errors generated so far.
+    FrameGeneratorStatistics statistics;
+
+    /// @brief
+    ///   Random generator.
+    std::mt19937 random;
+
+    /// @brief
+    ///   Number of next frame.
+    uint32_t frameNumber;
+
+    /// @brief
+    ///   Packet length of the previous frame. Its transmit time is reported in Statistics TLV.
+    uint32_t lastPacketLength;
+
+    /// @brief
+    ///   Device clock in ticks. Wraps around like the 32-bit device counter.
+    double deviceTime;
+
+    /// @brief
+    ///   Moving targets.
+    std::vector<Target> targets;
+
+    /// @brief
+    ///   Points of static reflectors.
+    std::vector<Point> reflectors;
+
+    /// @brief
+    ///   Points of current frame.
+    std::vector<Point> points;
+};
+
+} // namespace iwr1443
@@ -0,0 +1,324 @@
+#include "Fusion.h"
+#include "../Log.h"
+#include "Data.h"
+
+#include <algorithm>
+#include <format>
+
+using namespace iwr1443;
+
+iwr1443::PointCloudFusion::PointCloudFusion(const FusionConfig       &config,
+                                            std::vector<FusionDevice> devices)
+    : config(config),
+      devices(),
+      spareClouds(),
+      readySlices(),
+      deliveringSlices(),
+      spareSlices(),
+      delivering(false),
+      sink(),
+      sliceEnd(),
+      wallClockOffset(),
+      slices(0),
+      incompleteSlices(0),
+      frames(0),
+      lateFrames(0),
+      points(0),
+      latencies(),
+      latencyCount(0),
+      logInterval(10),
+      lastLogTime(),
+      mutex() {
+    this->devices.reserve(devices.size());
+    for (auto &device : devices)
+        this->devices.push_back(DeviceState{std::move(device), PointCloud(), {}});
+
+    wallClockOffset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch() -
+        std::chrono::steady_clock::now().time_since_epoch());
+}
+
+iwr1443::PointCloudFusion::~PointCloudFusion() noexcept {
+    Flush();
+}
+
+auto iwr1443::PointCloudFusion::SetSink(std::function<void(const FusedFrame &)> sink) noexcept
+    -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->sink = std::move(sink);
+}
+
+auto iwr1443::PointCloudFusion::OnFrame(uint16_t                              device,
+                                        const void                           *frame,
+                                        std::chrono::steady_clock::time_point time) -> void {
+    if (device >= devices.size())
+        return;
+
+    // Extract without the lock. Only this device touches its scratch cloud.
+    DeviceState &state = devices[device];
+    state.scratch.Clear();
+    ExtractPointCloud(frame, device, state.device.extrinsic, state.scratch);
+
+    const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+    const auto         now         = std::chrono::steady_clock::now();
+
+    // Device clock has no sample yet. Arrival time is the closest estimate, while the epoch would
+    // be older than every emitted slice and drop the frame as late.
+    if (time == std::chrono::steady_clock::time_point())
+        time = now;
+
+    std::chrono::steady_clock::duration behind{};
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (time < sliceEnd) {
+            ++lateFrames;
+            behind = sliceEnd - time;
+        } else {
+            PendingFrame pending{time, now, frameHeader->frameNumber, PointCloud()};
+            if (!spareClouds.empty()) {
+                pending.cloud = std::move(spareClouds.back());
+                spareClouds.pop_back();
+            }
+
+            std::swap(pending.cloud, state.scratch);
+            state.pending.push_back(std::move(pending));
+        }
+
+        Merge(now, false);
+        Deliver(lock);
+    }
+
+    if (behind.count() > 0) {
+        LOG_RATE_LIMITED(LogLevel::Warning,
+                         1.0,
+                         5,
+                         "Fusion dropped late frame {} of {}, {:.1f} ms behind emitted slices.",
+                         frameHeader->frameNumber,
+                         state.device.name,
+                         std::chrono::duration<double, std::milli>(behind).count());
+    }
+
+    LogReport(now);
+}
+
+auto iwr1443::PointCloudFusion::Poll() -> void {
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        Merge(now, false);
+        Deliver(lock);
+    }
+    LogReport(now);
+}
+
+auto iwr1443::PointCloudFusion::Flush() -> void {
+    const auto                   now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    Merge(now, true);
+    Deliver(lock);
+}
+
+auto iwr1443::PointCloudFusion::Serialize(const FusedFrame &frame, std::string &output) const
+    -> void {
+    const auto wallClock = [this](std::chrono::steady_clock::time_point time) -> int64_t {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch() +
+                                                                     wallClockOffset)
+            .count();
+    };
+
+    std::format_to(std::back_inserter(output),
+                   "{{\"Sequence\": {}, \"Time\": {}, \"Sources\": [",
+                   frame.sequence,
+                   wallClock(frame.time));
+
+    for (size_t i = 0; i < frame.sources.size(); ++i) {
+        const FusedSource &source = frame.sources[i];
+        std::format_to(std::back_inserter(output),
+                       "{}{{\"Device\": \"{}\", \"Frame\": {}, \"Time\": {}}}",
+                       i == 0 ? "" : ", ",
+                       devices[source.device].device.name,
+                       source.frameNumber,
+                       wallClock(source.time));
+    }
+
+    output.append("], \"Points\": [");
+
+    const PointCloud &cloud = frame.points;
+    for (size_t i = 0; i < cloud.Size(); ++i) {
+        std::format_to(std::back_inserter(output),
+                       "{}{{\"x\": {}, \"y\": {}, \"z\": {}, \"doppler\": {}, \"snr\": {}, "
+                       "\"device\": {}}}",
+                       i == 0 ? "" : ", ",
+                       cloud.x[i],
+                       cloud.y[i],
+                       cloud.z[i],
+                       cloud.doppler[i],
+                       cloud.snr[i],
+                       cloud.device[i]);
+    }
+
+    output.append("]}, ");
+}
+
+auto iwr1443::PointCloudFusion::GetReport() const noexcept -> FusionReport {
+    FusionReport report{};
+
+    std::vector<double> window;
+    window.reserve(LatencyWindowSize);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    report.slices           = slices;
+    report.incompleteSlices = incompleteSlices;
+    report.frames           = frames;
+    report.lateFrames       = lateFrames;
+    if (slices != 0)
+        report.pointsPerSlice = static_cast<double>(points) / static_cast<double>(slices);
+
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(latencyCount, LatencyWindowSize));
+    if (count == 0)
+        return report;
+
+    window.assign(latencies.begin(), latencies.begin() + static_cast<ptrdiff_t>(count));
+    const auto percentile = [&window](double quantile) -> double {
+        const size_t index =
+            std::min(static_cast<size_t>(quantile * static_cast<double>(window.size())),
+                     window.size() - 1);
+        std::nth_element(window.begin(),
+                         window.begin() + static_cast<ptrdiff_t>(index),
+                         window.end());
+        return window[index];
+    };
+
+    report.latencyP50 = percentile(0.5);
+    report.latencyP99 = percentile(0.99);
+    report.latencyMax = percentile(1.0);
+    return report;
+}
+
+auto iwr1443::PointCloudFusion::SetLogInterval(std::chrono::seconds interval) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInterval = interval;
+}
+
+auto iwr1443::PointCloudFusion::Merge(std::chrono::steady_clock::time_point now, bool flush)
+    -> void {
+    for (;;) {
+        // The earliest buffered frame opens the next slice. This is a k-way merge over the device
+        // queues, each of which is in acquisition order.
+        DeviceState *earliest = nullptr;
+        for (auto &state : devices) {
+            if (!state.pending.empty() &&
+                (earliest == nullptr ||
+                 state.pending.front().time < earliest->pending.front().time))
+                earliest = &state;
+        }
+
+        if (earliest == nullptr)
+            return;
+
+        const auto start = earliest->pending.front().time;
+        const auto end   = start + config.slicePeriod;
+
+        // A device may still deliver frames of this slice until it has buffered one after the
+        // slice. Frames of one device arrive in acquisition order.
+        bool complete = true;
+        for (const auto &state : devices) {
+            if (state.pending.empty() || state.pending.back().time < end)
+                complete = false;
+        }
+
+        if (!complete && !flush && now < end + config.waitWindow)
+            return;
+
+        FusedFrame fused;
+        if (!spareSlices.empty()) {
+            fused = std::move(spareSlices.back());
+            spareSlices.pop_back();
+        }
+
+        fused.sequence = slices;
+        fused.time     = start;
+        fused.sources.clear();
+        fused.points.Clear();
+
+        // A device faster than the slice period has several frames in the slice. All of them are
+        // merged, otherwise the later ones would be dropped as late.
+        size_t sourceDevices = 0;
+        for (size_t device = 0; device < devices.size(); ++device) {
+            auto &pending = devices[device].pending;
+            if (!pending.empty() && pending.front().time < end)
+                ++sourceDevices;
+
+            while (!pending.empty() && pending.front().time < end) {
+                PendingFrame &frame = pending.front();
+                fused.sources.push_back(
+                    FusedSource{static_cast<uint16_t>(device), frame.frameNumber, frame.time});
+                fused.points.Append(frame.cloud);
+
+                latencies[latencyCount % LatencyWindowSize] =
+                    std::chrono::duration<double, std::micro>(now - frame.arrival).count();
+                ++latencyCount;
+
+                spareClouds.push_back(std::move(frame.cloud));
+                pending.pop_front();
+            }
+        }
+
+        sliceEnd = end;
+        ++slices;
+        frames += fused.sources.size();
+        points += fused.points.Size();
+        if (sourceDevices != devices.size())
+            ++incompleteSlices;
+
+        readySlices.push_back(std::move(fused));
+    }
+}
+
+auto iwr1443::PointCloudFusion::Deliver(std::unique_lock<std::mutex> &lock) -> void {
+    // Slices stay in order since only one thread delivers. Others only queue their slices.
+    if (delivering)
+        return;
+
+    delivering = true;
+    while (!readySlices.empty()) {
+        deliveringSlices.swap(readySlices);
+        lock.unlock();
+
+        if (sink) {
+            for (const FusedFrame &slice : deliveringSlices)
+                sink(slice);
+        }
+
+        lock.lock();
+        for (FusedFrame &slice : deliveringSlices)
+            spareSlices.push_back(std::move(slice));
+        deliveringSlices.clear();
+    }
+    delivering = false;
+}
+
+auto iwr1443::PointCloudFusion::LogReport(std::chrono::steady_clock::time_point now) -> void {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (logInterval.count() <= 0 || slices == 0 || now - lastLogTime < logInterval)
+            return;
+        lastLogTime = now;
+    }
+
+    if (!LogSystem::GetSingleton()->IsEnabled(LogLevel::Info))
+        return;
+
+    const FusionReport report = GetReport();
+    LogInfo("Fusion of {} devices: {} slices, {} incomplete, {} frames, {} late, {:.1f} points per "
+            "slice, merge latency p50 {:.0f} us p99 {:.0f} us max {:.0f} us.",
+            devices.size(),
+            report.slices,
+            report.incompleteSlices,
+            report.frames,
+            report.lateFrames,
+            report.pointsPerSlice,
+            report.latencyP50,
+            report.latencyP99,
+            report.latencyMax);
+}
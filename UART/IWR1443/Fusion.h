@@ -0,0 +1,311 @@
+#pragma once
+
+#include "PointCloud.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace iwr1443 {
+
+struct FusionConfig {
+    /// @brief
+    ///   Frames of different devices whose acquisition times are within this period of the
+    ///   earliest one are merged into the same slice. Should not exceed the frame period.
+    std::chrono::microseconds slicePeriod;
+
+    /// @brief
+    ///   Maximum time after the end of a slice to wait for frames of other devices before the slice
+    ///   is emitted without them.
+    std::chrono::microseconds waitWindow;
+};
+
+struct FusionDevice {
+    /// @brief
+    ///   Name of the device in fused output.
+    std::string name;
+
+    /// @brief
+    ///   Transform from sensor coordinates of the device to site coordinates.
+    RigidTransform extrinsic;
+};
+
+struct FusedSource {
+    /// @brief
+    ///   Index of the device.
+    uint16_t device;
+
+    /// @brief
+    ///   Frame number of the merged frame.
+    uint32_t frameNumber;
+
+    /// @brief
+    ///   Acquisition time of the merged frame in host time.
+    std::chrono::steady_clock::time_point time;
+};
+
+struct FusedFrame {
+    /// @brief
+    ///   Sequence number of this slice.
+    uint64_t sequence;
+
+    /// @brief
+    ///   Acquisition time of the earliest frame in this slice.
+    std::chrono::steady_clock::time_point time;
+
+    /// @brief
+    ///   Frames merged into this slice in device order. A device whose frame period is shorter than
+    ///   the slice period may contribute several.
+    std::vector<FusedSource> sources;
+
+    /// @brief
+    ///   Points of all merged frames in site coordinates.
+    PointCloud points;
+};
+
+struct FusionReport {
+    /// @brief
+    ///   Number of slices emitted.
+    uint64_t slices;
+
+    /// @brief
+    ///   Number of slices emitted without a frame from every device.
+    uint64_t incompleteSlices;
+
+    /// @brief
+    ///   Number of frames merged into slices.
+    uint64_t frames;
+
+    /// @brief
+    ///   Number of frames dropped because their slice has been emitted.
+    uint64_t lateFrames;
+
+    /// @brief
+    ///   Average number of points per slice.
+    double pointsPerSlice;
+
+    /// @brief
+    ///   Merge latency percentiles in microseconds over recent frames, from a frame being handed
+    ///   to the fusion stage to its slice being emitted.
+    double latencyP50;
+    double latencyP99;
+    double latencyMax;
+};
+
+/// @brief
+///   Merges point clouds of several devices into time slices. Frames are buffered per device and
+///   merged in order of their acquisition time. A slice is emitted with every buffered frame
+///   acquired within it once every device has buffered a frame after the slice, or once the wait
+///   window has passed since the end of the slice.
+class PointCloudFusion {
+public:
+    /// @brief
+    ///   Create a fusion stage for the specified devices.
+    ///
+    /// @param config   Slice period and wait window.
+    /// @param devices  Devices to be merged. Device index is the position in this list.
+    PointCloudFusion(const FusionConfig &config, std::vector<FusionDevice> devices);
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    PointCloudFusion(const PointCloudFusion &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const PointCloudFusion &) = delete;
+
+    /// @brief
+    ///   Destroy this fusion stage. Buffered frames are flushed to the sink.
+    ~PointCloudFusion() noexcept;
+
+    /// @brief
+    ///   Set the function that receives fused slices. Set before frames are added.
+    ///
+    /// @param sink     The sink. The slice is only valid during the call. Called without the
+    ///                 fusion lock held, by one thread at a time, so slices are delivered in order.
+    auto SetSink(std::function<void(const FusedFrame &)> sink) noexcept -> void;
+
+    /// @brief
+    ///   Add a complete frame of the specified device. Frames of one device must not be added
+    ///   concurrently.
+    ///
+    /// @param     device   Index of the device.
+    /// @param[in] frame    Pointer to start of a complete frame.
+    /// @param     time     Acquisition time of the frame in host time. A default time point means
+    ///                     that acquisition time is unknown, and arrival time is used instead.
+    auto OnFrame(uint16_t device, const void *frame, std::chrono::steady_clock::time_point time)
+        -> void;
+
+    /// @brief
+    ///   Emit slices whose wait window has expired. OnFrame does this too, so this is only needed
+    ///   when no device is delivering frames.
+    auto Poll() -> void;
+
+    /// @brief
+    ///   Emit all buffered frames without waiting for the wait window. Call once devices stopped
+    ///   delivering frames.
+    auto Flush() -> void;
+
+    /// @brief
+    ///   Serialize a fused slice as a JSON object followed by a comma, like frames of DataSerial.
+    ///
+    /// @param      frame   The fused slice.
+    /// @param[out] output  The JSON is appended to this string.
+    auto Serialize(const FusedFrame &frame, std::string &output) const -> void;
+
+    /// @brief
+    ///   Get current fusion statistics.
+    ///
+    /// @return FusionReport
+    ///   Return a snapshot of fusion statistics.
+    auto GetReport() const noexcept -> FusionReport;
+
+    /// @brief
+    ///   Set interval to log fusion statistics. Pass zero to disable logging.
+    ///
+    /// @param interval     The new log interval.
+    auto SetLogInterval(std::chrono::seconds interval) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Number of recent merge latencies kept for percentiles.
+    static constexpr const size_t LatencyWindowSize = 1024;
+
+    struct PendingFrame {
+        /// @brief
+        ///   Acquisition time of the frame.
+        std::chrono::steady_clock::time_point time;
+
+        /// @brief
+        ///   Time that the frame is added to the fusion stage.
+        std::chrono::steady_clock::time_point arrival;
+
+        /// @brief
+        ///   Frame number of the frame.
+        uint32_t frameNumber;
+
+        /// @brief
+        ///   Points of the frame in site coordinates.
+        PointCloud cloud;
+    };
+
+    struct DeviceState {
+        /// @brief
+        ///   Name and extrinsic transform of the device.
+        FusionDevice device;
+
+        /// @brief
+        ///   Scratch point cloud that frames are extracted to without the lock.
+        PointCloud scratch;
+
+        /// @brief
+        ///   Buffered frames in arrival order.
+        std::deque<PendingFrame> pending;
+    };
+
+    /// @brief
+    ///   Queue all slices that are ready for delivery. Must be called with the lock held.
+    ///
+    /// @param now      Current time.
+    /// @param flush    Whether to merge buffered frames without waiting for the wait window.
+    auto Merge(std::chrono::steady_clock::time_point now, bool flush) -> void;
+
+    /// @brief
+    ///   Pass queued slices to the sink. The lock is released during sink calls. Returns at once if
+    ///   another thread is delivering, which then delivers the queued slices too.
+    ///
+    /// @param lock     Lock of the fusion mutex. Must be locked.
+    auto Deliver(std::unique_lock<std::mutex> &lock) -> void;
+
+    /// @brief
+    ///   Log fusion statistics if the log interval has passed.
+    auto LogReport(std::chrono::steady_clock::time_point now) -> void;
+
+private:
+    /// @brief
+    ///   Slice period and wait window.
+    FusionConfig config;
+
+    /// @brief
+    ///   Per device buffers.
+    std::vector<DeviceState> devices;
+
+    /// @brief
+    ///   Point clouds of merged frames kept for reuse.
+    std::vector<PointCloud> spareClouds;
+
+    /// @brief
+    ///   Slices merged but not yet passed to the sink, in order.
+    std::vector<FusedFrame> readySlices;
+
+    /// @brief
+    ///   Slices being passed to the sink. Only touched by the delivering thread.
+    std::vector<FusedFrame> deliveringSlices;
+
+    /// @brief
+    ///   Delivered slices kept for reuse.
+    std::vector<FusedFrame> spareSlices;
+
+    /// @brief
+    ///   Whether a thread is passing slices to the sink.
+    bool delivering;
+
+    /// @brief
+    ///   The sink of fused slices.
+    std::function<void(const FusedFrame &)> sink;
+
+    /// @brief
+    ///   End of the last emitted slice. Frames acquired before it are late.
+    std::chrono::steady_clock::time_point sliceEnd;
+
+    /// @brief
+    ///   Offset from steady clock to system clock, used to write wall clock time of slices.
+    std::chrono::nanoseconds wallClockOffset;
+
+    /// @brief
+    ///   Number of slices emitted.
+    uint64_t slices;
+
+    /// @brief
+    ///   Number of slices emitted without every device.
+    uint64_t incompleteSlices;
+
+    /// @brief
+    ///   Number of frames merged.
+    uint64_t frames;
+
+    /// @brief
+    ///   Number of late frames dropped.
+    uint64_t lateFrames;
+
+    /// @brief
+    ///   Number of points emitted.
+    uint64_t points;
+
+    /// @brief
+    ///   Ring buffer of recent merge latencies in microseconds.
+    std::array<double, LatencyWindowSize> latencies;
+
+    /// @brief
+    ///   Number of merge latencies recorded.
+    uint64_t latencyCount;
+
+    /// @brief
+    ///   Interval to log fusion statistics.
+    std::chrono::seconds logInterval;
+
+    /// @brief
+    ///   Time that fusion statistics are logged last time.
+    std::chrono::steady_clock::time_point lastLogTime;
+
+    /// @brief
+    ///   Mutex that is used to protect buffers and statistics.
+    mutable std::mutex mutex;
+};
+
+} // namespace iwr1443
@@ -0,0 +1,162 @@
+#include "LinkBudget.h"
+#include "../Log.h"
+
+#include <algorithm>
+
+using namespace iwr1443;
+
+// Weight of a new sample in moving averages.
+static constexpr const double SMOOTHING = 0.1;
+
+iwr1443::LinkBudget::LinkBudget(const Serial &serial) noexcept
+    : serial(serial),
+      frameInterval(0),
+      bytesPerFrame(0),
+      bytesPerInterval(0),
+      tlvs(),
+      lastBytesReceived(0),
+      lastFrameTime(),
+      logInterval(10),
+      lastLogTime(),
+      mutex() {}
+
+iwr1443::LinkBudget::~LinkBudget() noexcept {}
+
+auto iwr1443::LinkBudget::OnFrame(const void *frame) noexcept -> void {
+    const auto         now           = std::chrono::steady_clock::now();
+    const uint64_t     bytesReceived = serial.GetBytesReceived();
+    const FrameHeader *frameHeader   = static_cast<const FrameHeader *>(frame);
+
+    bool shouldLog = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // TLVs that are missing in this frame decay to zero.
+        for (auto &tlv : tlvs)
+            tlv.share = 0;
+
+        ForEachTLV(frame, [this](const TLVHeader &header, const void *) -> void {
+            auto iter = std::find_if(tlvs.begin(), tlvs.end(), [&header](const auto &tlv) {
+                return tlv.type == header.type;
+            });
+
+            if (iter == tlvs.end()) {
+                tlvs.push_back(TLVBudget{header.type, 0, 0});
+                iter = tlvs.end() - 1;
+            }
+
+            // Share is used to accumulate bytes of this frame here.
+            iter->share += sizeof(TLVHeader) + header.length;
+        });
+
+        const bool firstFrame = (lastFrameTime == std::chrono::steady_clock::time_point());
+        if (firstFrame) {
+            for (auto &tlv : tlvs)
+                tlv.bytesPerFrame = tlv.share;
+            bytesPerFrame = frameHeader->packetLength;
+        } else {
+            for (auto &tlv : tlvs)
+                tlv.bytesPerFrame += SMOOTHING * (tlv.share - tlv.bytesPerFrame);
+            bytesPerFrame += SMOOTHING * (frameHeader->packetLength - bytesPerFrame);
+
+            const double interval = std::chrono::duration<double>(now - lastFrameTime).count();
+            const double received = static_cast<double>(bytesReceived - lastBytesReceived);
+
+            if (frameInterval == 0) {
+                frameInterval    = interval;
+                bytesPerInterval = received;
+            } else {
+                frameInterval += SMOOTHING * (interval - frameInterval);
+                bytesPerInterval += SMOOTHING * (received - bytesPerInterval);
+            }
+        }
+
+        lastFrameTime     = now;
+        lastBytesReceived = bytesReceived;
+
+        if (logInterval.count() > 0 && frameInterval > 0 && now - lastLogTime >= logInterval) {
+            lastLogTime = now;
+            shouldLog   = true;
+        }
+    }
+
+    if (!shouldLog || !LogSystem::GetSingleton()->IsEnabled(LogLevel::Info))
+        return;
+
+    const LinkBudgetReport report = GetReport();
+
+    std::string tlvShares;
+    for (const auto &tlv : report.tlvs)
+        std::format_to(std::back_inserter(tlvShares), " {} {:.1f}%", tlv.type, tlv.share * 100);
+
+    LogInfo("Serial {} link budget: {:.0f} B/s, {:.1f}% of {:.0f} B/s, {:.1f} fps, {:.0f} B/frame, "
+            "max {:.1f} fps. TLV share:{}",
+            serial.GetPortName(),
+            report.bytesPerSecond,
+            report.utilisation * 100,
+            report.capacity,
+            report.frameRate,
+            report.bytesPerFrame,
+            report.maxFrameRate,
+            tlvShares);
+}
+
+auto iwr1443::LinkBudget::GetReport() const noexcept -> LinkBudgetReport {
+    LinkBudgetReport report{};
+    report.capacity = serial.GetBaudRate() / 10.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    report.bytesPerFrame = bytesPerFrame;
+
+    if (frameInterval > 0) {
+        report.bytesPerSecond = bytesPerInterval / frameInterval;
+        report.frameRate      = 1.0 / frameInterval;
+    }
+
+    if (report.capacity > 0)
+        report.utilisation = report.bytesPerSecond / report.capacity;
+
+    // Bytes outside frames are assumed to grow with frames.
+    const double bytesPerSlot = std::max(bytesPerFrame, bytesPerInterval);
+    if (bytesPerSlot > 0)
+        report.maxFrameRate = report.capacity / bytesPerSlot;
+
+    report.tlvs = tlvs;
+    for (auto &tlv : report.tlvs)
+        tlv.share = bytesPerFrame > 0 ? tlv.bytesPerFrame / bytesPerFrame : 0;
+
+    std::sort(report.tlvs.begin(), report.tlvs.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.bytesPerFrame > rhs.bytesPerFrame;
+    });
+
+    return report;
+}
+
+auto iwr1443::LinkBudget::GetUtilisation() const noexcept -> double {
+    return ProjectUtilisation(0);
+}
+
+auto iwr1443::LinkBudget::ProjectUtilisation(double extraBytesPerFrame) const noexcept -> double {
+    const double capacity = serial.GetBaudRate() / 10.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frameInterval <= 0 || capacity <= 0)
+        return 0;
+
+    return (bytesPerInterval + extraBytesPerFrame) / frameInterval / capacity;
+}
+
+auto iwr1443::LinkBudget::GetTLVBytes(TLVType type) const noexcept -> double {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &tlv : tlvs) {
+        if (tlv.type == type)
+            return tlv.bytesPerFrame;
+    }
+    return 0;
+}
+
+auto iwr1443::LinkBudget::SetLogInterval(std::chrono::seconds interval) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInterval = interval;
+}
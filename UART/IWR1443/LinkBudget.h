@@ -0,0 +1,163 @@
+#pragma once
+
+#include "../Serial.h"
+#include "Data.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace iwr1443 {
+
+struct TLVBudget {
+    /// @brief
+    ///   Type of the TLV.
+    TLVType type;
+
+    /// @brief
+    ///   Average bytes per frame of this TLV, including its header.
+    double bytesPerFrame;
+
+    /// @brief
+    ///   Ratio of this TLV to average frame size.
+    double share;
+};
+
+struct LinkBudgetReport {
+    /// @brief
+    ///   Link capacity in bytes per second. 10 bits are transferred for each byte.
+    double capacity;
+
+    /// @brief
+    ///   Measured bytes per second received by the serial, including bytes outside frames.
+    double bytesPerSecond;
+
+    /// @brief
+    ///   Ratio of measured bytes per second to link capacity.
+    double utilisation;
+
+    /// @brief
+    ///   Measured frames per second.
+    double frameRate;
+
+    /// @brief
+    ///   Average bytes per frame.
+    double bytesPerFrame;
+
+    /// @brief
+    ///   Maximum frame rate that the link could carry with current payload mix.
+    double maxFrameRate;
+
+    /// @brief
+    ///   Byte share of each TLV type that has been received.
+    std::vector<TLVBudget> tlvs;
+};
+
+class LinkBudget {
+public:
+    /// @brief
+    ///   Create a link budget analyzer for the specified serial.
+    ///
+    /// @param serial   The serial to be analyzed. Baud rate is taken from it on each frame, so it
+    ///                 could be initialized later.
+    explicit LinkBudget(const Serial &serial) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    LinkBudget(const LinkBudget &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const LinkBudget &) = delete;
+
+    /// @brief
+    ///   Destroy this link budget analyzer.
+    ~LinkBudget() noexcept;
+
+    /// @brief
+    ///   Account a complete frame received by the serial.
+    ///
+    /// @param[in] frame    Pointer to start of a complete frame.
+    auto OnFrame(const void *frame) noexcept -> void;
+
+    /// @brief
+    ///   Get current link budget.
+    ///
+    /// @return LinkBudgetReport
+    ///   Return a snapshot of current link budget.
+    auto GetReport() const noexcept -> LinkBudgetReport;
+
+    /// @brief
+    ///   Get measured link utilisation.
+    ///
+    /// @return double
+    ///   Return ratio of measured bytes per second to link capacity.
+    auto GetUtilisation() const noexcept -> double;
+
+    /// @brief
+    ///   Estimate link utilisation at current frame rate if each frame carries extra bytes.
+    ///
+    /// @param extraBytesPerFrame   Bytes to be added to each frame. May be negative.
+    ///
+    /// @return double
+    ///   Return the estimated utilisation.
+    auto ProjectUtilisation(double extraBytesPerFrame) const noexcept -> double;
+
+    /// @brief
+    ///   Get average bytes per frame of the specified TLV type.
+    ///
+    /// @param type     The TLV type.
+    ///
+    /// @return double
+    ///   Return average bytes per frame of the TLV. Return 0 if the TLV has not been received.
+    auto GetTLVBytes(TLVType type) const noexcept -> double;
+
+    /// @brief
+    ///   Set interval to log link budget. Pass zero to disable logging.
+    ///
+    /// @param interval     The new log interval.
+    auto SetLogInterval(std::chrono::seconds interval) noexcept -> void;
+
+private:
+    /// @brief
+    ///   The serial to be analyzed.
+    const Serial &serial;
+
+    /// @brief
+    ///   Average seconds between frames.
+    double frameInterval;
+
+    /// @brief
+    ///   Average bytes per frame.
+    double bytesPerFrame;
+
+    /// @brief
+    ///   Average bytes received by the serial between frames.
+    double bytesPerInterval;
+
+    /// @brief
+    ///   Average bytes per frame of each TLV type.
+    std::vector<TLVBudget> tlvs;
+
+    /// @brief
+    ///   Byte counter of the serial at last frame.
+    uint64_t lastBytesReceived;
+
+    /// @brief
+    ///   Arrival time of last frame.
+    std::chrono::steady_clock::time_point lastFrameTime;
+
+    /// @brief
+    ///   Interval to log link budget.
+    std::chrono::seconds logInterval;
+
+    /// @brief
+    ///   Time that link budget is logged last time.
+    std::chrono::steady_clock::time_point lastLogTime;
+
+    /// @brief
+    ///   Mutex that is used to protect the averages.
+    mutable std::mutex mutex;
+};
+
+} // namespace iwr1443
@@ -0,0 +1,368 @@
+#include "PointCloud.h"
+#include "Data.h"
+
+#include <cmath>
+#include <numbers>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    define IWR1443_SIMD_X86 1
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define IWR1443_TARGET_AVX2
+#    else
+#        define IWR1443_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#    endif
+#endif
+
+using namespace iwr1443;
+
+auto iwr1443::PointCloud::Clear() noexcept -> void {
+    x.clear();
+    y.clear();
+    z.clear();
+    doppler.clear();
+    snr.clear();
+    device.clear();
+}
+
+auto iwr1443::PointCloud::Reserve(size_t capacity) -> void {
+    x.reserve(capacity);
+    y.reserve(capacity);
+    z.reserve(capacity);
+    doppler.reserve(capacity);
+    snr.reserve(capacity);
+    device.reserve(capacity);
+}
+
+auto iwr1443::PointCloud::Resize(size_t size) -> void {
+    x.resize(size);
+    y.resize(size);
+    z.resize(size);
+    doppler.resize(size);
+    snr.resize(size);
+    device.resize(size);
+}
+
+auto iwr1443::PointCloud::Append(const PointCloud &other) -> void {
+    x.insert(x.end(), other.x.begin(), other.x.end());
+    y.insert(y.end(), other.y.begin(), other.y.end());
+    z.insert(z.end(), other.z.begin(), other.z.end());
+    doppler.insert(doppler.end(), other.doppler.begin(), other.doppler.end());
+    snr.insert(snr.end(), other.snr.begin(), other.snr.end());
+    device.insert(device.end(), other.device.begin(), other.device.end());
+}
+
+auto iwr1443::RigidTransform::Identity() noexcept -> RigidTransform {
+    return RigidTransform{{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+}
+
+auto iwr1443::RigidTransform::FromPose(
+    float x, float y, float z, float yaw, float pitch, float roll) noexcept -> RigidTransform {
+    constexpr const float radian = std::numbers::pi_v<float> / 180.0f;
+
+    const float cy = std::cos(yaw * radian);
+    const float sy = std::sin(yaw * radian);
+    const float cp = std::cos(pitch * radian);
+    const float sp = std::sin(pitch * radian);
+    const float cr = std::cos(roll * radian);
+    const float sr = std::sin(roll * radian);
+
+    // Rz(yaw) * Rx(pitch) * Ry(roll).
+    RigidTransform transform = Identity();
+    transform.matrix[0][0]   = cy * cr - sy * sp * sr;
+    transform.matrix[0][1]   = -sy * cp;
+    transform.matrix[0][2]   = cy * sr + sy * sp * cr;
+    transform.matrix[1][0]   = sy * cr + cy * sp * sr;
+    transform.matrix[1][1]   = cy * cp;
+    transform.matrix[1][2]   = sy * sr - cy * sp * cr;
+    transform.matrix[2][0]   = -cp * sr;
+    transform.matrix[2][1]   = sp;
+    transform.matrix[2][2]   = cp * cr;
+    transform.matrix[0][3]   = x;
+    transform.matrix[1][3]   = y;
+    transform.matrix[2][3]   = z;
+    return transform;
+}
+
+auto iwr1443::RigidTransform::IsIdentity() const noexcept -> bool {
+    const RigidTransform identity = Identity();
+    for (size_t row = 0; row < 4; ++row) {
+        for (size_t column = 0; column < 4; ++column) {
+            if (matrix[row][column] != identity.matrix[row][column])
+                return false;
+        }
+    }
+    return true;
+}
+
+auto iwr1443::ExtractPointCloud(const void           *frame,
+                                uint16_t              device,
+                                const RigidTransform &extrinsic,
+                                PointCloud           &cloud) -> size_t {
+    const DetectedPointHeader *detectedHeader = nullptr;
+    const DetectedPoint       *detectedPoints = nullptr;
+
+    const SphericalCoordinate *spherical      = nullptr;
+    size_t                     sphericalCount = 0;
+
+    const DetectedPointSideInfo *sideInfo      = nullptr;
+    size_t                       sideInfoCount = 0;
+
+    const SphericalCompressedPointCloudHeader *compressedHeader = nullptr;
+    const SphericalCompressedPoint            *compressedPoints = nullptr;
+    size_t                                     compressedCount  = 0;
+
+    ForEachTLV(frame, [&](const TLVHeader &header, const void *data) -> void {
+        switch (header.type) {
+        case TLVType::DetectedPoints:
+            detectedHeader = static_cast<const DetectedPointHeader *>(data);
+            detectedPoints = reinterpret_cast<const DetectedPoint *>(
+                static_cast<const std::byte *>(data) + sizeof(DetectedPointHeader));
+            break;
+        case TLVType::SphericalCoordinates:
+            spherical      = static_cast<const SphericalCoordinate *>(data);
+            sphericalCount = header.length / sizeof(SphericalCoordinate);
+            break;
+        case TLVType::DetectedPointsSideInfo:
+            sideInfo      = static_cast<const DetectedPointSideInfo *>(data);
+            sideInfoCount = header.length / sizeof(DetectedPointSideInfo);
+            break;
+        case TLVType::SphericalCompressedPointCloud:
+            compressedHeader = static_cast<const SphericalCompressedPointCloudHeader *>(data);
+            compressedPoints = reinterpret_cast<const SphericalCompressedPoint *>(
+                static_cast<const std::byte *>(data) + sizeof(SphericalCompressedPointCloudHeader));
+            compressedCount = (header.length - sizeof(SphericalCompressedPointCloudHeader)) /
+                              sizeof(SphericalCompressedPoint);
+            break;
+        default:
+            break;
+        }
+    });
+
+    const size_t first = cloud.Size();
+
+    if (compressedHeader != nullptr) {
+        cloud.Resize(first + compressedCount);
+        for (size_t i = 0; i < compressedCount; ++i) {
+            const SphericalCompressedPoint &point = compressedPoints[i];
+
+            const float range     = point.range * compressedHeader->rangeUnit;
+            const float azimuth   = point.azimuth * compressedHeader->azimuthUnit;
+            const float elevation = point.elevation * compressedHeader->elevationUnit;
+
+            cloud.x[first + i]       = range * std::cos(elevation) * std::sin(azimuth);
+            cloud.y[first + i]       = range * std::cos(elevation) * std::cos(azimuth);
+            cloud.z[first + i]       = range * std::sin(elevation);
+            cloud.doppler[first + i] = point.doppler * compressedHeader->dopplerUnit;
+            cloud.snr[first + i]     = point.snr * compressedHeader->snrUnit;
+            cloud.device[first + i]  = device;
+        }
+
+        TransformPointCloud(extrinsic, cloud, first);
+        return compressedCount;
+    }
+
+    if (detectedHeader != nullptr) {
+        const size_t count = detectedHeader->detectedObjectCount;
+        cloud.Resize(first + count);
+        for (size_t i = 0; i < count; ++i) {
+            cloud.x[first + i]      = detectedPoints[i].x;
+            cloud.y[first + i]      = detectedPoints[i].y;
+            cloud.z[first + i]      = detectedPoints[i].z;
+            cloud.device[first + i] = device;
+        }
+
+        // Both TLVs describe the same points in the same order.
+        if (sphericalCount == count) {
+            for (size_t i = 0; i < count; ++i)
+                cloud.doppler[first + i] = spherical[i].doppler;
+        }
+
+        // SNR is reported in units of 0.1 dB.
+        if (sideInfoCount == count) {
+            for (size_t i = 0; i < count; ++i)
+                cloud.snr[first + i] = sideInfo[i].snr * 0.1f;
+        }
+        return count;
+    }
+
+    cloud.Resize(first + sphericalCount);
+    for (size_t i = 0; i < sphericalCount; ++i) {
+        const SphericalCoordinate &point = spherical[i];
+
+        const float horizontal   = point.range * std::cos(point.elevation);
+        cloud.x[first + i]       = horizontal * std::sin(point.azimuth);
+        cloud.y[first + i]       = horizontal * std::cos(point.azimuth);
+        cloud.z[first + i]       = point.range * std::sin(point.elevation);
+        cloud.doppler[first + i] = point.doppler;
+        cloud.device[first + i]  = device;
+    }
+
+    if (sideInfoCount == sphericalCount) {
+        for (size_t i = 0; i < sphericalCount; ++i)
+            cloud.snr[first + i] = sideInfo[i].snr * 0.1f;
+    }
+
+    TransformPointCloud(extrinsic, cloud, first);
+    return sphericalCount;
+}
+
+/// @brief
+///   Transform points [begin, count) one at a time.
+static auto TransformScalar(const RigidTransform &transform,
+                            float                *x,
+                            float                *y,
+                            float                *z,
+                            size_t                begin,
+                            size_t                count) noexcept -> void {
+    const auto &m = transform.matrix;
+    for (size_t i = begin; i < count; ++i) {
+        const float px = x[i];
+        const float py = y[i];
+        const float pz = z[i];
+        x[i]           = m[0][0] * px + m[0][1] * py + m[0][2] * pz + m[0][3];
+        y[i]           = m[1][0] * px + m[1][1] * py + m[1][2] * pz + m[1][3];
+        z[i]           = m[2][0] * px + m[2][1] * py + m[2][2] * pz + m[2][3];
+    }
+}
+
+#ifdef IWR1443_SIMD_X86
+/// @brief
+///   Transform 4 points per iteration with SSE.
+///
+/// @return size_t
+///   Return number of points transformed. The remaining points are left to the caller.
+static auto TransformSSE(const RigidTransform &transform,
+                         float                *x,
+                         float                *y,
+                         float                *z,
+                         size_t                count) noexcept -> size_t {
+    const auto &m = transform.matrix;
+    __m128 row[3][4];
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t c = 0; c < 4; ++c)
+            row[r][c] = _mm_set1_ps(m[r][c]);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 px = _mm_loadu_ps(x + i);
+        const __m128 py = _mm_loadu_ps(y + i);
+        const __m128 pz = _mm_loadu_ps(z + i);
+
+        __m128 result[3];
+        for (size_t r = 0; r < 3; ++r) {
+            result[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[r][0], px), _mm_mul_ps(row[r][1], py)),
+                                   _mm_add_ps(_mm_mul_ps(row[r][2], pz), row[r][3]));
+        }
+
+        _mm_storeu_ps(x + i, result[0]);
+        _mm_storeu_ps(y + i, result[1]);
+        _mm_storeu_ps(z + i, result[2]);
+    }
+    return i;
+}
+
+/// @brief
+///   Transform 8 points per iteration with AVX2 and FMA.
+///
+/// @return size_t
+///   Return number of points transformed. The remaining points are left to the caller.
+IWR1443_TARGET_AVX2 static auto TransformAVX2(const RigidTransform &transform,
+                                              float                *x,
+                                              float                *y,
+                                              float                *z,
+                                              size_t                count) noexcept -> size_t {
+    const auto &m = transform.matrix;
+    __m256 row[3][4];
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t c = 0; c < 4; ++c)
+            row[r][c] = _mm256_set1_ps(m[r][c]);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 px = _mm256_loadu_ps(x + i);
+        const __m256 py = _mm256_loadu_ps(y + i);
+        const __m256 pz = _mm256_loadu_ps(z + i);
+
+        __m256 result[3];
+        for (size_t r = 0; r < 3; ++r) {
+            result[r] = _mm256_fmadd_ps(
+                row[r][0],
+                px,
+                _mm256_fmadd_ps(row[r][1], py, _mm256_fmadd_ps(row[r][2], pz, row[r][3])));
+        }
+
+        _mm256_storeu_ps(x + i, result[0]);
+        _mm256_storeu_ps(y + i, result[1]);
+        _mm256_storeu_ps(z + i, result[2]);
+    }
+    return i;
+}
+#endif
+
+/// @brief
+///   Detect the widest instruction set that could be used.
+static auto DetectSimdLevel() noexcept -> SimdLevel {
+#ifdef IWR1443_SIMD_X86
+#    ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool fma     = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    // The operating system must save YMM registers on context switches.
+    if (fma && osxsave && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+        return SimdLevel::AVX2;
+#    else
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+#    endif
+    return SimdLevel::SSE;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+auto iwr1443::GetSimdLevel() noexcept -> SimdLevel {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+auto iwr1443::TransformPoints(const RigidTransform &transform,
+                              float                *x,
+                              float                *y,
+                              float                *z,
+                              size_t                count,
+                              SimdLevel             level) noexcept -> void {
+    size_t done = 0;
+
+#ifdef IWR1443_SIMD_X86
+    if (level == SimdLevel::AVX2)
+        done = TransformAVX2(transform, x, y, z, count);
+    else if (level == SimdLevel::SSE)
+        done = TransformSSE(transform, x, y, z, count);
+#else
+    (void)level;
+#endif
+
+    TransformScalar(transform, x, y, z, done, count);
+}
+
+auto iwr1443::TransformPointCloud(const RigidTransform &transform,
+                                  PointCloud           &cloud,
+                                  size_t                first) noexcept -> void {
+    if (first >= cloud.Size() || transform.IsIdentity())
+        return;
+
+    TransformPoints(transform,
+                    cloud.x.data() + first,
+                    cloud.y.data() + first,
+                    cloud.z.data() + first,
+                    cloud.Size() - first);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace iwr1443 {
+
+/// @brief
+///   Detected points of one or more frames stored as one column per attribute, so that per point
+///   passes run over contiguous floats.
+struct PointCloud {
+    /// @brief
+    ///   X coordinates in meters.
+    std::vector<float> x;
+
+    /// @brief
+    ///   Y coordinates in meters.
+    std::vector<float> y;
+
+    /// @brief
+    ///   Z coordinates in meters.
+    std::vector<float> z;
+
+    /// @brief
+    ///   Radial velocities in meters per second. 0 if the frame does not report doppler.
+    std::vector<float> doppler;
+
+    /// @brief
+    ///   Signal to noise ratios in dB. 0 if the frame does not report SNR.
+    std::vector<float> snr;
+
+    /// @brief
+    ///   Index of the device that detected each point.
+    std::vector<uint16_t> device;
+
+    /// @brief
+    ///   Get number of points in this point cloud.
+    auto Size() const noexcept -> size_t {
+        return x.size();
+    }
+
+    /// @brief
+    ///   Remove all points. Capacity is kept.
+    auto Clear() noexcept -> void;
+
+    /// @brief
+    ///   Reserve capacity of all columns.
+    ///
+    /// @param capacity     Number of points to reserve.
+    auto Reserve(size_t capacity) -> void;
+
+    /// @brief
+    ///   Resize all columns. New points are zero.
+    ///
+    /// @param size     The new number of points.
+    auto Resize(size_t size) -> void;
+
+    /// @brief
+    ///   Append all points of another point cloud.
+    ///
+    /// @param other    The point cloud to be appended.
+    auto Append(const PointCloud &other) -> void;
+};
+
+/// @brief
+///   Rigid transform from sensor coordinates to site coordinates as a row major 4x4 matrix. The
+///   last row is always (0, 0, 0, 1).
+struct RigidTransform {
+    /// @brief
+    ///   Rotation in the upper left 3x3 and translation in the last column.
+    float matrix[4][4];
+
+    /// @brief
+    ///   Get the identity transform.
+    static auto Identity() noexcept -> RigidTransform;
+
+    /// @brief
+    ///   Create a transform from sensor pose in site coordinates. Rotations are applied in roll,
+    ///   pitch, yaw order about the site x, y and z axes.
+    ///
+    /// @param x        Sensor position along site x axis in meters.
+    /// @param y        Sensor position along site y axis in meters.
+    /// @param z        Sensor position along site z axis in meters.
+    /// @param yaw      Rotation about z axis in degrees.
+    /// @param pitch    Rotation about x axis in degrees.
+    /// @param roll     Rotation about y axis in degrees.
+    static auto FromPose(float x, float y, float z, float yaw, float pitch, float roll) noexcept
+        -> RigidTransform;
+
+    /// @brief
+    ///   Check whether this is the identity transform.
+    auto IsIdentity() const noexcept -> bool;
+};
+
+/// @brief
+///   Instruction sets that point kernels could use.
+enum class SimdLevel {
+    Scalar = 0,
+    SSE    = 1,
+    AVX2   = 2,
+};
+
+/// @brief
+///   Get the widest instruction set supported by current processor and operating system.
+///
+/// @return SimdLevel
+///   Return the instruction set. Detected once and cached.
+auto GetSimdLevel() noexcept -> SimdLevel;
+
+/// @brief
+///   Append detected points of a frame to a point cloud. SphericalCompressedPointCloud is used if
+///   present. Otherwise DetectedPoints provides coordinates, SphericalCoordinates provides doppler
+///   and DetectedPointsSideInfo provides SNR. SphericalCoordinates alone are converted to
+///   cartesian coordinates.
+///
+/// @param[in]  frame       Pointer to start of a complete and validated frame.
+/// @param      device      Device index stored with each point.
+/// @param      extrinsic   Transform applied to points converted from spherical TLVs.
+///                         DetectedPoints are not transformed since DataSerial rewrites them in
+///                         site coordinates before frames are handed out.
+/// @param[out] cloud       The point cloud to append to.
+///
+/// @return size_t
+///   Return number of points appended.
+auto ExtractPointCloud(const void           *frame,
+                       uint16_t              device,
+                       const RigidTransform &extrinsic,
+                       PointCloud           &cloud) -> size_t;
+
+/// @brief
+///   Transform coordinates stored as separate columns in place.
+///
+/// @param         transform   The rigid transform.
+/// @param[in,out] x           X coordinates.
+/// @param[in,out] y           Y coordinates.
+/// @param[in,out] z           Z coordinates.
+/// @param         count       Number of points.
+/// @param         level       Instruction set to use. Must be supported by current processor.
+auto TransformPoints(const RigidTransform &transform,
+                     float                *x,
+                     float                *y,
+                     float                *z,
+                     size_t                count,
+                     SimdLevel             level = GetSimdLevel()) noexcept -> void;
+
+/// @brief
+///   Transform coordinates of points in place.
+///
+/// @param      transform   The rigid transform.
+/// @param[out] cloud       The point cloud to be transformed.
+/// @param      first       Index of the first point to transform. Points before it are unchanged.
+auto TransformPointCloud(const RigidTransform &transform, PointCloud &cloud, size_t first = 0)
+    noexcept -> void;
+
+} // namespace iwr1443
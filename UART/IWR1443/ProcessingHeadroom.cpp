@@ -0,0 +1,223 @@
+#include "ProcessingHeadroom.h"
+#include "../Log.h"
+#include "Data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+using namespace iwr1443;
+
+// Weight of a new sample in frame period average.
+static constexpr const double SMOOTHING = 0.1;
+
+/// @brief
+///   Get name of the specified bottleneck.
+static auto BottleneckName(HeadroomBottleneck bottleneck) noexcept -> std::string_view {
+    switch (bottleneck) {
+    case HeadroomBottleneck::Processing:
+        return "processing";
+    case HeadroomBottleneck::UART:
+        return "UART";
+    default:
+        return "unknown";
+    }
+}
+
+iwr1443::ProcessingHeadroom::ProcessingHeadroom(const Serial      &serial,
+                                                const DeviceClock &deviceClock) noexcept
+    : serial(serial),
+      deviceClock(deviceClock),
+      samples(),
+      nextSample(0),
+      sampleCount(0),
+      lowCount(0),
+      framePeriod(0),
+      lastFrameNumber(0),
+      lastDeviceTime(0),
+      lastPacketLength(0),
+      marginThreshold(0.1),
+      logInterval(10),
+      lastLogTime(),
+      mutex() {}
+
+iwr1443::ProcessingHeadroom::~ProcessingHeadroom() noexcept {}
+
+auto iwr1443::ProcessingHeadroom::OnFrame(const void *frame) noexcept -> void {
+    const auto         now         = std::chrono::steady_clock::now();
+    const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+
+    Statistics statistics{};
+    bool       hasStatistics = false;
+    ForEachTLV(frame, [&](const TLVHeader &header, const void *data) -> void {
+        if (header.type == TLVType::Statistics && header.length >= sizeof(Statistics)) {
+            std::memcpy(&statistics, data, sizeof(Statistics));
+            hasStatistics = true;
+        }
+    });
+
+    const double baudRate  = serial.GetBaudRate();
+    const double clockRate = deviceClock.GetClockRate();
+
+    bool shouldLog  = false;
+    bool enterAlert = false;
+    bool leaveAlert = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Frames lost on the link leave a gap of several periods.
+        const uint32_t frameGap = frameHeader->frameNumber - lastFrameNumber;
+        if (lastPacketLength != 0 && frameGap != 0 && frameGap < WindowSize) {
+            const double period = static_cast<double>(frameHeader->time - lastDeviceTime) /
+                                  clockRate * 1e6 / frameGap;
+            framePeriod = (framePeriod == 0) ? period
+                                             : framePeriod + SMOOTHING * (period - framePeriod);
+        }
+
+        if (hasStatistics) {
+            Sample sample{};
+            sample.frameMargin     = static_cast<int32_t>(statistics.interFrameProcessingMargin);
+            sample.chirpMargin     = static_cast<int32_t>(statistics.interChirpProcessingMargin);
+            sample.activeFrameLoad = statistics.activeFrameCPULoad;
+            sample.interFrameLoad  = statistics.interFrameCPULoad;
+            sample.processingTime  = statistics.interFrameProcessingTime;
+            sample.transmitTime    = statistics.transmitOutputTime;
+
+            // The device reports transmit time of the previous frame.
+            if (frameGap == 1 && lastPacketLength != 0 && baudRate > 0)
+                sample.expectedTransmitTime = lastPacketLength * 10.0 * 1e6 / baudRate;
+
+            sample.low = IsLow(sample);
+
+            const bool wasLow = (lowCount != 0);
+            if (sampleCount == WindowSize && samples[nextSample].low)
+                --lowCount;
+            if (sample.low)
+                ++lowCount;
+
+            samples[nextSample] = sample;
+            nextSample          = (nextSample + 1) % WindowSize;
+            sampleCount         = std::min(sampleCount + 1, WindowSize);
+
+            enterAlert = !wasLow && lowCount != 0;
+            leaveAlert = wasLow && lowCount == 0;
+        }
+
+        lastFrameNumber  = frameHeader->frameNumber;
+        lastDeviceTime   = frameHeader->time;
+        lastPacketLength = frameHeader->packetLength;
+
+        if (logInterval.count() > 0 && sampleCount != 0 && now - lastLogTime >= logInterval) {
+            lastLogTime = now;
+            shouldLog   = true;
+        }
+    }
+
+    if (enterAlert) {
+        LogWarning("Serial {} device is close to missing frame deadline at frame {}: frame margin "
+                   "{} us, chirp margin {} us, processing {} us, transmit {} us.",
+                   serial.GetPortName(),
+                   frameHeader->frameNumber,
+                   static_cast<int32_t>(statistics.interFrameProcessingMargin),
+                   static_cast<int32_t>(statistics.interChirpProcessingMargin),
+                   statistics.interFrameProcessingTime,
+                   statistics.transmitOutputTime);
+    } else if (leaveAlert) {
+        LogInfo("Serial {} device processing headroom recovered at frame {}.",
+                serial.GetPortName(),
+                frameHeader->frameNumber);
+    }
+
+    if (!shouldLog || !LogSystem::GetSingleton()->IsEnabled(LogLevel::Info))
+        return;
+
+    const HeadroomReport report = GetReport();
+    LogInfo("Serial {} processing headroom: period {:.0f} us, frame margin min {:.0f} us p5 "
+            "{:.0f} us, chirp margin min {:.0f} us, CPU p95 {:.0f}%/{:.0f}%, processing p95 {:.0f} "
+            "us, transmit p95 {:.0f} us, UART efficiency {:.2f}, bottleneck {}.",
+            serial.GetPortName(),
+            report.framePeriod,
+            report.minFrameMargin,
+            report.lowFrameMargin,
+            report.minChirpMargin,
+            report.highActiveFrameLoad,
+            report.highInterFrameLoad,
+            report.highProcessingTime,
+            report.highTransmitTime,
+            report.transmitEfficiency,
+            BottleneckName(report.bottleneck));
+}
+
+auto iwr1443::ProcessingHeadroom::GetReport() const noexcept -> HeadroomReport {
+    HeadroomReport report{};
+
+    std::vector<double> values;
+    values.reserve(WindowSize);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    report.samples      = static_cast<uint32_t>(sampleCount);
+    report.framePeriod  = framePeriod;
+    report.nearDeadline = (lowCount != 0);
+    if (sampleCount == 0)
+        return report;
+
+    const auto percentile = [&](auto field, double quantile) -> double {
+        values.clear();
+        for (size_t i = 0; i < sampleCount; ++i)
+            values.push_back(static_cast<double>(samples[i].*field));
+
+        const auto index = static_cast<ptrdiff_t>(
+            std::min(static_cast<size_t>(quantile * static_cast<double>(sampleCount)),
+                     sampleCount - 1));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[static_cast<size_t>(index)];
+    };
+
+    report.minFrameMargin      = percentile(&Sample::frameMargin, 0.0);
+    report.lowFrameMargin      = percentile(&Sample::frameMargin, 0.05);
+    report.minChirpMargin      = percentile(&Sample::chirpMargin, 0.0);
+    report.lowChirpMargin      = percentile(&Sample::chirpMargin, 0.05);
+    report.highActiveFrameLoad = percentile(&Sample::activeFrameLoad, 0.95);
+    report.highInterFrameLoad  = percentile(&Sample::interFrameLoad, 0.95);
+    report.highProcessingTime  = percentile(&Sample::processingTime, 0.95);
+    report.highTransmitTime    = percentile(&Sample::transmitTime, 0.95);
+
+    // Only frames whose previous frame is known take part in the correlation.
+    double expected = 0;
+    double measured = 0;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        if (samples[i].expectedTransmitTime > 0 && samples[i].transmitTime > 0) {
+            expected += samples[i].expectedTransmitTime;
+            measured += samples[i].transmitTime;
+        }
+    }
+
+    if (measured > 0)
+        report.transmitEfficiency = expected / measured;
+
+    if (report.highProcessingTime > 0 || report.highTransmitTime > 0) {
+        report.bottleneck = (report.highTransmitTime >= report.highProcessingTime)
+                                ? HeadroomBottleneck::UART
+                                : HeadroomBottleneck::Processing;
+    }
+
+    return report;
+}
+
+auto iwr1443::ProcessingHeadroom::SetMarginThreshold(double ratio) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    marginThreshold = ratio;
+}
+
+auto iwr1443::ProcessingHeadroom::SetLogInterval(std::chrono::seconds interval) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInterval = interval;
+}
+
+auto iwr1443::ProcessingHeadroom::IsLow(const Sample &sample) const noexcept -> bool {
+    if (sample.chirpMargin < 0 || sample.frameMargin <= 0)
+        return true;
+    return framePeriod > 0 && sample.frameMargin < framePeriod * marginThreshold;
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "../Serial.h"
+#include "DeviceClock.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace iwr1443 {
+
+enum class HeadroomBottleneck {
+    Unknown    = 0,
+    Processing = 1,
+    UART       = 2,
+};
+
+struct HeadroomReport {
+    /// @brief
+    ///   Number of Statistics TLVs in the window.
+    uint32_t samples;
+
+    /// @brief
+    ///   Frame period in microseconds measured with device timestamps.
+    double framePeriod;
+
+    /// @brief
+    ///   Minimum inter-frame processing margin in microseconds.
+    double minFrameMargin;
+
+    /// @brief
+    ///   5th percentile of inter-frame processing margin in microseconds.
+    double lowFrameMargin;
+
+    /// @brief
+    ///   Minimum inter-chirp processing margin in microseconds.
+    double minChirpMargin;
+
+    /// @brief
+    ///   5th percentile of inter-chirp processing margin in microseconds.
+    double lowChirpMargin;
+
+    /// @brief
+    ///   95th percentile of active frame CPU load in percent.
+    double highActiveFrameLoad;
+
+    /// @brief
+    ///   95th percentile of inter-frame CPU load in percent.
+    double highInterFrameLoad;
+
+    /// @brief
+    ///   95th percentile of inter-frame processing time in microseconds.
+    double highProcessingTime;
+
+    /// @brief
+    ///   95th percentile of output transmit time reported by the device in microseconds.
+    double highTransmitTime;
+
+    /// @brief
+    ///   Mean ratio of the time that frame bytes take on the UART at current baud rate to the
+    ///   transmit time reported by the device. Close to 1 if the device is limited by the UART.
+    double transmitEfficiency;
+
+    /// @brief
+    ///   The stage that takes the larger part of the frame period.
+    HeadroomBottleneck bottleneck;
+
+    /// @brief
+    ///   Whether any frame in the window is close to missing its deadline.
+    bool nearDeadline;
+};
+
+/// @brief
+///   Tracks Statistics TLVs over a sliding window to tell how close the device is to missing its
+///   frame deadline and whether on-chip processing or the UART limits it.
+class ProcessingHeadroom {
+public:
+    /// @brief
+    ///   Create a processing headroom monitor for the specified serial.
+    ///
+    /// @param serial       The serial that receives frames. Baud rate is taken from it on each
+    ///                     frame, so it could be initialized later.
+    /// @param deviceClock  Device clock estimator of the serial. Its fitted rate converts device
+    ///                     timestamps to frame period.
+    ProcessingHeadroom(const Serial &serial, const DeviceClock &deviceClock) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    ProcessingHeadroom(const ProcessingHeadroom &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const ProcessingHeadroom &) = delete;
+
+    /// @brief
+    ///   Destroy this processing headroom monitor.
+    ~ProcessingHeadroom() noexcept;
+
+    /// @brief
+    ///   Account a complete frame received by the serial. Frames without Statistics TLV only
+    ///   update frame period.
+    ///
+    /// @param[in] frame    Pointer to start of a complete frame.
+    auto OnFrame(const void *frame) noexcept -> void;
+
+    /// @brief
+    ///   Get current processing headroom.
+    ///
+    /// @return HeadroomReport
+    ///   Return a snapshot of processing headroom over the window.
+    auto GetReport() const noexcept -> HeadroomReport;
+
+    /// @brief
+    ///   Set ratio of frame period below which inter-frame processing margin is considered close
+    ///   to the deadline.
+    ///
+    /// @param ratio    The margin ratio. Default is 0.1.
+    auto SetMarginThreshold(double ratio) noexcept -> void;
+
+    /// @brief
+    ///   Set interval to log processing headroom. Pass zero to disable logging.
+    ///
+    /// @param interval     The new log interval.
+    auto SetLogInterval(std::chrono::seconds interval) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Number of frames in the window.
+    static constexpr const size_t WindowSize = 256;
+
+    struct Sample {
+        /// @brief
+        ///   Inter-frame processing margin in microseconds. Negative if the deadline is missed.
+        int32_t frameMargin;
+
+        /// @brief
+        ///   Inter-chirp processing margin in microseconds. Negative if the deadline is missed.
+        int32_t chirpMargin;
+
+        /// @brief
+        ///   Active frame CPU load in percent.
+        uint32_t activeFrameLoad;
+
+        /// @brief
+        ///   Inter-frame CPU load in percent.
+        uint32_t interFrameLoad;
+
+        /// @brief
+        ///   Inter-frame processing time in microseconds.
+        uint32_t processingTime;
+
+        /// @brief
+        ///   Output transmit time reported by the device in microseconds.
+        uint32_t transmitTime;
+
+        /// @brief
+        ///   Time in microseconds that the previous frame takes on the UART. 0 if unknown.
+        double expectedTransmitTime;
+
+        /// @brief
+        ///   Whether this frame is close to missing its deadline.
+        bool low;
+    };
+
+    /// @brief
+    ///   Check whether a sample is close to missing its deadline with current frame period.
+    auto IsLow(const Sample &sample) const noexcept -> bool;
+
+private:
+    /// @brief
+    ///   The serial that receives frames.
+    const Serial &serial;
+
+    /// @brief
+    ///   Device clock estimator of the serial.
+    const DeviceClock &deviceClock;
+
+    /// @brief
+    ///   Ring buffer of samples.
+    std::array<Sample, WindowSize> samples;
+
+    /// @brief
+    ///   Index of the next sample to be written.
+    size_t nextSample;
+
+    /// @brief
+    ///   Number of valid samples in the ring buffer.
+    size_t sampleCount;
+
+    /// @brief
+    ///   Number of samples in the window that are close to missing their deadline.
+    size_t lowCount;
+
+    /// @brief
+    ///   Average frame period in microseconds. 0 if unknown.
+    double framePeriod;
+
+    /// @brief
+    ///   Frame number of the last frame.
+    uint32_t lastFrameNumber;
+
+    /// @brief
+    ///   Device timestamp of the last frame.
+    uint32_t lastDeviceTime;
+
+    /// @brief
+    ///   Packet length of the last frame. 0 if there is no last frame.
+    uint32_t lastPacketLength;
+
+    /// @brief
+    ///   Ratio of frame period below which frame margin is close to the deadline.
+    double marginThreshold;
+
+    /// @brief
+    ///   Interval to log processing headroom.
+    std::chrono::seconds logInterval;
+
+    /// @brief
+    ///   Time that processing headroom is logged last time.
+    std::chrono::steady_clock::time_point lastLogTime;
+
+    /// @brief
+    ///   Mutex that is used to protect the window.
+    mutable std::mutex mutex;
+};
+
+} // namespace iwr1443
@@ -0,0 +1,536 @@
+#include "Radar.h"
+#include "../Log.h"
+#include "../Trace.h"
+#include "ConfigLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+
+using namespace iwr1443;
+
+// Default baud rate of sensor CLI port.
+static constexpr const uint32_t DEFAULT_CONTROL_BAUD_RATE = 115200;
+
+// Default baud rate of sensor data port.
+static constexpr const uint32_t DEFAULT_DATA_BAUD_RATE = 921600;
+
+// Number of values in a pose field.
+static constexpr const size_t POSE_FIELD_COUNT = 6;
+
+// Number of values in a cluster field.
+static constexpr const size_t CLUSTER_FIELD_COUNT = 4;
+
+// Number of values in a clutter map field.
+static constexpr const size_t CLUTTER_MAP_FIELD_COUNT = 3;
+
+/// @brief
+///   Parse a field of comma separated numbers.
+///
+/// @param      value   The field value.
+/// @param[out] numbers The parsed numbers.
+/// @param      count   Number of numbers that the field must contain.
+///
+/// @return bool
+///   Return true if the field contains exactly the specified number of valid numbers.
+static auto ParseNumbers(std::string_view value, float *numbers, size_t count) noexcept -> bool {
+    for (size_t i = 0; i < count; ++i) {
+        const size_t           separator = value.find(',');
+        const std::string_view number    = value.substr(0, separator);
+
+        const auto [end, error] =
+            std::from_chars(number.data(), number.data() + number.size(), numbers[i]);
+        if (error != std::errc() || end != number.data() + number.size())
+            return false;
+
+        if ((separator == std::string_view::npos) != (i + 1 == count))
+            return false;
+        value.remove_prefix(std::min(separator + 1, value.size()));
+    }
+
+    return true;
+}
+
+/// @brief
+///   Parse a pose field in the form of "x,y,z,yaw,pitch,roll".
+///
+/// @param      value       The field value.
+/// @param[out] extrinsic   The transform from sensor coordinates to site coordinates.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParsePose(std::string_view value, RigidTransform &extrinsic) noexcept -> bool {
+    float pose[POSE_FIELD_COUNT];
+    if (!ParseNumbers(value, pose, POSE_FIELD_COUNT))
+        return false;
+
+    extrinsic = RigidTransform::FromPose(pose[0], pose[1], pose[2], pose[3], pose[4], pose[5]);
+    return true;
+}
+
+/// @brief
+///   Parse a cluster field in the form of "epsilon,minPoints,dopplerWeight,snrWeight".
+///
+/// @param      value   The field value.
+/// @param[out] cluster The clustering parameters.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParseCluster(std::string_view value, ClusterConfig &cluster) noexcept -> bool {
+    float parameters[CLUSTER_FIELD_COUNT];
+    if (!ParseNumbers(value, parameters, CLUSTER_FIELD_COUNT))
+        return false;
+
+    if (!(parameters[0] > 0) || parameters[1] < 1 || parameters[1] != std::floor(parameters[1]) ||
+        parameters[2] < 0 || parameters[3] < 0)
+        return false;
+
+    cluster.epsilon       = parameters[0];
+    cluster.minPoints     = static_cast<uint32_t>(parameters[1]);
+    cluster.dopplerWeight = parameters[2];
+    cluster.snrWeight     = parameters[3];
+    return true;
+}
+
+/// @brief
+///   Parse a tracker field in the form of "cv" or "ca".
+///
+/// @param      value   The field value.
+/// @param[out] tracker The tracking parameters. Only the motion model is changed.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParseTracker(std::string_view value, TrackerConfig &tracker) noexcept -> bool {
+    if (value == "cv")
+        tracker.model = MotionModel::ConstantVelocity;
+    else if (value == "ca")
+        tracker.model = MotionModel::ConstantAcceleration;
+    else
+        return false;
+    return true;
+}
+
+/// @brief
+///   Parse a clutter field in the form of "drop" or "tag".
+///
+/// @param      value   The field value.
+/// @param[out] clutter The clutter filter parameters. Only the action is changed.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParseClutter(std::string_view value, ClutterFilterConfig &clutter) noexcept -> bool {
+    if (value == "drop")
+        clutter.action = ClutterAction::Drop;
+    else if (value == "tag")
+        clutter.action = ClutterAction::Tag;
+    else
+        return false;
+    return true;
+}
+
+/// @brief
+///   Parse a clutter map field in the form of "dopplerThreshold,halfLife,threshold".
+///
+/// @param      value   The field value.
+/// @param[out] clutter The clutter filter parameters.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParseClutterMap(std::string_view value, ClutterFilterConfig &clutter) noexcept
+    -> bool {
+    float parameters[CLUTTER_MAP_FIELD_COUNT];
+    if (!ParseNumbers(value, parameters, CLUTTER_MAP_FIELD_COUNT))
+        return false;
+
+    if (parameters[0] < 0 || !(parameters[1] > 0) || !(parameters[2] > 0))
+        return false;
+
+    clutter.dopplerThreshold = parameters[0];
+    clutter.halfLife         = parameters[1];
+    clutter.threshold        = parameters[2];
+    return true;
+}
+
+/// @brief
+///   Get files that a radar writes to.
+///
+/// @param config   Config of the radar.
+///
+/// @return std::array<std::string_view, 3>
+///   Return output, cluster and track paths. Unused paths are empty.
+static auto GetOutputPaths(const RadarConfig &config) noexcept -> std::array<std::string_view, 3> {
+    return {config.outputPath, config.clusterPath, config.trackPath};
+}
+
+/// @brief
+///   Check whether two radars, or the same radar, write to a common file.
+///
+/// @param first    Config of the first radar.
+/// @param second   Config of the second radar.
+///
+/// @return bool
+///   Return true if a file is written twice. Each output of a radar is only compared with the
+///   following outputs when both configs are the same one.
+static auto SharesOutput(const RadarConfig &first, const RadarConfig &second) noexcept -> bool {
+    const auto firstPaths  = GetOutputPaths(first);
+    const auto secondPaths = GetOutputPaths(second);
+    for (size_t i = 0; i < firstPaths.size(); ++i) {
+        for (size_t j = (&first == &second ? i + 1 : 0); j < secondPaths.size(); ++j) {
+            if (!firstPaths[i].empty() && firstPaths[i] == secondPaths[j])
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/// @brief
+///   Parse a port field in the form of "COM3" or "COM3@921600".
+///
+/// @param      value       The field value.
+/// @param[out] port        The port name.
+/// @param[out] baudRate    The baud rate. Unchanged if the field does not specify one.
+///
+/// @return bool
+///   Return true if the field is valid.
+static auto ParsePort(std::string_view value, std::string &port, uint32_t &baudRate) noexcept
+    -> bool {
+    const size_t separator = value.find('@');
+    port                   = value.substr(0, separator);
+    if (port.empty())
+        return false;
+
+    if (separator == std::string_view::npos)
+        return true;
+
+    const std::string_view rate = value.substr(separator + 1);
+    const auto [end, error]     = std::from_chars(rate.data(), rate.data() + rate.size(), baudRate);
+    return error == std::errc() && end == rate.data() + rate.size() && baudRate != 0;
+}
+
+auto iwr1443::LoadRadarConfigs(std::string_view path, std::vector<RadarConfig> &configs) noexcept
+    -> std::error_code {
+    configs.clear();
+
+    std::ifstream file{std::string(path)};
+    if (!file.is_open()) {
+        LogError("Failed to open site file {}.", path);
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    std::string line;
+    size_t      lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '%')
+            continue;
+
+        RadarConfig config{};
+        config.controlBaudRate = DEFAULT_CONTROL_BAUD_RATE;
+        config.dataBaudRate    = DEFAULT_DATA_BAUD_RATE;
+        config.extrinsic       = RigidTransform::Identity();
+        config.cluster         = PointClusterer::DefaultConfig();
+        config.tracker         = TargetTracker::DefaultConfig();
+        config.clutter         = StaticClutterFilter::DefaultConfig();
+
+        std::string_view rest(line);
+        rest.remove_prefix(first);
+        while (!rest.empty()) {
+            const size_t           end   = rest.find_first_of(" \t\r");
+            const std::string_view field = rest.substr(0, end);
+            rest.remove_prefix(field.size());
+            rest.remove_prefix(std::min(rest.find_first_not_of(" \t\r"), rest.size()));
+
+            const size_t equal = field.find('=');
+            if (equal == std::string_view::npos) {
+                LogError("Invalid field \"{}\" at {}:{}.", field, path, lineNumber);
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+
+            const std::string_view key   = field.substr(0, equal);
+            const std::string_view value = field.substr(equal + 1);
+
+            bool valid = !value.empty();
+            if (key == "name")
+                config.name = value;
+            else if (key == "control")
+                valid = ParsePort(value, config.controlPort, config.controlBaudRate);
+            else if (key == "data")
+                valid = ParsePort(value, config.dataPort, config.dataBaudRate);
+            else if (key == "config")
+                config.configPath = value;
+            else if (key == "output")
+                config.outputPath = value;
+            else if (key == "pose")
+                valid = ParsePose(value, config.extrinsic);
+            else if (key == "clusters")
+                config.clusterPath = value;
+            else if (key == "cluster")
+                valid = ParseCluster(value, config.cluster);
+            else if (key == "tracks")
+                config.trackPath = value;
+            else if (key == "tracker")
+                valid = ParseTracker(value, config.tracker);
+            else if (key == "clutter")
+                valid = ParseClutter(value, config.clutter);
+            else if (key == "clutterMap")
+                valid = ParseClutterMap(value, config.clutter);
+            else
+                valid = false;
+
+            if (!valid) {
+                LogError("Invalid field \"{}\" at {}:{}.", field, path, lineNumber);
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+        }
+
+        if (config.name.empty() || config.controlPort.empty() || config.dataPort.empty()) {
+            LogError("Radar at {}:{} requires name, control and data.", path, lineNumber);
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+
+        if (config.outputPath.empty())
+            config.outputPath = config.name + ".json";
+
+        if (SharesOutput(config, config)) {
+            LogError("Radar {} at {}:{} writes several outputs to the same file.",
+                     config.name,
+                     path,
+                     lineNumber);
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+
+        for (const auto &other : configs) {
+            if (other.name == config.name || other.controlPort == config.controlPort ||
+                other.dataPort == config.dataPort || SharesOutput(config, other)) {
+                LogError("Radar {} at {}:{} shares name, port or output with radar {}.",
+                         config.name,
+                         path,
+                         lineNumber,
+                         other.name);
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+        }
+
+        configs.push_back(std::move(config));
+    }
+
+    LogInfo("Loaded {} radars from site file {}.", configs.size(), path);
+    return std::error_code();
+}
+
+iwr1443::Radar::Radar(RadarConfig config)
+    : config(std::move(config)),
+      controlSerial(),
+      dataSerial(),
+      bandwidthGovernor(controlSerial, dataSerial.GetLinkBudget()),
+      outputWriter(),
+      clusterer(this->config.cluster),
+      clusterCloud(),
+      clusterText(),
+      clusterWriter(),
+      tracker(this->config.tracker),
+      trackText(),
+      trackWriter() {}
+
+iwr1443::Radar::~Radar() {}
+
+auto iwr1443::Radar::Initialize(IOContext        &ioContext,
+                                PointCloudFusion *fusion,
+                                uint16_t          device) noexcept -> std::error_code {
+    std::error_code errorCode =
+        controlSerial.Initialize(config.controlPort, config.controlBaudRate);
+    if (errorCode.value() != 0) {
+        LogError("Failed to initialize control serial of radar {}: {}.",
+                 config.name,
+                 errorCode.message());
+        return errorCode;
+    }
+
+    errorCode = dataSerial.Initialize(config.dataPort, config.dataBaudRate);
+    if (errorCode.value() != 0) {
+        LogError(
+            "Failed to initialize data serial of radar {}: {}.", config.name, errorCode.message());
+        return errorCode;
+    }
+
+    errorCode = outputWriter.Open(config.outputPath);
+    if (errorCode.value() != 0) {
+        LogError("Failed to open data file {} of radar {}: {}.",
+                 config.outputPath,
+                 config.name,
+                 errorCode.message());
+        return errorCode;
+    }
+
+    // Detected points are persisted in site coordinates.
+    dataSerial.SetExtrinsic(config.extrinsic);
+
+    if (config.clutter.action != ClutterAction::None)
+        dataSerial.SetClutterFilter(config.clutter);
+
+    if (!config.clusterPath.empty()) {
+        errorCode = clusterWriter.Open(config.clusterPath);
+        if (errorCode.value() != 0) {
+            LogError("Failed to open cluster file {} of radar {}: {}.",
+                     config.clusterPath,
+                     config.name,
+                     errorCode.message());
+            return errorCode;
+        }
+    }
+
+    if (!config.trackPath.empty()) {
+        errorCode = trackWriter.Open(config.trackPath);
+        if (errorCode.value() != 0) {
+            LogError("Failed to open track file {} of radar {}: {}.",
+                     config.trackPath,
+                     config.name,
+                     errorCode.message());
+            return errorCode;
+        }
+    }
+
+    if (!config.clusterPath.empty() || !config.trackPath.empty())
+        dataSerial.AddFrameListener([this](const void *frame) -> void { ClusterFrame(frame); });
+
+    // Disable heavy TLV outputs if the data port could not keep up with the sensor.
+    dataSerial.AddFrameListener([this](const void *) -> void { bandwidthGovernor.OnFrame(); });
+
+    // Fusion merges frames of all radars by host time.
+    if (fusion != nullptr) {
+        dataSerial.AddFrameListener([this, fusion, device](const void *frame) -> void {
+            const uint32_t time = static_cast<const FrameHeader *>(frame)->time;
+            fusion->OnFrame(device, frame, dataSerial.GetDeviceClock().ToHostTime(time));
+        });
+    }
+
+    dataSerial.SetPersistantWriter([this](const void *data, size_t size) -> void {
+        outputWriter.Write(data, size);
+    });
+
+    errorCode = ioContext.Register(&controlSerial);
+    if (errorCode.value() != 0) {
+        LogError("Failed to register control serial of radar {} to IO context: {}.",
+                 config.name,
+                 errorCode.message());
+        return errorCode;
+    }
+
+    errorCode = ioContext.Register(&dataSerial);
+    if (errorCode.value() != 0) {
+        LogError("Failed to register data serial of radar {} to IO context: {}.",
+                 config.name,
+                 errorCode.message());
+        return errorCode;
+    }
+
+    return std::error_code();
+}
+
+auto iwr1443::Radar::Configure(ConfigCache              &cache,
+                               std::chrono::milliseconds commandTimeout) noexcept
+    -> std::error_code {
+    if (config.configPath.empty())
+        return std::error_code();
+
+    ConfigLoader configLoader;
+
+    std::error_code errorCode = configLoader.Load(config.configPath);
+    if (errorCode.value() == 0)
+        errorCode = configLoader.ApplyCached(controlSerial, dataSerial, cache, commandTimeout);
+
+    if (errorCode.value() != 0) {
+        LogError("Failed to configure radar {} with {}: {}.",
+                 config.name,
+                 config.configPath,
+                 errorCode.message());
+        return errorCode;
+    }
+
+    for (const auto &line : configLoader.GetCommands()) {
+        if (line.starts_with("guiMonitor"))
+            bandwidthGovernor.SetGuiMonitor(line);
+    }
+
+    return std::error_code();
+}
+
+auto iwr1443::Radar::SendCommand(std::string_view command) noexcept -> void {
+    std::string line(command);
+    line.push_back('\n');
+    controlSerial.AsyncWrite(line.data(), line.size());
+}
+
+auto iwr1443::Radar::ClusterFrame(const void *frame) noexcept -> void {
+    TRACE_SPAN("Radar::ClusterFrame");
+
+    // DataSerial has moved DetectedPoints to site coordinates. Labels follow the point order of
+    // the extracted TLV.
+    clusterCloud.Clear();
+    ExtractPointCloud(frame, 0, config.extrinsic, clusterCloud);
+    clusterer.Cluster(clusterCloud);
+
+    const auto *header = static_cast<const FrameHeader *>(frame);
+    if (!config.clusterPath.empty()) {
+        clusterText.clear();
+        clusterer.Serialize(header->frameNumber, clusterText);
+        clusterWriter.Write(clusterText.data(), clusterText.size());
+    }
+
+    if (config.trackPath.empty())
+        return;
+
+    const uint64_t dropped = tracker.GetReport().droppedClusters;
+    tracker.Update(dataSerial.GetDeviceClock().ToHostTime(header->time), clusterer.GetClusters());
+
+    const TrackerReport report = tracker.GetReport();
+    if (report.droppedClusters != dropped) {
+        LOG_RATE_LIMITED(LogLevel::Warning,
+                         1.0,
+                         5,
+                         "Radar {} reached {} tracks and dropped {} clusters of frame {}.",
+                         config.name,
+                         report.activeTracks,
+                         report.droppedClusters - dropped,
+                         header->frameNumber);
+    }
+
+    trackText.clear();
+    tracker.Serialize(header->frameNumber, trackText);
+    trackWriter.Write(trackText.data(), trackText.size());
+}
+
+auto iwr1443::Radar::LogStatistics() const noexcept -> void {
+    const SerialStatistics statistics = dataSerial.GetStatistics();
+    LogInfo("Radar {} data serial {} received {} bytes. Overrun errors: {}, input overflow errors: "
+            "{}, framing errors: {}, peak input queue: {}/{} bytes.",
+            config.name,
+            dataSerial.GetPortName(),
+            statistics.bytesReceived,
+            statistics.overrunErrors,
+            statistics.inputOverflowErrors,
+            statistics.framingErrors,
+            statistics.peakInputQueue,
+            statistics.inputQueueSize);
+
+    if (config.clutter.action == ClutterAction::None)
+        return;
+
+    const ClutterReport clutter = dataSerial.GetClutterFilter().GetReport();
+    LogInfo("Radar {} clutter filter {} {} of {} points ({:.1f}%) in {} frames, frame bytes "
+            "reduced from {} to {} ({:.1f}%).",
+            config.name,
+            config.clutter.action == ClutterAction::Tag ? "tagged" : "dropped",
+            clutter.clutterPoints,
+            clutter.inputPoints,
+            clutter.pointReduction * 100,
+            clutter.frames,
+            clutter.inputBytes,
+            clutter.outputBytes,
+            clutter.byteReduction * 100);
+}
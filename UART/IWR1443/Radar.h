@@ -0,0 +1,236 @@
+#pragma once
+
+#include "../FileWriter.h"
+#include "../IOContext.h"
+#include "BandwidthGovernor.h"
+#include "Clustering.h"
+#include "ConfigCache.h"
+#include "Fusion.h"
+#include "Serials.h"
+#include "Tracker.h"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace iwr1443 {
+
+struct RadarConfig {
+    /// @brief
+    ///   Name of the radar. Used to address console commands and to name log lines.
+    std::string name;
+
+    /// @brief
+    ///   Port connected to sensor CLI port.
+    std::string controlPort;
+
+    /// @brief
+    ///   Baud rate of sensor CLI port.
+    uint32_t controlBaudRate;
+
+    /// @brief
+    ///   Port connected to sensor data port.
+    std::string dataPort;
+
+    /// @brief
+    ///   Baud rate of sensor data port.
+    uint32_t dataBaudRate;
+
+    /// @brief
+    ///   Path to the sensor config file. The sensor is not configured if this is empty.
+    std::string configPath;
+
+    /// @brief
+    ///   Path to the file that serialized frames are appended to.
+    std::string outputPath;
+
+    /// @brief
+    ///   Transform from sensor coordinates to site coordinates. Identity if no pose is specified.
+    RigidTransform extrinsic;
+
+    /// @brief
+    ///   Path to the file that cluster labels and summaries of each frame are appended to. Frames
+    ///   are not clustered if this is empty.
+    std::string clusterPath;
+
+    /// @brief
+    ///   Clustering parameters.
+    ClusterConfig cluster;
+
+    /// @brief
+    ///   Path to the file that confirmed tracks of each frame are appended to. Clusters are
+    ///   tracked if this is not empty, even if they are not written.
+    std::string trackPath;
+
+    /// @brief
+    ///   Tracking parameters.
+    TrackerConfig tracker;
+
+    /// @brief
+    ///   Static clutter filter applied to frames before they are serialized.
+    ClutterFilterConfig clutter;
+};
+
+/// @brief
+///   Load radar configs from a site file, given to the capture app with --site. Each line
+///   describes one radar with space separated key=value fields, such as
+///   "name=front control=COM4@115200 data=COM3@921600 config=front.cfg output=front.json".
+///   Baud rates are optional and default to those of the demo firmware. Sensor pose in site
+///   coordinates is given by "pose=x,y,z,yaw,pitch,roll" in meters and degrees. Points of each
+///   frame are clustered into the file given by "clusters=path", with parameters given by
+///   "cluster=epsilon,minPoints,dopplerWeight,snrWeight". Clusters are tracked into the file given
+///   by "tracks=path", with a constant velocity or constant acceleration model given by
+///   "tracker=cv" or "tracker=ca". Static clutter is removed from frames with "clutter=drop" or
+///   marked with "clutter=tag", and its persistence is given by
+///   "clutterMap=dopplerThreshold,halfLife,threshold" in m/s, frames and occupancy. Empty lines
+///   and lines starting with '%' are ignored.
+///
+/// @param      path    Path to the site file.
+/// @param[out] configs Radar configs loaded from the file. Cleared before loading.
+///
+/// @return std::error_code
+///   Return an error code that represents the load result.
+auto LoadRadarConfigs(std::string_view path, std::vector<RadarConfig> &configs) noexcept
+    -> std::error_code;
+
+/// @brief
+///   A sensor connected through a pair of serials, with its own output file, bandwidth governor and
+///   statistics. Radars share an IOContext and an optional fusion stage, and no other per-frame
+///   state.
+class Radar {
+public:
+    /// @brief
+    ///   Create a radar with the specified config. Initialize this radar before using.
+    ///
+    /// @param config   Ports and files of this radar.
+    explicit Radar(RadarConfig config);
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    Radar(const Radar &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const Radar &) = delete;
+
+    /// @brief
+    ///   Destroy this radar. The IOContext must have stopped running.
+    ~Radar();
+
+    /// @brief
+    ///   Connect serials of this radar, open its output file and register serials to the
+    ///   specified IOContext.
+    ///
+    /// @param ioContext    The IOContext that dispatches IO completions of this radar.
+    /// @param fusion       The fusion stage that point clouds of this radar are merged by. Pass
+    ///                     nullptr to disable fusion.
+    /// @param device       Index of this radar in the fusion stage.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the initialize result.
+    auto Initialize(IOContext &ioContext, PointCloudFusion *fusion, uint16_t device) noexcept
+        -> std::error_code;
+
+    /// @brief
+    ///   Apply the sensor config file of this radar. Do nothing if no config file is specified.
+    ///
+    /// @param cache            The config cache shared by all radars. Entries are keyed by port.
+    /// @param commandTimeout   Maximum time to wait for acknowledgment of a single command.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the configuration result.
+    auto Configure(ConfigCache &cache, std::chrono::milliseconds commandTimeout) noexcept
+        -> std::error_code;
+
+    /// @brief
+    ///   Send a CLI command to the sensor without waiting for its response.
+    ///
+    /// @param command  The command without trailing newline.
+    auto SendCommand(std::string_view command) noexcept -> void;
+
+    /// @brief
+    ///   Log serial statistics of this radar.
+    auto LogStatistics() const noexcept -> void;
+
+    /// @brief
+    ///   Get name of this radar.
+    ///
+    /// @return std::string_view
+    ///   Return name of this radar.
+    auto GetName() const noexcept -> std::string_view {
+        return config.name;
+    }
+
+    /// @brief
+    ///   Get control serial of this radar.
+    auto GetControlSerial() noexcept -> ControlSerial & {
+        return controlSerial;
+    }
+
+    /// @brief
+    ///   Get data serial of this radar.
+    auto GetDataSerial() noexcept -> DataSerial & {
+        return dataSerial;
+    }
+
+private:
+    /// @brief
+    ///   Cluster points of a frame, track the clusters and write them to the cluster and track
+    ///   files. Called from IO thread for each frame.
+    ///
+    /// @param[in] frame    Pointer to start of a complete frame.
+    auto ClusterFrame(const void *frame) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Ports and files of this radar.
+    RadarConfig config;
+
+    /// @brief
+    ///   Serial connected to sensor CLI port.
+    ControlSerial controlSerial;
+
+    /// @brief
+    ///   Serial connected to sensor data port.
+    DataSerial dataSerial;
+
+    /// @brief
+    ///   Bandwidth governor of this radar. Must be constructed after both serials.
+    BandwidthGovernor bandwidthGovernor;
+
+    /// @brief
+    ///   Output file of serialized frames.
+    FileWriter outputWriter;
+
+    /// @brief
+    ///   Clusterer of frame points.
+    PointClusterer clusterer;
+
+    /// @brief
+    ///   Points of the frame being clustered. Reused to avoid allocations.
+    PointCloud clusterCloud;
+
+    /// @brief
+    ///   Serialized clusters of the frame being clustered. Reused to avoid allocations.
+    std::string clusterText;
+
+    /// @brief
+    ///   Output file of cluster labels and summaries.
+    FileWriter clusterWriter;
+
+    /// @brief
+    ///   Tracker of frame clusters.
+    TargetTracker tracker;
+
+    /// @brief
+    ///   Serialized tracks of the frame being tracked. Reused to avoid allocations.
+    std::string trackText;
+
+    /// @brief
+    ///   Output file of confirmed tracks.
+    FileWriter trackWriter;
+};
+
+} // namespace iwr1443
@@ -1,32 +1,236 @@
 #include "Serials.h"
+#include "../ConsoleSink.h"
 #include "../Log.h"
+#include "../Trace.h"
 #include "Data.h"
 
 #include <Windows.h>
 
+#include <algorithm>
+
 using namespace iwr1443;
 
-iwr1443::ControlSerial::ControlSerial() noexcept : Serial() {}
+iwr1443::ControlSerial::ControlSerial() noexcept
+    : Serial(),
+      lineReader(),
+      pendingCommands(),
+      sentCommands(0),
+      pendingMutex(),
+      pendingCondition(),
+      timeoutThread() {
+    timeoutThread =
+        std::jthread([this](std::stop_token stopToken) -> void { ExpireCommands(stopToken); });
+}
 
-iwr1443::ControlSerial::~ControlSerial() noexcept {}
+iwr1443::ControlSerial::~ControlSerial() noexcept {
+    timeoutThread.request_stop();
+    timeoutThread.join();
 
-auto iwr1443::ControlSerial::Initialize() noexcept -> std::error_code {
-    return Serial::Initialize("COM4", 115200);
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (auto &pending : pendingCommands) {
+        if (!pending.expired)
+            pending.promise.set_value(
+                CommandResponse{std::make_error_code(std::errc::operation_canceled), {}});
+    }
+}
+
+auto iwr1443::ControlSerial::Initialize(std::string_view portName, uint32_t baudRate) noexcept
+    -> std::error_code {
+    return Serial::Initialize(portName, baudRate);
 }
 
 auto iwr1443::ControlSerial::OnRead(const void *data, size_t size) noexcept -> void {
-    WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), data, static_cast<DWORD>(size), nullptr, nullptr);
+    ConsoleSink::GetSingleton()->Write(data, size);
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    lineReader.Feed(data, size, [this](std::string_view line) -> void {
+        // Prompt is followed by the echo of next command on the same line.
+        if (line.starts_with(Prompt)) {
+            OnLine(Prompt);
+            line.remove_prefix(Prompt.size());
+        }
+
+        if (!line.empty())
+            OnLine(line);
+    });
+
+    // Prompt is not terminated by new line.
+    if (lineReader.GetPending() == Prompt) {
+        OnLine(Prompt);
+        lineReader.Clear();
+    }
+}
+
+auto iwr1443::ControlSerial::SendCommand(std::string_view          command,
+                                         std::chrono::milliseconds timeout)
+    -> std::future<CommandResponse> {
+    std::string data(command);
+    data.push_back('\n');
+
+    std::future<CommandResponse> result;
+
+    { // Write under lock so that commands are sent in the same order as they are queued.
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        PendingCommand &pending = pendingCommands.emplace_back(PendingCommand{
+            std::string(command),
+            std::promise<CommandResponse>(),
+            std::chrono::steady_clock::now() + timeout,
+            CommandResponse{},
+            false,
+            false,
+            false,
+        });
+
+        result = pending.promise.get_future();
+        ++sentCommands;
+        AsyncWrite(data.data(), data.size());
+    }
+
+    pendingCondition.notify_one();
+    return result;
+}
+
+auto iwr1443::ControlSerial::OnLine(std::string_view line) noexcept -> void {
+    if (pendingCommands.empty())
+        return;
+
+    // A command lost by the sensor never gets response, and a command that timed out after its
+    // echo may never get status. Resynchronize on echo of a later command once the commands
+    // before it have expired. Echo of the front command itself is not a reason to skip it.
+    const PendingCommand &first = pendingCommands.front();
+    if (first.expired && line != Prompt && (first.echoed || line != first.command)) {
+        auto echoed = std::find_if(pendingCommands.begin() + 1,
+                                   pendingCommands.end(),
+                                   [line](const PendingCommand &p) { return p.command == line; });
+
+        if (echoed != pendingCommands.end() &&
+            std::all_of(pendingCommands.begin(), echoed, [](const PendingCommand &p) {
+                return p.expired;
+            }))
+            pendingCommands.erase(pendingCommands.begin(), echoed);
+    }
+
+    PendingCommand &front = pendingCommands.front();
+    if (line == Prompt) {
+        // A prompt without status is a leftover from an earlier command.
+        if (!front.responded)
+            return;
+
+        if (!front.expired)
+            front.promise.set_value(std::move(front.response));
+
+        pendingCommands.pop_front();
+    } else if (!front.echoed && line == front.command) {
+        front.echoed = true;
+    } else if (line == "Done") {
+        front.responded = true;
+    } else if (line.starts_with("Error") || line.find("not recognized") != line.npos) {
+        front.responded      = true;
+        front.response.error = std::make_error_code(std::errc::invalid_argument);
+        front.response.lines.emplace_back(line);
+    } else if (!front.responded) {
+        front.response.lines.emplace_back(line);
+    }
+}
+
+auto iwr1443::ControlSerial::ExpireCommands(std::stop_token stopToken) -> void {
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    while (!stopToken.stop_requested()) {
+        // Find the earliest deadline of commands that are still waited for.
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        for (const auto &pending : pendingCommands) {
+            if (!pending.expired && pending.deadline < deadline)
+                deadline = pending.deadline;
+        }
+
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            pendingCondition.wait(lock, stopToken, [this]() -> bool {
+                for (const auto &pending : pendingCommands) {
+                    if (!pending.expired)
+                        return true;
+                }
+                return false;
+            });
+            continue;
+        }
+
+        // Wake up early if a new command is sent. It may have an earlier deadline.
+        const uint64_t sent = sentCommands;
+        pendingCondition.wait_until(
+            lock, stopToken, deadline, [&]() -> bool { return sentCommands != sent; });
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto &pending : pendingCommands) {
+            if (!pending.expired && pending.deadline <= now) {
+                pending.expired = true;
+                pending.promise.set_value(
+                    CommandResponse{std::make_error_code(std::errc::timed_out), {}});
+            }
+        }
+    }
 }
 
-iwr1443::DataSerial::DataSerial() noexcept : Serial(), buffer() {}
+iwr1443::DataSerial::DataSerial() noexcept
+    : Serial(),
+      buffer(),
+      arrivalTimes(),
+      persistantWriter(),
+      frameListeners(),
+      extrinsic(RigidTransform::Identity()),
+      hasExtrinsic(false),
+      extrinsicField(),
+      transformScratch(),
+      linkBudget(*this),
+      deviceClock(*this),
+      processingHeadroom(*this, deviceClock),
+      clutterFilter(*this),
+      hasClutterFilter(false),
+      frameCount(0),
+      frameCounter(),
+      frameSizeHistogram(),
+      transportLatency(),
+      assemblyLatency(),
+      decodeLatency(),
+      serializeLatency(),
+      writeLatency(),
+      endToEndLatency(),
+      serializedBytesCounter() {}
 
 iwr1443::DataSerial::~DataSerial() noexcept {}
 
-auto iwr1443::DataSerial::Initialize() noexcept -> std::error_code {
-    return Serial::Initialize("COM3", 921600);
+auto iwr1443::DataSerial::Initialize(std::string_view portName, uint32_t baudRate) noexcept
+    -> std::error_code {
+    std::error_code errorCode = Serial::Initialize(portName, baudRate);
+    if (errorCode.value() != 0)
+        return errorCode;
+
+    const auto latencyName = [portName](std::string_view stage) -> std::string {
+        return std::format(R"(frame_latency_ns{{port="{}",stage="{}"}})", portName, stage);
+    };
+
+    MetricRegistry *registry = MetricRegistry::GetSingleton();
+    frameCounter       = registry->GetCounter(std::format("data_frames{{port=\"{}\"}}", portName));
+    frameSizeHistogram =
+        registry->GetHistogram(std::format("data_frame_bytes{{port=\"{}\"}}", portName));
+    serializedBytesCounter =
+        registry->GetCounter(std::format("data_serialized_bytes{{port=\"{}\"}}", portName));
+    transportLatency = registry->GetHistogram(latencyName("transport"));
+    assemblyLatency  = registry->GetHistogram(latencyName("assembly"));
+    decodeLatency    = registry->GetHistogram(latencyName("decode"));
+    serializeLatency = registry->GetHistogram(latencyName("serialize"));
+    writeLatency     = registry->GetHistogram(latencyName("write"));
+    endToEndLatency  = registry->GetHistogram(latencyName("total"));
+
+    return std::error_code();
 }
 
-static auto LocateFrameHeader(const void *start, size_t size) noexcept -> const void * {
+// Largest frame accepted. Larger packet length means a corrupted header.
+static constexpr const size_t MAX_FRAME_SIZE = 1024 * 1024;
+
+auto iwr1443::LocateFrameHeader(const void *start, size_t size) noexcept -> const void * {
+    if (size < sizeof(FrameHeader))
+        return nullptr;
+
     const std::byte *searchStart = static_cast<const std::byte *>(start);
     const std::byte *searchEnd   = searchStart + size - sizeof(FrameHeader) + 1;
 
@@ -42,34 +246,109 @@ static auto LocateFrameHeader(const void *start, size_t size) noexcept -> const
     return nullptr;
 }
 
+/// @brief
+///   Check that all TLVs of a complete frame lie within its packet length and are large enough for
+///   their fixed size parts. Frames with corrupted bytes may not pass this check.
+static auto ValidateFrame(const void *frame) noexcept -> bool {
+    const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+    size_t             offset      = sizeof(FrameHeader);
+
+    for (uint32_t i = 0; i < frameHeader->tlvCount; ++i) {
+        if (frameHeader->packetLength - offset < sizeof(TLVHeader))
+            return false;
+
+        TLVHeader tlvHeader;
+        memcpy(&tlvHeader, static_cast<const std::byte *>(frame) + offset, sizeof(TLVHeader));
+        offset += sizeof(TLVHeader);
+
+        if (frameHeader->packetLength - offset < tlvHeader.length)
+            return false;
+
+        size_t minimum = 0;
+        switch (tlvHeader.type) {
+        case TLVType::DetectedPoints: {
+            if (tlvHeader.length < sizeof(DetectedPointHeader))
+                return false;
+
+            DetectedPointHeader header;
+            memcpy(&header, static_cast<const std::byte *>(frame) + offset, sizeof(header));
+            minimum =
+                sizeof(DetectedPointHeader) + header.detectedObjectCount * sizeof(DetectedPoint);
+            break;
+        }
+        case TLVType::Statistics:
+            minimum = sizeof(Statistics);
+            break;
+        case TLVType::TemperatureStatistics:
+            minimum = sizeof(TemperatureStatistics);
+            break;
+        case TLVType::SphericalCompressedPointCloud:
+            minimum = sizeof(SphericalCompressedPointCloudHeader);
+            break;
+        default:
+            break;
+        }
+
+        if (tlvHeader.length < minimum)
+            return false;
+
+        offset += tlvHeader.length;
+    }
+
+    return true;
+}
+
 auto iwr1443::DataSerial::OnRead(const void *data, size_t size) noexcept -> void {
+    TRACE_SPAN_ARG("DataSerial::OnRead", size);
+
     buffer.insert(buffer.end(),
                   static_cast<const std::byte *>(data),
                   static_cast<const std::byte *>(data) + size);
+    arrivalTimes.emplace_back(buffer.size(), GetReadTime());
+
+    // A single read may complete more than one frame.
+    while (buffer.size() >= sizeof(FrameHeader)) {
+        const void *frameStart = LocateFrameHeader(buffer.data(), buffer.size());
+        if (frameStart == nullptr) {
+            // Keep the tail since it may be the beginning of a magic word.
+            Consume(buffer.size() - sizeof(FrameHeader) + 1);
+            return;
+        }
 
-    if (buffer.size() < sizeof(FrameHeader))
-        return;
+        // Move frame to start of the buffer. frameStart may be invalidated here.
+        Consume(static_cast<size_t>(static_cast<const std::byte *>(frameStart) - buffer.data()));
+
+        const FrameHeader *frameHeader = reinterpret_cast<const FrameHeader *>(buffer.data());
+        const size_t       frameSize   = frameHeader->packetLength;
+        if (frameSize < sizeof(FrameHeader) || frameSize > MAX_FRAME_SIZE) {
+            LOG_RATE_LIMITED(LogLevel::Warning,
+                             1.0,
+                             5,
+                             "Serial {} received frame with invalid packet length {}. Skipped.",
+                             GetPortName(),
+                             frameSize);
+            Consume(sizeof(uint64_t));
+            continue;
+        }
 
-    const void *frameStart = LocateFrameHeader(buffer.data(), buffer.size());
-    if (frameStart == nullptr) {
-        buffer.clear();
-        return;
-    }
+        // Wait for the whole frame.
+        if (buffer.size() < frameSize)
+            return;
 
-    // Move frame to start of the buffer.
-    if (frameStart != buffer.data()) {
-        size_t eraseSize = static_cast<const std::byte *>(frameStart) - buffer.data();
-        // frameStart may be invalidated here.
-        buffer.erase(buffer.begin(), buffer.begin() + eraseSize);
-    }
+        FrameTimestamps timestamps{};
+        timestamps.magicWord = GetArrivalTime(0);
+        timestamps.lastByte  = GetArrivalTime(frameSize - 1);
 
-    // Wait for the whole frame.
-    FrameHeader *frameHeader = reinterpret_cast<FrameHeader *>(buffer.data());
-    if (buffer.size() < size_t(frameHeader->packetLength))
-        return;
+        if (!HandleFrame(buffer.data(), frameSize, timestamps)) {
+            Consume(sizeof(uint64_t));
+            continue;
+        }
 
-    HandleFrame(frameHeader);
-    buffer.clear();
+        RecordLatency(timestamps);
+
+        // Keep bytes of the next frame.
+        Consume(frameSize);
+    }
 }
 
 auto iwr1443::DataSerial::SetPersistantWriter(
@@ -77,16 +356,62 @@ auto iwr1443::DataSerial::SetPersistantWriter(
     persistantWriter = std::move(writer);
 }
 
+auto iwr1443::DataSerial::AddFrameListener(std::function<void(const void *)> listener) noexcept
+    -> void {
+    frameListeners.push_back(std::move(listener));
+}
+
+auto iwr1443::DataSerial::SetExtrinsic(const RigidTransform &transform) noexcept -> void {
+    extrinsic    = transform;
+    hasExtrinsic = !transform.IsIdentity();
+
+    extrinsicField.clear();
+    if (!hasExtrinsic)
+        return;
+
+    std::format_to(std::back_inserter(extrinsicField), "\"Extrinsic\": [");
+    for (size_t row = 0; row < 4; ++row) {
+        std::format_to(std::back_inserter(extrinsicField),
+                       "{}[{}, {}, {}, {}]",
+                       row == 0 ? "" : ", ",
+                       transform.matrix[row][0],
+                       transform.matrix[row][1],
+                       transform.matrix[row][2],
+                       transform.matrix[row][3]);
+    }
+    std::format_to(std::back_inserter(extrinsicField), "], ");
+}
+
+auto iwr1443::DataSerial::SetClutterFilter(const ClutterFilterConfig &config) noexcept -> void {
+    clutterFilter.SetConfig(config);
+    hasClutterFilter = clutterFilter.GetConfig().action != ClutterAction::None;
+}
+
 auto iwr1443::DataSerial::Persistant(const void *data, size_t size) noexcept -> void {
     if (persistantWriter)
         persistantWriter(data, size);
     else
-        WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), data, DWORD(size), nullptr, nullptr);
+        ConsoleSink::GetSingleton()->Write(data, size);
+}
+
+/// @brief
+///   Get trace span name of handling the specified TLV type.
+static auto TLVSpanName(TLVType type) noexcept -> const char * {
+    thread_local std::vector<std::pair<TLVType, const char *>> spanNames;
+    for (const auto &[key, name] : spanNames) {
+        if (key == type)
+            return name;
+    }
+
+    const char *name = TraceSystem::GetSingleton()->Intern(std::format("HandleTLV {}", type));
+    spanNames.emplace_back(type, name);
+    return name;
 }
 
 static auto HandleTLV(std::string &ctx, const void *tlv) noexcept -> size_t {
     const TLVHeader *tlvHeader = static_cast<const TLVHeader *>(tlv);
     const void      *data      = static_cast<const std::byte *>(tlv) + sizeof(TLVHeader);
+    TRACE_SPAN_ARG(TLVSpanName(tlvHeader->type), tlvHeader->length);
 
     std::format_to(std::back_inserter(ctx), "{{\"Type\": \"{}\", ", tlvHeader->type);
     switch (tlvHeader->type) {
@@ -225,13 +550,55 @@ static auto HandleTLV(std::string &ctx, const void *tlv) noexcept -> size_t {
     return tlvHeader->length + sizeof(TLVHeader);
 }
 
-auto iwr1443::DataSerial::HandleFrame(const void *frame) noexcept -> void {
+auto iwr1443::DataSerial::HandleFrame(void            *frame,
+                                      size_t           size,
+                                      FrameTimestamps &timestamps) noexcept -> bool {
+    TRACE_SPAN("DataSerial::HandleFrame");
+    if (size < sizeof(FrameHeader))
+        return false;
+
     const FrameHeader *frameHeader = static_cast<const FrameHeader *>(frame);
+    if (frameHeader->packetLength < sizeof(FrameHeader) || frameHeader->packetLength > size ||
+        !ValidateFrame(frame)) {
+        LOG_RATE_LIMITED(LogLevel::Warning,
+                         1.0,
+                         5,
+                         "Serial {} received frame {} with invalid length or TLVs. Skipped.",
+                         GetPortName(),
+                         frameHeader->frameNumber);
+        return false;
+    }
+
+    // Points are persisted in site coordinates.
+    if (hasExtrinsic)
+        TransformDetectedPoints(frame);
+
+    frameCount.fetch_add(1, std::memory_order_relaxed);
+    frameCounter.Add();
+    frameSizeHistogram.Record(frameHeader->packetLength);
+    linkBudget.OnFrame(frame);
+    // Device clock is updated before listeners, so listeners can map frame timestamps to host time.
+    timestamps.acquired = deviceClock.OnFrame(frame, timestamps.magicWord);
+    processingHeadroom.OnFrame(frame);
+
+    // Analyzers above see the frame as it is sent over the link.
+    const void *output = frame;
+    if (hasClutterFilter) {
+        output      = clutterFilter.Filter(output);
+        frameHeader = static_cast<const FrameHeader *>(output);
+    }
+
+    for (const auto &listener : frameListeners)
+        listener(output);
+
+    timestamps.decoded = std::chrono::steady_clock::now();
 
     std::string ctx;
-    std::format_to(std::back_inserter(ctx), "{{\"Header\": {}, \"TLVs\": [", *frameHeader);
+    std::format_to(std::back_inserter(ctx), "{{\"Header\": {}, ", *frameHeader);
+    ctx.append(extrinsicField);
+    std::format_to(std::back_inserter(ctx), "\"TLVs\": [");
 
-    const std::byte *iter = static_cast<const std::byte *>(frame);
+    const std::byte *iter = static_cast<const std::byte *>(output);
     iter += sizeof(FrameHeader);
 
     for (uint32_t i = 0; i < frameHeader->tlvCount; ++i) {
@@ -240,6 +607,109 @@ auto iwr1443::DataSerial::HandleFrame(const void *frame) noexcept -> void {
         iter += HandleTLV(ctx, iter);
     }
 
-    std::format_to(std::back_inserter(ctx), "]}}, ");
+    std::format_to(std::back_inserter(ctx), "]");
+
+    if (hasClutterFilter && clutterFilter.GetConfig().action == ClutterAction::Tag) {
+        std::format_to(std::back_inserter(ctx), ", \"StaticPoints\": [");
+        const auto &clutterPoints = clutterFilter.GetClutterPoints();
+        for (size_t i = 0; i < clutterPoints.size(); ++i)
+            std::format_to(std::back_inserter(ctx), "{}{}", i == 0 ? "" : ", ", clutterPoints[i]);
+        std::format_to(std::back_inserter(ctx), "]");
+    }
+
+    std::format_to(std::back_inserter(ctx), "}}, ");
+    timestamps.serialized = std::chrono::steady_clock::now();
+
     Persistant(ctx.data(), ctx.size());
+    timestamps.handedOff = std::chrono::steady_clock::now();
+
+    serializedBytesCounter.Add(ctx.size());
+    return true;
+}
+
+auto iwr1443::DataSerial::TransformDetectedPoints(void *frame) noexcept -> void {
+    TRACE_SPAN("DataSerial::TransformDetectedPoints");
+
+    FrameHeader frameHeader;
+    memcpy(&frameHeader, frame, sizeof(FrameHeader));
+
+    std::byte *iter = static_cast<std::byte *>(frame) + sizeof(FrameHeader);
+    for (uint32_t i = 0; i < frameHeader.tlvCount; ++i) {
+        TLVHeader tlvHeader;
+        memcpy(&tlvHeader, iter, sizeof(TLVHeader));
+        iter += sizeof(TLVHeader);
+
+        if (tlvHeader.type != TLVType::DetectedPoints) {
+            iter += tlvHeader.length;
+            continue;
+        }
+
+        DetectedPointHeader header;
+        memcpy(&header, iter, sizeof(DetectedPointHeader));
+
+        // Points may be unaligned in the receive buffer, so they are gathered into columns, which
+        // also lets the transform run on several points per instruction.
+        std::byte   *points = iter + sizeof(DetectedPointHeader);
+        const size_t count  = header.detectedObjectCount;
+        transformScratch.x.resize(count);
+        transformScratch.y.resize(count);
+        transformScratch.z.resize(count);
+
+        for (size_t j = 0; j < count; ++j) {
+            DetectedPoint point;
+            memcpy(&point, points + j * sizeof(DetectedPoint), sizeof(DetectedPoint));
+            transformScratch.x[j] = point.x;
+            transformScratch.y[j] = point.y;
+            transformScratch.z[j] = point.z;
+        }
+
+        TransformPoints(extrinsic,
+                        transformScratch.x.data(),
+                        transformScratch.y.data(),
+                        transformScratch.z.data(),
+                        count);
+
+        for (size_t j = 0; j < count; ++j) {
+            const DetectedPoint point{
+                transformScratch.x[j], transformScratch.y[j], transformScratch.z[j]};
+            memcpy(points + j * sizeof(DetectedPoint), &point, sizeof(DetectedPoint));
+        }
+
+        iter += tlvHeader.length;
+    }
+}
+
+auto iwr1443::DataSerial::Consume(size_t size) noexcept -> void {
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(size));
+
+    while (!arrivalTimes.empty() && arrivalTimes.front().first <= size)
+        arrivalTimes.pop_front();
+    for (auto &arrival : arrivalTimes)
+        arrival.first -= size;
+}
+
+auto iwr1443::DataSerial::GetArrivalTime(size_t offset) const noexcept
+    -> std::chrono::steady_clock::time_point {
+    for (const auto &[end, time] : arrivalTimes) {
+        if (offset < end)
+            return time;
+    }
+
+    return arrivalTimes.empty() ? std::chrono::steady_clock::time_point()
+                                : arrivalTimes.back().second;
+}
+
+auto iwr1443::DataSerial::RecordLatency(const FrameTimestamps &timestamps) noexcept -> void {
+    const auto nanoseconds = [](auto from, auto to) -> uint64_t {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    };
+
+    if (timestamps.acquired != std::chrono::steady_clock::time_point())
+        transportLatency.Record(nanoseconds(timestamps.acquired, timestamps.magicWord));
+    assemblyLatency.Record(nanoseconds(timestamps.magicWord, timestamps.lastByte));
+    decodeLatency.Record(nanoseconds(timestamps.lastByte, timestamps.decoded));
+    serializeLatency.Record(nanoseconds(timestamps.decoded, timestamps.serialized));
+    writeLatency.Record(nanoseconds(timestamps.serialized, timestamps.handedOff));
+    endToEndLatency.Record(nanoseconds(timestamps.magicWord, timestamps.handedOff));
 }
@@ -1,11 +1,37 @@
 #pragma once
 
+#include "../LineReader.h"
 #include "../Serial.h"
+#include "ClutterFilter.h"
+#include "DeviceClock.h"
+#include "LinkBudget.h"
+#include "PointCloud.h"
+#include "ProcessingHeadroom.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
+#include <string>
+#include <thread>
 
 namespace iwr1443 {
 
+struct CommandResponse {
+    /// @brief
+    ///   Result of the command. std::errc::invalid_argument if the sensor rejected the command,
+    ///   std::errc::timed_out if the sensor did not respond in time and
+    ///   std::errc::operation_canceled if the serial is closed before the response arrived.
+    std::error_code error;
+
+    /// @brief
+    ///   Lines printed by the sensor for this command, excluding the command echo, status line
+    ///   and prompt. The rejection reason is the last line if the command failed.
+    std::vector<std::string> lines;
+};
+
 class ControlSerial final : public Serial {
 public:
     /// @brief
@@ -13,15 +39,18 @@ public:
     ControlSerial() noexcept;
 
     /// @brief
-    ///   Destroy this control serial.
+    ///   Destroy this control serial. Pending commands are canceled.
     ~ControlSerial() noexcept override;
 
     /// @brief
     ///   Initialize this control serial and connect to IWR1443 CLI port.
     ///
+    /// @param portName     The CLI port, such as COM4.
+    /// @param baudRate     Baud rate of the CLI port. The demo firmware uses 115200.
+    ///
     /// @return std::error_code
     ///   Return an error code that represents the connect result.
-    auto Initialize() noexcept -> std::error_code;
+    auto Initialize(std::string_view portName, uint32_t baudRate) noexcept -> std::error_code;
 
     /// @brief
     ///   Data receive callback.
@@ -29,8 +58,107 @@ public:
     /// @param[in] data     Pointer to start of data received from serial.
     /// @param     size     Size in byte of data transferred.
     auto OnRead(const void *data, size_t size) noexcept -> void override;
+
+    /// @brief
+    ///   Send a CLI command to the sensor. Responses are matched to commands in the order they are
+    ///   sent. A command is completed once the CLI reports its status and prints the prompt again.
+    ///
+    /// @param command  The CLI command to be sent, without line terminator.
+    /// @param timeout  Maximum time to wait for the response.
+    ///
+    /// @return std::future<CommandResponse>
+    ///   Return a future that becomes ready once the command is completed or timed out.
+    auto SendCommand(std::string_view          command,
+                     std::chrono::milliseconds timeout = std::chrono::milliseconds(2000))
+        -> std::future<CommandResponse>;
+
+    /// @brief
+    ///   CLI prompt of the IWR1443 mmWave demo. The prompt is not terminated by new line.
+    static constexpr const std::string_view Prompt = "mmwDemo:/>";
+
+private:
+    /// @brief
+    ///   Handle a complete line received from the CLI port.
+    auto OnLine(std::string_view line) noexcept -> void;
+
+    /// @brief
+    ///   Timeout thread entry. Completes commands that are not responded in time.
+    auto ExpireCommands(std::stop_token stopToken) -> void;
+
+private:
+    struct PendingCommand {
+        std::string                           command;
+        std::promise<CommandResponse>         promise;
+        std::chrono::steady_clock::time_point deadline;
+        CommandResponse                       response;
+        bool                                  echoed;
+        bool                                  responded;
+        bool                                  expired;
+    };
+
+    /// @brief
+    ///   Line assembler for data received from CLI port.
+    LineReader lineReader;
+
+    /// @brief
+    ///   Commands that have been sent but not completed, in sending order. Expired commands are
+    ///   kept until their late response arrives so that later responses are not mismatched.
+    std::deque<PendingCommand> pendingCommands;
+
+    /// @brief
+    ///   Number of commands sent. Timeout thread uses it to detect new deadlines.
+    uint64_t sentCommands;
+
+    /// @brief
+    ///   Mutex that is used to protect @p pendingCommands and @p sentCommands.
+    std::mutex pendingMutex;
+
+    /// @brief
+    ///   Condition variable that is used to wake up the timeout thread.
+    std::condition_variable_any pendingCondition;
+
+    /// @brief
+    ///   Timeout thread. Declared last so that it starts after other members.
+    std::jthread timeoutThread;
+};
+
+struct FrameTimestamps {
+    /// @brief
+    ///   Host time that the frame is acquired, mapped from device timestamp by DeviceClock.
+    std::chrono::steady_clock::time_point acquired;
+
+    /// @brief
+    ///   Completion time of the read operation that delivered the magic word.
+    std::chrono::steady_clock::time_point magicWord;
+
+    /// @brief
+    ///   Completion time of the read operation that delivered the last byte of the frame.
+    std::chrono::steady_clock::time_point lastByte;
+
+    /// @brief
+    ///   Time that the frame is decoded and frame listeners return.
+    std::chrono::steady_clock::time_point decoded;
+
+    /// @brief
+    ///   Time that the frame is serialized.
+    std::chrono::steady_clock::time_point serialized;
+
+    /// @brief
+    ///   Time that the serialized frame is handed off to the persistant writer and it returns.
+    std::chrono::steady_clock::time_point handedOff;
 };
 
+/// @brief
+///   Find the first frame magic word in the specified buffer.
+///
+/// @param[in] start    Start of the buffer.
+/// @param     size     Size in byte of the buffer.
+///
+/// @return const void *
+///   Return pointer to the magic word. Return nullptr if there is no complete frame header after
+///   the magic word in this buffer.
+auto LocateFrameHeader(const void *start, size_t size) noexcept -> const void *;
+
 class DataSerial final : public Serial {
 public:
     /// @brief
@@ -42,11 +170,14 @@ public:
     ~DataSerial() noexcept override;
 
     /// @brief
-    ///   Initialize this control serial and connect to IWR1443 data port.
+    ///   Initialize this data serial and connect to IWR1443 data port.
+    ///
+    /// @param portName     The data port, such as COM3.
+    /// @param baudRate     Baud rate of the data port. The demo firmware uses 921600.
     ///
     /// @return std::error_code
     ///   Return an error code that represents the connect result.
-    auto Initialize() noexcept -> std::error_code;
+    auto Initialize(std::string_view portName, uint32_t baudRate) noexcept -> std::error_code;
 
     /// @brief
     ///   Data receive callback.
@@ -61,23 +192,254 @@ public:
     /// @param writer   The data persistant writer function. The writer should not throw exception.
     auto SetPersistantWriter(std::function<void(const void *, size_t)> writer) noexcept -> void;
 
+    /// @brief
+    ///   Add a frame listener to this data serial. Listeners are called from IO thread with every
+    ///   complete frame before it is serialized. Add listeners before registering this serial to
+    ///   IOContext.
+    ///
+    /// @param listener     The frame listener. The frame is only valid during the call. The
+    ///                     listener should not throw exception.
+    auto AddFrameListener(std::function<void(const void *)> listener) noexcept -> void;
+
+    /// @brief
+    ///   Set transform from sensor coordinates to site coordinates. DetectedPoints of every frame
+    ///   are rewritten with this transform before frame listeners and the persistant writer see
+    ///   them. SphericalCoordinates, TargetList and SphericalCompressedPointCloud stay in sensor
+    ///   coordinates, so each serialized frame carries the transform as an "Extrinsic" row major
+    ///   4x4 matrix after its "Header". Frames have no "Extrinsic" if all TLVs are in sensor
+    ///   coordinates. Set before registering this serial to IOContext.
+    ///
+    /// @param transform    The extrinsic transform. Identity disables the rewrite.
+    auto SetExtrinsic(const RigidTransform &transform) noexcept -> void;
+
+    /// @brief
+    ///   Set static clutter filter of this data serial. Frames are filtered after the analyzers
+    ///   below account them as received, and before frame listeners and the persistant writer see
+    ///   them. Tagged points are serialized as "StaticPoints" indices of each frame. Set before
+    ///   registering this serial to IOContext.
+    ///
+    /// @param config   The filter configuration. ClutterAction::None disables the filter.
+    auto SetClutterFilter(const ClutterFilterConfig &config) noexcept -> void;
+
+    /// @brief
+    ///   Get link budget analyzer of this data serial. It is updated before frame listeners are
+    ///   called.
+    ///
+    /// @return const LinkBudget &
+    ///   Return the link budget analyzer.
+    auto GetLinkBudget() const noexcept -> const LinkBudget & {
+        return linkBudget;
+    }
+
+    /// @brief
+    ///   Get link budget analyzer of this data serial.
+    ///
+    /// @return LinkBudget &
+    ///   Return the link budget analyzer.
+    auto GetLinkBudget() noexcept -> LinkBudget & {
+        return linkBudget;
+    }
+
+    /// @brief
+    ///   Get device clock estimator of this data serial. It is updated before frame listeners are
+    ///   called.
+    ///
+    /// @return const DeviceClock &
+    ///   Return the device clock estimator.
+    auto GetDeviceClock() const noexcept -> const DeviceClock & {
+        return deviceClock;
+    }
+
+    /// @brief
+    ///   Get device clock estimator of this data serial.
+    ///
+    /// @return DeviceClock &
+    ///   Return the device clock estimator.
+    auto GetDeviceClock() noexcept -> DeviceClock & {
+        return deviceClock;
+    }
+
+    /// @brief
+    ///   Get processing headroom monitor of this data serial. It is updated before frame listeners
+    ///   are called.
+    ///
+    /// @return const ProcessingHeadroom &
+    ///   Return the processing headroom monitor.
+    auto GetProcessingHeadroom() const noexcept -> const ProcessingHeadroom & {
+        return processingHeadroom;
+    }
+
+    /// @brief
+    ///   Get processing headroom monitor of this data serial.
+    ///
+    /// @return ProcessingHeadroom &
+    ///   Return the processing headroom monitor.
+    auto GetProcessingHeadroom() noexcept -> ProcessingHeadroom & {
+        return processingHeadroom;
+    }
+
+    /// @brief
+    ///   Get static clutter filter of this data serial.
+    ///
+    /// @return const StaticClutterFilter &
+    ///   Return the static clutter filter.
+    auto GetClutterFilter() const noexcept -> const StaticClutterFilter & {
+        return clutterFilter;
+    }
+
+    /// @brief
+    ///   Get static clutter filter of this data serial.
+    ///
+    /// @return StaticClutterFilter &
+    ///   Return the static clutter filter.
+    auto GetClutterFilter() noexcept -> StaticClutterFilter & {
+        return clutterFilter;
+    }
+
+    /// @brief
+    ///   Get number of frames received by this data serial.
+    ///
+    /// @return uint64_t
+    ///   Return number of frames received.
+    auto GetFrameCount() const noexcept -> uint64_t {
+        return frameCount.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Validate, serialize the specified frame and notify frame listeners. This is called by
+    ///   OnRead for each complete frame. DetectedPoints are transformed in place if an extrinsic
+    ///   transform is set.
+    ///
+    /// @param[in,out] frame        Pointer to start of a complete frame.
+    /// @param         size         Number of readable bytes at frame.
+    /// @param[in,out] timestamps   Arrival timestamps of the frame. Processing timestamps are
+    ///                             filled in by this method.
+    ///
+    /// @return bool
+    ///   Return false if packet length or TLVs of the frame are invalid. The frame is skipped.
+    auto HandleFrame(void *frame, size_t size, FrameTimestamps &timestamps) noexcept -> bool;
+
 private:
     /// @brief
     ///   Persistant data using writer.
     auto Persistant(const void *data, size_t size) noexcept -> void;
 
     /// @brief
-    ///   Serialize the specified frame.
-    auto HandleFrame(const void *frame) noexcept -> void;
+    ///   Remove bytes from start of the buffer.
+    auto Consume(size_t size) noexcept -> void;
+
+    /// @brief
+    ///   Get completion time of the read operation that delivered the specified byte in buffer.
+    ///
+    /// @param offset   Offset of the byte in buffer.
+    auto GetArrivalTime(size_t offset) const noexcept -> std::chrono::steady_clock::time_point;
+
+    /// @brief
+    ///   Record stage latencies of a handled frame.
+    auto RecordLatency(const FrameTimestamps &timestamps) noexcept -> void;
+
+    /// @brief
+    ///   Transform DetectedPoints of a complete and validated frame in place with the extrinsic
+    ///   transform.
+    ///
+    /// @param[in,out] frame    Pointer to start of the frame.
+    auto TransformDetectedPoints(void *frame) noexcept -> void;
 
 private:
     /// @brief
     ///   Data buffer that is used to temporary store received binary data.
     std::vector<std::byte> buffer;
 
+    /// @brief
+    ///   End offset in buffer and completion time of each read operation that delivered bytes
+    ///   still in buffer.
+    std::deque<std::pair<size_t, std::chrono::steady_clock::time_point>> arrivalTimes;
+
     /// @brief
     ///   Data persistant writer.
     std::function<void(const void *, size_t)> persistantWriter;
+
+    /// @brief
+    ///   Frame listeners.
+    std::vector<std::function<void(const void *)>> frameListeners;
+
+    /// @brief
+    ///   Transform from sensor coordinates to site coordinates.
+    RigidTransform extrinsic;
+
+    /// @brief
+    ///   Whether DetectedPoints are transformed. False if the extrinsic transform is identity.
+    bool hasExtrinsic;
+
+    /// @brief
+    ///   "Extrinsic" field serialized into each frame. Empty if the extrinsic transform is
+    ///   identity.
+    std::string extrinsicField;
+
+    /// @brief
+    ///   Coordinates gathered from DetectedPoints for transform. Reused to avoid allocations.
+    PointCloud transformScratch;
+
+    /// @brief
+    ///   Link budget analyzer of this data serial.
+    LinkBudget linkBudget;
+
+    /// @brief
+    ///   Device clock estimator of this data serial.
+    DeviceClock deviceClock;
+
+    /// @brief
+    ///   Processing headroom monitor of this data serial.
+    ProcessingHeadroom processingHeadroom;
+
+    /// @brief
+    ///   Static clutter filter of this data serial.
+    StaticClutterFilter clutterFilter;
+
+    /// @brief
+    ///   Whether frames are filtered. False if the clutter action is None.
+    bool hasClutterFilter;
+
+    /// @brief
+    ///   Number of frames received.
+    std::atomic<uint64_t> frameCount;
+
+    /// @brief
+    ///   Number of frames received.
+    MetricCounter frameCounter;
+
+    /// @brief
+    ///   Size in byte of received frames.
+    MetricHistogram frameSizeHistogram;
+
+    /// @brief
+    ///   Nanoseconds from frame acquisition to magic word arrival, above the minimum transport
+    ///   delay.
+    MetricHistogram transportLatency;
+
+    /// @brief
+    ///   Nanoseconds from magic word arrival to last byte arrival.
+    MetricHistogram assemblyLatency;
+
+    /// @brief
+    ///   Nanoseconds from last byte arrival to decode finish.
+    MetricHistogram decodeLatency;
+
+    /// @brief
+    ///   Nanoseconds from decode finish to serialization finish.
+    MetricHistogram serializeLatency;
+
+    /// @brief
+    ///   Nanoseconds from serialization finish to write hand-off.
+    MetricHistogram writeLatency;
+
+    /// @brief
+    ///   Nanoseconds from magic word arrival to write hand-off.
+    MetricHistogram endToEndLatency;
+
+    /// @brief
+    ///   Number of bytes serialized to the persistant writer.
+    MetricCounter serializedBytesCounter;
 };
 
 } // namespace iwr1443
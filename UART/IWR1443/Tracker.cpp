@@ -0,0 +1,524 @@
+#include "Tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <numeric>
+
+using namespace iwr1443;
+
+// Cost of pairs outside the gate. Larger than any gated cost, and finite so that potentials stay
+// finite.
+static constexpr const float FORBIDDEN_COST = 1e6f;
+
+// Weight of the latest frame in track quality.
+static constexpr const float QUALITY_WEIGHT = 0.2f;
+
+// Marks an unassigned track or cluster.
+static constexpr const int32_t UNASSIGNED = -1;
+
+iwr1443::TargetTracker::TargetTracker(const TrackerConfig &config) noexcept
+    : config(config),
+      axes(),
+      trackIDs(),
+      trackHits(),
+      trackMisses(),
+      trackQuality(),
+      trackClusters(),
+      clusterAssignments(),
+      limitedClusters(),
+      limitedIndices(),
+      rowTracks(),
+      columnClusters(),
+      pairCosts(),
+      costs(),
+      rowPotentials(),
+      columnPotentials(),
+      columnRows(),
+      previousColumns(),
+      slacks(),
+      usedColumns(),
+      targets(),
+      clusterTracks(),
+      lastTime(),
+      nextTrackID(0),
+      frames(0),
+      tracksCreated(0),
+      tracksDeleted(0),
+      droppedClusters(0) {}
+
+iwr1443::TargetTracker::~TargetTracker() noexcept {}
+
+auto iwr1443::TargetTracker::DefaultConfig() noexcept -> TrackerConfig {
+    TrackerConfig config{};
+    config.model                       = MotionModel::ConstantVelocity;
+    config.processNoise                = 2.0f;
+    config.measurementNoise            = 0.04f;
+    config.initialVelocityVariance     = 4.0f;
+    config.initialAccelerationVariance = 4.0f;
+    config.gate                        = 16.0f;
+    config.confirmHits                 = 3;
+    config.maxMisses                   = 5;
+    config.maxTracks                   = 256;
+    config.maxTimeStep                 = std::chrono::milliseconds(500);
+    return config;
+}
+
+auto iwr1443::TargetTracker::Update(std::chrono::steady_clock::time_point time,
+                                    const std::vector<ClusterSummary>    &clusters) -> void {
+    if (frames != 0) {
+        const auto elapsed = std::clamp<std::chrono::steady_clock::duration>(
+            time - lastTime, std::chrono::steady_clock::duration::zero(), config.maxTimeStep);
+        Predict(std::chrono::duration<float>(elapsed).count());
+    } else {
+        Predict(0);
+    }
+
+    lastTime = time;
+    ++frames;
+
+    const std::vector<ClusterSummary> &tracked = LimitClusters(clusters);
+    const bool                         limited = &tracked != &clusters;
+
+    Assign(tracked);
+    Correct();
+    ManageTracks(tracked);
+
+    targets.clear();
+    clusterTracks.assign(clusters.size(), UNASSIGNED);
+    for (size_t i = 0; i < trackIDs.size(); ++i) {
+        if (trackHits[i] < config.confirmHits)
+            continue;
+
+        Tracked3DTarget target{};
+        target.trackID        = static_cast<float>(trackIDs[i]);
+        target.position.x     = axes[0].position[i];
+        target.position.y     = axes[1].position[i];
+        target.position.z     = axes[2].position[i];
+        target.velocity.x     = axes[0].velocity[i];
+        target.velocity.y     = axes[1].velocity[i];
+        target.velocity.z     = axes[2].velocity[i];
+        target.acceleration.x = axes[0].acceleration[i];
+        target.acceleration.y = axes[1].acceleration[i];
+        target.acceleration.z = axes[2].acceleration[i];
+        for (size_t axis = 0; axis < 3; ++axis)
+            target.errorCovariance[axis][axis] = axes[axis].pp[i];
+        target.gatingFunctionGain = config.gate;
+        target.confidenceLevel    = trackQuality[i];
+        targets.push_back(target);
+
+        if (trackClusters[i] != UNASSIGNED) {
+            size_t cluster = static_cast<size_t>(trackClusters[i]);
+            if (limited)
+                cluster = limitedIndices[cluster];
+            clusterTracks[cluster] = static_cast<int32_t>(trackIDs[i]);
+        }
+    }
+}
+
+auto iwr1443::TargetTracker::GetReport() const noexcept -> TrackerReport {
+    TrackerReport report{};
+    report.frames          = frames;
+    report.tracksCreated   = tracksCreated;
+    report.tracksDeleted   = tracksDeleted;
+    report.activeTracks    = trackIDs.size();
+    report.confirmedTracks = targets.size();
+    report.droppedClusters = droppedClusters;
+    return report;
+}
+
+auto iwr1443::TargetTracker::Serialize(uint32_t frameNumber, std::string &output) const -> void {
+    std::format_to(std::back_inserter(output), "{{\"Frame\": {}, \"Targets\": [", frameNumber);
+
+    for (size_t i = 0; i < targets.size(); ++i)
+        std::format_to(std::back_inserter(output), "{}{}", i == 0 ? "" : ", ", targets[i]);
+
+    output.append("]}, ");
+}
+
+auto iwr1443::TargetTracker::Predict(float timeStep) noexcept -> void {
+    const float dt  = timeStep;
+    const float dt2 = dt * dt;
+    const float dt3 = dt2 * dt;
+    const float h   = dt2 * 0.5f;
+    const float q   = config.processNoise;
+    const float r   = config.measurementNoise;
+
+    // Discrete white noise of acceleration (constant velocity) or jerk (constant acceleration).
+    // Acceleration terms stay zero for the constant velocity model.
+    float qpp, qpv, qpa, qvv, qva, qaa;
+    if (config.model == MotionModel::ConstantVelocity) {
+        qpp = q * dt3 / 3;
+        qpv = q * dt2 / 2;
+        qpa = 0;
+        qvv = q * dt;
+        qva = 0;
+        qaa = 0;
+    } else {
+        qpp = q * dt3 * dt2 / 20;
+        qpv = q * dt2 * dt2 / 8;
+        qpa = q * dt3 / 6;
+        qvv = q * dt3 / 3;
+        qva = q * dt2 / 2;
+        qaa = q * dt;
+    }
+
+    const size_t count = trackIDs.size();
+    for (auto &axis : axes) {
+        float *position     = axis.position.data();
+        float *velocity     = axis.velocity.data();
+        float *acceleration = axis.acceleration.data();
+        float *pp           = axis.pp.data();
+        float *pv           = axis.pv.data();
+        float *pa           = axis.pa.data();
+        float *vv           = axis.vv.data();
+        float *va           = axis.va.data();
+        float *aa           = axis.aa.data();
+        float *inverse      = axis.inverseInnovation.data();
+
+        // x = F x and P = F P F' + Q with F = [1 dt dt^2/2; 0 1 dt; 0 0 1], expanded per entry so
+        // that the loop runs over columns.
+        for (size_t i = 0; i < count; ++i) {
+            position[i] += dt * velocity[i] + h * acceleration[i];
+            velocity[i] += dt * acceleration[i];
+
+            const float a = pp[i];
+            const float b = pv[i];
+            const float c = pa[i];
+            const float d = vv[i];
+            const float e = va[i];
+            const float f = aa[i];
+
+            const float r00 = a + dt * b + h * c;
+            const float r01 = b + dt * d + h * e;
+            const float r02 = c + dt * e + h * f;
+            const float r11 = d + dt * e;
+            const float r12 = e + dt * f;
+
+            pp[i]      = r00 + dt * r01 + h * r02 + qpp;
+            pv[i]      = r01 + dt * r02 + qpv;
+            pa[i]      = r02 + qpa;
+            vv[i]      = r11 + dt * r12 + qvv;
+            va[i]      = r12 + qva;
+            aa[i]      = f + qaa;
+            inverse[i] = 1.0f / (pp[i] + r);
+        }
+    }
+}
+
+auto iwr1443::TargetTracker::LimitClusters(const std::vector<ClusterSummary> &clusters)
+    -> const std::vector<ClusterSummary> & {
+    if (clusters.size() <= config.maxTracks)
+        return clusters;
+
+    // Ties are broken by index so that the choice does not depend on the standard library.
+    limitedIndices.resize(clusters.size());
+    std::iota(limitedIndices.begin(), limitedIndices.end(), 0U);
+    std::nth_element(limitedIndices.begin(),
+                     limitedIndices.begin() + config.maxTracks,
+                     limitedIndices.end(),
+                     [&clusters](uint32_t a, uint32_t b) -> bool {
+                         if (clusters[a].pointCount != clusters[b].pointCount)
+                             return clusters[a].pointCount > clusters[b].pointCount;
+                         return a < b;
+                     });
+
+    limitedIndices.resize(config.maxTracks);
+    std::sort(limitedIndices.begin(), limitedIndices.end());
+
+    limitedClusters.clear();
+    for (uint32_t index : limitedIndices)
+        limitedClusters.push_back(clusters[index]);
+
+    droppedClusters += clusters.size() - config.maxTracks;
+    return limitedClusters;
+}
+
+auto iwr1443::TargetTracker::Assign(const std::vector<ClusterSummary> &clusters) -> void {
+    const size_t trackCount   = trackIDs.size();
+    const size_t clusterCount = clusters.size();
+
+    trackClusters.assign(trackCount, UNASSIGNED);
+    clusterAssignments.assign(clusterCount, 0);
+    if (trackCount == 0 || clusterCount == 0) {
+        clusterAssignments.assign(clusterCount, UNASSIGNED);
+        return;
+    }
+
+    const float *px = axes[0].position.data();
+    const float *py = axes[1].position.data();
+    const float *pz = axes[2].position.data();
+    const float *ix = axes[0].inverseInnovation.data();
+    const float *iy = axes[1].inverseInnovation.data();
+    const float *iz = axes[2].inverseInnovation.data();
+
+    // Squared Mahalanobis distance of every pair. Rows and columns are then limited to tracks and
+    // clusters with at least one pair inside the gate, since others are trivially unassigned.
+    // clusterAssignments counts gated tracks of each cluster meanwhile.
+    rowTracks.clear();
+    columnClusters.clear();
+    pairCosts.resize(trackCount * clusterCount);
+    for (size_t i = 0; i < trackCount; ++i) {
+        float *row = pairCosts.data() + i * clusterCount;
+        for (size_t j = 0; j < clusterCount; ++j) {
+            const float dx = clusters[j].x - px[i];
+            const float dy = clusters[j].y - py[i];
+            const float dz = clusters[j].z - pz[i];
+            row[j]         = dx * dx * ix[i] + dy * dy * iy[i] + dz * dz * iz[i];
+        }
+
+        bool gated = false;
+        for (size_t j = 0; j < clusterCount; ++j) {
+            if (row[j] <= config.gate) {
+                gated = true;
+                ++clusterAssignments[j];
+            }
+        }
+
+        if (gated)
+            rowTracks.push_back(static_cast<uint32_t>(i));
+    }
+
+    for (size_t j = 0; j < clusterCount; ++j) {
+        if (clusterAssignments[j] != 0)
+            columnClusters.push_back(static_cast<uint32_t>(j));
+        clusterAssignments[j] = UNASSIGNED;
+    }
+
+    const size_t rows = rowTracks.size();
+    if (rows == 0)
+        return;
+
+    // Each row may also take its own miss column at the cost of the gate, so a pair outside the
+    // gate is never better than leaving both unassigned, and every row has a solution.
+    const size_t gatedColumns = columnClusters.size();
+    const size_t columns      = gatedColumns + rows;
+    costs.resize(rows * columns);
+    for (size_t row = 0; row < rows; ++row) {
+        const float *source = pairCosts.data() + static_cast<size_t>(rowTracks[row]) * clusterCount;
+        float       *target = costs.data() + row * columns;
+        for (size_t column = 0; column < gatedColumns; ++column) {
+            const float cost = source[columnClusters[column]];
+            target[column]   = cost <= config.gate ? cost : FORBIDDEN_COST;
+        }
+
+        std::fill(target + gatedColumns, target + columns, FORBIDDEN_COST);
+        target[gatedColumns + row] = config.gate;
+    }
+
+    SolveAssignment(rows, columns);
+
+    for (size_t column = 0; column < gatedColumns; ++column) {
+        const uint32_t row = columnRows[column + 1];
+        if (row == 0)
+            continue;
+
+        const uint32_t track   = rowTracks[row - 1];
+        const uint32_t cluster = columnClusters[column];
+        if (costs[(row - 1) * columns + column] >= FORBIDDEN_COST)
+            continue;
+
+        trackClusters[track]        = static_cast<int32_t>(cluster);
+        clusterAssignments[cluster] = static_cast<int32_t>(track);
+        axes[0].measurement[track]  = clusters[cluster].x;
+        axes[1].measurement[track]  = clusters[cluster].y;
+        axes[2].measurement[track]  = clusters[cluster].z;
+    }
+}
+
+auto iwr1443::TargetTracker::SolveAssignment(size_t rows, size_t columns) -> void {
+    // Shortest augmenting path formulation with 1-based rows and columns. Column 0 is a virtual
+    // column that holds the row being inserted.
+    constexpr const float infinity = std::numeric_limits<float>::infinity();
+
+    rowPotentials.assign(rows + 1, 0);
+    columnPotentials.assign(columns + 1, 0);
+    columnRows.assign(columns + 1, 0);
+    previousColumns.assign(columns + 1, 0);
+
+    for (size_t row = 1; row <= rows; ++row) {
+        columnRows[0]  = static_cast<uint32_t>(row);
+        size_t column0 = 0;
+
+        slacks.assign(columns + 1, infinity);
+        usedColumns.assign(columns + 1, 0);
+
+        do {
+            usedColumns[column0] = 1;
+
+            const size_t row0    = columnRows[column0];
+            const float *cost    = costs.data() + (row0 - 1) * columns;
+            float        delta   = infinity;
+            size_t       column1 = 0;
+            for (size_t column = 1; column <= columns; ++column) {
+                if (usedColumns[column] != 0)
+                    continue;
+
+                const float reduced =
+                    cost[column - 1] - rowPotentials[row0] - columnPotentials[column];
+                if (reduced < slacks[column]) {
+                    slacks[column]          = reduced;
+                    previousColumns[column] = static_cast<uint32_t>(column0);
+                }
+
+                if (slacks[column] < delta) {
+                    delta   = slacks[column];
+                    column1 = column;
+                }
+            }
+
+            for (size_t column = 0; column <= columns; ++column) {
+                if (usedColumns[column] != 0) {
+                    rowPotentials[columnRows[column]] += delta;
+                    columnPotentials[column]          -= delta;
+                } else {
+                    slacks[column] -= delta;
+                }
+            }
+
+            column0 = column1;
+        } while (columnRows[column0] != 0);
+
+        // Flip the augmenting path.
+        do {
+            const size_t column1 = previousColumns[column0];
+            columnRows[column0]  = columnRows[column1];
+            column0              = column1;
+        } while (column0 != 0);
+    }
+}
+
+auto iwr1443::TargetTracker::Correct() noexcept -> void {
+    const size_t   count    = trackIDs.size();
+    const int32_t *assigned = trackClusters.data();
+
+    for (auto &axis : axes) {
+        float       *position     = axis.position.data();
+        float       *velocity     = axis.velocity.data();
+        float       *acceleration = axis.acceleration.data();
+        float       *pp           = axis.pp.data();
+        float       *pv           = axis.pv.data();
+        float       *pa           = axis.pa.data();
+        float       *vv           = axis.vv.data();
+        float       *va           = axis.va.data();
+        float       *aa           = axis.aa.data();
+        const float *inverse      = axis.inverseInnovation.data();
+        const float *measurement  = axis.measurement.data();
+
+        // Measurement matrix is [1 0 0]. Gains of unassigned tracks are masked to zero, so that
+        // the loop has no branches.
+        for (size_t i = 0; i < count; ++i) {
+            const float mask       = assigned[i] != UNASSIGNED ? 1.0f : 0.0f;
+            const float innovation = mask * (measurement[i] - position[i]);
+            const float scale      = mask * inverse[i];
+
+            const float a = pp[i];
+            const float b = pv[i];
+            const float c = pa[i];
+
+            position[i]     += a * inverse[i] * innovation;
+            velocity[i]     += b * inverse[i] * innovation;
+            acceleration[i] += c * inverse[i] * innovation;
+
+            pp[i] = a - a * a * scale;
+            pv[i] = b - a * b * scale;
+            pa[i] = c - a * c * scale;
+            vv[i] = vv[i] - b * b * scale;
+            va[i] = va[i] - b * c * scale;
+            aa[i] = aa[i] - c * c * scale;
+        }
+    }
+}
+
+auto iwr1443::TargetTracker::ManageTracks(const std::vector<ClusterSummary> &clusters) -> void {
+    // Iterate backwards so that removing a track only moves tracks that are already updated.
+    for (size_t i = trackIDs.size(); i-- > 0;) {
+        const bool hit  = trackClusters[i] != UNASSIGNED;
+        trackQuality[i] += QUALITY_WEIGHT * ((hit ? 1.0f : 0.0f) - trackQuality[i]);
+        if (hit) {
+            ++trackHits[i];
+            trackMisses[i] = 0;
+            continue;
+        }
+
+        ++trackMisses[i];
+        const bool confirmed = trackHits[i] >= config.confirmHits;
+        if (!confirmed || trackMisses[i] > config.maxMisses) {
+            // The cluster of the moved track follows it.
+            const size_t last = trackIDs.size() - 1;
+            if (trackClusters[last] != UNASSIGNED)
+                clusterAssignments[static_cast<size_t>(trackClusters[last])] =
+                    static_cast<int32_t>(i);
+
+            RemoveTrack(i);
+            ++tracksDeleted;
+        }
+    }
+
+    const float velocityVariance     = config.initialVelocityVariance;
+    const float accelerationVariance = config.model == MotionModel::ConstantAcceleration
+                                           ? config.initialAccelerationVariance
+                                           : 0.0f;
+
+    for (size_t j = 0; j < clusters.size(); ++j) {
+        if (clusterAssignments[j] != UNASSIGNED)
+            continue;
+
+        if (trackIDs.size() >= config.maxTracks) {
+            ++droppedClusters;
+            continue;
+        }
+
+        const float position[3]{clusters[j].x, clusters[j].y, clusters[j].z};
+        for (size_t axis = 0; axis < 3; ++axis) {
+            TrackAxis &state = axes[axis];
+            state.position.push_back(position[axis]);
+            state.velocity.push_back(0);
+            state.acceleration.push_back(0);
+            state.pp.push_back(config.measurementNoise);
+            state.pv.push_back(0);
+            state.pa.push_back(0);
+            state.vv.push_back(velocityVariance);
+            state.va.push_back(0);
+            state.aa.push_back(accelerationVariance);
+            state.inverseInnovation.push_back(0);
+            state.measurement.push_back(0);
+        }
+
+        clusterAssignments[j] = static_cast<int32_t>(trackIDs.size());
+        trackIDs.push_back(nextTrackID++);
+        trackHits.push_back(1);
+        trackMisses.push_back(0);
+        trackQuality.push_back(QUALITY_WEIGHT);
+        trackClusters.push_back(static_cast<int32_t>(j));
+        ++tracksCreated;
+    }
+}
+
+auto iwr1443::TargetTracker::RemoveTrack(size_t track) noexcept -> void {
+    const auto remove = [track](auto &column) -> void {
+        column[track] = column.back();
+        column.pop_back();
+    };
+
+    for (auto &axis : axes) {
+        remove(axis.position);
+        remove(axis.velocity);
+        remove(axis.acceleration);
+        remove(axis.pp);
+        remove(axis.pv);
+        remove(axis.pa);
+        remove(axis.vv);
+        remove(axis.va);
+        remove(axis.aa);
+        remove(axis.inverseInnovation);
+        remove(axis.measurement);
+    }
+
+    remove(trackIDs);
+    remove(trackHits);
+    remove(trackMisses);
+    remove(trackQuality);
+    remove(trackClusters);
+}
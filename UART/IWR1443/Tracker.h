@@ -0,0 +1,329 @@
+#pragma once
+
+#include "Clustering.h"
+#include "Data.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace iwr1443 {
+
+enum class MotionModel {
+    ConstantVelocity     = 0,
+    ConstantAcceleration = 1,
+};
+
+struct TrackerConfig {
+    /// @brief
+    ///   Motion model of tracks.
+    MotionModel model;
+
+    /// @brief
+    ///   Spectral density of the white noise that drives the model, acceleration for constant
+    ///   velocity and jerk for constant acceleration, in m^2/s^3 and m^2/s^5.
+    float processNoise;
+
+    /// @brief
+    ///   Variance of cluster centroids along each axis in m^2.
+    float measurementNoise;
+
+    /// @brief
+    ///   Variance of velocity of new tracks along each axis in (m/s)^2.
+    float initialVelocityVariance;
+
+    /// @brief
+    ///   Variance of acceleration of new tracks along each axis in (m/s^2)^2. Ignored by the
+    ///   constant velocity model.
+    float initialAccelerationVariance;
+
+    /// @brief
+    ///   Maximum squared Mahalanobis distance of a cluster assigned to a track.
+    float gate;
+
+    /// @brief
+    ///   Number of assigned frames for a new track to be reported.
+    uint32_t confirmHits;
+
+    /// @brief
+    ///   Number of consecutive frames without a cluster for a reported track to be deleted. New
+    ///   tracks are deleted on the first miss.
+    uint32_t maxMisses;
+
+    /// @brief
+    ///   Maximum number of tracks. Clusters are not tracked once this is reached. Only the clusters
+    ///   with the most points, up to this number, take part in each update, so that the time of an
+    ///   update is bounded no matter how many clusters a frame has.
+    uint32_t maxTracks;
+
+    /// @brief
+    ///   Maximum time step of a prediction. Longer gaps between frames are predicted over this step
+    ///   only, so that tracks are not thrown far away after a stall.
+    std::chrono::milliseconds maxTimeStep;
+};
+
+struct TrackerReport {
+    /// @brief
+    ///   Number of frames updated.
+    uint64_t frames;
+
+    /// @brief
+    ///   Number of tracks created.
+    uint64_t tracksCreated;
+
+    /// @brief
+    ///   Number of tracks deleted.
+    uint64_t tracksDeleted;
+
+    /// @brief
+    ///   Number of current tracks, including unconfirmed ones.
+    size_t activeTracks;
+
+    /// @brief
+    ///   Number of current confirmed tracks.
+    size_t confirmedTracks;
+
+    /// @brief
+    ///   Number of clusters skipped because the track or cluster limit is reached.
+    uint64_t droppedClusters;
+};
+
+/// @brief
+///   Multi-target tracker over cluster centroids in site coordinates. Each track is a Kalman filter
+///   with constant velocity or constant acceleration model. Clusters are gated by Mahalanobis
+///   distance and assigned to tracks with the Hungarian method. Centroids are measured in
+///   cartesian coordinates and axes are modelled independently, so every axis has its own 3x3
+///   covariance and the filter math runs over columns of all tracks at once.
+class TargetTracker {
+public:
+    /// @brief
+    ///   Create a tracker with the specified config.
+    ///
+    /// @param config   Motion model, noise, gating and track management parameters.
+    explicit TargetTracker(const TrackerConfig &config) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    TargetTracker(const TargetTracker &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const TargetTracker &) = delete;
+
+    /// @brief
+    ///   Destroy this tracker.
+    ~TargetTracker() noexcept;
+
+    /// @brief
+    ///   Get default configuration. Suits walking people seen by the demo firmware.
+    static auto DefaultConfig() noexcept -> TrackerConfig;
+
+    /// @brief
+    ///   Predict all tracks to the specified time and update them with clusters of a frame.
+    ///
+    /// @param time         Acquisition time of the frame. Must not go backwards.
+    /// @param clusters     Clusters of the frame in site coordinates.
+    auto Update(std::chrono::steady_clock::time_point time,
+                const std::vector<ClusterSummary>    &clusters) -> void;
+
+    /// @brief
+    ///   Get confirmed tracks after the last update.
+    ///
+    /// @return const std::vector<Tracked3DTarget> &
+    ///   Return confirmed tracks in the layout of TargetList TLVs. The error covariance is that of
+    ///   position.
+    auto GetTargets() const noexcept -> const std::vector<Tracked3DTarget> & {
+        return targets;
+    }
+
+    /// @brief
+    ///   Get track of each cluster of the last update.
+    ///
+    /// @return const std::vector<int32_t> &
+    ///   Return track ID of each cluster, or -1 if the cluster is not assigned to a confirmed
+    ///   track.
+    auto GetClusterTracks() const noexcept -> const std::vector<int32_t> & {
+        return clusterTracks;
+    }
+
+    /// @brief
+    ///   Get tracker statistics.
+    ///
+    /// @return TrackerReport
+    ///   Return a snapshot of tracker statistics.
+    auto GetReport() const noexcept -> TrackerReport;
+
+    /// @brief
+    ///   Serialize confirmed tracks of the last update as a JSON object followed by a comma, like
+    ///   frames of DataSerial.
+    ///
+    /// @param      frameNumber     Frame number of the last update.
+    /// @param[out] output          The JSON is appended to this string.
+    auto Serialize(uint32_t frameNumber, std::string &output) const -> void;
+
+private:
+    /// @brief
+    ///   Kalman filter state of one axis of all tracks, one column per state and covariance entry.
+    struct TrackAxis {
+        /// @brief
+        ///   Position, velocity and acceleration.
+        std::vector<float> position;
+        std::vector<float> velocity;
+        std::vector<float> acceleration;
+
+        /// @brief
+        ///   Upper triangle of the symmetric covariance of position, velocity and acceleration.
+        std::vector<float> pp;
+        std::vector<float> pv;
+        std::vector<float> pa;
+        std::vector<float> vv;
+        std::vector<float> va;
+        std::vector<float> aa;
+
+        /// @brief
+        ///   Reciprocal of the innovation variance of the predicted state.
+        std::vector<float> inverseInnovation;
+
+        /// @brief
+        ///   Assigned cluster centroid of this update.
+        std::vector<float> measurement;
+    };
+
+    /// @brief
+    ///   Predict all tracks forward in time.
+    ///
+    /// @param timeStep     Seconds since the last update.
+    auto Predict(float timeStep) noexcept -> void;
+
+    /// @brief
+    ///   Keep the clusters with the most points if a frame has more than maxTracks clusters.
+    ///
+    /// @param clusters     Clusters of the frame.
+    ///
+    /// @return const std::vector<ClusterSummary> &
+    ///   Return @p clusters if it is within the limit, otherwise limitedClusters.
+    auto LimitClusters(const std::vector<ClusterSummary> &clusters)
+        -> const std::vector<ClusterSummary> &;
+
+    /// @brief
+    ///   Gate clusters and assign them to tracks. Fills trackClusters and the measurement columns.
+    ///
+    /// @param clusters     Clusters of the frame.
+    auto Assign(const std::vector<ClusterSummary> &clusters) -> void;
+
+    /// @brief
+    ///   Solve the rectangular assignment problem in costs with the Hungarian method. Runs in
+    ///   O(rows^2 * columns) time.
+    ///
+    /// @param rows     Number of rows. Must not exceed number of columns.
+    /// @param columns  Number of columns.
+    auto SolveAssignment(size_t rows, size_t columns) -> void;
+
+    /// @brief
+    ///   Correct assigned tracks with their measurements.
+    auto Correct() noexcept -> void;
+
+    /// @brief
+    ///   Update hit and miss counts, delete lost tracks and start tracks from unassigned clusters.
+    ///
+    /// @param clusters     Clusters of the frame.
+    auto ManageTracks(const std::vector<ClusterSummary> &clusters) -> void;
+
+    /// @brief
+    ///   Remove a track by moving the last track into its place.
+    ///
+    /// @param track    Index of the track.
+    auto RemoveTrack(size_t track) noexcept -> void;
+
+private:
+    /// @brief
+    ///   Motion model, noise, gating and track management parameters.
+    TrackerConfig config;
+
+    /// @brief
+    ///   Filter state of x, y and z axes.
+    std::array<TrackAxis, 3> axes;
+
+    /// @brief
+    ///   ID of each track.
+    std::vector<uint32_t> trackIDs;
+
+    /// @brief
+    ///   Number of frames that each track has been assigned a cluster.
+    std::vector<uint32_t> trackHits;
+
+    /// @brief
+    ///   Number of consecutive frames that each track has not been assigned a cluster.
+    std::vector<uint32_t> trackMisses;
+
+    /// @brief
+    ///   Recent ratio of assigned frames of each track.
+    std::vector<float> trackQuality;
+
+    /// @brief
+    ///   Index of the cluster assigned to each track in this update, or -1.
+    std::vector<int32_t> trackClusters;
+
+    /// @brief
+    ///   Index of the track assigned to each cluster in this update, or -1.
+    std::vector<int32_t> clusterAssignments;
+
+    /// @brief
+    ///   Clusters of the frame that take part in the update if the frame exceeds the cluster limit,
+    ///   in frame order, and the index of each in the frame.
+    std::vector<ClusterSummary> limitedClusters;
+    std::vector<uint32_t>       limitedIndices;
+
+    /// @brief
+    ///   Tracks that have a cluster inside their gate, as rows of the assignment problem.
+    std::vector<uint32_t> rowTracks;
+
+    /// @brief
+    ///   Clusters inside the gate of a track, as columns of the assignment problem.
+    std::vector<uint32_t> columnClusters;
+
+    /// @brief
+    ///   Row major squared Mahalanobis distance of every track and cluster pair.
+    std::vector<float> pairCosts;
+
+    /// @brief
+    ///   Row major costs of the assignment problem. Each row ends with one miss column per row.
+    std::vector<float> costs;
+
+    /// @brief
+    ///   Buffers of the Hungarian method: row and column potentials, row of each column, previous
+    ///   column on the augmenting path, slack of each column and visited columns.
+    std::vector<float>    rowPotentials;
+    std::vector<float>    columnPotentials;
+    std::vector<uint32_t> columnRows;
+    std::vector<uint32_t> previousColumns;
+    std::vector<float>    slacks;
+    std::vector<uint8_t>  usedColumns;
+
+    /// @brief
+    ///   Confirmed tracks of the last update.
+    std::vector<Tracked3DTarget> targets;
+
+    /// @brief
+    ///   Track ID of each cluster of the last update, or -1.
+    std::vector<int32_t> clusterTracks;
+
+    /// @brief
+    ///   Acquisition time of the last update.
+    std::chrono::steady_clock::time_point lastTime;
+
+    /// @brief
+    ///   ID of the next track.
+    uint32_t nextTrackID;
+
+    /// @brief
+    ///   Statistics.
+    uint64_t frames;
+    uint64_t tracksCreated;
+    uint64_t tracksDeleted;
+    uint64_t droppedClusters;
+};
+
+} // namespace iwr1443
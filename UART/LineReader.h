@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+class LineReader {
+public:
+    /// @brief
+    ///   Create an empty line reader.
+    ///
+    /// @param maxLineSize  Lines longer than this are split into multiple lines.
+    explicit LineReader(size_t maxLineSize = 4096) noexcept
+        : buffer(), lineStart(0), scanOffset(0), maxLineSize(maxLineSize) {}
+
+    /// @brief
+    ///   Append data to this reader and call @p handler for each complete line. Every byte is
+    ///   scanned for new line only once, no matter how many chunks a line is split into.
+    ///
+    /// @tparam Handler     Type of the line handler.
+    /// @param[in] data     Pointer to start of data received.
+    /// @param     size     Size in byte of data received.
+    /// @param     handler  The line handler that is called with each line. Line terminators are
+    ///                     not included. The line is only valid during the call.
+    template <typename Handler>
+    auto Feed(const void *data, size_t size, Handler &&handler) -> void {
+        buffer.append(static_cast<const char *>(data), size);
+
+        for (;;) {
+            const char *scanStart = buffer.data() + scanOffset;
+            const char *newLine   = static_cast<const char *>(
+                std::memchr(scanStart, '\n', buffer.size() - scanOffset));
+
+            if (newLine == nullptr) {
+                if (buffer.size() - lineStart < maxLineSize) {
+                    scanOffset = buffer.size();
+                    break;
+                }
+
+                // Line too long. Split it.
+                newLine = buffer.data() + lineStart + maxLineSize;
+            }
+
+            const size_t     lineEnd = static_cast<size_t>(newLine - buffer.data());
+            std::string_view line(buffer.data() + lineStart, lineEnd - lineStart);
+            if (line.ends_with('\r'))
+                line.remove_suffix(1);
+
+            handler(line);
+
+            lineStart  = (lineEnd < buffer.size() && *newLine == '\n') ? lineEnd + 1 : lineEnd;
+            scanOffset = lineStart;
+        }
+
+        // Drop consumed lines.
+        if (lineStart != 0) {
+            buffer.erase(0, lineStart);
+            scanOffset -= lineStart;
+            lineStart = 0;
+        }
+    }
+
+    /// @brief
+    ///   Get data of the incomplete line.
+    ///
+    /// @return std::string_view
+    ///   Return data received after the last new line.
+    auto GetPending() const noexcept -> std::string_view {
+        return std::string_view(buffer).substr(lineStart);
+    }
+
+    /// @brief
+    ///   Drop all data of the incomplete line.
+    auto Clear() noexcept -> void {
+        buffer.clear();
+        lineStart  = 0;
+        scanOffset = 0;
+    }
+
+private:
+    /// @brief
+    ///   Data that has not been consumed as lines.
+    std::string buffer;
+
+    /// @brief
+    ///   Offset of start of current line in @p buffer.
+    size_t lineStart;
+
+    /// @brief
+    ///   Offset in @p buffer to continue scanning for new line.
+    size_t scanOffset;
+
+    /// @brief
+    ///   Maximum size in byte of a single line.
+    size_t maxLineSize;
+};
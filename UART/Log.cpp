@@ -1,11 +1,74 @@
 #include "Log.h"
+#include "Metrics.h"
 
 #include <Windows.h>
 
 #include <chrono>
 
-static constexpr const size_t BUFFER_SIZE = 4096;
-static constexpr const size_t FLUSH_SIZE  = BUFFER_SIZE - 256;
+namespace {
+
+/// @brief
+///   Per-thread cache of the "{threadID} {date} {time}" log message prefix. The prefix is formatted
+///   once per second and only sub-second digits are patched in for each message.
+class LogPrefixCache {
+public:
+    using Clock     = std::chrono::system_clock;
+    using Precision = std::chrono::hh_mm_ss<Clock::duration>;
+
+    /// @brief
+    ///   Create a prefix cache for current thread.
+    LogPrefixCache() noexcept : second(), text(), secondSize(0), threadIDSize(0) {
+        const DWORD threadID = GetCurrentThreadId();
+        threadIDSize =
+            static_cast<size_t>(std::format_to(text, "{} ", threadID) - static_cast<char *>(text));
+    }
+
+    /// @brief
+    ///   Get log message prefix of the specified time point.
+    ///
+    /// @param now  Time point of the log message.
+    ///
+    /// @return std::string_view
+    ///   Return the formatted prefix. The prefix is valid until next call from this thread.
+    auto Format(Clock::time_point now) noexcept -> std::string_view {
+        const auto current = std::chrono::floor<std::chrono::seconds>(now);
+        if (current != second || secondSize == 0) {
+            char *end  = std::format_to(text + threadIDSize, "{:%F %T}", current);
+            secondSize = static_cast<size_t>(end - static_cast<char *>(text));
+            if constexpr (Precision::fractional_width != 0)
+                text[secondSize++] = '.';
+            second = current;
+        }
+
+        // Patch sub-second digits. They are exactly what std::chrono formatter prints.
+        auto subsecond = static_cast<uint64_t>((now - current).count());
+        for (size_t i = secondSize + Precision::fractional_width; i != secondSize; --i) {
+            text[i - 1] = static_cast<char>('0' + subsecond % 10);
+            subsecond /= 10;
+        }
+
+        return std::string_view(text, secondSize + Precision::fractional_width);
+    }
+
+private:
+    /// @brief
+    ///   The second that @p text is formatted for.
+    std::chrono::sys_seconds second;
+
+    /// @brief
+    ///   Formatted prefix.
+    char text[64];
+
+    /// @brief
+    ///   Size in byte of prefix without sub-second digits.
+    size_t secondSize;
+
+    /// @brief
+    ///   Size in byte of the thread ID part of the prefix.
+    size_t threadIDSize;
+};
+
+} // namespace
 
 static auto LogLevelName(LogLevel level) noexcept -> std::string_view {
     switch (level) {
@@ -24,9 +87,27 @@ static auto LogLevelName(LogLevel level) noexcept -> std::string_view {
     }
 }
 
+/// @brief
+///   Get counter of log messages of the specified level.
+static auto MessageCounter(LogLevel level) noexcept -> const MetricCounter & {
+    static const std::array<MetricCounter, 5> counters = []() -> std::array<MetricCounter, 5> {
+        std::array<MetricCounter, 5> result;
+        for (size_t i = 0; i < result.size(); ++i)
+            result[i] = MetricRegistry::GetSingleton()->GetCounter(std::format(
+                "log_messages{{level=\"{}\"}}", LogLevelName(static_cast<LogLevel>(i))));
+        return result;
+    }();
+
+    return counters[static_cast<size_t>(level) < counters.size() ? static_cast<size_t>(level)
+                                                                 : counters.size() - 1];
+}
+
 LogSystem::LogSystem(LogLevel level) noexcept
-    : filterLevel(level), buffer(), bufferMutex(), writer() {
-    buffer.reserve(BUFFER_SIZE);
+    : filterLevel(level < CompileLogLevel ? CompileLogLevel : level),
+      buffer(),
+      bufferMutex(),
+      writer() {
+    buffer.reserve(BufferSize);
 }
 
 LogSystem::~LogSystem() {
@@ -43,22 +124,34 @@ auto LogSystem::LogMessage(LogLevel severity, std::string_view message) -> void
     if (severity < filterLevel)
         return;
 
-    static thread_local const DWORD threadID = GetCurrentThreadId();
+    static thread_local LogPrefixCache prefixCache;
+    MessageCounter(severity).Add();
+
+    const std::string_view prefix = prefixCache.Format(std::chrono::system_clock::now());
+    if (writer != nullptr && writer->IsBuffered()) {
+        // The writer batches messages by itself. Hand the message over directly.
+        static thread_local std::string line;
+        line.assign(prefix);
+        std::format_to(std::back_inserter(line), " [{}] {}\n", LogLevelName(severity), message);
+        writer->Write(line.data(), line.size());
+
+        // Errors must not wait for the flush interval, they may be the last words before a crash.
+        // The writer thread is only woken up, so that the caller does not block on file IO.
+        if (severity >= LogLevel::Error)
+            writer->RequestFlush();
+        return;
+    }
 
-    const auto        now = std::chrono::system_clock::now();
     std::vector<char> flushBuffer;
 
     { // Write message to buffer.
         std::lock_guard<std::mutex> lock(bufferMutex);
-        std::format_to(std::back_inserter(buffer),
-                       "{} {} [{}] {}\n",
-                       threadID,
-                       now,
-                       LogLevelName(severity),
-                       message);
-
-        if (buffer.size() >= FLUSH_SIZE || severity >= LogLevel::Error) {
-            flushBuffer.reserve(BUFFER_SIZE);
+        buffer.insert(buffer.end(), prefix.begin(), prefix.end());
+        std::format_to(
+            std::back_inserter(buffer), " [{}] {}\n", LogLevelName(severity), message);
+
+        if (buffer.size() >= FlushSize || severity >= LogLevel::Error) {
+            flushBuffer.reserve(BufferSize);
             flushBuffer.swap(buffer);
         }
     }
@@ -77,21 +170,23 @@ auto LogSystem::LogMessage(LogLevel severity, std::string_view message) -> void
 
 auto LogSystem::Flush() -> void {
     std::vector<char> flushBuffer;
-    flushBuffer.reserve(BUFFER_SIZE);
+    flushBuffer.reserve(BufferSize);
 
     { // Swap buffers to avoid locking for too long.
         std::lock_guard<std::mutex> lock(bufferMutex);
         buffer.swap(flushBuffer);
     }
 
-    if (writer != nullptr)
+    if (writer != nullptr) {
         writer->Write(flushBuffer.data(), flushBuffer.size());
-    else
+        writer->Flush();
+    } else {
         WriteFile(GetStdHandle(STD_ERROR_HANDLE),
                   flushBuffer.data(),
                   DWORD(flushBuffer.size()),
                   nullptr,
                   nullptr);
+    }
 }
 
 auto LogSystem::GetSingleton() noexcept -> LogSystem * {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <format>
 #include <memory>
 #include <mutex>
@@ -14,6 +16,21 @@ enum class LogLevel {
     Off,
 };
 
+// Minimum log level compiled into this binary. Define LOG_COMPILE_LEVEL to one of the LogLevel
+// enumerators to override the default.
+#ifndef LOG_COMPILE_LEVEL
+#    ifdef NDEBUG
+#        define LOG_COMPILE_LEVEL Info
+#    else
+#        define LOG_COMPILE_LEVEL Trace
+#    endif
+#endif
+
+/// @brief
+///   Log messages with lower level than this are removed at compile time. The runtime filter level
+///   of LogSystem never goes below this level.
+inline constexpr LogLevel CompileLogLevel = LogLevel::LOG_COMPILE_LEVEL;
+
 class LogWriter {
 public:
     /// @brief
@@ -26,10 +43,38 @@ public:
     /// @param[in] data     Pointer to start of data to be written.
     /// @param     size     Size in byte of data to be written.
     virtual auto Write(const void *data, size_t size) -> void = 0;
+
+    /// @brief
+    ///   Checks whether this writer buffers data by itself. Log system hands every message to a
+    ///   buffered writer directly instead of caching it.
+    ///
+    /// @return bool
+    ///   Return true if this writer buffers data by itself.
+    virtual auto IsBuffered() const noexcept -> bool {
+        return false;
+    }
+
+    /// @brief
+    ///   Wait until all data written so far is persisted. Writers that do not buffer data by
+    ///   themselves have nothing to do.
+    virtual auto Flush() -> void {}
+
+    /// @brief
+    ///   Ask the writer to persist all data written so far soon, without waiting for it. Writers
+    ///   that do not buffer data by themselves have nothing to do.
+    virtual auto RequestFlush() -> void {}
 };
 
 class LogSystem {
 public:
+    /// @brief
+    ///   Capacity reserved for buffered log messages.
+    static constexpr const size_t BufferSize = 4096;
+
+    /// @brief
+    ///   Buffered messages are handed to the writer once the buffer reaches this size.
+    static constexpr const size_t FlushSize = BufferSize - 256;
+
     /// @brief
     ///   Create a log system and write message to stderr.
     ///
@@ -48,12 +93,59 @@ public:
     /// @param message      The log message to be written.
     auto LogMessage(LogLevel severity, std::string_view message) -> void;
 
+    /// @brief
+    ///   Checks whether messages of the specified level pass the log filter.
+    ///
+    /// @param level    Severity of the message to be checked.
+    ///
+    /// @return bool
+    ///   Return true if messages of @p level will be written.
+    auto IsEnabled(LogLevel level) const noexcept -> bool {
+        return level >= filterLevel;
+    }
+
+    /// @brief
+    ///   Write a log message with compile-time severity. Nothing is generated for this call if
+    ///   @p Level is lower than CompileLogLevel.
+    ///
+    /// @tparam Level   Severity of this log message.
+    /// @param message  The log message to be written.
+    template <LogLevel Level>
+    auto Log(std::string_view message) -> void {
+        if constexpr (Level >= CompileLogLevel) {
+            if (IsEnabled(Level))
+                LogMessage(Level, message);
+        }
+    }
+
+    /// @brief
+    ///   Format and write a log message with compile-time severity. Nothing is generated for this
+    ///   call if @p Level is lower than CompileLogLevel.
+    ///
+    /// @tparam Level   Severity of this log message.
+    /// @tparam Arg     Type of the first argument to be formatted.
+    /// @tparam Args    Types of the rest arguments to be formatted.
+    /// @param  format  The format string specifies how to format the message.
+    /// @param  arg     The first argument to be formatted.
+    /// @param  args    The rest arguments to be formatted.
+    template <LogLevel Level, typename Arg, typename... Args>
+    auto Log(std::format_string<Arg, Args...> format, Arg &&arg, Args &&...args) -> void {
+        if constexpr (Level >= CompileLogLevel) {
+            if (!IsEnabled(Level))
+                return;
+
+            std::string message(
+                std::format(format, std::forward<Arg>(arg), std::forward<Args>(args)...));
+            LogMessage(Level, message);
+        }
+    }
+
     /// @brief
     ///   Write a trace log message.
     ///
     /// @param message      The log message to be written.
     auto Trace(std::string_view message) -> void {
-        LogMessage(LogLevel::Trace, message);
+        Log<LogLevel::Trace>(message);
     }
 
     /// @brief
@@ -61,7 +153,7 @@ public:
     ///
     /// @param message      The log message to be written.
     auto Debug(std::string_view message) -> void {
-        LogMessage(LogLevel::Debug, message);
+        Log<LogLevel::Debug>(message);
     }
 
     /// @brief
@@ -69,7 +161,7 @@ public:
     ///
     /// @param message      The log message to be written.
     auto Info(std::string_view message) -> void {
-        LogMessage(LogLevel::Info, message);
+        Log<LogLevel::Info>(message);
     }
 
     /// @brief
@@ -77,7 +169,7 @@ public:
     ///
     /// @param message      The log message to be written.
     auto Warning(std::string_view message) -> void {
-        LogMessage(LogLevel::Warning, message);
+        Log<LogLevel::Warning>(message);
     }
 
     /// @brief
@@ -85,7 +177,7 @@ public:
     ///
     /// @param message      The log message to be written.
     auto Error(std::string_view message) -> void {
-        LogMessage(LogLevel::Error, message);
+        Log<LogLevel::Error>(message);
     }
 
     /// @brief
@@ -96,11 +188,7 @@ public:
     /// @param  args    Arguments to be formatted.
     template <typename... Args>
     auto Trace(std::format_string<Args...> format, Args &&...args) -> void {
-        if (filterLevel > LogLevel::Trace)
-            return;
-
-        std::string message(std::format(format, std::forward<Args>(args)...));
-        LogMessage(LogLevel::Trace, message);
+        Log<LogLevel::Trace>(format, std::forward<Args>(args)...);
     }
 
     /// @brief
@@ -111,11 +199,7 @@ public:
     /// @param  args    Arguments to be formatted.
     template <typename... Args>
     auto Debug(std::format_string<Args...> format, Args &&...args) -> void {
-        if (filterLevel > LogLevel::Debug)
-            return;
-
-        std::string message(std::format(format, std::forward<Args>(args)...));
-        LogMessage(LogLevel::Debug, message);
+        Log<LogLevel::Debug>(format, std::forward<Args>(args)...);
     }
 
     /// @brief
@@ -126,11 +210,7 @@ public:
     /// @param  args    Arguments to be formatted.
     template <typename... Args>
     auto Info(std::format_string<Args...> format, Args &&...args) -> void {
-        if (filterLevel > LogLevel::Info)
-            return;
-
-        std::string message(std::format(format, std::forward<Args>(args)...));
-        LogMessage(LogLevel::Info, message);
+        Log<LogLevel::Info>(format, std::forward<Args>(args)...);
     }
 
     /// @brief
@@ -141,11 +221,7 @@ public:
     /// @param  args    Arguments to be formatted.
     template <typename... Args>
     auto Warning(std::format_string<Args...> format, Args &&...args) -> void {
-        if (filterLevel > LogLevel::Warning)
-            return;
-
-        std::string message(std::format(format, std::forward<Args>(args)...));
-        LogMessage(LogLevel::Warning, message);
+        Log<LogLevel::Warning>(format, std::forward<Args>(args)...);
     }
 
     /// @brief
@@ -156,11 +232,30 @@ public:
     /// @param  args    Arguments to be formatted.
     template <typename... Args>
     auto Error(std::format_string<Args...> format, Args &&...args) -> void {
-        if (filterLevel > LogLevel::Error)
-            return;
+        Log<LogLevel::Error>(format, std::forward<Args>(args)...);
+    }
 
-        std::string message(std::format(format, std::forward<Args>(args)...));
-        LogMessage(LogLevel::Error, message);
+    /// @brief
+    ///   Format and write a log message from a rate limited call site. A summary of suppressed
+    ///   messages is appended if any message from the same call site has been dropped since the
+    ///   last one that was written.
+    ///
+    /// @tparam Level       Severity of this log message.
+    /// @tparam Args        Types of arguments to be formatted.
+    /// @param  suppressed  Number of messages dropped by the call site since the last write.
+    /// @param  format      The format string specifies how to format the message.
+    /// @param  args        Arguments to be formatted.
+    template <LogLevel Level, typename... Args>
+    auto LogLimited(uint64_t suppressed, std::format_string<Args...> format, Args &&...args)
+        -> void {
+        if constexpr (Level >= CompileLogLevel) {
+            std::string message(std::format(format, std::forward<Args>(args)...));
+            if (suppressed != 0)
+                std::format_to(std::back_inserter(message),
+                               " ({} similar messages suppressed)",
+                               suppressed);
+            LogMessage(Level, message);
+        }
     }
 
     /// @brief
@@ -177,11 +272,12 @@ public:
     }
 
     /// @brief
-    ///   Set log level of message filter.
+    ///   Set log level of message filter. Level lower than CompileLogLevel is raised to
+    ///   CompileLogLevel.
     ///
     /// @param level    New log filter level.
     auto SetLevel(LogLevel level) noexcept -> void {
-        filterLevel = level;
+        filterLevel = level < CompileLogLevel ? CompileLogLevel : level;
     }
 
     /// @brief
@@ -230,47 +326,221 @@ private:
     std::unique_ptr<LogWriter> writer;
 };
 
+class LogRateLimiter {
+public:
+    /// @brief
+    ///   Create a token bucket rate limiter for a log call site.
+    ///
+    /// @param ratePerSecond    Number of messages allowed per second in the long run. Zero or
+    ///                         negative rate suppresses all messages.
+    /// @param burst            Number of messages allowed back to back before limiting.
+    LogRateLimiter(double ratePerSecond, uint32_t burst) noexcept
+        : emissionInterval(ratePerSecond > 0 ? static_cast<int64_t>(1e9 / ratePerSecond) : 0),
+          burstTolerance(emissionInterval * (burst > 0 ? burst - 1 : 0)),
+          suppressAll(!(ratePerSecond > 0)),
+          theoreticalArrival(0),
+          suppressed(0) {}
+
+    /// @brief
+    ///   Try to take a token from the bucket. This is implemented as a generic cell rate algorithm
+    ///   so that the whole bucket state is a single atomic.
+    ///
+    /// @return bool
+    ///   Return true if the message should be written. Otherwise the message is counted as
+    ///   suppressed.
+    auto TryAcquire() noexcept -> bool {
+        if (suppressAll) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch())
+                                .count();
+
+        int64_t arrival = theoreticalArrival.load(std::memory_order_relaxed);
+        for (;;) {
+            if (now < arrival - burstTolerance) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            const int64_t next = (arrival > now ? arrival : now) + emissionInterval;
+            if (theoreticalArrival.compare_exchange_weak(arrival, next, std::memory_order_relaxed))
+                return true;
+        }
+    }
+
+    /// @brief
+    ///   Get and reset number of messages suppressed since last call.
+    auto TakeSuppressed() noexcept -> uint64_t {
+        return suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief
+    ///   Nanoseconds between two messages in the long run.
+    int64_t emissionInterval;
+
+    /// @brief
+    ///   Nanoseconds that a message may arrive ahead of schedule.
+    int64_t burstTolerance;
+
+    /// @brief
+    ///   Whether every message is suppressed because the rate is not positive.
+    bool suppressAll;
+
+    /// @brief
+    ///   Theoretical arrival time in nanoseconds of the next message.
+    std::atomic<int64_t> theoreticalArrival;
+
+    /// @brief
+    ///   Number of messages suppressed since last written message.
+    std::atomic<uint64_t> suppressed;
+};
+
+class LogSampler {
+public:
+    /// @brief
+    ///   Create a sampler for a log call site that writes the first @p first messages and every
+    ///   @p every-th message after that.
+    ///
+    /// @param first    Number of messages that are always written.
+    /// @param every    Sample period after the first messages.
+    LogSampler(uint64_t first, uint64_t every) noexcept
+        : first(first), every(every > 0 ? every : 1), count(0), suppressed(0) {}
+
+    /// @brief
+    ///   Count a message and check whether it should be written.
+    ///
+    /// @return bool
+    ///   Return true if the message should be written. Otherwise the message is counted as
+    ///   suppressed.
+    auto TryAcquire() noexcept -> bool {
+        const uint64_t index = count.fetch_add(1, std::memory_order_relaxed);
+        if (index < first || (index - first) % every == 0)
+            return true;
+
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// @brief
+    ///   Get and reset number of messages suppressed since last call.
+    auto TakeSuppressed() noexcept -> uint64_t {
+        return suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief
+    ///   Number of messages that are always written.
+    uint64_t first;
+
+    /// @brief
+    ///   Sample period after the first messages.
+    uint64_t every;
+
+    /// @brief
+    ///   Number of messages seen by this call site.
+    std::atomic<uint64_t> count;
+
+    /// @brief
+    ///   Number of messages suppressed since last written message.
+    std::atomic<uint64_t> suppressed;
+};
+
 inline auto LogTrace(std::string_view message) -> void {
-    LogSystem::GetSingleton()->Trace(message);
+    if constexpr (LogLevel::Trace >= CompileLogLevel)
+        LogSystem::GetSingleton()->Trace(message);
 }
 
 template <typename... Args>
 inline auto LogTrace(std::format_string<Args...> format, Args &&...args) -> void {
-    LogSystem::GetSingleton()->Trace(format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Trace >= CompileLogLevel)
+        LogSystem::GetSingleton()->Trace(format, std::forward<Args>(args)...);
 }
 
 inline auto LogDebug(std::string_view message) -> void {
-    LogSystem::GetSingleton()->Debug(message);
+    if constexpr (LogLevel::Debug >= CompileLogLevel)
+        LogSystem::GetSingleton()->Debug(message);
 }
 
 template <typename... Args>
 inline auto LogDebug(std::format_string<Args...> format, Args &&...args) -> void {
-    LogSystem::GetSingleton()->Debug(format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Debug >= CompileLogLevel)
+        LogSystem::GetSingleton()->Debug(format, std::forward<Args>(args)...);
 }
 
 inline auto LogInfo(std::string_view message) -> void {
-    LogSystem::GetSingleton()->Info(message);
+    if constexpr (LogLevel::Info >= CompileLogLevel)
+        LogSystem::GetSingleton()->Info(message);
 }
 
 template <typename... Args>
 inline auto LogInfo(std::format_string<Args...> format, Args &&...args) -> void {
-    LogSystem::GetSingleton()->Info(format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Info >= CompileLogLevel)
+        LogSystem::GetSingleton()->Info(format, std::forward<Args>(args)...);
 }
 
 inline auto LogWarning(std::string_view message) -> void {
-    LogSystem::GetSingleton()->Warning(message);
+    if constexpr (LogLevel::Warning >= CompileLogLevel)
+        LogSystem::GetSingleton()->Warning(message);
 }
 
 template <typename... Args>
 inline auto LogWarning(std::format_string<Args...> format, Args &&...args) -> void {
-    LogSystem::GetSingleton()->Warning(format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Warning >= CompileLogLevel)
+        LogSystem::GetSingleton()->Warning(format, std::forward<Args>(args)...);
 }
 
 inline auto LogError(std::string_view message) -> void {
-    LogSystem::GetSingleton()->Error(message);
+    if constexpr (LogLevel::Error >= CompileLogLevel)
+        LogSystem::GetSingleton()->Error(message);
 }
 
 template <typename... Args>
 inline auto LogError(std::format_string<Args...> format, Args &&...args) -> void {
-    LogSystem::GetSingleton()->Error(format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Error >= CompileLogLevel)
+        LogSystem::GetSingleton()->Error(format, std::forward<Args>(args)...);
 }
+
+// The following macros skip evaluation of their arguments entirely if the message would be
+// filtered, either at compile time by CompileLogLevel or at runtime by the log system filter.
+#define LOG_AT_LEVEL(level, ...)                                                                   \
+    do {                                                                                           \
+        if constexpr ((level) >= CompileLogLevel) {                                                \
+            LogSystem *logSystem_ = LogSystem::GetSingleton();                                     \
+            if (logSystem_->IsEnabled(level))                                                      \
+                logSystem_->Log<level>(__VA_ARGS__);                                               \
+        }                                                                                          \
+    } while (false)
+
+#define LOG_TRACE(...)   LOG_AT_LEVEL(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...)   LOG_AT_LEVEL(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT_LEVEL(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT_LEVEL(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT_LEVEL(LogLevel::Error, __VA_ARGS__)
+
+// Log at most ratePerSecond messages per second from this call site, allowing bursts of up to
+// burst messages. Dropped messages are summarized in the next message that is written.
+#define LOG_RATE_LIMITED(level, ratePerSecond, burst, ...)                                         \
+    do {                                                                                           \
+        if constexpr ((level) >= CompileLogLevel) {                                                \
+            static LogRateLimiter logLimiter_(ratePerSecond, burst);                               \
+            LogSystem            *logSystem_ = LogSystem::GetSingleton();                          \
+            if (logSystem_->IsEnabled(level) && logLimiter_.TryAcquire())                          \
+                logSystem_->LogLimited<level>(logLimiter_.TakeSuppressed(), __VA_ARGS__);          \
+        }                                                                                          \
+    } while (false)
+
+// Log the first messages from this call site and then every every-th message. Dropped messages
+// are summarized in the next message that is written.
+#define LOG_SAMPLED(level, first, every, ...)                                                      \
+    do {                                                                                           \
+        if constexpr ((level) >= CompileLogLevel) {                                                \
+            static LogSampler logSampler_(first, every);                                           \
+            LogSystem        *logSystem_ = LogSystem::GetSingleton();                              \
+            if (logSystem_->IsEnabled(level) && logSampler_.TryAcquire())                          \
+                logSystem_->LogLimited<level>(logSampler_.TakeSuppressed(), __VA_ARGS__);          \
+        }                                                                                          \
+    } while (false)
@@ -0,0 +1,221 @@
+#include "LogFileWriter.h"
+#include "Trace.h"
+
+static constexpr const size_t WRITE_SIZE       = 1024 * 1024;
+static constexpr const size_t MAX_PENDING_SIZE = 64 * 1024 * 1024;
+
+/// @brief
+///   Report an error of the log writer itself. Log system cannot be used here.
+template <typename... Args>
+static auto ReportError(std::format_string<Args...> format, Args &&...args) noexcept -> void {
+    std::string message(std::format(format, std::forward<Args>(args)...));
+    WriteFile(
+        GetStdHandle(STD_ERROR_HANDLE), message.data(), DWORD(message.size()), nullptr, nullptr);
+}
+
+LogFileWriter::LogFileWriter(std::string_view          path,
+                             size_t                    rotateSize,
+                             std::chrono::seconds      rotateInterval,
+                             uint32_t                  keepFiles,
+                             std::chrono::milliseconds flushInterval)
+    : path(path),
+      rotateSize(rotateSize),
+      rotateInterval(rotateInterval),
+      keepFiles(keepFiles),
+      flushInterval(flushInterval),
+      fileHandle(INVALID_HANDLE_VALUE),
+      fileSize(0),
+      rotateTime(),
+      pending(),
+      droppedBytes(0),
+      writtenBytesCounter(MetricRegistry::GetSingleton()->GetCounter("log_file_written_bytes")),
+      droppedBytesCounter(MetricRegistry::GetSingleton()->GetCounter("log_file_dropped_bytes")),
+      writeHistogram(MetricRegistry::GetSingleton()->GetHistogram("log_file_write_ns")),
+      flushRequests(0),
+      flushedRequests(0),
+      stopped(false),
+      pendingMutex(),
+      pendingCondition(),
+      flushedCondition(),
+      thread() {
+    pending.reserve(WRITE_SIZE);
+    thread = std::jthread([this](std::stop_token stopToken) -> void { Run(stopToken); });
+}
+
+LogFileWriter::~LogFileWriter() {
+    thread.request_stop();
+    thread.join();
+
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+}
+
+auto LogFileWriter::Write(const void *data, size_t size) -> void {
+    bool wakeUp;
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pending.size() + size > MAX_PENDING_SIZE) {
+            droppedBytes += size;
+            return;
+        }
+
+        pending.insert(pending.end(),
+                       static_cast<const char *>(data),
+                       static_cast<const char *>(data) + size);
+        wakeUp = (pending.size() >= WRITE_SIZE);
+    }
+
+    if (wakeUp)
+        pendingCondition.notify_one();
+}
+
+auto LogFileWriter::Flush() -> void {
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    const uint64_t               request = ++flushRequests;
+    pendingCondition.notify_one();
+    flushedCondition.wait(
+        lock, [this, request]() -> bool { return flushedRequests >= request || stopped; });
+}
+
+auto LogFileWriter::RequestFlush() -> void {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        ++flushRequests;
+    }
+    pendingCondition.notify_one();
+}
+
+auto LogFileWriter::Run(std::stop_token stopToken) -> void {
+    std::vector<char> writeBuffer;
+    writeBuffer.reserve(WRITE_SIZE);
+
+    std::error_code errorCode = OpenFile();
+    if (errorCode.value() != 0)
+        ReportError("Failed to open log file {}: {}.\n", path, errorCode.message());
+
+    for (;;) {
+        size_t   dropped;
+        uint64_t requests;
+
+        { // Wait for a full buffer, a flush request or flush timeout.
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            pendingCondition.wait_for(lock, stopToken, flushInterval, [this]() -> bool {
+                return pending.size() >= WRITE_SIZE || flushRequests != flushedRequests;
+            });
+
+            writeBuffer.swap(pending);
+            dropped      = droppedBytes;
+            droppedBytes = 0;
+            requests     = flushRequests;
+        }
+
+        if (dropped != 0) {
+            droppedBytesCounter.Add(dropped);
+            std::format_to(std::back_inserter(writeBuffer),
+                           "LogFileWriter dropped {} bytes of log messages.\n",
+                           dropped);
+        }
+
+        if (!writeBuffer.empty()) {
+            WriteToFile(writeBuffer);
+            writeBuffer.clear();
+        }
+
+        { // Data of every request taken above has been written.
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            flushedRequests = requests;
+        }
+        flushedCondition.notify_all();
+
+        if (stopToken.stop_requested()) {
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            if (pending.empty()) {
+                stopped = true;
+                lock.unlock();
+                flushedCondition.notify_all();
+                break;
+            }
+        }
+    }
+}
+
+auto LogFileWriter::WriteToFile(const std::vector<char> &data) noexcept -> void {
+    TRACE_SPAN_ARG("LogFileWriter::WriteToFile", data.size());
+
+    const bool sizeExceeded =
+        (rotateSize != 0 && fileSize != 0 && fileSize + data.size() > rotateSize);
+    const bool timeExceeded =
+        (rotateInterval.count() != 0 && std::chrono::steady_clock::now() >= rotateTime);
+
+    if (sizeExceeded || timeExceeded)
+        Rotate();
+
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        WriteFile(
+            GetStdHandle(STD_ERROR_HANDLE), data.data(), DWORD(data.size()), nullptr, nullptr);
+        return;
+    }
+
+    const auto start        = std::chrono::steady_clock::now();
+    DWORD      bytesWritten = 0;
+    if (!WriteFile(fileHandle, data.data(), DWORD(data.size()), &bytesWritten, nullptr)) {
+        ReportError("Failed to write log file {}: {}.\n", path, GetLastError());
+        WriteFile(
+            GetStdHandle(STD_ERROR_HANDLE), data.data(), DWORD(data.size()), nullptr, nullptr);
+    }
+
+    fileSize += bytesWritten;
+    writtenBytesCounter.Add(bytesWritten);
+    writeHistogram.RecordSince(start);
+}
+
+auto LogFileWriter::OpenFile() noexcept -> std::error_code {
+    HANDLE newFile = CreateFileA(path.c_str(),
+                                 FILE_APPEND_DATA,
+                                 FILE_SHARE_READ,
+                                 nullptr,
+                                 OPEN_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL,
+                                 nullptr);
+
+    if (newFile == INVALID_HANDLE_VALUE)
+        return std::error_code(GetLastError(), std::system_category());
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(newFile, &size);
+
+    fileHandle = newFile;
+    fileSize   = static_cast<size_t>(size.QuadPart);
+    rotateTime = std::chrono::steady_clock::now() + rotateInterval;
+
+    return std::error_code();
+}
+
+auto LogFileWriter::Rotate() noexcept -> void {
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    // Shift rotated files. The oldest one is replaced.
+    if (keepFiles != 0) {
+        for (uint32_t i = keepFiles - 1; i != 0; --i) {
+            std::string from = std::format("{}.{}", path, i);
+            std::string to   = std::format("{}.{}", path, i + 1);
+            MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING);
+        }
+
+        std::string rotated = std::format("{}.1", path);
+        if (!MoveFileExA(path.c_str(), rotated.c_str(), MOVEFILE_REPLACE_EXISTING))
+            ReportError("Failed to rotate log file {}: {}.\n", path, GetLastError());
+    } else {
+        DeleteFileA(path.c_str());
+    }
+
+    std::error_code errorCode = OpenFile();
+    if (errorCode.value() != 0)
+        ReportError("Failed to open log file {}: {}.\n", path, errorCode.message());
+}
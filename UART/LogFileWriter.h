@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Log.h"
+#include "Metrics.h"
+
+#include <Windows.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <string>
+#include <thread>
+
+class LogFileWriter final : public LogWriter {
+public:
+    /// @brief
+    ///   Create a log writer that writes log messages to rotated files through a background
+    ///   thread. Active log file is @p path. Rotated files are renamed to "path.1", "path.2" and so
+    ///   on, where "path.1" is the newest one.
+    ///
+    /// @param path             Path of the active log file.
+    /// @param rotateSize       Rotate log file once its size exceeds this value in byte. Pass 0 to
+    ///                         disable size based rotation.
+    /// @param rotateInterval   Rotate log file once it has been written for this long. Pass 0 to
+    ///                         disable time based rotation.
+    /// @param keepFiles        Maximum number of rotated files to keep.
+    /// @param flushInterval    Maximum delay before a written message reaches the log file.
+    LogFileWriter(std::string_view          path,
+                  size_t                    rotateSize     = 16 * 1024 * 1024,
+                  std::chrono::seconds      rotateInterval = std::chrono::seconds(0),
+                  uint32_t                  keepFiles      = 8,
+                  std::chrono::milliseconds flushInterval  = std::chrono::milliseconds(500));
+
+    /// @brief
+    ///   Stop the background thread and write all pending messages to file.
+    ~LogFileWriter() override;
+
+    /// @brief
+    ///   Append data to pending buffer. Data is written to file by the background thread. Data is
+    ///   dropped if the background thread could not catch up.
+    ///
+    /// @param[in] data     Pointer to start of data to be written.
+    /// @param     size     Size in byte of data to be written.
+    auto Write(const void *data, size_t size) -> void override;
+
+    /// @brief
+    ///   This writer buffers data by itself.
+    auto IsBuffered() const noexcept -> bool override {
+        return true;
+    }
+
+    /// @brief
+    ///   Wake up the background thread and wait until all data written so far reaches the log
+    ///   file. Returns at once if the background thread has stopped.
+    auto Flush() -> void override;
+
+    /// @brief
+    ///   Wake up the background thread to write all data written so far without waiting for it.
+    auto RequestFlush() -> void override;
+
+private:
+    /// @brief
+    ///   Background thread entry. Writes pending data to file periodically.
+    auto Run(std::stop_token stopToken) -> void;
+
+    /// @brief
+    ///   Write data to the active log file and rotate it if necessary.
+    auto WriteToFile(const std::vector<char> &data) noexcept -> void;
+
+    /// @brief
+    ///   Open the active log file for appending.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the open result.
+    auto OpenFile() noexcept -> std::error_code;
+
+    /// @brief
+    ///   Close the active log file and shift rotated files.
+    auto Rotate() noexcept -> void;
+
+private:
+    /// @brief
+    ///   Path of the active log file.
+    std::string path;
+
+    /// @brief
+    ///   Size in byte to rotate log file.
+    size_t rotateSize;
+
+    /// @brief
+    ///   Time interval to rotate log file.
+    std::chrono::seconds rotateInterval;
+
+    /// @brief
+    ///   Maximum number of rotated files to keep.
+    uint32_t keepFiles;
+
+    /// @brief
+    ///   Maximum delay before pending data is written to file.
+    std::chrono::milliseconds flushInterval;
+
+    /// @brief
+    ///   Win32 file handle of the active log file. Only accessed by the background thread.
+    HANDLE fileHandle;
+
+    /// @brief
+    ///   Size in byte of the active log file.
+    size_t fileSize;
+
+    /// @brief
+    ///   Time to rotate the active log file.
+    std::chrono::steady_clock::time_point rotateTime;
+
+    /// @brief
+    ///   Data waiting to be written by the background thread.
+    std::vector<char> pending;
+
+    /// @brief
+    ///   Number of bytes dropped because the background thread could not catch up.
+    size_t droppedBytes;
+
+    /// @brief
+    ///   Number of bytes written to log files.
+    MetricCounter writtenBytesCounter;
+
+    /// @brief
+    ///   Number of bytes dropped because the writer could not keep up.
+    MetricCounter droppedBytesCounter;
+
+    /// @brief
+    ///   Time in nanoseconds to write a batch to the log file.
+    MetricHistogram writeHistogram;
+
+    /// @brief
+    ///   Number of flush requests. Each request is numbered by this counter.
+    uint64_t flushRequests;
+
+    /// @brief
+    ///   Number of flush requests whose data has been written to file.
+    uint64_t flushedRequests;
+
+    /// @brief
+    ///   Whether the background thread has exited. Nobody serves flush requests then.
+    bool stopped;
+
+    /// @brief
+    ///   Mutex that is used to protect @p pending, @p droppedBytes and flush requests.
+    std::mutex pendingMutex;
+
+    /// @brief
+    ///   Condition variable that is used to wake up the background thread.
+    std::condition_variable_any pendingCondition;
+
+    /// @brief
+    ///   Condition variable that is used to wake up threads waiting for a flush.
+    std::condition_variable flushedCondition;
+
+    /// @brief
+    ///   Background writer thread. Declared last so that it starts after other members.
+    std::jthread thread;
+};
@@ -1,38 +1,34 @@
+#include "FileWriter.h"
 #include "IOContext.h"
-#include "IWR1443/Serials.h"
+#include "IWR1443/Radar.h"
 #include "Log.h"
+#include "LogFileWriter.h"
+#include "Metrics.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace iwr1443;
 
-class FileWriter {
-public:
-    /// @brief
-    ///   Create an null json writer.
-    FileWriter() noexcept;
+// Frames of different radars acquired within this period are merged into one slice.
+static constexpr const std::chrono::milliseconds FUSION_SLICE_PERIOD{50};
 
-    /// @brief
-    ///   Destroy this json writer.
-    ~FileWriter() noexcept;
+// Maximum time that a slice waits for frames of other radars.
+static constexpr const std::chrono::milliseconds FUSION_WAIT_WINDOW{100};
 
-    /// @brief
-    ///   Try to open the specified file as output file.
-    auto Open(std::string_view path) noexcept -> std::error_code;
-
-    /// @brief
-    ///   Try to append data to the end of file.
-    auto Write(const void *data, size_t size) noexcept -> std::error_code;
+auto main(int argc, char *argv[]) -> int {
+    std::error_code errorCode;
 
-private:
-    /// @brief
-    ///   Handle of the json file.
-    HANDLE fileHandle;
-};
+    LogSystem::GetSingleton()->SetPersistantWriter<LogFileWriter>("uart.log");
 
-auto main() -> int {
-    std::error_code errorCode;
+    // Export metrics to metrics.txt and http://127.0.0.1:9464/.
+    MetricRegistry::GetSingleton()->StartExport("metrics.txt", 9464, std::chrono::seconds(1));
 
     IOContext ioContext;
     errorCode = ioContext.Initialize();
@@ -41,104 +37,155 @@ auto main() -> int {
         return EXIT_FAILURE;
     }
 
-    ControlSerial controlSerial;
-    errorCode = controlSerial.Initialize();
-    if (errorCode.value() != 0) {
-        LogError("Failed to initialize control serial: {}.", errorCode.message());
-        return EXIT_FAILURE;
-    }
-
-    DataSerial dataSerial;
-    errorCode = dataSerial.Initialize();
-    if (errorCode.value() != 0) {
-        LogError("Failed to initialize data serial: {}.", errorCode.message());
-        return EXIT_FAILURE;
+    // Radars are listed in the site file given with --site. Otherwise a single radar is connected
+    // with the demo firmware ports and configured with the sensor config file given in command
+    // line, if any, like "UART.exe profile.cfg".
+    std::vector<RadarConfig> radarConfigs;
+    if (argc > 1 && std::string_view(argv[1]) == "--site") {
+        if (argc < 3) {
+            LogError("Missing site file. Usage: UART [--site path | sensor config path].");
+            return EXIT_FAILURE;
+        }
+
+        errorCode = LoadRadarConfigs(argv[2], radarConfigs);
+        if (errorCode.value() != 0) {
+            LogError("Failed to load site file {}: {}.", argv[2], errorCode.message());
+            return EXIT_FAILURE;
+        }
+    } else {
+        radarConfigs.push_back(RadarConfig{"radar",
+                                           "COM4",
+                                           115200,
+                                           "COM3",
+                                           921600,
+                                           argc > 1 ? std::string(argv[1]) : std::string(),
+                                           "data.json",
+                                           RigidTransform::Identity(),
+                                           "clusters.json",
+                                           PointClusterer::DefaultConfig(),
+                                           "tracks.json",
+                                           TargetTracker::DefaultConfig(),
+                                           StaticClutterFilter::DefaultConfig()});
     }
 
-    FileWriter radarDataWriter;
-    errorCode = radarDataWriter.Open("data.json");
-    if (errorCode.value() != 0) {
-        LogError("Failed to open data file {}: {}.", "data.json", errorCode.message());
-        return EXIT_FAILURE;
+    // Point clouds of several radars are merged into time slices in site coordinates.
+    std::unique_ptr<PointCloudFusion> fusion;
+    FileWriter                        fusedWriter;
+    std::string                       fusedText;
+    if (radarConfigs.size() > 1) {
+        std::vector<FusionDevice> fusionDevices;
+        for (const auto &config : radarConfigs)
+            fusionDevices.push_back(FusionDevice{config.name, config.extrinsic});
+
+        fusion = std::make_unique<PointCloudFusion>(
+            FusionConfig{FUSION_SLICE_PERIOD, FUSION_WAIT_WINDOW}, std::move(fusionDevices));
+
+        errorCode = fusedWriter.Open("fused.json");
+        if (errorCode.value() != 0) {
+            LogError("Failed to open fused data file {}: {}.", "fused.json", errorCode.message());
+            return EXIT_FAILURE;
+        }
+
+        fusion->SetSink([&](const FusedFrame &frame) -> void {
+            fusedText.clear();
+            fusion->Serialize(frame, fusedText);
+            fusedWriter.Write(fusedText.data(), fusedText.size());
+        });
     }
 
-    errorCode = ioContext.Register(&controlSerial);
-    if (errorCode.value() != 0) {
-        LogError("Failed to register control serial to IO context: {}.", errorCode.message());
-        return EXIT_FAILURE;
+    std::vector<std::unique_ptr<Radar>> radars;
+    for (auto &config : radarConfigs) {
+        const auto device = static_cast<uint16_t>(radars.size());
+        radars.push_back(std::make_unique<Radar>(std::move(config)));
+        errorCode = radars.back()->Initialize(ioContext, fusion.get(), device);
+        if (errorCode.value() != 0)
+            return EXIT_FAILURE;
     }
 
-    errorCode = ioContext.Register(&dataSerial);
-    if (errorCode.value() != 0) {
-        LogError("Failed to register data serial to IO context: {}.", errorCode.message());
-        return EXIT_FAILURE;
+    // One IO thread per radar so that a radar busy with a frame does not delay the others.
+    const size_t threadCount =
+        std::clamp<size_t>(radars.size(), 1, std::max(std::thread::hardware_concurrency(), 1U));
+
+    std::vector<std::jthread> tasks;
+    for (size_t i = 0; i < threadCount; ++i)
+        tasks.emplace_back([&ioContext]() -> void { ioContext.Run(); });
+
+    // Configure sensors one at a time. They share the config cache file.
+    ConfigCache configCache;
+    errorCode = configCache.Load("iwr1443.cache");
+    if (errorCode.value() != 0)
+        LogError("Failed to load config cache: {}.", errorCode.message());
+
+    for (auto &radar : radars)
+        radar->Configure(configCache, std::chrono::milliseconds(2000));
+
+    // Emit slices of radars that stopped delivering frames.
+    std::jthread fusionTask;
+    if (fusion) {
+        fusionTask = std::jthread([&fusion](std::stop_token stopToken) -> void {
+            while (!stopToken.stop_requested()) {
+                std::this_thread::sleep_for(FUSION_WAIT_WINDOW);
+                fusion->Poll();
+            }
+        });
     }
 
-    dataSerial.SetPersistantWriter([&radarDataWriter](const void *data, size_t size) -> void {
-        radarDataWriter.Write(data, size);
-    });
-
-    std::jthread task([&ioContext]() -> void { ioContext.Run(); });
-
     std::string command;
     for (;;) {
         std::getline(std::cin, command);
         if (command == "exit")
             break;
 
-        command.push_back('\n');
-        controlSerial.AsyncWrite(command.data(), command.size());
+        // Trace commands are handled locally: "trace on", "trace off" and "trace dump <path>".
+        if (command.starts_with("trace ")) {
+            if (command == "trace on")
+                TraceSystem::GetSingleton()->SetEnabled(true);
+            else if (command == "trace off")
+                TraceSystem::GetSingleton()->SetEnabled(false);
+            else if (command.starts_with("trace dump "))
+                TraceSystem::GetSingleton()->Dump(std::string_view(command).substr(11));
+            else
+                LogWarning("Unknown trace command \"{}\".", command);
+
+            command.clear();
+            continue;
+        }
+
+        // "<name>: <command>" is sent to the named radar. Other commands go to all radars.
+        bool addressed = false;
+        for (auto &radar : radars) {
+            const std::string_view name = radar->GetName();
+            if (command.size() > name.size() && command.starts_with(name) &&
+                command[name.size()] == ':') {
+                const std::string_view line = std::string_view(command).substr(name.size() + 1);
+                radar->SendCommand(line.substr(std::min(line.find_first_not_of(' '), line.size())));
+                addressed = true;
+                break;
+            }
+        }
+
+        if (!addressed) {
+            for (auto &radar : radars)
+                radar->SendCommand(command);
+        }
+
         command.clear();
     }
 
-    ioContext.Quit();
-    task.join();
-
-    return 0;
-}
-
-FileWriter::FileWriter() noexcept : fileHandle(INVALID_HANDLE_VALUE) {}
+    ioContext.Quit(static_cast<uint32_t>(threadCount));
+    for (auto &task : tasks)
+        task.join();
 
-FileWriter::~FileWriter() noexcept {
-    if (fileHandle != INVALID_HANDLE_VALUE) {
-        CloseHandle(fileHandle);
-        fileHandle = INVALID_HANDLE_VALUE;
+    if (fusionTask.joinable()) {
+        fusionTask.request_stop();
+        fusionTask.join();
+        fusion->Flush();
     }
-}
-
-auto FileWriter::Open(std::string_view path) noexcept -> std::error_code {
-    const int count =
-        MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
 
-    if (count <= 0)
-        return std::error_code(GetLastError(), std::system_category());
+    MetricRegistry::GetSingleton()->StopExport();
 
-    std::wstring widePath;
-    widePath.resize(static_cast<size_t>(count));
+    for (const auto &radar : radars)
+        radar->LogStatistics();
 
-    MultiByteToWideChar(
-        CP_UTF8, 0, path.data(), static_cast<int>(path.size()), widePath.data(), count);
-
-    HANDLE newFile = CreateFile(widePath.c_str(),
-                                GENERIC_WRITE,
-                                FILE_SHARE_READ,
-                                nullptr,
-                                CREATE_ALWAYS,
-                                FILE_ATTRIBUTE_NORMAL,
-                                nullptr);
-
-    if (newFile == INVALID_HANDLE_VALUE)
-        return std::error_code(GetLastError(), std::system_category());
-
-    if (fileHandle != INVALID_HANDLE_VALUE)
-        CloseHandle(fileHandle);
-
-    fileHandle = newFile;
-    return std::error_code();
-}
-
-auto FileWriter::Write(const void *data, size_t size) noexcept -> std::error_code {
-    if (!WriteFile(fileHandle, data, static_cast<DWORD>(size), nullptr, nullptr))
-        return std::error_code(GetLastError(), std::system_category());
-    return std::error_code();
+    return 0;
 }
@@ -0,0 +1,405 @@
+#include "Metrics.h"
+#include "Log.h"
+
+#include <Windows.h>
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+// Time to wait for a request line from endpoint clients.
+static constexpr const long REQUEST_TIMEOUT_US = 100000;
+
+// Interval to poll the endpoint socket and the stop token.
+static constexpr const std::chrono::milliseconds POLL_INTERVAL = std::chrono::milliseconds(100);
+
+/// @brief
+///   Scratch chunk that takes values when chunk allocation failed.
+static std::atomic<uint64_t> ScratchChunk[MetricShard::ChunkSize];
+
+/// @brief
+///   Value of detached gauges.
+static std::atomic<int64_t> ScratchGauge;
+
+MetricShard::MetricShard() noexcept : chunks(), inUse(false) {}
+
+MetricShard::~MetricShard() noexcept {
+    for (auto &chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+auto MetricShard::AllocateChunk(size_t index) noexcept -> std::atomic<uint64_t> * {
+    auto *chunk = new (std::nothrow) std::atomic<uint64_t>[ChunkSize]();
+    if (chunk == nullptr)
+        return ScratchChunk;
+
+    // Release so that readers see zero-initialized slots.
+    chunks[index].store(chunk, std::memory_order_release);
+    return chunk;
+}
+
+MetricGauge::MetricGauge() noexcept : value(&ScratchGauge) {}
+
+auto MetricHistogramSnapshot::Percentile(double quantile) const noexcept -> uint64_t {
+    if (count == 0)
+        return 0;
+
+    const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count)));
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(MetricHistogram::BucketUpperBound(i), max);
+    }
+
+    return max;
+}
+
+/// @brief
+///   Append a label to a metric name that may already have labels.
+static auto AppendLabel(std::string_view name, std::string_view label) -> std::string {
+    if (!name.empty() && name.back() == '}')
+        return std::format("{},{}}}", name.substr(0, name.size() - 1), label);
+    return std::format("{}{{{}}}", name, label);
+}
+
+/// @brief
+///   Append a suffix to base name of a metric name that may have labels.
+static auto AppendSuffix(std::string_view name, std::string_view suffix) -> std::string {
+    const size_t labels = std::min(name.find('{'), name.size());
+    return std::format("{}{}{}", name.substr(0, labels), suffix, name.substr(labels));
+}
+
+auto MetricSnapshot::ToText() const -> std::string {
+    std::string text;
+    auto        out = std::back_inserter(text);
+
+    for (const auto &[name, value] : counters)
+        std::format_to(out, "{} {}\n", name, value);
+
+    for (const auto &[name, value] : gauges)
+        std::format_to(out, "{} {}\n", name, value);
+
+    constexpr const std::pair<std::string_view, double> quantiles[] = {
+        {"0.5", 0.5},
+        {"0.9", 0.9},
+        {"0.99", 0.99},
+        {"0.999", 0.999},
+    };
+
+    for (const auto &histogram : histograms) {
+        for (const auto &[label, quantile] : quantiles)
+            std::format_to(out,
+                           "{} {}\n",
+                           AppendLabel(histogram.name, std::format("quantile=\"{}\"", label)),
+                           histogram.Percentile(quantile));
+
+        std::format_to(out, "{} {}\n", AppendSuffix(histogram.name, "_max"), histogram.max);
+        std::format_to(out, "{} {}\n", AppendSuffix(histogram.name, "_sum"), histogram.sum);
+        std::format_to(out, "{} {}\n", AppendSuffix(histogram.name, "_count"), histogram.count);
+    }
+
+    return text;
+}
+
+MetricRegistry::MetricRegistry() noexcept
+    : entries(),
+      nextSlot(MetricHistogram::SlotCount),
+      gaugeValues(),
+      shards(),
+      collectors(),
+      nextCollectorID(1),
+      exportPath(),
+      exportPort(0),
+      exportInterval(1000),
+      mutex(),
+      exportCondition(),
+      thread() {}
+
+MetricRegistry::~MetricRegistry() noexcept {
+    StopExport();
+}
+
+auto MetricRegistry::GetCounter(std::string_view name) noexcept -> MetricCounter {
+    return MetricCounter(Allocate(name, MetricKind::Counter, 1));
+}
+
+auto MetricRegistry::GetGauge(std::string_view name) noexcept -> MetricGauge {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &entry : entries) {
+        if (entry.kind == MetricKind::Gauge && entry.name == name)
+            return MetricGauge(&gaugeValues[entry.slot]);
+    }
+
+    const uint32_t index = static_cast<uint32_t>(gaugeValues.size());
+    entries.push_back(MetricEntry{std::string(name), MetricKind::Gauge, index});
+    return MetricGauge(&gaugeValues.emplace_back(0));
+}
+
+auto MetricRegistry::GetHistogram(std::string_view name) noexcept -> MetricHistogram {
+    return MetricHistogram(Allocate(name, MetricKind::Histogram, MetricHistogram::SlotCount));
+}
+
+auto MetricRegistry::AddCollector(std::function<void(MetricSnapshot &)> collector) noexcept
+    -> size_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t id = nextCollectorID++;
+    collectors.emplace_back(id, std::move(collector));
+    return id;
+}
+
+auto MetricRegistry::RemoveCollector(size_t id) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::erase_if(collectors, [id](const auto &collector) { return collector.first == id; });
+}
+
+auto MetricRegistry::Snapshot() const -> MetricSnapshot {
+    MetricSnapshot snapshot;
+    snapshot.time = std::chrono::system_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto sum = [this](uint32_t slot) -> uint64_t {
+        uint64_t value = 0;
+        for (const auto &shard : shards)
+            value += shard->Load(slot);
+        return value;
+    };
+
+    for (const auto &entry : entries) {
+        switch (entry.kind) {
+        case MetricKind::Counter:
+            snapshot.counters.emplace_back(entry.name, sum(entry.slot));
+            break;
+
+        case MetricKind::Gauge:
+            snapshot.gauges.emplace_back(
+                entry.name, gaugeValues[entry.slot].load(std::memory_order_relaxed));
+            break;
+
+        case MetricKind::Histogram: {
+            MetricHistogramSnapshot histogram;
+            histogram.name  = entry.name;
+            histogram.count = sum(entry.slot + MetricHistogram::BucketCount);
+            histogram.sum   = sum(entry.slot + MetricHistogram::BucketCount + 1);
+            histogram.max   = 0;
+            for (const auto &shard : shards)
+                histogram.max = std::max(
+                    histogram.max, shard->Load(entry.slot + MetricHistogram::BucketCount + 2));
+
+            histogram.buckets.resize(MetricHistogram::BucketCount);
+            for (uint32_t i = 0; i < MetricHistogram::BucketCount; ++i)
+                histogram.buckets[i] = sum(entry.slot + i);
+
+            snapshot.histograms.push_back(std::move(histogram));
+            break;
+        }
+        }
+    }
+
+    for (const auto &collector : collectors)
+        collector.second(snapshot);
+
+    return snapshot;
+}
+
+auto MetricRegistry::StartExport(std::string_view          path,
+                                 uint16_t                  port,
+                                 std::chrono::milliseconds interval) noexcept -> std::error_code {
+    if (thread.joinable()) {
+        LogWarning("Metric export is already started. Duplicate start is ignored.");
+        return std::error_code();
+    }
+
+    exportPath     = path;
+    exportPort     = port;
+    exportInterval = interval;
+
+    thread = std::jthread([this](std::stop_token stopToken) -> void { Run(stopToken); });
+    return std::error_code();
+}
+
+auto MetricRegistry::StopExport() noexcept -> void {
+    if (!thread.joinable())
+        return;
+
+    thread.request_stop();
+    thread.join();
+}
+
+auto MetricRegistry::GetSingleton() noexcept -> MetricRegistry * {
+    // Leaked on purpose. Log system and thread-local shard leases record metrics while they are
+    // destroyed, which may happen after a function-local static registry is gone.
+    static MetricRegistry *const instance = new MetricRegistry;
+    return instance;
+}
+
+auto MetricRegistry::Allocate(std::string_view name, MetricKind kind, uint32_t slotCount) noexcept
+    -> uint32_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &entry : entries) {
+        if (entry.kind == kind && entry.name == name)
+            return entry.slot;
+    }
+
+    // Log system itself uses metrics, so registry full is not logged.
+    if (nextSlot + slotCount > MetricShard::ChunkSize * MetricShard::ChunkCount)
+        return 0;
+
+    // Keep a histogram inside a single chunk so that recording touches one allocation.
+    if (nextSlot / MetricShard::ChunkSize != (nextSlot + slotCount - 1) / MetricShard::ChunkSize)
+        nextSlot = (nextSlot / MetricShard::ChunkSize + 1) * MetricShard::ChunkSize;
+
+    entries.push_back(MetricEntry{std::string(name), kind, nextSlot});
+    nextSlot += slotCount;
+    return entries.back().slot;
+}
+
+auto MetricRegistry::AcquireShard() noexcept -> MetricShard * {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &shard : shards) {
+        bool expected = false;
+        if (shard->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return shard.get();
+    }
+
+    shards.push_back(std::make_unique<MetricShard>());
+    shards.back()->inUse.store(true, std::memory_order_relaxed);
+    return shards.back().get();
+}
+
+/// @brief
+///   Open a listening socket on 127.0.0.1:port.
+///
+/// @return SOCKET
+///   Return the listening socket. Return INVALID_SOCKET on failure.
+static auto OpenEndpoint(uint16_t port) noexcept -> SOCKET {
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        LogError("Failed to create metric endpoint socket: {}.", WSAGetLastError());
+        return INVALID_SOCKET;
+    }
+
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listenSocket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket, 4) != 0) {
+        LogError("Failed to listen on metric endpoint 127.0.0.1:{}: {}.", port, WSAGetLastError());
+        closesocket(listenSocket);
+        return INVALID_SOCKET;
+    }
+
+    return listenSocket;
+}
+
+/// @brief
+///   Wait until the specified socket is readable.
+///
+/// @return bool
+///   Return true if the socket is readable before timeout.
+static auto WaitReadable(SOCKET target, long timeoutMicroseconds) noexcept -> bool {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(target, &readSet);
+
+    timeval timeout{};
+    timeout.tv_sec  = timeoutMicroseconds / 1000000;
+    timeout.tv_usec = timeoutMicroseconds % 1000000;
+
+    // First parameter is ignored by Winsock.
+    return select(static_cast<int>(target) + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+}
+
+auto MetricRegistry::Run(std::stop_token stopToken) -> void {
+    WSADATA wsaData;
+    bool    wsaStarted   = false;
+    SOCKET  listenSocket = INVALID_SOCKET;
+
+    if (exportPort != 0) {
+        wsaStarted = (WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+        if (wsaStarted)
+            listenSocket = OpenEndpoint(exportPort);
+        else
+            LogError("Failed to start Winsock for metric endpoint.");
+    }
+
+    auto nextExport = std::chrono::steady_clock::now() + exportInterval;
+    while (!stopToken.stop_requested()) {
+        if (listenSocket != INVALID_SOCKET) {
+            const auto pollTime =
+                std::chrono::duration_cast<std::chrono::microseconds>(POLL_INTERVAL).count();
+
+            if (WaitReadable(listenSocket, static_cast<long>(pollTime))) {
+                SOCKET client = accept(listenSocket, nullptr, nullptr);
+                if (client != INVALID_SOCKET) {
+                    // Consume request line of HTTP clients. Plain TCP clients send nothing.
+                    char request[1024];
+                    if (WaitReadable(client, REQUEST_TIMEOUT_US))
+                        recv(client, request, sizeof(request), 0);
+
+                    const std::string body     = Snapshot().ToText();
+                    const std::string response = std::format("HTTP/1.0 200 OK\r\n"
+                                                             "Content-Type: text/plain\r\n"
+                                                             "Content-Length: {}\r\n\r\n{}",
+                                                             body.size(),
+                                                             body);
+
+                    send(client, response.data(), static_cast<int>(response.size()), 0);
+                    shutdown(client, SD_SEND);
+                    closesocket(client);
+                }
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(mutex);
+            exportCondition.wait_for(
+                lock, stopToken, POLL_INTERVAL, []() -> bool { return false; });
+        }
+
+        if (!exportPath.empty() && std::chrono::steady_clock::now() >= nextExport) {
+            WriteSnapshotFile();
+            nextExport += exportInterval;
+        }
+    }
+
+    if (!exportPath.empty())
+        WriteSnapshotFile();
+
+    if (listenSocket != INVALID_SOCKET)
+        closesocket(listenSocket);
+    if (wsaStarted)
+        WSACleanup();
+}
+
+auto MetricRegistry::WriteSnapshotFile() noexcept -> void {
+    const MetricSnapshot snapshot = Snapshot();
+    const std::string    tempPath = exportPath + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_RATE_LIMITED(
+                LogLevel::Error, 0.1, 1, "Failed to open metric snapshot file {}.", tempPath);
+            return;
+        }
+
+        file << std::format("# {:%F %T}\n", snapshot.time) << snapshot.ToText();
+    }
+
+    // Replace the snapshot file at once so that readers never see a partial snapshot.
+    if (!MoveFileExA(tempPath.c_str(), exportPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+        LOG_RATE_LIMITED(LogLevel::Error,
+                         0.1,
+                         1,
+                         "Failed to replace metric snapshot file {}: {}.",
+                         exportPath,
+                         GetLastError());
+}
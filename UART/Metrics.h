@@ -0,0 +1,511 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// @brief
+///   Per-thread storage of metric values. Each shard is written by a single thread, so that
+///   updates are plain relaxed loads and stores without read-modify-write instructions. Readers
+///   sum up all shards.
+class MetricShard {
+public:
+    /// @brief
+    ///   Number of slots in a chunk. Chunks are allocated when first written.
+    static constexpr const size_t ChunkSize = 4096;
+
+    /// @brief
+    ///   Maximum number of chunks in a shard.
+    static constexpr const size_t ChunkCount = 64;
+
+    /// @brief
+    ///   Create an empty shard.
+    MetricShard() noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    MetricShard(const MetricShard &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const MetricShard &) = delete;
+
+    /// @brief
+    ///   Destroy this shard and release all chunks.
+    ~MetricShard() noexcept;
+
+    /// @brief
+    ///   Add value to the specified slot. Only the owner thread of this shard could call this
+    ///   method.
+    ///
+    /// @param slot     Index of the slot.
+    /// @param value    The value to be added.
+    auto Add(uint32_t slot, uint64_t value) noexcept -> void {
+        std::atomic<uint64_t> &target = Slot(slot);
+        target.store(target.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Raise the specified slot to @p value if it is less than @p value. Only the owner thread
+    ///   of this shard could call this method.
+    ///
+    /// @param slot     Index of the slot.
+    /// @param value    The candidate maximum value.
+    auto Max(uint32_t slot, uint64_t value) noexcept -> void {
+        std::atomic<uint64_t> &target = Slot(slot);
+        if (target.load(std::memory_order_relaxed) < value)
+            target.store(value, std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Read value of the specified slot. This method could be called from any thread.
+    ///
+    /// @param slot     Index of the slot.
+    ///
+    /// @return uint64_t
+    ///   Return value of the slot.
+    auto Load(uint32_t slot) const noexcept -> uint64_t {
+        const auto *chunk = chunks[slot / ChunkSize].load(std::memory_order_acquire);
+        return chunk == nullptr ? 0 : chunk[slot % ChunkSize].load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class MetricRegistry;
+
+    /// @brief
+    ///   Get the specified slot and allocate its chunk if necessary.
+    auto Slot(uint32_t slot) noexcept -> std::atomic<uint64_t> & {
+        auto *chunk = chunks[slot / ChunkSize].load(std::memory_order_relaxed);
+        if (chunk == nullptr) [[unlikely]]
+            chunk = AllocateChunk(slot / ChunkSize);
+        return chunk[slot % ChunkSize];
+    }
+
+    /// @brief
+    ///   Allocate the specified chunk.
+    ///
+    /// @return std::atomic<uint64_t> *
+    ///   Return pointer to the new chunk. A shared scratch chunk is returned if allocation
+    ///   failed, so values written to it are lost.
+    auto AllocateChunk(size_t index) noexcept -> std::atomic<uint64_t> *;
+
+private:
+    /// @brief
+    ///   Slot chunks.
+    std::array<std::atomic<std::atomic<uint64_t> *>, ChunkCount> chunks;
+
+    /// @brief
+    ///   Whether this shard is owned by a living thread.
+    std::atomic<bool> inUse;
+};
+
+class MetricCounter {
+public:
+    /// @brief
+    ///   Create a detached counter. Values added to it are discarded.
+    MetricCounter() noexcept : slot(0) {}
+
+    /// @brief
+    ///   Add value to this counter.
+    ///
+    /// @param value    The value to be added.
+    auto Add(uint64_t value = 1) const noexcept -> void;
+
+private:
+    friend class MetricRegistry;
+
+    /// @brief
+    ///   Create a counter for the specified slot.
+    explicit MetricCounter(uint32_t slot) noexcept : slot(slot) {}
+
+    /// @brief
+    ///   Slot of this counter.
+    uint32_t slot;
+};
+
+class MetricGauge {
+public:
+    /// @brief
+    ///   Create a detached gauge. Values set to it are discarded.
+    MetricGauge() noexcept;
+
+    /// @brief
+    ///   Set value of this gauge.
+    ///
+    /// @param newValue     The new value.
+    auto Set(int64_t newValue) const noexcept -> void {
+        value->store(newValue, std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Add value to this gauge.
+    ///
+    /// @param delta    The value to be added. May be negative.
+    auto Add(int64_t delta) const noexcept -> void {
+        value->fetch_add(delta, std::memory_order_relaxed);
+    }
+
+private:
+    friend class MetricRegistry;
+
+    /// @brief
+    ///   Create a gauge for the specified value.
+    explicit MetricGauge(std::atomic<int64_t> *value) noexcept : value(value) {}
+
+    /// @brief
+    ///   Value of this gauge.
+    std::atomic<int64_t> *value;
+};
+
+class MetricHistogram {
+public:
+    /// @brief
+    ///   Each power of two is split into 2^SubBucketBits linear buckets, so that relative error
+    ///   of recorded values is less than 1/16.
+    static constexpr const uint32_t SubBucketBits = 4;
+
+    /// @brief
+    ///   Number of linear buckets per power of two.
+    static constexpr const uint32_t SubBucketCount = 1U << SubBucketBits;
+
+    /// @brief
+    ///   Number of buckets that covers the whole uint64_t range.
+    static constexpr const uint32_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+    /// @brief
+    ///   Number of slots of a histogram: buckets, count, sum and max.
+    static constexpr const uint32_t SlotCount = BucketCount + 3;
+
+    /// @brief
+    ///   Create a detached histogram. Values recorded to it are discarded.
+    MetricHistogram() noexcept : slot(0) {}
+
+    /// @brief
+    ///   Record a value to this histogram.
+    ///
+    /// @param value    The value to be recorded.
+    auto Record(uint64_t value) const noexcept -> void;
+
+    /// @brief
+    ///   Record nanoseconds elapsed since @p start to this histogram.
+    ///
+    /// @param start    Start time of the measured operation.
+    auto RecordSince(std::chrono::steady_clock::time_point start) const noexcept -> void {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    /// @brief
+    ///   Get bucket index of the specified value.
+    static constexpr auto BucketIndex(uint64_t value) noexcept -> uint32_t {
+        if (value < SubBucketCount)
+            return static_cast<uint32_t>(value);
+
+        const uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+        const uint32_t shift    = exponent - SubBucketBits;
+        return (shift + 1) * SubBucketCount +
+               static_cast<uint32_t>((value >> shift) & (SubBucketCount - 1));
+    }
+
+    /// @brief
+    ///   Get the largest value that falls into the specified bucket.
+    static constexpr auto BucketUpperBound(uint32_t index) noexcept -> uint64_t {
+        if (index < SubBucketCount)
+            return index;
+
+        const uint32_t shift = index / SubBucketCount - 1;
+        const uint64_t lower = uint64_t(SubBucketCount + index % SubBucketCount) << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    friend class MetricRegistry;
+
+    /// @brief
+    ///   Create a histogram for the specified slots.
+    explicit MetricHistogram(uint32_t slot) noexcept : slot(slot) {}
+
+    /// @brief
+    ///   First slot of this histogram.
+    uint32_t slot;
+};
+
+struct MetricHistogramSnapshot {
+    /// @brief
+    ///   Name of the histogram.
+    std::string name;
+
+    /// @brief
+    ///   Number of recorded values.
+    uint64_t count;
+
+    /// @brief
+    ///   Sum of recorded values.
+    uint64_t sum;
+
+    /// @brief
+    ///   Maximum recorded value.
+    uint64_t max;
+
+    /// @brief
+    ///   Number of values in each bucket.
+    std::vector<uint64_t> buckets;
+
+    /// @brief
+    ///   Get the value at the specified quantile.
+    ///
+    /// @param quantile     The quantile in range [0, 1].
+    ///
+    /// @return uint64_t
+    ///   Return upper bound of the bucket that contains the quantile, clamped to the maximum
+    ///   recorded value. Return 0 if the histogram is empty.
+    auto Percentile(double quantile) const noexcept -> uint64_t;
+};
+
+struct MetricSnapshot {
+    /// @brief
+    ///   Time that this snapshot is taken.
+    std::chrono::system_clock::time_point time;
+
+    /// @brief
+    ///   Counter names and values.
+    std::vector<std::pair<std::string, uint64_t>> counters;
+
+    /// @brief
+    ///   Gauge names and values.
+    std::vector<std::pair<std::string, int64_t>> gauges;
+
+    /// @brief
+    ///   Histograms.
+    std::vector<MetricHistogramSnapshot> histograms;
+
+    /// @brief
+    ///   Format this snapshot in Prometheus text exposition format. Histograms are exported as
+    ///   summaries with p50, p90, p99 and p99.9 quantiles.
+    ///
+    /// @return std::string
+    ///   Return the formatted text.
+    auto ToText() const -> std::string;
+};
+
+class MetricRegistry {
+public:
+    /// @brief
+    ///   Create an empty metric registry.
+    MetricRegistry() noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    MetricRegistry(const MetricRegistry &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const MetricRegistry &) = delete;
+
+    /// @brief
+    ///   Stop exporting and destroy this registry.
+    ~MetricRegistry() noexcept;
+
+    /// @brief
+    ///   Get or create the counter with the specified name. Labels could be attached in
+    ///   Prometheus style, e.g. serial_reads{port="COM3"}.
+    ///
+    /// @param name     Name of the counter.
+    ///
+    /// @return MetricCounter
+    ///   Return the counter. Return a detached counter if the registry is full.
+    auto GetCounter(std::string_view name) noexcept -> MetricCounter;
+
+    /// @brief
+    ///   Get or create the gauge with the specified name.
+    ///
+    /// @param name     Name of the gauge.
+    ///
+    /// @return MetricGauge
+    ///   Return the gauge.
+    auto GetGauge(std::string_view name) noexcept -> MetricGauge;
+
+    /// @brief
+    ///   Get or create the histogram with the specified name.
+    ///
+    /// @param name     Name of the histogram.
+    ///
+    /// @return MetricHistogram
+    ///   Return the histogram. Return a detached histogram if the registry is full.
+    auto GetHistogram(std::string_view name) noexcept -> MetricHistogram;
+
+    /// @brief
+    ///   Add a collector that appends values to each snapshot. Collectors are used to expose
+    ///   statistics that are already maintained elsewhere without touching hot paths.
+    ///
+    /// @param collector    The collector. It is called with the registry lock held, so it must
+    ///                     not access this registry.
+    ///
+    /// @return size_t
+    ///   Return ID of the collector.
+    auto AddCollector(std::function<void(MetricSnapshot &)> collector) noexcept -> size_t;
+
+    /// @brief
+    ///   Remove the specified collector. Objects that add collectors must remove them before
+    ///   destruction.
+    ///
+    /// @param id   ID of the collector.
+    auto RemoveCollector(size_t id) noexcept -> void;
+
+    /// @brief
+    ///   Take a snapshot of all metrics.
+    ///
+    /// @return MetricSnapshot
+    ///   Return the snapshot.
+    auto Snapshot() const -> MetricSnapshot;
+
+    /// @brief
+    ///   Start exporting snapshots. Snapshots are written to @p path periodically, and served as
+    ///   plain text to clients connecting to 127.0.0.1:@p port.
+    ///
+    /// @param path         Path to the snapshot file. Pass empty string to disable file export.
+    /// @param port         Local TCP port. Pass 0 to disable the text endpoint.
+    /// @param interval     Interval to write the snapshot file.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the start result.
+    auto StartExport(std::string_view          path,
+                     uint16_t                  port,
+                     std::chrono::milliseconds interval) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Stop exporting snapshots. The snapshot file is written once more before return.
+    auto StopExport() noexcept -> void;
+
+    /// @brief
+    ///   Get shard of current thread.
+    static auto LocalShard() noexcept -> MetricShard & {
+        thread_local MetricShardLease lease(GetSingleton());
+        return *lease.shard;
+    }
+
+    /// @brief
+    ///   Get the global metric registry. The global registry is never destroyed, so metrics could
+    ///   be recorded until the process exits. Call StopExport before exit to write the last
+    ///   snapshot.
+    static auto GetSingleton() noexcept -> MetricRegistry *;
+
+private:
+    /// @brief
+    ///   Lease of a shard for the lifetime of a thread.
+    struct MetricShardLease {
+        explicit MetricShardLease(MetricRegistry *registry) noexcept
+            : shard(registry->AcquireShard()) {}
+
+        ~MetricShardLease() noexcept {
+            shard->inUse.store(false, std::memory_order_release);
+        }
+
+        MetricShard *shard;
+    };
+
+    enum class MetricKind {
+        Counter,
+        Gauge,
+        Histogram,
+    };
+
+    struct MetricEntry {
+        std::string name;
+        MetricKind  kind;
+        uint32_t    slot;
+    };
+
+    /// @brief
+    ///   Find or allocate slots of the specified metric.
+    ///
+    /// @return uint32_t
+    ///   Return first slot of the metric. Return 0 if the registry is full.
+    auto Allocate(std::string_view name, MetricKind kind, uint32_t slotCount) noexcept -> uint32_t;
+
+    /// @brief
+    ///   Get a shard that is not owned by any thread, or create a new one.
+    auto AcquireShard() noexcept -> MetricShard *;
+
+    /// @brief
+    ///   Export thread entry.
+    auto Run(std::stop_token stopToken) -> void;
+
+    /// @brief
+    ///   Write current snapshot to the snapshot file.
+    auto WriteSnapshotFile() noexcept -> void;
+
+private:
+    /// @brief
+    ///   Registered metrics.
+    std::vector<MetricEntry> entries;
+
+    /// @brief
+    ///   Next free slot. Slots of the first histogram are reserved for detached counters and
+    ///   histograms.
+    uint32_t nextSlot;
+
+    /// @brief
+    ///   Gauge values. Deque keeps their addresses stable.
+    std::deque<std::atomic<int64_t>> gaugeValues;
+
+    /// @brief
+    ///   All shards ever created. Shards are reused but never released, so that values of exited
+    ///   threads are kept.
+    std::vector<std::unique_ptr<MetricShard>> shards;
+
+    /// @brief
+    ///   Snapshot collectors and their IDs.
+    std::vector<std::pair<size_t, std::function<void(MetricSnapshot &)>>> collectors;
+
+    /// @brief
+    ///   ID of next collector.
+    size_t nextCollectorID;
+
+    /// @brief
+    ///   Path to the snapshot file.
+    std::string exportPath;
+
+    /// @brief
+    ///   Local TCP port of the text endpoint.
+    uint16_t exportPort;
+
+    /// @brief
+    ///   Interval to write the snapshot file.
+    std::chrono::milliseconds exportInterval;
+
+    /// @brief
+    ///   Mutex that is used to protect metric entries, shards and collectors.
+    mutable std::mutex mutex;
+
+    /// @brief
+    ///   Condition variable that is used to wait for next export.
+    std::condition_variable_any exportCondition;
+
+    /// @brief
+    ///   Export thread. Declared last so that it starts after other members.
+    std::jthread thread;
+};
+
+inline auto MetricCounter::Add(uint64_t value) const noexcept -> void {
+    MetricRegistry::LocalShard().Add(slot, value);
+}
+
+inline auto MetricHistogram::Record(uint64_t value) const noexcept -> void {
+    MetricShard &shard = MetricRegistry::LocalShard();
+    shard.Add(slot + BucketIndex(value), 1);
+    shard.Add(slot + BucketCount, 1);
+    shard.Add(slot + BucketCount + 1, value);
+    shard.Max(slot + BucketCount + 2, value);
+}
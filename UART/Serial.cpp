@@ -1,19 +1,44 @@
 #include "Serial.h"
 #include "Log.h"
+#include "Trace.h"
 
 #include <cassert>
 
+// Size in byte of the driver input and output queue.
+static constexpr const DWORD QUEUE_SIZE = 4096;
+
+/// @brief
+///   Get name of a per-port metric.
+static auto MetricName(std::string_view metric, std::string_view port) -> std::string {
+    return std::format("{}{{port=\"{}\"}}", metric, port);
+}
+
 Serial::Serial() noexcept
     : IAsync(),
       fileHandle(INVALID_HANDLE_VALUE),
       port(),
+      baudRate(),
       overlappedRead(),
       overlappedWrite(),
       readBuffer(),
       bytesRead(),
+      readTime(),
+      bytesReceived(0),
+      overrunErrors(0),
+      inputOverflowErrors(0),
+      framingErrors(0),
+      parityErrors(0),
+      breaks(0),
+      peakInputQueue(0),
+      readCounter(),
+      readSizeHistogram(),
+      metricCollector(0),
       dataToWrite() {}
 
 Serial::~Serial() noexcept {
+    if (metricCollector != 0)
+        MetricRegistry::GetSingleton()->RemoveCollector(metricCollector);
+
     if (fileHandle != INVALID_HANDLE_VALUE) {
         assert(overlappedRead.hEvent != nullptr);
         assert(overlappedWrite.hEvent != nullptr);
@@ -54,7 +79,7 @@ auto Serial::Initialize(std::string_view portName, uint32_t baudRate) noexcept -
     }
 
     // Setup a 4k buffer.
-    SetupComm(fileHandle, 4096, 4096);
+    SetupComm(fileHandle, QUEUE_SIZE, QUEUE_SIZE);
 
     // Configure port.
     DCB dcb;
@@ -88,6 +113,30 @@ auto Serial::Initialize(std::string_view portName, uint32_t baudRate) noexcept -
         return std::error_code(errorCode, std::system_category());
     }
 
+    this->baudRate = baudRate;
+
+    // Register metrics.
+    MetricRegistry *registry = MetricRegistry::GetSingleton();
+    readCounter              = registry->GetCounter(MetricName("serial_reads", portName));
+    readSizeHistogram        = registry->GetHistogram(MetricName("serial_read_bytes", portName));
+    metricCollector          = registry->AddCollector(
+        [this, name = std::string(portName)](MetricSnapshot &snapshot) -> void {
+            const SerialStatistics statistics = GetStatistics();
+            snapshot.counters.emplace_back(MetricName("serial_bytes_received", name),
+                                           statistics.bytesReceived);
+            snapshot.counters.emplace_back(MetricName("serial_overrun_errors", name),
+                                           statistics.overrunErrors);
+            snapshot.counters.emplace_back(MetricName("serial_input_overflow_errors", name),
+                                           statistics.inputOverflowErrors);
+            snapshot.counters.emplace_back(MetricName("serial_framing_errors", name),
+                                           statistics.framingErrors);
+            snapshot.counters.emplace_back(MetricName("serial_parity_errors", name),
+                                           statistics.parityErrors);
+            snapshot.counters.emplace_back(MetricName("serial_breaks", name), statistics.breaks);
+            snapshot.gauges.emplace_back(MetricName("serial_peak_input_queue_bytes", name),
+                                         statistics.peakInputQueue);
+        });
+
     // Clear buffer.
     PurgeComm(fileHandle, PURGE_TXCLEAR | PURGE_TXABORT | PURGE_RXCLEAR | PURGE_RXABORT);
 
@@ -104,19 +153,33 @@ auto Serial::OnRegister() noexcept -> void {
 
 auto Serial::OnIOComplete(DWORD bytesTransferred, OVERLAPPED *overlapped) noexcept -> void {
     if (overlapped == &overlappedRead) {
+        readTime = std::chrono::steady_clock::now();
+
         if (bytesTransferred != bytesRead)
-            LogInfo(
+            LOG_SAMPLED(
+                LogLevel::Info,
+                10,
+                1000,
                 "IO complete port transferred bytes {} is different from overlapped IO bytes {}.",
                 bytesTransferred,
                 bytesRead);
 
-        if (bytesRead != 0)
+        readCounter.Add();
+        readSizeHistogram.Record(bytesRead);
+
+        if (bytesRead != 0) {
+            bytesReceived.fetch_add(bytesRead, std::memory_order_relaxed);
             this->OnRead(readBuffer, bytesRead);
+        }
 
         std::error_code errorCode = AsyncRead();
         if (errorCode.value() != 0)
-            LogError(
-                "Failed to start async read task for serial {}: {}.", port, errorCode.message());
+            LOG_RATE_LIMITED(LogLevel::Error,
+                             1.0,
+                             5,
+                             "Failed to start async read task for serial {}: {}.",
+                             port,
+                             errorCode.message());
     } else if (overlapped == &overlappedWrite) {
         OnWriteComplete();
 
@@ -139,6 +202,19 @@ auto Serial::GetHandle() const noexcept -> HANDLE {
     return fileHandle;
 }
 
+auto Serial::GetStatistics() const noexcept -> SerialStatistics {
+    SerialStatistics statistics;
+    statistics.bytesReceived       = bytesReceived.load(std::memory_order_relaxed);
+    statistics.overrunErrors       = overrunErrors.load(std::memory_order_relaxed);
+    statistics.inputOverflowErrors = inputOverflowErrors.load(std::memory_order_relaxed);
+    statistics.framingErrors       = framingErrors.load(std::memory_order_relaxed);
+    statistics.parityErrors        = parityErrors.load(std::memory_order_relaxed);
+    statistics.breaks              = breaks.load(std::memory_order_relaxed);
+    statistics.peakInputQueue      = peakInputQueue.load(std::memory_order_relaxed);
+    statistics.inputQueueSize      = QUEUE_SIZE;
+    return statistics;
+}
+
 auto Serial::AsyncWrite(const void *data, size_t size) noexcept -> void {
     std::lock_guard<std::mutex> lock(writeMutex);
     dataToWrite.emplace(static_cast<const std::byte *>(data),
@@ -159,24 +235,62 @@ auto Serial::OnRead(const void *data, size_t size) noexcept -> void {
 auto Serial::OnWriteComplete() noexcept -> void {}
 
 auto Serial::AsyncRead() noexcept -> std::error_code {
+    TRACE_SPAN("Serial::AsyncRead");
+
     DWORD   errorCode;
     COMSTAT comStat;
 
     ResetEvent(overlappedRead.hEvent);
     if (!ClearCommError(fileHandle, &errorCode, &comStat)) {
         errorCode = GetLastError();
-        LogError("Failed to clear comm error for serial {}: {}.", port, errorCode);
+        LOG_RATE_LIMITED(LogLevel::Error,
+                         1.0,
+                         5,
+                         "Failed to clear comm error for serial {}: {}.",
+                         port,
+                         errorCode);
         return std::error_code(errorCode, std::system_category());
     }
 
+    // Only IO thread starts read operations, so relaxed load and store are enough here.
+    if (errorCode != 0) {
+        if (errorCode & CE_OVERRUN)
+            overrunErrors.fetch_add(1, std::memory_order_relaxed);
+        if (errorCode & CE_RXOVER)
+            inputOverflowErrors.fetch_add(1, std::memory_order_relaxed);
+        if (errorCode & CE_FRAME)
+            framingErrors.fetch_add(1, std::memory_order_relaxed);
+        if (errorCode & CE_RXPARITY)
+            parityErrors.fetch_add(1, std::memory_order_relaxed);
+        if (errorCode & CE_BREAK)
+            breaks.fetch_add(1, std::memory_order_relaxed);
+
+        LOG_RATE_LIMITED(LogLevel::Warning,
+                         1.0,
+                         5,
+                         "Serial {} driver reported comm error 0x{:X}. Received data may be lost.",
+                         port,
+                         errorCode);
+    }
+
+    if (comStat.cbInQue > peakInputQueue.load(std::memory_order_relaxed))
+        peakInputQueue.store(comStat.cbInQue, std::memory_order_relaxed);
+
     const DWORD readSize = comStat.cbInQue < static_cast<DWORD>(sizeof(readBuffer))
                                ? comStat.cbInQue
                                : static_cast<DWORD>(sizeof(readBuffer));
 
     if (!ReadFile(fileHandle, readBuffer, readSize, &bytesRead, &overlappedRead)) {
         errorCode = GetLastError();
-        LogError("Failed to start overlapped read task for serial {}: {}.", port, errorCode);
-        return std::error_code(errorCode, std::system_category());
+        if (errorCode != ERROR_IO_PENDING) {
+            LOG_RATE_LIMITED(LogLevel::Error,
+                             1.0,
+                             5,
+                             "Failed to start overlapped read task for serial {}: {}.",
+                             port,
+                             errorCode);
+            return std::error_code(errorCode, std::system_category());
+        }
     }
 
     return std::error_code();
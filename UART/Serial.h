@@ -1,12 +1,51 @@
 #pragma once
 
 #include "IAsync.h"
+#include "Metrics.h"
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <queue>
 #include <system_error>
 #include <vector>
 
+struct SerialStatistics {
+    /// @brief
+    ///   Number of bytes received.
+    uint64_t bytesReceived;
+
+    /// @brief
+    ///   Number of times that the hardware receive buffer overran (CE_OVERRUN). Bytes are lost
+    ///   before reaching the driver.
+    uint64_t overrunErrors;
+
+    /// @brief
+    ///   Number of times that the driver input queue overflowed (CE_RXOVER). Bytes are lost
+    ///   because the application does not read fast enough.
+    uint64_t inputOverflowErrors;
+
+    /// @brief
+    ///   Number of framing errors detected by the hardware (CE_FRAME).
+    uint64_t framingErrors;
+
+    /// @brief
+    ///   Number of parity errors detected by the hardware (CE_RXPARITY).
+    uint64_t parityErrors;
+
+    /// @brief
+    ///   Number of break conditions detected by the hardware (CE_BREAK).
+    uint64_t breaks;
+
+    /// @brief
+    ///   Maximum number of bytes observed in the driver input queue.
+    uint32_t peakInputQueue;
+
+    /// @brief
+    ///   Size in byte of the driver input queue.
+    uint32_t inputQueueSize;
+};
+
 class Serial : public IAsync {
 public:
     /// @brief
@@ -39,6 +78,41 @@ public:
     ///   Get win32 native handle so that IO complete port could register this object.
     auto GetHandle() const noexcept -> HANDLE final;
 
+    /// @brief
+    ///   Get name of the port that this serial is connected to.
+    ///
+    /// @return std::string_view
+    ///   Return the port name. The port name is empty if this serial is not initialized.
+    auto GetPortName() const noexcept -> std::string_view {
+        return port;
+    }
+
+    /// @brief
+    ///   Get baud rate of this serial.
+    ///
+    /// @return uint32_t
+    ///   Return the baud rate. Return 0 if this serial is not initialized.
+    auto GetBaudRate() const noexcept -> uint32_t {
+        return baudRate;
+    }
+
+    /// @brief
+    ///   Get number of bytes received by this serial.
+    ///
+    /// @return uint64_t
+    ///   Return number of bytes received since this serial is created.
+    auto GetBytesReceived() const noexcept -> uint64_t {
+        return bytesReceived.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Get driver error counters and input queue statistics of this serial. Counters are
+    ///   collected each time a read operation is started.
+    ///
+    /// @return SerialStatistics
+    ///   Return a snapshot of the statistics.
+    auto GetStatistics() const noexcept -> SerialStatistics;
+
     /// @brief
     ///   Pend data to write to this serial.
     auto AsyncWrite(const void *data, size_t size) noexcept -> void;
@@ -54,6 +128,16 @@ public:
     ///   Write complete callback.
     virtual auto OnWriteComplete() noexcept -> void;
 
+protected:
+    /// @brief
+    ///   Get completion time of the read operation whose data is being delivered to OnRead.
+    ///
+    /// @return std::chrono::steady_clock::time_point
+    ///   Return the read completion time. Only valid in OnRead.
+    auto GetReadTime() const noexcept -> std::chrono::steady_clock::time_point {
+        return readTime;
+    }
+
 private:
     /// @brief
     ///   Start async read task.
@@ -78,6 +162,10 @@ private:
     ///   Port of this serial that is connected to.
     std::string port;
 
+    /// @brief
+    ///   Baud rate of this serial.
+    uint32_t baudRate;
+
     /// @brief
     ///   Overlapped struct that is used to synchronize with read operations.
     OVERLAPPED overlappedRead;
@@ -94,6 +182,50 @@ private:
     ///   Bytes read from read buffer in the specified read operation.
     DWORD bytesRead;
 
+    /// @brief
+    ///   Completion time of last read operation.
+    std::chrono::steady_clock::time_point readTime;
+
+    /// @brief
+    ///   Number of bytes received by this serial.
+    std::atomic<uint64_t> bytesReceived;
+
+    /// @brief
+    ///   Number of hardware overrun errors.
+    std::atomic<uint64_t> overrunErrors;
+
+    /// @brief
+    ///   Number of driver input queue overflow errors.
+    std::atomic<uint64_t> inputOverflowErrors;
+
+    /// @brief
+    ///   Number of framing errors.
+    std::atomic<uint64_t> framingErrors;
+
+    /// @brief
+    ///   Number of parity errors.
+    std::atomic<uint64_t> parityErrors;
+
+    /// @brief
+    ///   Number of break conditions.
+    std::atomic<uint64_t> breaks;
+
+    /// @brief
+    ///   Maximum number of bytes observed in the driver input queue.
+    std::atomic<uint32_t> peakInputQueue;
+
+    /// @brief
+    ///   Number of completed read operations.
+    MetricCounter readCounter;
+
+    /// @brief
+    ///   Size in byte of completed read operations.
+    MetricHistogram readSizeHistogram;
+
+    /// @brief
+    ///   ID of the metric collector that exports statistics of this serial.
+    size_t metricCollector;
+
     /// @brief
     ///   Data to be written to serial.
     std::queue<std::vector<std::byte>> dataToWrite;
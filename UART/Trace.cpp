@@ -0,0 +1,142 @@
+#include "Trace.h"
+#include "Log.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <fstream>
+
+TraceBuffer::TraceBuffer(uint32_t threadID) noexcept
+    : threadID(threadID), head(0), events(new TraceEvent[Capacity]) {}
+
+TraceBuffer::~TraceBuffer() noexcept {}
+
+auto TraceBuffer::CopyTo(std::vector<TraceEvent> &output) const noexcept -> void {
+    const uint64_t end   = head.load(std::memory_order_acquire);
+    const uint64_t begin = end > Capacity ? end - Capacity : 0;
+
+    const size_t offset = output.size();
+    for (uint64_t i = begin; i != end; ++i)
+        output.push_back(events[i & (Capacity - 1)]);
+
+    // The owner thread may have overwritten the oldest events during the copy. The slot of the
+    // event being written is not safe either.
+    const uint64_t current   = head.load(std::memory_order_acquire);
+    const uint64_t firstSafe = current + 1 > Capacity ? current + 1 - Capacity : 0;
+    if (firstSafe > begin) {
+        const size_t overwritten = static_cast<size_t>(std::min(firstSafe, end) - begin);
+        output.erase(output.begin() + static_cast<ptrdiff_t>(offset),
+                     output.begin() + static_cast<ptrdiff_t>(offset + overwritten));
+    }
+}
+
+TraceSystem::TraceSystem() noexcept : buffers(), names(), baseTick(0), baseTime(), mutex() {}
+
+TraceSystem::~TraceSystem() noexcept {}
+
+auto TraceSystem::SetEnabled(bool enable) noexcept -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enable == enabled.load(std::memory_order_relaxed))
+        return;
+
+    if (enable) {
+        baseTime = std::chrono::steady_clock::now();
+        baseTick = ReadTraceClock();
+    }
+
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+auto TraceSystem::Dump(std::string_view path) noexcept -> std::error_code {
+    std::vector<TraceEvent>                  events;
+    std::vector<std::pair<uint32_t, size_t>> threadEvents;
+    std::chrono::steady_clock::time_point    startTime;
+    uint64_t                                 startTick;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &buffer : buffers) {
+            buffer->CopyTo(events);
+            threadEvents.emplace_back(buffer->GetThreadID(), events.size());
+        }
+
+        startTime = baseTime;
+        startTick = baseTick;
+    }
+
+    // Calibrate trace clock against steady clock over the whole tracing period.
+    const uint64_t endTick = ReadTraceClock();
+    const double   elapsed =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime)
+            .count();
+
+    if (startTick == 0 || endTick <= startTick || elapsed <= 0) {
+        LogWarning("No trace event to dump. Enable tracing first.");
+        return std::make_error_code(std::errc::operation_not_permitted);
+    }
+
+    const double ticksPerMicrosecond = static_cast<double>(endTick - startTick) / elapsed;
+
+    std::ofstream file{std::string(path), std::ios::trunc};
+    if (!file.is_open()) {
+        LogError("Failed to open trace file {}.", path);
+        return std::make_error_code(std::errc::permission_denied);
+    }
+
+    std::string text;
+    text.reserve(events.size() * 128);
+    text.append(R"({"displayTimeUnit": "ns", "traceEvents": [)");
+
+    bool   first = true;
+    size_t index = 0;
+    for (const auto &[threadID, end] : threadEvents) {
+        for (; index < end; ++index) {
+            const TraceEvent &event = events[index];
+            if (event.start < startTick || event.end < event.start)
+                continue;
+
+            std::format_to(std::back_inserter(text),
+                           R"({}{{"name": "{}", "ph": "X", "pid": 1, "tid": {}, "ts": {:.3f}, )"
+                           R"("dur": {:.3f}, "args": {{"arg": {}}}}})",
+                           first ? "\n" : ",\n",
+                           event.name,
+                           threadID,
+                           static_cast<double>(event.start - startTick) / ticksPerMicrosecond,
+                           static_cast<double>(event.end - event.start) / ticksPerMicrosecond,
+                           event.argument);
+            first = false;
+        }
+    }
+
+    text.append("\n]}\n");
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!file) {
+        LogError("Failed to write trace file {}.", path);
+        return std::make_error_code(std::errc::io_error);
+    }
+
+    LogInfo(
+        "Dumped {} trace events of {} threads to {}.", events.size(), threadEvents.size(), path);
+    return std::error_code();
+}
+
+auto TraceSystem::Intern(std::string_view name) noexcept -> const char * {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto                        iter = names.find(name);
+    if (iter == names.end())
+        iter = names.emplace(name).first;
+    return iter->c_str();
+}
+
+auto TraceSystem::GetSingleton() noexcept -> TraceSystem * {
+    // Leaked on purpose. Thread-local buffer pointers outlive a function-local static, and the log
+    // writer still traces while the log system is destroyed at exit.
+    static TraceSystem *const instance = new TraceSystem;
+    return instance;
+}
+
+auto TraceSystem::CreateBuffer() noexcept -> TraceBuffer * {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.push_back(std::make_unique<TraceBuffer>(static_cast<uint32_t>(GetCurrentThreadId())));
+    return buffers.back().get();
+}
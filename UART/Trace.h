@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#    else
+#        include <x86intrin.h>
+#    endif
+#    define TRACE_HAS_TSC 1
+#else
+#    define TRACE_HAS_TSC 0
+#endif
+
+#ifndef TRACE_COMPILE_ENABLED
+#    define TRACE_COMPILE_ENABLED 1
+#endif
+
+/// @brief
+///   Read the timestamp counter. Falls back to steady clock on platforms without TSC.
+///
+/// @return uint64_t
+///   Return current tick count.
+inline auto ReadTraceClock() noexcept -> uint64_t {
+#if TRACE_HAS_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct TraceEvent {
+    /// @brief
+    ///   Name of the span. Must be a string literal or an interned string.
+    const char *name;
+
+    /// @brief
+    ///   Start tick of the span.
+    uint64_t start;
+
+    /// @brief
+    ///   End tick of the span.
+    uint64_t end;
+
+    /// @brief
+    ///   User defined argument of the span.
+    uint64_t argument;
+};
+
+/// @brief
+///   Per-thread ring buffer of trace events. Events are written by the owner thread only and the
+///   oldest events are overwritten once the ring is full.
+class TraceBuffer {
+public:
+    /// @brief
+    ///   Number of events kept per thread. Must be a power of 2.
+    static constexpr const size_t Capacity = 64 * 1024;
+
+    /// @brief
+    ///   Create a trace buffer for the specified thread.
+    ///
+    /// @param threadID     ID of the owner thread.
+    explicit TraceBuffer(uint32_t threadID) noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    TraceBuffer(const TraceBuffer &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const TraceBuffer &) = delete;
+
+    /// @brief
+    ///   Destroy this trace buffer.
+    ~TraceBuffer() noexcept;
+
+    /// @brief
+    ///   Append an event. Only the owner thread could call this method.
+    auto Push(const char *name, uint64_t start, uint64_t end, uint64_t argument) noexcept -> void {
+        const uint64_t index = head.load(std::memory_order_relaxed);
+        events[index & (Capacity - 1)] = TraceEvent{name, start, end, argument};
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    /// @brief
+    ///   Copy events that are still in the ring. Events overwritten during the copy are dropped.
+    ///
+    /// @param[out] output  Events are appended to this vector.
+    auto CopyTo(std::vector<TraceEvent> &output) const noexcept -> void;
+
+    /// @brief
+    ///   Get ID of the owner thread.
+    auto GetThreadID() const noexcept -> uint32_t {
+        return threadID;
+    }
+
+private:
+    /// @brief
+    ///   ID of the owner thread.
+    uint32_t threadID;
+
+    /// @brief
+    ///   Number of events ever pushed.
+    std::atomic<uint64_t> head;
+
+    /// @brief
+    ///   The event ring.
+    std::unique_ptr<TraceEvent[]> events;
+};
+
+class TraceSystem {
+public:
+    /// @brief
+    ///   Create a disabled trace system.
+    TraceSystem() noexcept;
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    TraceSystem(const TraceSystem &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const TraceSystem &) = delete;
+
+    /// @brief
+    ///   Destroy this trace system.
+    ~TraceSystem() noexcept;
+
+    /// @brief
+    ///   Check whether tracing is enabled. This is a single relaxed load.
+    static auto IsEnabled() noexcept -> bool {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief
+    ///   Enable or disable tracing. Clock calibration starts when tracing is enabled.
+    ///
+    /// @param enable   Whether to enable tracing.
+    auto SetEnabled(bool enable) noexcept -> void;
+
+    /// @brief
+    ///   Write events of all threads to the specified file in Chrome trace event format. The file
+    ///   could be opened with chrome://tracing or Perfetto.
+    ///
+    /// @param path     Path to the trace file.
+    ///
+    /// @return std::error_code
+    ///   Return an error code that represents the dump result.
+    auto Dump(std::string_view path) noexcept -> std::error_code;
+
+    /// @brief
+    ///   Get a stable C string that is equal to @p name. Used for span names built at runtime.
+    ///
+    /// @param name     The span name.
+    ///
+    /// @return const char *
+    ///   Return the interned name. It is valid until the trace system is destroyed.
+    auto Intern(std::string_view name) noexcept -> const char *;
+
+    /// @brief
+    ///   Get trace buffer of current thread.
+    static auto LocalBuffer() noexcept -> TraceBuffer & {
+        thread_local TraceBuffer *buffer = GetSingleton()->CreateBuffer();
+        return *buffer;
+    }
+
+    /// @brief
+    ///   Get the global trace system. It is never destroyed, so that spans traced during static
+    ///   destruction still find their buffers.
+    static auto GetSingleton() noexcept -> TraceSystem *;
+
+private:
+    /// @brief
+    ///   Create a trace buffer for current thread.
+    auto CreateBuffer() noexcept -> TraceBuffer *;
+
+private:
+    /// @brief
+    ///   Whether tracing is enabled.
+    static inline std::atomic<bool> enabled = false;
+
+    /// @brief
+    ///   Trace buffers of all threads that have traced. Buffers are kept after their threads
+    ///   exit so that their events could still be dumped.
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+    /// @brief
+    ///   Interned span names.
+    std::set<std::string, std::less<>> names;
+
+    /// @brief
+    ///   Trace clock tick when tracing is enabled.
+    uint64_t baseTick;
+
+    /// @brief
+    ///   Steady clock time when tracing is enabled.
+    std::chrono::steady_clock::time_point baseTime;
+
+    /// @brief
+    ///   Mutex that is used to protect buffers and names.
+    mutable std::mutex mutex;
+};
+
+/// @brief
+///   Scoped trace span. The span is recorded to trace buffer of current thread when it ends.
+class TraceSpan {
+public:
+    /// @brief
+    ///   Start a span. Pass nullptr to create an inactive span.
+    ///
+    /// @param name         Name of the span. Must outlive the trace system.
+    /// @param argument     User defined argument of the span.
+    explicit TraceSpan(const char *name, uint64_t argument = 0) noexcept
+        : name(name), argument(argument), start(name == nullptr ? 0 : ReadTraceClock()) {}
+
+    /// @brief
+    ///   Copy constructor is disabled.
+    TraceSpan(const TraceSpan &) = delete;
+
+    /// @brief
+    ///   Copy assignment is disabled.
+    auto operator=(const TraceSpan &) = delete;
+
+    /// @brief
+    ///   End this span.
+    ~TraceSpan() noexcept {
+        if (name != nullptr)
+            TraceSystem::LocalBuffer().Push(name, start, ReadTraceClock(), argument);
+    }
+
+private:
+    /// @brief
+    ///   Name of the span. nullptr if tracing is disabled when the span starts.
+    const char *name;
+
+    /// @brief
+    ///   User defined argument of the span.
+    uint64_t argument;
+
+    /// @brief
+    ///   Start tick of the span.
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+
+/// @brief
+///   Trace current scope. @p name is only evaluated if tracing is enabled.
+#if TRACE_COMPILE_ENABLED
+#    define TRACE_SPAN(name)                                                                       \
+        TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(TraceSystem::IsEnabled() ? (name) : nullptr)
+#    define TRACE_SPAN_ARG(name, argument)                                                         \
+        TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(                                               \
+            TraceSystem::IsEnabled() ? (name) : nullptr, static_cast<uint64_t>(argument))
+#else
+#    define TRACE_SPAN(name)               ((void)0)
+#    define TRACE_SPAN_ARG(name, argument) ((void)0)
+#endif